@@ -35,6 +35,7 @@ For discussion please visit http://box2d.org/forum
 #include "Box2D/Common/b2Settings.h"
 #include "Box2D/Common/b2Draw.h"
 #include "Box2D/Common/b2Timer.h"
+#include "Box2D/Common/b2Snapshot.h"
 
 #include "Box2D/Collision/Shapes/b2CircleShape.h"
 #include "Box2D/Collision/Shapes/b2EdgeShape.h"
@@ -67,5 +68,6 @@ For discussion please visit http://box2d.org/forum
 #include "Box2D/Dynamics/Joints/b2WheelJoint.h"
 
 #include "Box2D/MT/b2ThreadPool.h"
+#include "Box2D/MT/b2Tracer.h"
 
 #endif
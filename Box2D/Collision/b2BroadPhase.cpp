@@ -18,15 +18,12 @@
 */
 
 #include "Box2D/Collision/b2BroadPhase.h"
+#include "Box2D/Common/b2Snapshot.h"
 
 b2BroadPhase::b2BroadPhase()
 {
 	m_proxyCount = 0;
-
-	for (int32 i = 0; i < b2_maxThreads; ++i)
-	{
-		m_perThreadData[i].m_queryProxyId = -1;
-	}
+	m_separateStaticTree = false;
 }
 
 b2BroadPhase::~b2BroadPhase()
@@ -43,6 +40,26 @@ void b2BroadPhase::Reset(float32 subTreeWidth, float32 subTreeHeight)
 }
 #endif
 
+void b2BroadPhase::SetThreadCount(uint32 threadCount)
+{
+	if (threadCount != m_perThreadData.size())
+	{
+		m_perThreadData.resize(threadCount);
+	}
+#ifdef b2_dynamicTreeOfTrees
+	m_tree.SetThreadCount(threadCount);
+#endif
+}
+
+void b2BroadPhase::Reserve(int32 proxyCount, int32 pairCount)
+{
+	m_moveBuffer.reserve(proxyCount);
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		m_perThreadData[i].m_pairBuffer.reserve(pairCount);
+	}
+}
+
 int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 {
 	int32 proxyId = m_tree.CreateProxy(aabb, userData);
@@ -51,22 +68,97 @@ int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 	return proxyId;
 }
 
+int32 b2BroadPhase::CreateStaticProxy(const b2AABB& aabb, void* userData)
+{
+	if (m_separateStaticTree == false)
+	{
+		return CreateProxy(aabb, userData);
+	}
+
+	int32 proxyId = m_staticTree.CreateProxy(aabb, userData) | e_staticProxyFlag;
+	++m_proxyCount;
+	BufferMove(proxyId);
+	return proxyId;
+}
+
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
 	--m_proxyCount;
+	if (IsStaticProxy(proxyId))
+	{
+		m_staticTree.DestroyProxy(proxyId & ~e_staticProxyFlag);
+		return;
+	}
 	m_tree.DestroyProxy(proxyId);
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	bool buffer;
+	if (IsStaticProxy(proxyId))
+	{
+		buffer = m_staticTree.MoveProxy(proxyId & ~e_staticProxyFlag, aabb, displacement);
+	}
+	else
+	{
+		buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	}
 	if (buffer)
 	{
 		BufferMove(proxyId);
 	}
 }
 
+void b2BroadPhase::SetSeparateStaticTree(bool flag)
+{
+	b2Assert(m_proxyCount == 0);
+	m_separateStaticTree = flag;
+}
+
+#ifndef b2_dynamicTreeOfTrees
+void b2BroadPhase::SetUserData(int32 proxyId, void* userData)
+{
+	if (IsStaticProxy(proxyId))
+	{
+		m_staticTree.SetUserData(proxyId & ~e_staticProxyFlag, userData);
+		return;
+	}
+	m_tree.SetUserData(proxyId, userData);
+}
+
+void b2BroadPhase::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_separateStaticTree);
+	stream.Transfer(m_proxyCount);
+
+	int32 moveCount = m_moveBuffer.size();
+	stream.Transfer(moveCount);
+	if (stream.IsReading())
+	{
+		if (stream.CanRead(moveCount, sizeof(int32)) == false)
+		{
+			return;
+		}
+		m_moveBuffer.clear();
+		m_moveBuffer.reserve(moveCount);
+		for (int32 i = 0; i < moveCount; ++i)
+		{
+			m_moveBuffer.push_back(e_nullProxy);
+		}
+	}
+	stream.TransferArray(m_moveBuffer.data(), moveCount);
+
+	m_tree.TransferState(stream);
+	m_staticTree.TransferState(stream);
+}
+#endif
+
+void b2BroadPhase::RebuildStaticTree(b2TaskExecutor& executor)
+{
+	m_staticTree.RebuildTopDown(executor);
+}
+
 void b2BroadPhase::TouchProxy(int32 proxyId)
 {
 	BufferMove(proxyId);
@@ -91,6 +183,8 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 // This is called from b2DynamicTree::Query when we are gathering pairs.
 bool b2BroadPhasePerThreadData::QueryCallback(int32 proxyId)
 {
+	proxyId |= m_queryTreeFlag;
+
 	// A proxy cannot form a pair with itself.
 	if (proxyId == m_queryProxyId)
 	{
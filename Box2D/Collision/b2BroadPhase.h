@@ -23,12 +23,15 @@
 #include "Box2D/Collision/b2Collision.h"
 #ifdef b2_dynamicTreeOfTrees
 #include "Box2D/MT/b2DynamicTreeOfTrees.h"
-#else
-#include "Box2D/Collision/b2DynamicTree.h"
 #endif
+#include "Box2D/Collision/b2DynamicTree.h"
 #include "Box2D/Common/b2GrowableArray.h"
+#include "Box2D/MT/b2ThreadDataArray.h"
 #include <algorithm>
 
+class b2TaskExecutor;
+class b2SnapshotStream;
+
 struct b2Pair
 {
 	int32 proxyIdA;
@@ -37,24 +40,39 @@ struct b2Pair
 
 struct b2BroadPhasePerThreadData
 {
+	b2BroadPhasePerThreadData()
+		: m_queryProxyId(-1)
+		, m_queryTreeFlag(0)
+	{}
+
 	bool QueryCallback(int32 proxyId);
 
 	b2GrowableArray<b2Pair> m_pairBuffer;
 	int32 m_queryProxyId;
 
+	// Added to the node ids of the tree being queried to make proxy ids.
+	int32 m_queryTreeFlag;
+
 	uint8 m_padding[b2_cacheLineSize];
 };
 
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
+///
+/// Static proxies can optionally be kept in a separate tree (see SetSeparateStaticTree).
+/// Moving proxies then only query it, so it isn't modified while stepping, and re-inserting
+/// a moving proxy doesn't touch the nodes of static proxies.
 class b2BroadPhase
 {
 public:
 
 	enum
 	{
-		e_nullProxy = -1
+		e_nullProxy = -1,
+
+		// Set in the ids of proxies in the static tree.
+		e_staticProxyFlag = 0x40000000
 	};
 
 	b2BroadPhase();
@@ -67,12 +85,24 @@ public:
 	/// Visit every leaf in the base tree.
 	template <typename T>
 	void VisitBaseTree(T* callback) const;
+
+	/// Get the sub-tree that a proxy can be moved within, or b2_nullNode if it can't be moved
+	/// within one sub-tree. See b2DynamicTreeOfTrees::GetMoveSubTree.
+	int32 GetMoveSubTree(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement, b2AABB* fatAABB) const;
+
+	/// Move a proxy within its sub-tree. This can be called from multiple threads for proxies
+	/// in different sub-trees. The proxy must be touched afterwards so that its pairs are updated.
+	void MoveProxyInSubTree(int32 proxyId, const b2AABB& fatAABB);
 #endif
 
 	/// Create a proxy with an initial AABB. Pairs are not reported until
 	/// UpdatePairs is called.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create a proxy for a fixture of a static body. This is the same as CreateProxy unless
+	/// static proxies are kept in a separate tree.
+	int32 CreateStaticProxy(const b2AABB& aabb, void* userData);
+
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
 
@@ -95,6 +125,18 @@ public:
 	/// Get the number of proxies.
 	int32 GetProxyCount() const;
 
+	/// Keep static proxies in a separate tree. Static proxies only pair with proxies in the
+	/// other tree, which are never static. This must be set while there are no proxies.
+	void SetSeparateStaticTree(bool flag);
+	bool GetSeparateStaticTree() const;
+
+	/// Is the proxy in the static tree?
+	bool IsStaticProxy(int32 proxyId) const;
+
+	/// Rebuild the static tree with b2DynamicTree::RebuildTopDown. Useful after creating
+	/// the static proxies of a level.
+	void RebuildStaticTree(b2TaskExecutor& executor);
+
 	/// Update the pairs. This results in pair callbacks. This can only add pairs.
 	/// Note: This can be called from multiple threads on separate ranges of the
 	/// move buffer. After all threads have finished, ResetBuffers must be called
@@ -126,6 +168,15 @@ public:
 	/// Get the quality metric of the embedded tree.
 	float32 GetTreeQuality() const;
 
+	/// Get the height of the static tree.
+	int32 GetStaticTreeHeight() const;
+
+	/// Get the balance of the static tree.
+	int32 GetStaticTreeBalance() const;
+
+	/// Get the quality metric of the static tree.
+	float32 GetStaticTreeQuality() const;
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -137,6 +188,23 @@ public:
 	/// Get the number of proxies in the move buffer.
 	int32 GetMoveCount() const;
 
+	/// Set the number of threads that can update pairs and query the broad-phase.
+	/// @warning must not be called while the broad-phase is being used by other threads.
+	void SetThreadCount(uint32 threadCount);
+
+	/// Make room for proxyCount moved proxies, and for pairCount pairs in the pair buffer of
+	/// every thread, so that updating pairs doesn't allocate.
+	void Reserve(int32 proxyCount, int32 pairCount);
+
+#ifndef b2_dynamicTreeOfTrees
+	/// Set the user data of a proxy.
+	void SetUserData(int32 proxyId, void* userData);
+
+	/// Read or write the trees and the move buffer, so that proxy ids are kept. User data isn't
+	/// stored, and must be set with SetUserData after reading.
+	void TransferState(b2SnapshotStream& stream);
+#endif
+
 private:
 
 	friend class b2DynamicTree;
@@ -149,10 +217,14 @@ private:
 	b2DynamicTree m_tree;
 #endif
 
+	// Static proxies when m_separateStaticTree is set.
+	b2DynamicTree m_staticTree;
+	bool m_separateStaticTree;
+
 	int32 m_proxyCount;
 	b2GrowableArray<int32> m_moveBuffer;
 
-	b2BroadPhasePerThreadData m_perThreadData[b2_maxThreads];
+	b2ThreadDataArray<b2BroadPhasePerThreadData> m_perThreadData;
 };
 
 /// This is used to sort pairs.
@@ -171,20 +243,34 @@ inline bool b2PairLessThan(const b2Pair& pair1, const b2Pair& pair2)
 	return false;
 }
 
+inline bool b2BroadPhase::IsStaticProxy(int32 proxyId) const
+{
+	b2Assert(proxyId != e_nullProxy);
+	return (proxyId & e_staticProxyFlag) != 0;
+}
+
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
+	if (IsStaticProxy(proxyId))
+	{
+		return m_staticTree.GetUserData(proxyId & ~e_staticProxyFlag);
+	}
 	return m_tree.GetUserData(proxyId);
 }
 
 inline bool b2BroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB) const
 {
-	const b2AABB& aabbA = m_tree.GetFatAABB(proxyIdA);
-	const b2AABB& aabbB = m_tree.GetFatAABB(proxyIdB);
+	const b2AABB& aabbA = GetFatAABB(proxyIdA);
+	const b2AABB& aabbB = GetFatAABB(proxyIdB);
 	return b2TestOverlap(aabbA, aabbB);
 }
 
 inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
+	if (IsStaticProxy(proxyId))
+	{
+		return m_staticTree.GetFatAABB(proxyId & ~e_staticProxyFlag);
+	}
 	return m_tree.GetFatAABB(proxyId);
 }
 
@@ -193,6 +279,11 @@ inline int32 b2BroadPhase::GetProxyCount() const
 	return m_proxyCount;
 }
 
+inline bool b2BroadPhase::GetSeparateStaticTree() const
+{
+	return m_separateStaticTree;
+}
+
 inline int32 b2BroadPhase::GetTreeHeight() const
 {
 	return m_tree.GetHeight();
@@ -208,10 +299,25 @@ inline float32 b2BroadPhase::GetTreeQuality() const
 	return m_tree.GetAreaRatio();
 }
 
+inline int32 b2BroadPhase::GetStaticTreeHeight() const
+{
+	return m_staticTree.GetHeight();
+}
+
+inline int32 b2BroadPhase::GetStaticTreeBalance() const
+{
+	return m_staticTree.GetMaxBalance();
+}
+
+inline float32 b2BroadPhase::GetStaticTreeQuality() const
+{
+	return m_staticTree.GetAreaRatio();
+}
+
 template <typename T>
 void b2BroadPhase::UpdatePairs(int32 moveBegin, int32 moveEnd, T* callback, uint32 threadId)
 {
-	b2BroadPhasePerThreadData* td = m_perThreadData + threadId;
+	b2BroadPhasePerThreadData* td = &m_perThreadData[threadId];
 
 	// Perform tree queries for all moving proxies.
 	for (int32 i = moveBegin; i < moveEnd; ++i)
@@ -224,14 +330,22 @@ void b2BroadPhase::UpdatePairs(int32 moveBegin, int32 moveEnd, T* callback, uint
 
 		// We have to query the tree with the fat AABB so that
 		// we don't fail to create a pair that may touch later.
-		b2AABB fatAABB = m_tree.GetFatAABB(td->m_queryProxyId);
+		b2AABB fatAABB = GetFatAABB(td->m_queryProxyId);
 
 		// Query the tree, create pairs and add them pair buffer.
+		td->m_queryTreeFlag = 0;
 #ifdef b2_dynamicTreeOfTrees
 		m_tree.Query(td, fatAABB, threadId);
 #else
 		m_tree.Query(td, fatAABB);
 #endif
+
+		// Static proxies don't pair with each other.
+		if (m_separateStaticTree && IsStaticProxy(td->m_queryProxyId) == false)
+		{
+			td->m_queryTreeFlag = e_staticProxyFlag;
+			m_staticTree.Query(td, fatAABB);
+		}
 	}
 
 	// Sort the pair buffer to expose duplicates.
@@ -243,8 +357,8 @@ void b2BroadPhase::UpdatePairs(int32 moveBegin, int32 moveEnd, T* callback, uint
 	{
 		b2Pair& primaryPair = td->m_pairBuffer[i];
 
-		void* userDataA = m_tree.GetUserData(primaryPair.proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair.proxyIdB);
+		void* userDataA = GetUserData(primaryPair.proxyIdA);
+		void* userDataB = GetUserData(primaryPair.proxyIdB);
 
 		callback->AddPair(userDataA, userDataB, threadId);
 
@@ -266,9 +380,59 @@ void b2BroadPhase::UpdatePairs(int32 moveBegin, int32 moveEnd, T* callback, uint
 	//m_tree.Rebalance(4);
 }
 
+// Passes static tree hits to a query callback with static proxy ids, and records whether
+// the callback ended the query.
+template <typename T>
+struct b2StaticTreeQueryCallback
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		proceed = callback->QueryCallback(proxyId | b2BroadPhase::e_staticProxyFlag);
+		return proceed;
+	}
+
+	T* callback;
+	bool proceed;
+};
+
+// Records how a ray-cast callback clipped or ended the ray, and passes static tree hits
+// to it with static proxy ids.
+template <typename T>
+struct b2RayCastClipCallback
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		float32 value = callback->RayCastCallback(input, proxyId | proxyFlag);
+		if (value == 0.0f)
+		{
+			terminated = true;
+		}
+		else if (value > 0.0f)
+		{
+			maxFraction = value;
+		}
+		return value;
+	}
+
+	T* callback;
+	int32 proxyFlag;
+	float32 maxFraction;
+	bool terminated;
+};
+
 template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb, uint32 threadId)
 {
+	if (m_separateStaticTree)
+	{
+		b2StaticTreeQueryCallback<T> staticCallback = { callback, true };
+		m_staticTree.Query(&staticCallback, aabb);
+		if (staticCallback.proceed == false)
+		{
+			return;
+		}
+	}
+
 #ifdef b2_dynamicTreeOfTrees
 	m_tree.Query(callback, aabb, threadId);
 #else
@@ -280,6 +444,27 @@ inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb, uint32 threadId
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input, uint32 threadId)
 {
+	if (m_separateStaticTree)
+	{
+		// Cast against the static tree first, then continue with the clipped ray.
+		b2RayCastClipCallback<T> clipCallback = { callback, e_staticProxyFlag, input.maxFraction, false };
+		m_staticTree.RayCast(&clipCallback, input);
+		if (clipCallback.terminated)
+		{
+			return;
+		}
+
+		b2RayCastInput clippedInput = input;
+		clippedInput.maxFraction = clipCallback.maxFraction;
+#ifdef b2_dynamicTreeOfTrees
+		m_tree.RayCast(callback, clippedInput, threadId);
+#else
+		B2_NOT_USED(threadId);
+		m_tree.RayCast(callback, clippedInput);
+#endif
+		return;
+	}
+
 #ifdef b2_dynamicTreeOfTrees
 	m_tree.RayCast(callback, input, threadId);
 #else
@@ -294,18 +479,34 @@ inline void b2BroadPhase::VisitBaseTree(T* callback) const
 {
 	m_tree.VisitBaseTree(callback);
 }
+
+inline int32 b2BroadPhase::GetMoveSubTree(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement,
+	b2AABB* fatAABB) const
+{
+	if (IsStaticProxy(proxyId))
+	{
+		return b2_nullNode;
+	}
+	return m_tree.GetMoveSubTree(proxyId, aabb, displacement, fatAABB);
+}
+
+inline void b2BroadPhase::MoveProxyInSubTree(int32 proxyId, const b2AABB& fatAABB)
+{
+	m_tree.MoveProxyInSubTree(proxyId, fatAABB);
+}
 #endif
 
 inline void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_tree.ShiftOrigin(newOrigin);
+	m_staticTree.ShiftOrigin(newOrigin);
 }
 
 inline void b2BroadPhase::ResetBuffers()
 {
 	m_moveBuffer.clear();
 
-	for (int32 i = 0; i < b2_maxThreads; ++i)
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
 	{
 		m_perThreadData[i].m_pairBuffer.clear();
 	}
@@ -18,6 +18,7 @@
 
 #include "Box2D/Collision/b2Collision.h"
 #include "Box2D/Collision/Shapes/b2PolygonShape.h"
+#include "Box2D/Common/b2WideMath.h"
 
 // Find the max separation between poly1 and poly2 using edge normals from poly1.
 static float32 b2FindMaxSeparation(int32* edgeIndex,
@@ -112,24 +113,13 @@ static void b2FindIncidentEdge(b2ClipVertex c[2],
 // Find incident edge
 // Clip
 
-// The normal points from 1 to 2
-void b2CollidePolygons(b2Manifold* manifold,
-					  const b2PolygonShape* polyA, const b2Transform& xfA,
-					  const b2PolygonShape* polyB, const b2Transform& xfB)
+// Choose the reference edge and clip, given the max separations of both polygons.
+static void b2ClipPolygons(b2Manifold* manifold,
+						   const b2PolygonShape* polyA, const b2Transform& xfA, int32 edgeA, float32 separationA,
+						   const b2PolygonShape* polyB, const b2Transform& xfB, int32 edgeB, float32 separationB)
 {
-	manifold->pointCount = 0;
 	float32 totalRadius = polyA->m_radius + polyB->m_radius;
 
-	int32 edgeA = 0;
-	float32 separationA = b2FindMaxSeparation(&edgeA, polyA, xfA, polyB, xfB);
-	if (separationA > totalRadius)
-		return;
-
-	int32 edgeB = 0;
-	float32 separationB = b2FindMaxSeparation(&edgeB, polyB, xfB, polyA, xfA);
-	if (separationB > totalRadius)
-		return;
-
 	const b2PolygonShape* poly1;	// reference polygon
 	const b2PolygonShape* poly2;	// incident polygon
 	b2Transform xf1, xf2;
@@ -237,3 +227,189 @@ void b2CollidePolygons(b2Manifold* manifold,
 
 	manifold->pointCount = pointCount;
 }
+
+// The normal points from 1 to 2
+void b2CollidePolygons(b2Manifold* manifold,
+					  const b2PolygonShape* polyA, const b2Transform& xfA,
+					  const b2PolygonShape* polyB, const b2Transform& xfB)
+{
+	manifold->pointCount = 0;
+	float32 totalRadius = polyA->m_radius + polyB->m_radius;
+
+	int32 edgeA = 0;
+	float32 separationA = b2FindMaxSeparation(&edgeA, polyA, xfA, polyB, xfB);
+	if (separationA > totalRadius)
+		return;
+
+	int32 edgeB = 0;
+	float32 separationB = b2FindMaxSeparation(&edgeB, polyB, xfB, polyA, xfA);
+	if (separationB > totalRadius)
+		return;
+
+	b2ClipPolygons(manifold, polyA, xfA, edgeA, separationA, polyB, xfB, edgeB, separationB);
+}
+
+// Up to b2_wideLaneCount polygons stored so that each vertex and normal of every polygon is
+// in one wide value. Unused lanes repeat the first polygon. Polygons with fewer vertices than
+// the largest one repeat their first vertex and normal. A repeated value never wins the strict
+// comparisons in b2FindMaxSeparationWide, so the results are the same as without padding.
+struct b2PolygonLanes
+{
+	b2FloatW vx[b2_maxPolygonVertices];
+	b2FloatW vy[b2_maxPolygonVertices];
+	b2FloatW nx[b2_maxPolygonVertices];
+	b2FloatW ny[b2_maxPolygonVertices];
+	int32 count;
+};
+
+static void b2GatherPolygonLanes(b2PolygonLanes* lanes, const b2PolygonShape* const* polygons, int32 count)
+{
+	static_assert(b2_wideLaneCount == 4, "Gathering assumes four lanes");
+
+	const b2PolygonShape* p0 = polygons[0];
+	const b2PolygonShape* p1 = polygons[count > 1 ? 1 : 0];
+	const b2PolygonShape* p2 = polygons[count > 2 ? 2 : 0];
+	const b2PolygonShape* p3 = polygons[count > 3 ? 3 : 0];
+
+	int32 maxCount = b2Max(b2Max(p0->m_count, p1->m_count), b2Max(p2->m_count, p3->m_count));
+	for (int32 i = 0; i < maxCount; ++i)
+	{
+		const b2Vec2& v0 = p0->m_vertices[i < p0->m_count ? i : 0];
+		const b2Vec2& v1 = p1->m_vertices[i < p1->m_count ? i : 0];
+		const b2Vec2& v2 = p2->m_vertices[i < p2->m_count ? i : 0];
+		const b2Vec2& v3 = p3->m_vertices[i < p3->m_count ? i : 0];
+		lanes->vx[i] = b2SetW(v0.x, v1.x, v2.x, v3.x);
+		lanes->vy[i] = b2SetW(v0.y, v1.y, v2.y, v3.y);
+
+		const b2Vec2& n0 = p0->m_normals[i < p0->m_count ? i : 0];
+		const b2Vec2& n1 = p1->m_normals[i < p1->m_count ? i : 0];
+		const b2Vec2& n2 = p2->m_normals[i < p2->m_count ? i : 0];
+		const b2Vec2& n3 = p3->m_normals[i < p3->m_count ? i : 0];
+		lanes->nx[i] = b2SetW(n0.x, n1.x, n2.x, n3.x);
+		lanes->ny[i] = b2SetW(n0.y, n1.y, n2.y, n3.y);
+	}
+
+	lanes->count = maxCount;
+}
+
+// b2FindMaxSeparation for one polygon pair per lane, where xf holds b2MulT(xf2, xf1) of each pair.
+// Each lane does the same operations in the same order as the scalar version.
+static void b2FindMaxSeparationWide(int32* edgeIndices, float32* separations,
+									const b2PolygonLanes& poly1, const b2PolygonLanes& poly2,
+									b2FloatW c, b2FloatW s, b2FloatW tx, b2FloatW ty)
+{
+	b2FloatW bestIndex = b2ZeroW();
+	b2FloatW maxSeparation = b2SplatW(-b2_maxFloat);
+	for (int32 i = 0; i < poly1.count; ++i)
+	{
+		// Get poly1 normal in frame2.
+		b2FloatW nx = poly1.nx[i];
+		b2FloatW ny = poly1.ny[i];
+		b2FloatW normalX = b2SubW(b2MulW(c, nx), b2MulW(s, ny));
+		b2FloatW normalY = b2AddW(b2MulW(s, nx), b2MulW(c, ny));
+
+		b2FloatW vx = poly1.vx[i];
+		b2FloatW vy = poly1.vy[i];
+		b2FloatW v1x = b2AddW(b2SubW(b2MulW(c, vx), b2MulW(s, vy)), tx);
+		b2FloatW v1y = b2AddW(b2AddW(b2MulW(s, vx), b2MulW(c, vy)), ty);
+
+		// Find deepest point for normal i.
+		b2FloatW si = b2SplatW(b2_maxFloat);
+		for (int32 j = 0; j < poly2.count; ++j)
+		{
+			b2FloatW dx = b2SubW(poly2.vx[j], v1x);
+			b2FloatW dy = b2SubW(poly2.vy[j], v1y);
+			b2FloatW sij = b2AddW(b2MulW(normalX, dx), b2MulW(normalY, dy));
+			si = b2SelectW(b2LessW(sij, si), sij, si);
+		}
+
+		b2MaskW better = b2GreaterW(si, maxSeparation);
+		maxSeparation = b2SelectW(better, si, maxSeparation);
+		bestIndex = b2SelectW(better, b2SplatW(float32(i)), bestIndex);
+	}
+
+	float32 indices[b2_wideLaneCount];
+	b2StoreW(indices, bestIndex);
+	b2StoreW(separations, maxSeparation);
+	for (int32 k = 0; k < b2_wideLaneCount; ++k)
+	{
+		edgeIndices[k] = int32(indices[k]);
+	}
+}
+
+void b2CollidePolygonsWide(b2Manifold* manifolds,
+						   const b2PolygonShape* const* polysA, const b2Transform* xfsA,
+						   const b2PolygonShape* const* polysB, const b2Transform* xfsB,
+						   int32 count)
+{
+	b2Assert(0 < count && count <= b2_wideLaneCount);
+
+	b2PolygonLanes lanesA, lanesB;
+	b2GatherPolygonLanes(&lanesA, polysA, count);
+	b2GatherPolygonLanes(&lanesB, polysB, count);
+
+	// Relative transforms of each pair, with unused lanes repeating the first pair.
+	b2Transform xfsAB[b2_wideLaneCount];
+	float32 totalRadii[b2_wideLaneCount];
+	for (int32 k = 0; k < b2_wideLaneCount; ++k)
+	{
+		int32 pair = k < count ? k : 0;
+		xfsAB[k] = b2MulT(xfsB[pair], xfsA[pair]);
+		totalRadii[k] = polysA[pair]->m_radius + polysB[pair]->m_radius;
+	}
+
+	int32 edgesA[b2_wideLaneCount];
+	float32 separationsA[b2_wideLaneCount];
+	b2FindMaxSeparationWide(edgesA, separationsA, lanesA, lanesB,
+		b2SetW(xfsAB[0].q.c, xfsAB[1].q.c, xfsAB[2].q.c, xfsAB[3].q.c),
+		b2SetW(xfsAB[0].q.s, xfsAB[1].q.s, xfsAB[2].q.s, xfsAB[3].q.s),
+		b2SetW(xfsAB[0].p.x, xfsAB[1].p.x, xfsAB[2].p.x, xfsAB[3].p.x),
+		b2SetW(xfsAB[0].p.y, xfsAB[1].p.y, xfsAB[2].p.y, xfsAB[3].p.y));
+
+	// Like the scalar version, skip the second search when every pair is already separated.
+	bool separated = true;
+	for (int32 k = 0; k < count; ++k)
+	{
+		separated = separated && separationsA[k] > totalRadii[k];
+	}
+
+	if (separated)
+	{
+		for (int32 k = 0; k < count; ++k)
+		{
+			manifolds[k].pointCount = 0;
+		}
+		return;
+	}
+
+	b2Transform xfsBA[b2_wideLaneCount];
+	for (int32 k = 0; k < b2_wideLaneCount; ++k)
+	{
+		int32 pair = k < count ? k : 0;
+		xfsBA[k] = b2MulT(xfsA[pair], xfsB[pair]);
+	}
+
+	int32 edgesB[b2_wideLaneCount];
+	float32 separationsB[b2_wideLaneCount];
+	b2FindMaxSeparationWide(edgesB, separationsB, lanesB, lanesA,
+		b2SetW(xfsBA[0].q.c, xfsBA[1].q.c, xfsBA[2].q.c, xfsBA[3].q.c),
+		b2SetW(xfsBA[0].q.s, xfsBA[1].q.s, xfsBA[2].q.s, xfsBA[3].q.s),
+		b2SetW(xfsBA[0].p.x, xfsBA[1].p.x, xfsBA[2].p.x, xfsBA[3].p.x),
+		b2SetW(xfsBA[0].p.y, xfsBA[1].p.y, xfsBA[2].p.y, xfsBA[3].p.y));
+
+	// Clipping is branchy and only needed by touching pairs, so it's done one pair at a time.
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2Manifold* manifold = manifolds + k;
+		manifold->pointCount = 0;
+
+		if (separationsA[k] > totalRadii[k])
+			continue;
+
+		if (separationsB[k] > totalRadii[k])
+			continue;
+
+		b2ClipPolygons(manifold, polysA[k], xfsA[k], edgesA[k], separationsA[k],
+			polysB[k], xfsB[k], edgesB[k], separationsB[k]);
+	}
+}
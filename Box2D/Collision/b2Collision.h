@@ -241,6 +241,14 @@ void b2CollidePolygons(b2Manifold* manifold,
 					   const b2PolygonShape* polygonA, const b2Transform& xfA,
 					   const b2PolygonShape* polygonB, const b2Transform& xfB);
 
+/// Compute the collision manifolds between up to b2_wideLaneCount pairs of polygons at once.
+/// The separating axis tests of all pairs are done together in SIMD lanes. Each manifold is
+/// identical to the one computed by b2CollidePolygons.
+void b2CollidePolygonsWide(b2Manifold* manifolds,
+						   const b2PolygonShape* const* polygonsA, const b2Transform* xfsA,
+						   const b2PolygonShape* const* polygonsB, const b2Transform* xfsB,
+						   int32 count);
+
 /// Compute the collision manifold between an edge and a circle.
 void b2CollideEdgeAndCircle(b2Manifold* manifold,
 							   const b2EdgeShape* polygonA, const b2Transform& xfA,
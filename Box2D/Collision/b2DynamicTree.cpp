@@ -17,6 +17,11 @@
 */
 
 #include "Box2D/Collision/b2DynamicTree.h"
+#include "Box2D/Common/b2GrowableArray.h"
+#include "Box2D/Common/b2Snapshot.h"
+#include "Box2D/MT/b2MtUtil.h"
+#include "Box2D/MT/b2TaskExecutor.h"
+#include <algorithm>
 #include <string.h>
 
 b2DynamicTree::b2DynamicTree()
@@ -118,6 +123,37 @@ int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	return proxyId;
 }
 
+void b2DynamicTree::CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData, int32 count)
+{
+	CreateLeaves(proxyIds, aabbs, userData, count);
+	RebuildTopDown();
+}
+
+void b2DynamicTree::CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData, int32 count,
+								  b2TaskExecutor& executor)
+{
+	CreateLeaves(proxyIds, aabbs, userData, count);
+	RebuildTopDown(executor);
+}
+
+// Create leaves that aren't in the tree yet.
+void b2DynamicTree::CreateLeaves(int32* proxyIds, const b2AABB* aabbs, void* const* userData, int32 count)
+{
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = AllocateNode();
+
+		// Fatten the aabb.
+		b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+		m_nodes[proxyId].aabb.lowerBound = aabbs[i].lowerBound - r;
+		m_nodes[proxyId].aabb.upperBound = aabbs[i].upperBound + r;
+		m_nodes[proxyId].userData = userData[i];
+		m_nodes[proxyId].height = 0;
+
+		proxyIds[i] = proxyId;
+	}
+}
+
 void b2DynamicTree::DestroyProxy(int32 proxyId)
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
@@ -769,6 +805,432 @@ void b2DynamicTree::RebuildBottomUp()
 	Validate();
 }
 
+// The number of bins that split candidates are evaluated at.
+#define b2_treeBuildBinCount 16
+
+// Deeper ranges are split at their median, which bounds the height of the tree.
+#define b2_treeBuildMaxSahDepth 64
+
+// A leaf being sorted into the tree by RebuildTopDown.
+struct b2TreeBuildLeaf
+{
+	b2AABB aabb;
+	b2Vec2 center;
+	int32 node;
+	int32 bin;
+};
+
+// The bounds of a range of leaves.
+struct b2TreeBuildBounds
+{
+	// The union of the leaf AABBs.
+	b2AABB aabb;
+
+	// The bounds of the leaf centers.
+	b2AABB centers;
+};
+
+// A range of leaves at the top of the tree.
+struct b2TreeBuildRange
+{
+	int32 begin;
+	int32 end;
+	int32 depth;
+	b2TreeBuildBounds bounds;
+
+	// The node that the range's sub-tree is a child of, and which child it is.
+	int32 parent;
+	bool isChild1;
+};
+
+// A range of leaves whose sub-tree is built by a task.
+struct b2TreeBuildJob
+{
+	b2TreeBuildRange range;
+	int32 root;
+};
+
+static void b2AddBounds(b2TreeBuildBounds* bounds, const b2TreeBuildBounds& other, bool isFirst)
+{
+	if (isFirst)
+	{
+		*bounds = other;
+	}
+	else
+	{
+		bounds->aabb.Combine(other.aabb);
+		bounds->centers.Combine(other.centers);
+	}
+}
+
+static b2TreeBuildBounds b2ComputeLeafBounds(const b2TreeBuildLeaf* leaves, int32 begin, int32 end)
+{
+	b2TreeBuildBounds bounds;
+	bounds.aabb = leaves[begin].aabb;
+	bounds.centers.lowerBound = leaves[begin].center;
+	bounds.centers.upperBound = leaves[begin].center;
+	for (int32 i = begin + 1; i < end; ++i)
+	{
+		bounds.aabb.Combine(leaves[i].aabb);
+		bounds.centers.lowerBound = b2Min(bounds.centers.lowerBound, leaves[i].center);
+		bounds.centers.upperBound = b2Max(bounds.centers.upperBound, leaves[i].center);
+	}
+	return bounds;
+}
+
+// Partition the leaves of a range into two non-empty ranges and compute their bounds.
+// @return the index of the first leaf of the second range.
+static int32 b2PartitionLeaves(b2TreeBuildLeaf* leaves, int32 begin, int32 end, int32 depth,
+							   const b2TreeBuildBounds& bounds, b2TreeBuildBounds* bounds1, b2TreeBuildBounds* bounds2)
+{
+	b2Assert(end - begin >= 2);
+
+	// Split along the axis with the largest spread of centers.
+	b2Vec2 extents = bounds.centers.upperBound - bounds.centers.lowerBound;
+	int32 axis = extents.x >= extents.y ? 0 : 1;
+	float32 lower = axis == 0 ? bounds.centers.lowerBound.x : bounds.centers.lowerBound.y;
+	float32 extent = axis == 0 ? extents.x : extents.y;
+
+	if (extent <= 0.0f || depth >= b2_treeBuildMaxSahDepth)
+	{
+		// Split at the median center. Coincident centers are split in half by index.
+		int32 mid = begin + (end - begin) / 2;
+		std::nth_element(leaves + begin, leaves + mid, leaves + end,
+			[axis](const b2TreeBuildLeaf& a, const b2TreeBuildLeaf& b)
+			{
+				float32 ca = axis == 0 ? a.center.x : a.center.y;
+				float32 cb = axis == 0 ? b.center.x : b.center.y;
+				return ca < cb || (ca == cb && a.node < b.node);
+			});
+		*bounds1 = b2ComputeLeafBounds(leaves, begin, mid);
+		*bounds2 = b2ComputeLeafBounds(leaves, mid, end);
+		return mid;
+	}
+
+	// Sort the leaves into bins by center. Small ranges use fewer bins.
+	int32 binCount = b2Min(end - begin, b2_treeBuildBinCount);
+	float32 scale = binCount * (1.0f - b2_epsilon) / extent;
+
+	int32 binCounts[b2_treeBuildBinCount] = {};
+	b2TreeBuildBounds binBounds[b2_treeBuildBinCount];
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2TreeBuildLeaf* leaf = leaves + i;
+		float32 center = axis == 0 ? leaf->center.x : leaf->center.y;
+		int32 bin = b2Min(int32(scale * (center - lower)), binCount - 1);
+		leaf->bin = bin;
+
+		b2TreeBuildBounds* b = binBounds + bin;
+		if (binCounts[bin] == 0)
+		{
+			b->aabb = leaf->aabb;
+			b->centers.lowerBound = leaf->center;
+			b->centers.upperBound = leaf->center;
+		}
+		else
+		{
+			b->aabb.Combine(leaf->aabb);
+			b->centers.lowerBound = b2Min(b->centers.lowerBound, leaf->center);
+			b->centers.upperBound = b2Max(b->centers.upperBound, leaf->center);
+		}
+		++binCounts[bin];
+	}
+
+	// Sweep from the right to get the cost of the right side of each split.
+	float32 rightCosts[b2_treeBuildBinCount];
+	int32 rightCount = 0;
+	b2AABB rightAABB;
+	for (int32 i = binCount - 1; i > 0; --i)
+	{
+		if (binCounts[i] > 0)
+		{
+			if (rightCount == 0)
+			{
+				rightAABB = binBounds[i].aabb;
+			}
+			else
+			{
+				rightAABB.Combine(binBounds[i].aabb);
+			}
+			rightCount += binCounts[i];
+		}
+		rightCosts[i] = rightCount > 0 ? rightCount * rightAABB.GetPerimeter() : 0.0f;
+	}
+
+	// Sweep from the left, splitting after bin i. The cost of a split is the perimeter of each
+	// side weighted by its leaf count.
+	int32 bestSplit = -1;
+	float32 bestCost = b2_maxFloat;
+	int32 leftCount = 0;
+	b2AABB leftAABB;
+	for (int32 i = 0; i < binCount - 1; ++i)
+	{
+		if (binCounts[i] > 0)
+		{
+			if (leftCount == 0)
+			{
+				leftAABB = binBounds[i].aabb;
+			}
+			else
+			{
+				leftAABB.Combine(binBounds[i].aabb);
+			}
+			leftCount += binCounts[i];
+		}
+
+		if (leftCount == 0 || leftCount == end - begin)
+		{
+			continue;
+		}
+
+		float32 cost = leftCount * leftAABB.GetPerimeter() + rightCosts[i + 1];
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = i;
+		}
+	}
+
+	b2Assert(bestSplit != -1);
+
+	int32 count1 = 0;
+	int32 count2 = 0;
+	for (int32 i = 0; i < binCount; ++i)
+	{
+		if (binCounts[i] == 0)
+		{
+			continue;
+		}
+
+		if (i <= bestSplit)
+		{
+			b2AddBounds(bounds1, binBounds[i], count1 == 0);
+			count1 += binCounts[i];
+		}
+		else
+		{
+			b2AddBounds(bounds2, binBounds[i], count2 == 0);
+			count2 += binCounts[i];
+		}
+	}
+
+	std::partition(leaves + begin, leaves + end,
+		[bestSplit](const b2TreeBuildLeaf& leaf)
+		{
+			return leaf.bin <= bestSplit;
+		});
+
+	return begin + count1;
+}
+
+// Build the sub-tree of leaves [begin, end) and return its root. The range owns the internal
+// nodes [begin, end - 1) and its root is the one before its split index, so that disjoint
+// ranges can be built at the same time and the tree doesn't depend on how the work is divided.
+int32 b2DynamicTree::BuildRange(b2TreeBuildLeaf* leaves, const int32* internalNodes, int32 begin, int32 end,
+								int32 depth, const b2TreeBuildBounds& bounds)
+{
+	if (end - begin == 1)
+	{
+		return leaves[begin].node;
+	}
+
+	b2TreeBuildBounds bounds1, bounds2;
+	int32 split = b2PartitionLeaves(leaves, begin, end, depth, bounds, &bounds1, &bounds2);
+
+	int32 child1 = BuildRange(leaves, internalNodes, begin, split, depth + 1, bounds1);
+	int32 child2 = BuildRange(leaves, internalNodes, split, end, depth + 1, bounds2);
+
+	int32 index = internalNodes[split - 1];
+	b2TreeNode* node = m_nodes + index;
+	node->aabb = bounds.aabb;
+	node->child1 = child1;
+	node->child2 = child2;
+	node->height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+	m_nodes[child1].parent = index;
+	m_nodes[child2].parent = index;
+	return index;
+}
+
+// Attach a node to its parent, or make it the root.
+void b2DynamicTree::LinkBuiltNode(int32 index, int32 parent, bool isChild1)
+{
+	m_nodes[index].parent = parent;
+	if (parent == b2_nullNode)
+	{
+		m_root = index;
+	}
+	else if (isChild1)
+	{
+		m_nodes[parent].child1 = index;
+	}
+	else
+	{
+		m_nodes[parent].child2 = index;
+	}
+}
+
+class b2BuildTreeTask : public b2RangeTask
+{
+public:
+	b2BuildTreeTask() {}
+
+	b2BuildTreeTask(const b2RangeTaskRange& range, b2DynamicTree* tree, b2TreeBuildLeaf* leaves,
+		const int32* internalNodes, b2TreeBuildJob* jobs)
+		: b2RangeTask(range)
+		, m_tree(tree)
+		, m_leaves(leaves)
+		, m_internalNodes(internalNodes)
+		, m_jobs(jobs)
+	{}
+
+	virtual b2Task::Type GetType() const override { return b2Task::e_buildTree; }
+
+	virtual void Execute(const b2ThreadContext&, const b2RangeTaskRange& range) override
+	{
+		for (uint32 i = range.begin; i < range.end; ++i)
+		{
+			b2TreeBuildJob& job = m_jobs[i];
+			const b2TreeBuildRange& r = job.range;
+			job.root = m_tree->BuildRange(m_leaves, m_internalNodes, r.begin, r.end, r.depth, r.bounds);
+		}
+	}
+
+private:
+	b2DynamicTree* m_tree;
+	b2TreeBuildLeaf* m_leaves;
+	const int32* m_internalNodes;
+	b2TreeBuildJob* m_jobs;
+};
+
+void b2DynamicTree::RebuildTopDown()
+{
+	BuildTopDown(nullptr);
+}
+
+void b2DynamicTree::RebuildTopDown(b2TaskExecutor& executor)
+{
+	BuildTopDown(&executor);
+}
+
+void b2DynamicTree::BuildTopDown(b2TaskExecutor* executor)
+{
+	b2TreeBuildLeaf* leaves = (b2TreeBuildLeaf*)b2Alloc(m_nodeCount * sizeof(b2TreeBuildLeaf));
+	int32 count = 0;
+
+	// Build array of leaves. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			b2TreeBuildLeaf* leaf = leaves + count;
+			leaf->aabb = m_nodes[i].aabb;
+			leaf->center = m_nodes[i].aabb.GetCenter();
+			leaf->node = i;
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	if (count == 0)
+	{
+		m_root = b2_nullNode;
+		b2Free(leaves);
+		return;
+	}
+
+	// A tree with n leaves has n - 1 internal nodes.
+	int32* internalNodes = (int32*)b2Alloc((count - 1) * sizeof(int32));
+	for (int32 i = 0; i < count - 1; ++i)
+	{
+		internalNodes[i] = AllocateNode();
+	}
+
+	// Split the top of the tree on this thread until the ranges are small enough to be
+	// spread across the threads.
+	uint32 threadCount = executor ? executor->GetThreadCount() : 1;
+	int32 maxJobSize = b2Max(count / int32(4 * threadCount), 1024);
+	b2TreeBuildBounds bounds = b2ComputeLeafBounds(leaves, 0, count);
+	if (threadCount == 1 || count <= maxJobSize)
+	{
+		m_root = BuildRange(leaves, internalNodes, 0, count, 0, bounds);
+	}
+	else
+	{
+		b2GrowableArray<b2TreeBuildRange> ranges;
+		b2GrowableArray<b2TreeBuildJob> jobs;
+		b2GrowableArray<int32> topNodes;
+		ranges.push_back({ 0, count, 0, bounds, b2_nullNode, true });
+		while (ranges.size() > 0)
+		{
+			b2TreeBuildRange range = ranges.pop_back();
+
+			if (range.end - range.begin <= maxJobSize)
+			{
+				jobs.push_back({ range, b2_nullNode });
+				continue;
+			}
+
+			b2TreeBuildBounds bounds1, bounds2;
+			int32 split = b2PartitionLeaves(leaves, range.begin, range.end, range.depth, range.bounds, &bounds1, &bounds2);
+
+			int32 index = internalNodes[split - 1];
+			m_nodes[index].aabb = range.bounds.aabb;
+			LinkBuiltNode(index, range.parent, range.isChild1);
+			topNodes.push_back(index);
+
+			ranges.push_back({ split, range.end, range.depth + 1, bounds2, index, false });
+			ranges.push_back({ range.begin, split, range.depth + 1, bounds1, index, true });
+		}
+
+		b2PartitionedRange taskRanges;
+		executor->PartitionRange(b2Task::e_buildTree, 0, jobs.size(), taskRanges);
+		b2BuildTreeTask* tasks = (b2BuildTreeTask*)b2Alloc(taskRanges.GetCount() * sizeof(b2BuildTreeTask));
+		for (uint32 i = 0; i < taskRanges.GetCount(); ++i)
+		{
+			new (tasks + i) b2BuildTreeTask(taskRanges[i], this, leaves, internalNodes, jobs.data());
+		}
+
+		b2TaskGroup* taskGroup = executor->AcquireTaskGroup();
+		b2SubmitTasks(*executor, taskGroup, tasks, taskRanges.GetCount());
+		executor->Wait(taskGroup, b2MainThreadCtx(nullptr));
+		executor->ReleaseTaskGroup(taskGroup);
+
+		for (uint32 i = 0; i < taskRanges.GetCount(); ++i)
+		{
+			tasks[i].~b2BuildTreeTask();
+		}
+		b2Free(tasks);
+
+		for (uint32 i = 0; i < jobs.size(); ++i)
+		{
+			LinkBuiltNode(jobs[i].root, jobs[i].range.parent, jobs[i].range.isChild1);
+		}
+
+		// Top nodes were split before their children, so fix their heights in reverse.
+		for (int32 i = int32(topNodes.size()) - 1; i >= 0; --i)
+		{
+			b2TreeNode* node = m_nodes + topNodes[i];
+			node->height = 1 + b2Max(m_nodes[node->child1].height, m_nodes[node->child2].height);
+		}
+	}
+
+	m_nodes[m_root].parent = b2_nullNode;
+
+	b2Free(internalNodes);
+	b2Free(leaves);
+
+	Validate();
+}
+
 void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	// Build array of leaves. Free the rest.
@@ -778,3 +1240,45 @@ void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 		m_nodes[i].aabb.upperBound -= newOrigin;
 	}
 }
+
+void b2DynamicTree::TransferState(b2SnapshotStream& stream)
+{
+	int32 nodeCapacity = m_nodeCapacity;
+	stream.Transfer(nodeCapacity);
+	if (stream.IsReading())
+	{
+		if (nodeCapacity <= 0 || stream.CanRead(nodeCapacity, sizeof(b2AABB) + 4 * sizeof(int32)) == false)
+		{
+			stream.SetFailed();
+			return;
+		}
+
+		if (nodeCapacity != m_nodeCapacity)
+		{
+			b2Free(m_nodes);
+			m_nodes = (b2TreeNode*)b2Alloc(nodeCapacity * sizeof(b2TreeNode));
+			m_nodeCapacity = nodeCapacity;
+		}
+	}
+
+	stream.Transfer(m_root);
+	stream.Transfer(m_nodeCount);
+	stream.Transfer(m_freeList);
+	stream.Transfer(m_path);
+	stream.Transfer(m_insertionCount);
+
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		b2TreeNode* node = m_nodes + i;
+		if (stream.IsReading())
+		{
+			// The user data of leaves is restored by their owner.
+			node->userData = nullptr;
+		}
+		stream.Transfer(node->aabb);
+		stream.Transfer(node->parent);
+		stream.Transfer(node->child1);
+		stream.Transfer(node->child2);
+		stream.Transfer(node->height);
+	}
+}
@@ -24,6 +24,11 @@
 
 #define b2_nullNode (-1)
 
+class b2TaskExecutor;
+class b2SnapshotStream;
+struct b2TreeBuildLeaf;
+struct b2TreeBuildBounds;
+
 /// A node in the dynamic tree. The client does not interact with this directly.
 struct b2TreeNode
 {
@@ -70,6 +75,16 @@ public:
 	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create many proxies at once. A new tree is built from these and any existing proxies
+	/// with RebuildTopDown, which is much faster than creating the proxies one at a time and
+	/// gives a better tree.
+	/// @param proxyIds receives the id of each new proxy.
+	void CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData, int32 count);
+
+	/// Create many proxies at once, building the tree in parallel.
+	void CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData, int32 count,
+					   b2TaskExecutor& executor);
+
 	/// Destroy a proxy. This asserts if the id is invalid.
 	void DestroyProxy(int32 proxyId);
 
@@ -83,6 +98,9 @@ public:
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
 
+	/// Set proxy user data.
+	void SetUserData(int32 proxyId, void* userData);
+
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
@@ -118,13 +136,27 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Build a new tree from the current proxies in O(n log(n)) time. Nodes are split top
+	/// down, using a binned surface area heuristic to choose each split. Proxy ids don't change.
+	void RebuildTopDown();
+
+	/// Rebuild the tree top down, building independent partitions in parallel. The resulting
+	/// tree is the same as the one built by RebuildTopDown().
+	void RebuildTopDown(b2TaskExecutor& executor);
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Read or write the nodes of the tree, so that proxy ids and the structure are kept. User
+	/// data isn't stored, and is null after reading.
+	void TransferState(b2SnapshotStream& stream);
+
 private:
 
+	friend class b2BuildTreeTask;
+
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
@@ -133,6 +165,12 @@ private:
 
 	int32 Balance(int32 index);
 
+	void CreateLeaves(int32* proxyIds, const b2AABB* aabbs, void* const* userData, int32 count);
+	void BuildTopDown(b2TaskExecutor* executor);
+	int32 BuildRange(b2TreeBuildLeaf* leaves, const int32* internalNodes, int32 begin, int32 end,
+					 int32 depth, const b2TreeBuildBounds& bounds);
+	void LinkBuiltNode(int32 index, int32 parent, bool isChild1);
+
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
@@ -159,6 +197,13 @@ inline void* b2DynamicTree::GetUserData(int32 proxyId) const
 	return m_nodes[proxyId].userData;
 }
 
+inline void b2DynamicTree::SetUserData(int32 proxyId, void* userData)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+	m_nodes[proxyId].userData = userData;
+}
+
 inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
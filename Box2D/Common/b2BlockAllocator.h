@@ -44,12 +44,20 @@ public:
 	/// Free memory. This will use b2Free if the size is larger than b2_maxBlockSize.
 	void Free(void* p, int32 size);
 
+	/// Make sure count blocks of the size can be allocated without allocating a chunk.
+	void Reserve(int32 size, int32 count);
+
+	/// Get the number of chunks that were allocated with b2Alloc.
+	int32 GetChunkCount() const;
+
 	void Clear();
 
 private:
 
 	static bool InitializeBlockSizeLookup();
 
+	void AllocateChunk(int32 index);
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
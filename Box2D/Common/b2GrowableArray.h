@@ -38,6 +38,7 @@ public:
 	b2GrowableArray(b2GrowableArray&& rhs)
 		: m_array(rhs.m_array)
 		, m_size(rhs.m_size)
+		, m_capacity(rhs.m_capacity)
 	{
 		rhs.m_array = nullptr;
 	}
@@ -69,11 +69,23 @@ public:
 		return m_stack[m_count];
 	}
 
-	int32 GetCount()
+	int32 GetCount() const
 	{
 		return m_count;
 	}
 
+	T& operator[](int32 i)
+	{
+		b2Assert(0 <= i && i < m_count);
+		return m_stack[i];
+	}
+
+	const T& operator[](int32 i) const
+	{
+		b2Assert(0 <= i && i < m_count);
+		return m_stack[i];
+	}
+
 private:
 	T* m_stack;
 	T m_array[N];
@@ -161,15 +161,14 @@ typedef double			float64;
 /// The size of a cache line.
 #define b2_cacheLineSize						64
 
-/// The maximum number of threads. Must be greater than 1 and even.
-#define b2_maxThreads							8
-
-/// The maximum number of subtasks that a range task can be split into.
-#define b2_maxRangeSubTasks						b2_maxThreads
-
 /// The maximum number of islands per solve task.
 #define b2_maxIslandsPerSolveTask				16
 
+/// The maximum number of constraint colors in an island that is solved by multiple threads.
+/// Constraints that don't fit in a color are solved on a single thread after the colors.
+/// This must not exceed 32.
+#define b2_maxConstraintColors					32
+
 /// The number of task groups used by a world's step. Do not change this value.
 #define b2_maxWorldStepTaskGroups				1
 
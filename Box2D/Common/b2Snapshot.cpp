@@ -0,0 +1,142 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Box2D/Common/b2Snapshot.h"
+#include "Box2D/Common/b2Math.h"
+#include <string.h>
+
+b2Snapshot::b2Snapshot()
+{
+	m_data = nullptr;
+	m_size = 0;
+	m_capacity = 0;
+}
+
+b2Snapshot::~b2Snapshot()
+{
+	b2Free(m_data);
+}
+
+b2Snapshot::b2Snapshot(const b2Snapshot& other)
+{
+	m_data = nullptr;
+	m_size = 0;
+	m_capacity = 0;
+	Set(other.m_data, other.m_size);
+}
+
+b2Snapshot& b2Snapshot::operator=(const b2Snapshot& other)
+{
+	if (this != &other)
+	{
+		Set(other.m_data, other.m_size);
+	}
+	return *this;
+}
+
+void b2Snapshot::Set(const void* data, int32 size)
+{
+	b2Assert(size >= 0);
+	Reserve(size);
+	if (size > 0)
+	{
+		memcpy(m_data, data, size);
+	}
+	m_size = size;
+}
+
+void b2Snapshot::Clear()
+{
+	m_size = 0;
+}
+
+void b2Snapshot::Reserve(int32 size)
+{
+	if (size <= m_capacity)
+	{
+		return;
+	}
+
+	uint8* data = (uint8*)b2Alloc(size);
+	if (m_size > 0)
+	{
+		memcpy(data, m_data, m_size);
+	}
+	b2Free(m_data);
+	m_data = data;
+	m_capacity = size;
+}
+
+b2SnapshotStream::b2SnapshotStream(b2Snapshot* snapshot)
+{
+	m_writeSnapshot = snapshot;
+	m_readSnapshot = nullptr;
+	m_offset = snapshot->m_size;
+	m_failed = false;
+}
+
+b2SnapshotStream::b2SnapshotStream(const b2Snapshot* snapshot)
+{
+	m_writeSnapshot = nullptr;
+	m_readSnapshot = snapshot;
+	m_offset = 0;
+	m_failed = false;
+}
+
+bool b2SnapshotStream::CanRead(int32 count, int32 elementSize)
+{
+	b2Assert(IsReading());
+	if (m_failed || count < 0 || (int64)count * elementSize > m_readSnapshot->m_size - m_offset)
+	{
+		m_failed = true;
+		return false;
+	}
+	return true;
+}
+
+void b2SnapshotStream::TransferBytes(void* data, int32 size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	if (m_writeSnapshot)
+	{
+		b2Snapshot* snapshot = m_writeSnapshot;
+		int32 required = m_offset + size;
+		if (required > snapshot->m_capacity)
+		{
+			snapshot->Reserve(b2Max(required, 2 * snapshot->m_capacity));
+		}
+		memcpy(snapshot->m_data + m_offset, data, size);
+		m_offset = required;
+		snapshot->m_size = required;
+		return;
+	}
+
+	if (m_failed || size > m_readSnapshot->m_size - m_offset)
+	{
+		m_failed = true;
+		memset(data, 0, size);
+		return;
+	}
+
+	memcpy(data, m_readSnapshot->m_data + m_offset, size);
+	m_offset += size;
+}
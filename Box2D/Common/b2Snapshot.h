@@ -0,0 +1,156 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include "Box2D/Common/b2Settings.h"
+
+/// A block of binary state, such as the state of a world written by b2World::SaveSnapshot.
+/// A snapshot is flat memory without pointers, so it can be copied, kept, or sent elsewhere
+/// as is. Values are stored in the native byte order and layout, so a snapshot can only be
+/// read by a build for the same platform. The memory is kept when a snapshot is overwritten,
+/// so reusing a snapshot doesn't allocate once it's large enough.
+class b2Snapshot
+{
+public:
+	b2Snapshot();
+	~b2Snapshot();
+
+	b2Snapshot(const b2Snapshot& other);
+	b2Snapshot& operator=(const b2Snapshot& other);
+
+	/// Replace the contents with a copy of size bytes, such as a snapshot received over the network.
+	void Set(const void* data, int32 size);
+
+	/// Empty the snapshot, keeping its memory.
+	void Clear();
+
+	/// Make room for size bytes.
+	void Reserve(int32 size);
+
+	/// Get the contents.
+	void* GetData();
+	const void* GetData() const;
+
+	/// Get the size of the contents in bytes.
+	int32 GetSize() const;
+
+private:
+	friend class b2SnapshotStream;
+
+	uint8* m_data;
+	int32 m_size;
+	int32 m_capacity;
+};
+
+/// Reads or writes the contents of a snapshot in order. Saving and restoring make the same
+/// sequence of Transfer calls, so their layouts can't drift apart.
+/// This is meant for internal use only.
+class b2SnapshotStream
+{
+public:
+	/// Write to the end of a snapshot.
+	explicit b2SnapshotStream(b2Snapshot* snapshot);
+
+	/// Read from the start of a snapshot.
+	explicit b2SnapshotStream(const b2Snapshot* snapshot);
+
+	/// Is this stream reading?
+	bool IsReading() const;
+
+	/// Did a read go past the end of the snapshot, or was the stream marked as failed?
+	/// Values read after a failure are zero.
+	bool HasFailed() const;
+
+	/// Mark a read as failed because the snapshot is malformed.
+	void SetFailed();
+
+	/// Check that count elements of elementSize bytes remain to be read. The stream fails if they
+	/// don't, so counts can be checked before memory is allocated for them.
+	bool CanRead(int32 count, int32 elementSize);
+
+	/// Get the number of bytes read or written so far.
+	int32 GetOffset() const;
+
+	/// Read or write a value.
+	template <typename T>
+	void Transfer(T& value);
+
+	/// Read or write an array of values.
+	template <typename T>
+	void TransferArray(T* values, int32 count);
+
+	/// Read or write raw bytes.
+	void TransferBytes(void* data, int32 size);
+
+private:
+	b2Snapshot* m_writeSnapshot;
+	const b2Snapshot* m_readSnapshot;
+	int32 m_offset;
+	bool m_failed;
+};
+
+inline void* b2Snapshot::GetData()
+{
+	return m_data;
+}
+
+inline const void* b2Snapshot::GetData() const
+{
+	return m_data;
+}
+
+inline int32 b2Snapshot::GetSize() const
+{
+	return m_size;
+}
+
+inline bool b2SnapshotStream::IsReading() const
+{
+	return m_readSnapshot != nullptr;
+}
+
+inline bool b2SnapshotStream::HasFailed() const
+{
+	return m_failed;
+}
+
+inline void b2SnapshotStream::SetFailed()
+{
+	m_failed = true;
+}
+
+inline int32 b2SnapshotStream::GetOffset() const
+{
+	return m_offset;
+}
+
+template <typename T>
+inline void b2SnapshotStream::Transfer(T& value)
+{
+	TransferBytes(&value, sizeof(T));
+}
+
+template <typename T>
+inline void b2SnapshotStream::TransferArray(T* values, int32 count)
+{
+	TransferBytes(values, count * (int32)sizeof(T));
+}
+
+#endif
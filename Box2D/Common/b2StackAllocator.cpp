@@ -18,31 +18,74 @@
 
 #include "Box2D/Common/b2StackAllocator.h"
 #include "Box2D/Common/b2Math.h"
+#include <string.h>
+
+#if defined(_WIN32)
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+
+#elif defined(__linux__)
+
+#include <sys/mman.h>
+
+// The usual size of a transparent huge page.
+static const size_t b2_largePageSize = 2 * 1024 * 1024;
+
+#endif
 
 b2StackAllocator::b2StackAllocator()
 {
+	m_memory = nullptr;
+	m_data = nullptr;
+	m_memorySize = 0;
+	m_memoryKind = e_heapMemory;
+	m_largePages = false;
+	m_capacity = 0;
 	m_index = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
+	m_mallocCount = 0;
 	m_entryCount = 0;
+	m_entryCapacity = b2_maxStackEntries;
+	m_entries = (b2StackEntry*)b2Alloc(m_entryCapacity * sizeof(b2StackEntry));
+
+	Resize(b2_stackSize);
 }
 
 b2StackAllocator::~b2StackAllocator()
 {
 	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+
+	FreeMemory();
+	b2Free(m_entries);
 }
 
 void* b2StackAllocator::Allocate(int32 size)
 {
-	b2Assert(m_entryCount < b2_maxStackEntries);
+	if (m_entryCount == m_entryCapacity)
+	{
+		b2StackEntry* oldEntries = m_entries;
+		m_entryCapacity *= 2;
+		m_entries = (b2StackEntry*)b2Alloc(m_entryCapacity * sizeof(b2StackEntry));
+		memcpy(m_entries, oldEntries, m_entryCount * sizeof(b2StackEntry));
+		b2Free(oldEntries);
+		++m_mallocCount;
+	}
+
+	size = (size + b2_stackAlignment - 1) & ~(b2_stackAlignment - 1);
 
 	b2StackEntry* entry = m_entries + m_entryCount;
 	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	if (m_index + size > m_capacity)
 	{
 		entry->data = (char*)b2Alloc(size);
 		entry->usedMalloc = true;
+		++m_mallocCount;
 	}
 	else
 	{
@@ -79,10 +122,153 @@ void b2StackAllocator::Free(void* p)
 	m_allocation -= entry->size;
 	--m_entryCount;
 
+	// Grow to the peak while the stack is empty, so the next use doesn't overflow.
+	if (m_entryCount == 0 && m_maxAllocation > m_capacity)
+	{
+		Resize(m_maxAllocation);
+		++m_mallocCount;
+	}
+
 	p = nullptr;
 }
 
+void b2StackAllocator::Reserve(int32 size)
+{
+	b2Assert(m_entryCount == 0);
+
+	if (size > m_capacity)
+	{
+		Resize(size);
+	}
+}
+
+void b2StackAllocator::SetLargePages(bool flag)
+{
+	b2Assert(m_entryCount == 0);
+
+	if (flag != m_largePages)
+	{
+		m_largePages = flag;
+		Resize(m_capacity);
+	}
+}
+
+bool b2StackAllocator::GetLargePages() const
+{
+	return m_largePages;
+}
+
+int32 b2StackAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
 int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+int32 b2StackAllocator::GetMallocCount() const
+{
+	return m_mallocCount;
+}
+
+void b2StackAllocator::Resize(int32 size)
+{
+	b2Assert(m_entryCount == 0);
+
+	FreeMemory();
+
+	size = (size + b2_stackAlignment - 1) & ~(b2_stackAlignment - 1);
+
+	if (m_largePages)
+	{
+#if defined(_WIN32)
+		// This needs the "Lock pages in memory" privilege.
+		size_t pageSize = GetLargePageMinimum();
+		if (pageSize > 0)
+		{
+			size_t memorySize = (size + pageSize - 1) & ~(pageSize - 1);
+			void* memory = VirtualAlloc(nullptr, memorySize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (memory)
+			{
+				m_memory = (char*)memory;
+				m_memorySize = (int32)memorySize;
+				m_memoryKind = e_virtualMemory;
+			}
+		}
+#elif defined(__linux__)
+		size_t memorySize = (size + b2_largePageSize - 1) & ~(b2_largePageSize - 1);
+		void* memory = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+		// Explicit huge pages only exist if the system reserved some.
+		memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+		if (memory == MAP_FAILED)
+		{
+			// Otherwise ask for transparent huge pages.
+			memory = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#if defined(MADV_HUGEPAGE)
+			if (memory != MAP_FAILED)
+			{
+				madvise(memory, memorySize, MADV_HUGEPAGE);
+			}
+#endif
+		}
+		if (memory != MAP_FAILED)
+		{
+			m_memory = (char*)memory;
+			m_memorySize = (int32)memorySize;
+			m_memoryKind = e_mappedMemory;
+		}
+#endif
+	}
+
+	if (m_memory)
+	{
+		// Pages are aligned, and the rest of the last page is usable.
+		m_data = m_memory;
+		m_capacity = m_memorySize;
+	}
+	else
+	{
+		// Over-allocate so the stack can be aligned.
+		m_memorySize = size + b2_stackAlignment - 1;
+		m_memory = (char*)b2Alloc(m_memorySize);
+		m_memoryKind = e_heapMemory;
+		m_data = (char*)(((uintptr_t)m_memory + b2_stackAlignment - 1) & ~(uintptr_t)(b2_stackAlignment - 1));
+		m_capacity = size;
+	}
+}
+
+void b2StackAllocator::FreeMemory()
+{
+	if (m_memory == nullptr)
+	{
+		return;
+	}
+
+	switch (m_memoryKind)
+	{
+	case e_heapMemory:
+		b2Free(m_memory);
+		break;
+
+	case e_mappedMemory:
+#if defined(__linux__)
+		munmap(m_memory, m_memorySize);
+#endif
+		break;
+
+	case e_virtualMemory:
+#if defined(_WIN32)
+		VirtualFree(m_memory, 0, MEM_RELEASE);
+#endif
+		break;
+	}
+
+	m_memory = nullptr;
+	m_data = nullptr;
+	m_memorySize = 0;
+	m_capacity = 0;
+}
@@ -24,6 +24,9 @@
 const int32 b2_stackSize = 256 * 1024; // TODO_JUSTIN: Reduce size required by b2World::Solve
 const int32 b2_maxStackEntries = 32;
 
+// Allocation sizes are rounded up to this so that every allocation is aligned.
+const int32 b2_stackAlignment = 16;
+
 struct b2StackEntry
 {
 	char* data;
@@ -34,27 +37,71 @@ struct b2StackEntry
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+//
+// The stack starts with b2_stackSize bytes and room for b2_maxStackEntries entries. Allocations
+// that don't fit use b2Alloc, and once everything is freed the stack grows to the peak
+// allocation, so a stack that is reused every step stops using b2Alloc after the first step
+// that overflowed it. The entries grow as needed.
 class b2StackAllocator
 {
 public:
 	b2StackAllocator();
 	~b2StackAllocator();
 
+	b2StackAllocator(const b2StackAllocator&) = delete;
+	b2StackAllocator& operator=(const b2StackAllocator&) = delete;
+
 	void* Allocate(int32 size);
 	void Free(void* p);
 
+	/// Make sure the stack holds at least size bytes, so allocations that fit don't use b2Alloc.
+	/// Nothing may be allocated.
+	void Reserve(int32 size);
+
+	/// Enable/disable backing the stack with large pages, which reduces TLB misses for big stacks.
+	/// The size of the stack is rounded up to the large page size. If the platform can't provide
+	/// large pages, the stack uses normal pages. Nothing may be allocated.
+	void SetLargePages(bool flag);
+	bool GetLargePages() const;
+
+	/// Get the number of bytes that can be allocated without using b2Alloc.
+	int32 GetCapacity() const;
+
 	int32 GetMaxAllocation() const;
 
+	/// Get the number of times b2Alloc was used because an allocation or entry didn't fit. Growing
+	/// the stack to the peak allocation after an overflow is counted too.
+	int32 GetMallocCount() const;
+
 private:
 
-	char m_data[b2_stackSize];
+	enum MemoryKind
+	{
+		e_heapMemory,
+		e_mappedMemory,
+		e_virtualMemory
+	};
+
+	// Replace the stack memory. Nothing may be allocated.
+	void Resize(int32 size);
+	void FreeMemory();
+
+	char* m_memory;
+	char* m_data;
+	int32 m_memorySize;
+	MemoryKind m_memoryKind;
+	bool m_largePages;
+
+	int32 m_capacity;
 	int32 m_index;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
+	int32 m_mallocCount;
 
-	b2StackEntry m_entries[b2_maxStackEntries];
+	b2StackEntry* m_entries;
 	int32 m_entryCount;
+	int32 m_entryCapacity;
 };
 
 #endif
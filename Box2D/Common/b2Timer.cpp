@@ -62,45 +62,47 @@ float32 b2Timer::GetMilliseconds() const
 	return ms;
 }
 
+static float64 b2QueryNanosecondsPerCount()
+{
+	LARGE_INTEGER largeInteger;
+	QueryPerformanceFrequency(&largeInteger);
+	return 1000000000.0 / float64(largeInteger.QuadPart);
+}
+
+uint64 b2Timer::GetNanoseconds()
+{
+	static const float64 s_nanosecondsPerCount = b2QueryNanosecondsPerCount();
+
+	LARGE_INTEGER largeInteger;
+	QueryPerformanceCounter(&largeInteger);
+	return uint64(s_nanosecondsPerCount * float64(largeInteger.QuadPart));
+}
+
 #elif defined(__linux__) || defined (__APPLE__)
 
-#include <sys/time.h>
+#include <time.h>
 
 b2Timer::b2Timer()
 {
-    Reset();
+	Reset();
 }
 
 void b2Timer::Reset()
 {
-    timeval t;
-    gettimeofday(&t, 0);
-    m_start_sec = t.tv_sec;
-    m_start_usec = t.tv_usec;
+	m_start = GetNanoseconds();
 }
 
 float32 b2Timer::GetMilliseconds() const
 {
-    timeval t;
-    gettimeofday(&t, 0);
-	time_t start_sec = m_start_sec;
-	suseconds_t start_usec = m_start_usec;
-	
-	// http://www.gnu.org/software/libc/manual/html_node/Elapsed-Time.html
-	if (t.tv_usec < start_usec)
-	{
-		int nsec = (start_usec - t.tv_usec) / 1000000 + 1;
-		start_usec -= 1000000 * nsec;
-		start_sec += nsec;
-	}
-	
-	if (t.tv_usec - start_usec > 1000000)
-	{
-		int nsec = (t.tv_usec - start_usec) / 1000000;
-		start_usec += 1000000 * nsec;
-		start_sec -= nsec;
-	}
-	return 1000.0f * (t.tv_sec - start_sec) + 0.001f * (t.tv_usec - start_usec);
+	return 0.000001f * float32(GetNanoseconds() - m_start);
+}
+
+uint64 b2Timer::GetNanoseconds()
+{
+	// The monotonic clock isn't affected by changes to the system time.
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return uint64(t.tv_sec) * 1000000000 + uint64(t.tv_nsec);
 }
 
 #else
@@ -118,4 +120,9 @@ float32 b2Timer::GetMilliseconds() const
 	return 0.0f;
 }
 
+uint64 b2Timer::GetNanoseconds()
+{
+	return 0;
+}
+
 #endif
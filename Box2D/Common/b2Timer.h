@@ -36,14 +36,17 @@ public:
 	/// Get the time since construction or the last reset.
 	float32 GetMilliseconds() const;
 
+	/// Get a timestamp in nanoseconds from a monotonic clock. Only differences between
+	/// timestamps are meaningful.
+	static uint64 GetNanoseconds();
+
 private:
 
 #if defined(_WIN32)
 	float64 m_start;
 	static float64 s_invFrequency;
 #elif defined(__linux__) || defined (__APPLE__)
-	unsigned long long m_start_sec;
-	unsigned long long m_start_usec;
+	uint64 m_start;
 #endif
 };
 
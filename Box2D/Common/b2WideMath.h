@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_WIDE_MATH_H
+#define B2_WIDE_MATH_H
+
+#include "Box2D/Common/b2Math.h"
+
+// Four float lanes that are processed together. SSE2 is used when it's available, otherwise
+// each lane is processed separately. Each lane gives the same result as the equivalent scalar
+// expression, so wide and scalar code can be mixed without changing the results.
+// Define b2_noSimd to always use the scalar fallback.
+
+#if !defined(b2_noSimd) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define b2_sse2
+#endif
+
+#define b2_wideLaneCount 4
+
+#ifdef b2_sse2
+
+#include <emmintrin.h>
+
+struct b2FloatW { __m128 v; };
+struct b2MaskW { __m128 v; };
+
+inline b2FloatW b2LoadW(const float32* a) { return { _mm_loadu_ps(a) }; }
+inline void b2StoreW(float32* dest, b2FloatW a) { _mm_storeu_ps(dest, a.v); }
+inline b2FloatW b2SplatW(float32 a) { return { _mm_set1_ps(a) }; }
+inline b2FloatW b2ZeroW() { return { _mm_setzero_ps() }; }
+inline b2FloatW b2SetW(float32 a, float32 b, float32 c, float32 d) { return { _mm_setr_ps(a, b, c, d) }; }
+
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return { _mm_add_ps(a.v, b.v) }; }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline b2FloatW b2NegW(b2FloatW a) { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+
+// Same as b2Min and b2Max, including which argument is returned for NaNs.
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return { _mm_min_ps(a.v, b.v) }; }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return { _mm_max_ps(a.v, b.v) }; }
+
+inline b2MaskW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline b2MaskW b2GreaterW(b2FloatW a, b2FloatW b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+inline b2MaskW b2LessW(b2FloatW a, b2FloatW b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline b2MaskW b2AndW(b2MaskW a, b2MaskW b) { return { _mm_and_ps(a.v, b.v) }; }
+inline b2MaskW b2OrW(b2MaskW a, b2MaskW b) { return { _mm_or_ps(a.v, b.v) }; }
+
+// Lanes where a[i] == b.
+inline b2MaskW b2EqualW(const int32* a, int32 b)
+{
+	__m128i ai = _mm_loadu_si128((const __m128i*)a);
+	return { _mm_castsi128_ps(_mm_cmpeq_epi32(ai, _mm_set1_epi32(b))) };
+}
+
+// mask ? a : b
+inline b2FloatW b2SelectW(b2MaskW mask, b2FloatW a, b2FloatW b)
+{
+	return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) };
+}
+
+#else
+
+struct b2FloatW { float32 v[b2_wideLaneCount]; };
+struct b2MaskW { bool v[b2_wideLaneCount]; };
+
+#define b2_wideLanes(expr) for (int32 i = 0; i < b2_wideLaneCount; ++i) { expr; }
+
+inline b2FloatW b2LoadW(const float32* a) { b2FloatW r; b2_wideLanes(r.v[i] = a[i]); return r; }
+inline void b2StoreW(float32* dest, b2FloatW a) { b2_wideLanes(dest[i] = a.v[i]); }
+inline b2FloatW b2SplatW(float32 a) { b2FloatW r; b2_wideLanes(r.v[i] = a); return r; }
+inline b2FloatW b2ZeroW() { return b2SplatW(0.0f); }
+inline b2FloatW b2SetW(float32 a, float32 b, float32 c, float32 d) { return { { a, b, c, d } }; }
+
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { b2FloatW r; b2_wideLanes(r.v[i] = a.v[i] + b.v[i]); return r; }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { b2FloatW r; b2_wideLanes(r.v[i] = a.v[i] - b.v[i]); return r; }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { b2FloatW r; b2_wideLanes(r.v[i] = a.v[i] * b.v[i]); return r; }
+inline b2FloatW b2NegW(b2FloatW a) { b2FloatW r; b2_wideLanes(r.v[i] = -a.v[i]); return r; }
+
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { b2FloatW r; b2_wideLanes(r.v[i] = b2Min(a.v[i], b.v[i])); return r; }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { b2FloatW r; b2_wideLanes(r.v[i] = b2Max(a.v[i], b.v[i])); return r; }
+
+inline b2MaskW b2GreaterEqualW(b2FloatW a, b2FloatW b) { b2MaskW r; b2_wideLanes(r.v[i] = a.v[i] >= b.v[i]); return r; }
+inline b2MaskW b2GreaterW(b2FloatW a, b2FloatW b) { b2MaskW r; b2_wideLanes(r.v[i] = a.v[i] > b.v[i]); return r; }
+inline b2MaskW b2LessW(b2FloatW a, b2FloatW b) { b2MaskW r; b2_wideLanes(r.v[i] = a.v[i] < b.v[i]); return r; }
+inline b2MaskW b2AndW(b2MaskW a, b2MaskW b) { b2MaskW r; b2_wideLanes(r.v[i] = a.v[i] && b.v[i]); return r; }
+inline b2MaskW b2OrW(b2MaskW a, b2MaskW b) { b2MaskW r; b2_wideLanes(r.v[i] = a.v[i] || b.v[i]); return r; }
+
+inline b2MaskW b2EqualW(const int32* a, int32 b) { b2MaskW r; b2_wideLanes(r.v[i] = a[i] == b); return r; }
+
+inline b2FloatW b2SelectW(b2MaskW mask, b2FloatW a, b2FloatW b)
+{
+	b2FloatW r;
+	b2_wideLanes(r.v[i] = mask.v[i] ? a.v[i] : b.v[i]);
+	return r;
+}
+
+#undef b2_wideLanes
+
+#endif
+
+#endif
@@ -82,14 +82,17 @@ b2Contact* b2Contact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtu
 	b2ContactCreateFcn* createFcn = s_registers[type1][type2].createFcn;
 	if (createFcn)
 	{
+		b2Contact* contact;
 		if (s_registers[type1][type2].primary)
 		{
-			return createFcn(fixtureA, indexA, fixtureB, indexB, allocator);
+			contact = createFcn(fixtureA, indexA, fixtureB, indexB, allocator);
 		}
 		else
 		{
-			return createFcn(fixtureB, indexB, fixtureA, indexA, allocator);
+			contact = createFcn(fixtureB, indexB, fixtureA, indexA, allocator);
 		}
+		contact->m_allocator = allocator;
+		return contact;
 	}
 	else
 	{
@@ -104,14 +107,6 @@ void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
 	b2Fixture* fixtureA = contact->m_fixtureA;
 	b2Fixture* fixtureB = contact->m_fixtureB;
 
-	if (contact->m_manifold.pointCount > 0 &&
-		fixtureA->IsSensor() == false &&
-		fixtureB->IsSensor() == false)
-	{
-		fixtureA->GetBody()->SetAwake(true);
-		fixtureB->GetBody()->SetAwake(true);
-	}
-
 	b2Shape::Type typeA = fixtureA->GetType();
 	b2Shape::Type typeB = fixtureB->GetType();
 
@@ -124,8 +119,7 @@ void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
 
 b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 {
-	m_flags = e_enabledFlag;
-
+	m_states = nullptr;
 	m_managerIndex = -1;
 
 	m_fixtureA = fA;
@@ -134,8 +128,6 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_indexA = indexA;
 	m_indexB = indexB;
 
-	m_manifold.pointCount = 0;
-
 	m_prev = nullptr;
 	m_next = nullptr;
 
@@ -148,38 +140,40 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_nodeB.prev = nullptr;
 	m_nodeB.next = nullptr;
 	m_nodeB.other = nullptr;
-
-	m_toiCount = 0;
-	m_toi = 1.0f;
-
-	m_friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
-	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
-
-	m_tangentSpeed = 0.0f;
 }
 
 void b2Contact::Update(b2ContactListener* listener)
 {
-	UpdateImpl<true>(nullptr, listener, 0);
+	UpdateImpl<true>(nullptr, listener, 0, nullptr);
 }
 
 void b2Contact::Update(b2ContactManagerPerThreadData& td, b2ContactListener* listener, uint32 threadId)
 {
-	UpdateImpl<false>(&td, listener, threadId);
+	UpdateImpl<false>(&td, listener, threadId, nullptr);
+}
+
+void b2Contact::Update(b2ContactManagerPerThreadData& td, b2ContactListener* listener, uint32 threadId,
+					   const b2Manifold& manifold)
+{
+	UpdateImpl<false>(&td, listener, threadId, &manifold);
 }
 
 // Update the contact manifold and touching status.
 // Note: do not assume the fixture AABBs are overlapping or are valid.
+// A non-null manifold replaces the call to Evaluate.
 template<bool isSingleThread>
-void b2Contact::UpdateImpl(b2ContactManagerPerThreadData* td, b2ContactListener* listener, uint32 threadId)
+void b2Contact::UpdateImpl(b2ContactManagerPerThreadData* td, b2ContactListener* listener, uint32 threadId,
+						   const b2Manifold* manifold)
 {
-	b2Manifold oldManifold = m_manifold;
+	uint32& flags = m_states->m_flags[m_managerIndex];
+	b2Manifold& contactManifold = m_states->m_manifolds[m_managerIndex];
+	b2Manifold oldManifold = contactManifold;
 
 	// Re-enable this contact.
-	m_flags |= e_enabledFlag;
+	flags |= e_enabledFlag;
 
 	bool touching = false;
-	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
+	bool wasTouching = (flags & e_touchingFlag) == e_touchingFlag;
 
 	bool sensorA = m_fixtureA->IsSensor();
 	bool sensorB = m_fixtureB->IsSensor();
@@ -198,18 +192,25 @@ void b2Contact::UpdateImpl(b2ContactManagerPerThreadData* td, b2ContactListener*
 		touching = b2TestOverlap(shapeA, m_indexA, shapeB, m_indexB, xfA, xfB);
 
 		// Sensors don't generate manifolds.
-		m_manifold.pointCount = 0;
+		contactManifold.pointCount = 0;
 	}
 	else
 	{
-		Evaluate(&m_manifold, xfA, xfB);
-		touching = m_manifold.pointCount > 0;
+		if (manifold)
+		{
+			contactManifold = *manifold;
+		}
+		else
+		{
+			Evaluate(&contactManifold, xfA, xfB);
+		}
+		touching = contactManifold.pointCount > 0;
 
 		// Match old contact ids to new contact ids and copy the
 		// stored impulses to warm start the solver.
-		for (int32 i = 0; i < m_manifold.pointCount; ++i)
+		for (int32 i = 0; i < contactManifold.pointCount; ++i)
 		{
-			b2ManifoldPoint* mp2 = m_manifold.points + i;
+			b2ManifoldPoint* mp2 = contactManifold.points + i;
 			mp2->normalImpulse = 0.0f;
 			mp2->tangentImpulse = 0.0f;
 			b2ContactID id2 = mp2->id;
@@ -243,11 +244,11 @@ void b2Contact::UpdateImpl(b2ContactManagerPerThreadData* td, b2ContactListener*
 
 	if (touching)
 	{
-		m_flags |= e_touchingFlag;
+		flags |= e_touchingFlag;
 	}
 	else
 	{
-		m_flags &= ~e_touchingFlag;
+		flags &= ~e_touchingFlag;
 	}
 
 	if (wasTouching == false && touching == true && listener)
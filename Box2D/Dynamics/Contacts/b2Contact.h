@@ -24,6 +24,7 @@
 #include "Box2D/Collision/b2Collision.h"
 #include "Box2D/Collision/Shapes/b2Shape.h"
 #include "Box2D/Collision/b2BroadPhase.h"
+#include "Box2D/Dynamics/b2ContactStateStore.h"
 #include "Box2D/Dynamics/b2Fixture.h"
 
 class b2Body;
@@ -61,21 +62,6 @@ struct b2ContactRegister
 	bool primary;
 };
 
-/// Stores the proxy ids of a contact's fixtures in a consistent order.
-struct b2ContactProxyIds
-{
-	b2ContactProxyIds()
-		: low(b2BroadPhase::e_nullProxy)
-		, high(b2BroadPhase::e_nullProxy)
-	{}
-	b2ContactProxyIds(int32 proxyIdA, int32 proxyIdB)
-		: low(proxyIdA < proxyIdB ? proxyIdA : proxyIdB)
-		, high(proxyIdA < proxyIdB ? proxyIdB : proxyIdA)
-	{}
-	int32 low;
-	int32 high;
-};
-
 /// A contact edge is used to connect bodies and contacts together
 /// in a contact graph where each body is a node and each contact
 /// is an edge. A contact edge belongs to a doubly linked list
@@ -168,10 +154,11 @@ protected:
 	friend class b2ContactSolver;
 	friend class b2Body;
 	friend class b2Fixture;
-	friend class b2ClearContactSolveFlags;
-	friend class b2ClearContactSolveTOIFlags;
+	friend class b2ContactStateStore;
 	friend class b2FindMinToiContactTask;
+	friend class b2FindToiEventsTask;
 	friend bool b2ContactPointerLessThan(const b2Contact*, const b2Contact*);
+	friend uint64 b2ContactSortKey(const b2Contact*);
 	friend bool b2ToiContactPointerLessThan(const b2Contact*, const b2Contact*);
 
 	// Flags stored in m_flags
@@ -192,7 +179,7 @@ protected:
 		// This bullet contact had a TOI event
 		e_bulletHitFlag		= 0x0010,
 
-		// This contact has a valid TOI in m_toi
+		// This contact has a valid TOI in its TOI state
 		e_toiFlag			= 0x0020,
 
 		// This contact must be checked for TOI events.
@@ -216,10 +203,16 @@ protected:
 	void Update(b2ContactManagerPerThreadData& td, b2ContactListener* listener, uint32 threadId);
 	void Update(b2ContactListener* listener);
 
+	// Update using a manifold that was already computed for the current transforms.
+	void Update(b2ContactManagerPerThreadData& td, b2ContactListener* listener, uint32 threadId,
+				const b2Manifold& manifold);
+
 	template <bool isSingleThread>
-	void UpdateImpl(b2ContactManagerPerThreadData* td, b2ContactListener* listener, uint32 threadId);
+	void UpdateImpl(b2ContactManagerPerThreadData* td, b2ContactListener* listener, uint32 threadId,
+					const b2Manifold* manifold);
 
 	bool IsMinToiCandidate() const;
+	static bool IsMinToiCandidate(uint32 flags, const b2ContactToi& toi);
 	void ClearToi();
 
 	static bool IsToiCandidate(b2Fixture* fA, b2Fixture* fB);
@@ -228,8 +221,9 @@ protected:
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
-	uint32 m_flags;
-
+	// The flags, proxy ids, TOI, material, and manifold are stored in the contact manager's
+	// b2ContactStateStore at m_managerIndex, which is -1 until the contact is added to the world.
+	b2ContactStateStore* m_states;
 	int32 m_managerIndex;
 
 	// Nodes for connecting bodies.
@@ -242,51 +236,22 @@ protected:
 	int32 m_indexA;
 	int32 m_indexB;
 
-	b2ContactProxyIds m_proxyIds;
-
-	b2Manifold m_manifold;
-
-	int32 m_toiCount;
-	float32 m_toi;
-
-	float32 m_friction;
-	float32 m_restitution;
-
-	float32 m_tangentSpeed;
-
 	// World pool and list pointers.
 	b2Contact* m_prev;
 	b2Contact* m_next;
-};
-
-inline bool operator==(const b2ContactProxyIds& lhs, const b2ContactProxyIds& rhs)
-{
-	return lhs.low == rhs.low && lhs.high == rhs.high;
-}
 
-inline bool operator<(const b2ContactProxyIds& lhs, const b2ContactProxyIds& rhs)
-{
-	if (lhs.low < rhs.low)
-	{
-		return true;
-	}
-
-	if (lhs.low == rhs.low)
-	{
-		return lhs.high < rhs.high;
-	}
-
-	return false;
-}
+	// The allocator this contact was created with.
+	b2BlockAllocator* m_allocator;
+};
 
 inline b2Manifold* b2Contact::GetManifold()
 {
-	return &m_manifold;
+	return &m_states->m_manifolds[m_managerIndex];
 }
 
 inline const b2Manifold* b2Contact::GetManifold() const
 {
-	return &m_manifold;
+	return &m_states->m_manifolds[m_managerIndex];
 }
 
 inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
@@ -296,29 +261,30 @@ inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
 	const b2Shape* shapeA = m_fixtureA->GetShape();
 	const b2Shape* shapeB = m_fixtureB->GetShape();
 
-	worldManifold->Initialize(&m_manifold, bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
+	worldManifold->Initialize(GetManifold(), bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
 }
 
 inline void b2Contact::SetEnabled(bool flag)
 {
+	uint32& flags = m_states->m_flags[m_managerIndex];
 	if (flag)
 	{
-		m_flags |= e_enabledFlag;
+		flags |= e_enabledFlag;
 	}
 	else
 	{
-		m_flags &= ~e_enabledFlag;
+		flags &= ~e_enabledFlag;
 	}
 }
 
 inline bool b2Contact::IsEnabled() const
 {
-	return (m_flags & e_enabledFlag) == e_enabledFlag;
+	return (m_states->m_flags[m_managerIndex] & e_enabledFlag) == e_enabledFlag;
 }
 
 inline bool b2Contact::IsTouching() const
 {
-	return (m_flags & e_touchingFlag) == e_touchingFlag;
+	return (m_states->m_flags[m_managerIndex] & e_touchingFlag) == e_touchingFlag;
 }
 
 inline b2Contact* b2Contact::GetNext()
@@ -363,54 +329,59 @@ inline int32 b2Contact::GetChildIndexB() const
 
 inline void b2Contact::SetFriction(float32 friction)
 {
-	m_friction = friction;
+	m_states->m_materials[m_managerIndex].friction = friction;
 }
 
 inline float32 b2Contact::GetFriction() const
 {
-	return m_friction;
+	return m_states->m_materials[m_managerIndex].friction;
 }
 
 inline void b2Contact::ResetFriction()
 {
-	m_friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
+	m_states->m_materials[m_managerIndex].friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
 }
 
 inline void b2Contact::SetRestitution(float32 restitution)
 {
-	m_restitution = restitution;
+	m_states->m_materials[m_managerIndex].restitution = restitution;
 }
 
 inline float32 b2Contact::GetRestitution() const
 {
-	return m_restitution;
+	return m_states->m_materials[m_managerIndex].restitution;
 }
 
 inline void b2Contact::ResetRestitution()
 {
-	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
+	m_states->m_materials[m_managerIndex].restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
 }
 
 inline void b2Contact::SetTangentSpeed(float32 speed)
 {
-	m_tangentSpeed = speed;
+	m_states->m_materials[m_managerIndex].tangentSpeed = speed;
 }
 
 inline float32 b2Contact::GetTangentSpeed() const
 {
-	return m_tangentSpeed;
+	return m_states->m_materials[m_managerIndex].tangentSpeed;
 }
 
 inline bool b2Contact::IsMinToiCandidate() const
+{
+	return IsMinToiCandidate(m_states->m_flags[m_managerIndex], m_states->m_tois[m_managerIndex]);
+}
+
+inline bool b2Contact::IsMinToiCandidate(uint32 flags, const b2ContactToi& toi)
 {
 	// Is this contact disabled?
-	if (IsEnabled() == false)
+	if ((flags & e_enabledFlag) == 0)
 	{
 		return false;
 	}
 
 	// Prevent excessive sub-stepping.
-	if (m_toiCount > b2_maxSubSteps)
+	if (toi.toiCount > b2_maxSubSteps)
 	{
 		return false;
 	}
@@ -420,9 +391,9 @@ inline bool b2Contact::IsMinToiCandidate() const
 
 inline void b2Contact::ClearToi()
 {
-	m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-	m_toiCount = 0;
-	m_toi = 1.0f;
+	m_states->m_flags[m_managerIndex] &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+	m_states->m_tois[m_managerIndex].toiCount = 0;
+	m_states->m_tois[m_managerIndex].toi = 1.0f;
 }
 
 #endif
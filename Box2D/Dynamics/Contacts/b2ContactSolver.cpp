@@ -23,6 +23,7 @@
 #include "Box2D/Dynamics/b2Fixture.h"
 #include "Box2D/Dynamics/b2World.h"
 #include "Box2D/Common/b2StackAllocator.h"
+#include "Box2D/Common/b2WideMath.h"
 
 // Solver debugging is normally disabled because the block solver sometimes has to deal with a poorly conditioned effective mass matrix.
 #define B2_DEBUG_SOLVER 0
@@ -54,6 +55,8 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
+	m_wideConstraints = nullptr;
+	m_wideCount = 0;
 	uint32 threadId = def->threadId;
 
 	// Initialize position independent portions of the constraints.
@@ -70,14 +73,15 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
 		b2Manifold* manifold = contact->GetManifold();
+		const b2ContactMaterial& material = contact->m_states->m_materials[contact->m_managerIndex];
 
 		int32 pointCount = manifold->pointCount;
 		b2Assert(pointCount == 1 || pointCount == 2);
 
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
-		vc->friction = contact->m_friction;
-		vc->restitution = contact->m_restitution;
-		vc->tangentSpeed = contact->m_tangentSpeed;
+		vc->friction = material.friction;
+		vc->restitution = material.restitution;
+		vc->tangentSpeed = material.tangentSpeed;
 		vc->indexA = bodyA->GetIslandIndex(threadId);
 		vc->indexB = bodyB->GetIslandIndex(threadId);
 		vc->invMassA = bodyA->m_invMass;
@@ -134,6 +138,10 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_wideConstraints)
+	{
+		m_allocator->Free(m_wideConstraints);
+	}
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -283,16 +291,28 @@ void b2ContactSolver::WarmStart()
 			vB += mB * P;
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		if (mA != 0.0f || iA != 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+
+		if (mB != 0.0f || iB != 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
 	}
 }
 
 void b2ContactSolver::SolveVelocityConstraints()
 {
-	for (int32 i = 0; i < m_count; ++i)
+	SolveVelocityConstraints(0, m_count);
+}
+
+void b2ContactSolver::SolveVelocityConstraints(int32 begin, int32 end)
+{
+	for (int32 i = begin; i < end; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
@@ -595,10 +615,19 @@ void b2ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		// Static and kinematic bodies aren't written, since constraints of the same color can share
+		// them while being solved on different threads.
+		if (mA != 0.0f || iA != 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+
+		if (mB != 0.0f || iB != 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
 	}
 }
 
@@ -617,6 +646,377 @@ void b2ContactSolver::StoreImpulses()
 	}
 }
 
+// Contact points of b2WideContactConstraint.
+struct b2WideVelocityConstraintPoint
+{
+	float32 rAx[b2_wideLaneCount], rAy[b2_wideLaneCount];
+	float32 rBx[b2_wideLaneCount], rBy[b2_wideLaneCount];
+	float32 normalImpulse[b2_wideLaneCount];
+	float32 tangentImpulse[b2_wideLaneCount];
+	float32 normalMass[b2_wideLaneCount];
+	float32 tangentMass[b2_wideLaneCount];
+	float32 velocityBias[b2_wideLaneCount];
+};
+
+// Velocity constraints in structure of arrays form, one constraint per lane.
+// Unused lanes have a point count of zero.
+struct b2WideContactConstraint
+{
+	b2WideVelocityConstraintPoint points[b2_maxManifoldPoints];
+	float32 normalx[b2_wideLaneCount], normaly[b2_wideLaneCount];
+	float32 normalMassExx[b2_wideLaneCount], normalMassExy[b2_wideLaneCount];
+	float32 normalMassEyx[b2_wideLaneCount], normalMassEyy[b2_wideLaneCount];
+	float32 Kexx[b2_wideLaneCount], Kexy[b2_wideLaneCount];
+	float32 Keyx[b2_wideLaneCount], Keyy[b2_wideLaneCount];
+	float32 invMassA[b2_wideLaneCount], invMassB[b2_wideLaneCount];
+	float32 invIA[b2_wideLaneCount], invIB[b2_wideLaneCount];
+	float32 friction[b2_wideLaneCount];
+	float32 tangentSpeed[b2_wideLaneCount];
+	int32 indexA[b2_wideLaneCount];
+	int32 indexB[b2_wideLaneCount];
+	int32 pointCount[b2_wideLaneCount];
+	int32 constraintIndex[b2_wideLaneCount];
+};
+
+void b2ContactSolver::PrepareWideConstraints(const int32* colorBegin, int32 colorCount)
+{
+	b2Assert(m_wideConstraints == nullptr);
+	b2Assert(colorCount <= b2_maxConstraintColors);
+
+	// Each color starts a new batch so the lanes of a batch never share dynamic bodies.
+	int32 batchCount = 0;
+	for (int32 i = 0; i < colorCount; ++i)
+	{
+		m_wideBegin[i] = batchCount;
+		int32 count = colorBegin[i + 1] - colorBegin[i];
+		batchCount += (count + b2_wideLaneCount - 1) / b2_wideLaneCount;
+	}
+	m_wideBegin[colorCount] = batchCount;
+	m_wideCount = batchCount;
+
+	m_wideConstraints = (b2WideContactConstraint*)m_allocator->Allocate(batchCount * sizeof(b2WideContactConstraint));
+	memset(m_wideConstraints, 0, batchCount * sizeof(b2WideContactConstraint));
+
+	for (int32 i = 0; i < colorCount; ++i)
+	{
+		for (int32 j = colorBegin[i]; j < colorBegin[i + 1]; ++j)
+		{
+			int32 colorIndex = j - colorBegin[i];
+			b2WideContactConstraint* wc = m_wideConstraints + m_wideBegin[i] + colorIndex / b2_wideLaneCount;
+			int32 lane = colorIndex % b2_wideLaneCount;
+
+			const b2ContactVelocityConstraint* vc = m_velocityConstraints + j;
+			for (int32 k = 0; k < vc->pointCount; ++k)
+			{
+				const b2VelocityConstraintPoint* vcp = vc->points + k;
+				b2WideVelocityConstraintPoint* wcp = wc->points + k;
+				wcp->rAx[lane] = vcp->rA.x;
+				wcp->rAy[lane] = vcp->rA.y;
+				wcp->rBx[lane] = vcp->rB.x;
+				wcp->rBy[lane] = vcp->rB.y;
+				wcp->normalImpulse[lane] = vcp->normalImpulse;
+				wcp->tangentImpulse[lane] = vcp->tangentImpulse;
+				wcp->normalMass[lane] = vcp->normalMass;
+				wcp->tangentMass[lane] = vcp->tangentMass;
+				wcp->velocityBias[lane] = vcp->velocityBias;
+			}
+			wc->normalx[lane] = vc->normal.x;
+			wc->normaly[lane] = vc->normal.y;
+			wc->normalMassExx[lane] = vc->normalMass.ex.x;
+			wc->normalMassExy[lane] = vc->normalMass.ex.y;
+			wc->normalMassEyx[lane] = vc->normalMass.ey.x;
+			wc->normalMassEyy[lane] = vc->normalMass.ey.y;
+			wc->Kexx[lane] = vc->K.ex.x;
+			wc->Kexy[lane] = vc->K.ex.y;
+			wc->Keyx[lane] = vc->K.ey.x;
+			wc->Keyy[lane] = vc->K.ey.y;
+			wc->invMassA[lane] = vc->invMassA;
+			wc->invMassB[lane] = vc->invMassB;
+			wc->invIA[lane] = vc->invIA;
+			wc->invIB[lane] = vc->invIB;
+			wc->friction[lane] = vc->friction;
+			wc->tangentSpeed[lane] = vc->tangentSpeed;
+			wc->indexA[lane] = vc->indexA;
+			wc->indexB[lane] = vc->indexB;
+			wc->pointCount[lane] = vc->pointCount;
+			wc->constraintIndex[lane] = j;
+		}
+	}
+}
+
+// Body velocities of one batch.
+struct b2WideBodyVelocities
+{
+	b2FloatW vAx, vAy, wA;
+	b2FloatW vBx, vBy, wB;
+};
+
+// Apply an impulse P to the lanes in the mask.
+static void b2ApplyWideImpulse(b2WideBodyVelocities& v, b2MaskW mask,
+	b2FloatW mA, b2FloatW iA, b2FloatW mB, b2FloatW iB,
+	b2FloatW Px, b2FloatW Py, b2FloatW crossA, b2FloatW crossB)
+{
+	v.vAx = b2SelectW(mask, b2SubW(v.vAx, b2MulW(mA, Px)), v.vAx);
+	v.vAy = b2SelectW(mask, b2SubW(v.vAy, b2MulW(mA, Py)), v.vAy);
+	v.wA = b2SelectW(mask, b2SubW(v.wA, b2MulW(iA, crossA)), v.wA);
+	v.vBx = b2SelectW(mask, b2AddW(v.vBx, b2MulW(mB, Px)), v.vBx);
+	v.vBy = b2SelectW(mask, b2AddW(v.vBy, b2MulW(mB, Py)), v.vBy);
+	v.wB = b2SelectW(mask, b2AddW(v.wB, b2MulW(iB, crossB)), v.wB);
+}
+
+// b2Cross(r, P)
+static b2FloatW b2CrossW(b2FloatW rx, b2FloatW ry, b2FloatW Px, b2FloatW Py)
+{
+	return b2SubW(b2MulW(rx, Py), b2MulW(ry, Px));
+}
+
+// Relative velocity at a contact point: vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA)
+static void b2RelativeVelocityW(const b2WideBodyVelocities& v, const b2WideVelocityConstraintPoint* wcp,
+	b2FloatW* dvx, b2FloatW* dvy)
+{
+	b2FloatW rAx = b2LoadW(wcp->rAx);
+	b2FloatW rAy = b2LoadW(wcp->rAy);
+	b2FloatW rBx = b2LoadW(wcp->rBx);
+	b2FloatW rBy = b2LoadW(wcp->rBy);
+	*dvx = b2SubW(b2SubW(b2AddW(v.vBx, b2MulW(b2NegW(v.wB), rBy)), v.vAx), b2MulW(b2NegW(v.wA), rAy));
+	*dvy = b2SubW(b2SubW(b2AddW(v.vBy, b2MulW(v.wB, rBx)), v.vAy), b2MulW(v.wA, rAx));
+}
+
+// This matches SolveVelocityConstraints operation for operation, so each lane gets the same
+// result as solving its constraint with the scalar solver.
+void b2ContactSolver::SolveWideVelocityConstraints(int32 begin, int32 end)
+{
+	const b2FloatW zero = b2ZeroW();
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2WideContactConstraint* wc = m_wideConstraints + i;
+
+		b2MaskW onePoint = b2EqualW(wc->pointCount, 1);
+		b2MaskW twoPoints = b2EqualW(wc->pointCount, 2);
+		b2MaskW pointMasks[b2_maxManifoldPoints] = { b2OrW(onePoint, twoPoints), twoPoints };
+
+		// Gather the body velocities.
+		float32 vAx[b2_wideLaneCount], vAy[b2_wideLaneCount], wA[b2_wideLaneCount];
+		float32 vBx[b2_wideLaneCount], vBy[b2_wideLaneCount], wB[b2_wideLaneCount];
+		for (int32 lane = 0; lane < b2_wideLaneCount; ++lane)
+		{
+			const b2Velocity& velocityA = m_velocities[wc->indexA[lane]];
+			const b2Velocity& velocityB = m_velocities[wc->indexB[lane]];
+			vAx[lane] = velocityA.v.x;
+			vAy[lane] = velocityA.v.y;
+			wA[lane] = velocityA.w;
+			vBx[lane] = velocityB.v.x;
+			vBy[lane] = velocityB.v.y;
+			wB[lane] = velocityB.w;
+		}
+
+		b2WideBodyVelocities v;
+		v.vAx = b2LoadW(vAx);
+		v.vAy = b2LoadW(vAy);
+		v.wA = b2LoadW(wA);
+		v.vBx = b2LoadW(vBx);
+		v.vBy = b2LoadW(vBy);
+		v.wB = b2LoadW(wB);
+
+		b2FloatW mA = b2LoadW(wc->invMassA);
+		b2FloatW iA = b2LoadW(wc->invIA);
+		b2FloatW mB = b2LoadW(wc->invMassB);
+		b2FloatW iB = b2LoadW(wc->invIB);
+
+		b2FloatW normalx = b2LoadW(wc->normalx);
+		b2FloatW normaly = b2LoadW(wc->normaly);
+		b2FloatW tangentx = normaly;
+		b2FloatW tangenty = b2NegW(normalx);
+		b2FloatW friction = b2LoadW(wc->friction);
+		b2FloatW tangentSpeed = b2LoadW(wc->tangentSpeed);
+
+		// Solve tangent constraints first because non-penetration is more important
+		// than friction.
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			b2WideVelocityConstraintPoint* wcp = wc->points + j;
+
+			b2FloatW dvx, dvy;
+			b2RelativeVelocityW(v, wcp, &dvx, &dvy);
+
+			// Compute tangent force
+			b2FloatW vt = b2SubW(b2AddW(b2MulW(dvx, tangentx), b2MulW(dvy, tangenty)), tangentSpeed);
+			b2FloatW lambda = b2MulW(b2LoadW(wcp->tangentMass), b2NegW(vt));
+
+			// b2Clamp the accumulated force
+			b2FloatW tangentImpulse = b2LoadW(wcp->tangentImpulse);
+			b2FloatW maxFriction = b2MulW(friction, b2LoadW(wcp->normalImpulse));
+			b2FloatW newImpulse = b2MaxW(b2NegW(maxFriction), b2MinW(b2AddW(tangentImpulse, lambda), maxFriction));
+			lambda = b2SubW(newImpulse, tangentImpulse);
+			b2StoreW(wcp->tangentImpulse, b2SelectW(pointMasks[j], newImpulse, tangentImpulse));
+
+			// Apply contact impulse
+			b2FloatW Px = b2MulW(lambda, tangentx);
+			b2FloatW Py = b2MulW(lambda, tangenty);
+			b2FloatW crossA = b2CrossW(b2LoadW(wcp->rAx), b2LoadW(wcp->rAy), Px, Py);
+			b2FloatW crossB = b2CrossW(b2LoadW(wcp->rBx), b2LoadW(wcp->rBy), Px, Py);
+			b2ApplyWideImpulse(v, pointMasks[j], mA, iA, mB, iB, Px, Py, crossA, crossB);
+		}
+
+		// Solve normal constraints one point at a time, except for two point lanes when
+		// block solving.
+		int32 normalPointCount = g_blockSolve ? 1 : b2_maxManifoldPoints;
+		for (int32 j = 0; j < normalPointCount; ++j)
+		{
+			b2MaskW mask = g_blockSolve ? onePoint : pointMasks[j];
+			b2WideVelocityConstraintPoint* wcp = wc->points + j;
+
+			b2FloatW dvx, dvy;
+			b2RelativeVelocityW(v, wcp, &dvx, &dvy);
+
+			// Compute normal impulse
+			b2FloatW vn = b2AddW(b2MulW(dvx, normalx), b2MulW(dvy, normaly));
+			b2FloatW lambda = b2MulW(b2NegW(b2LoadW(wcp->normalMass)), b2SubW(vn, b2LoadW(wcp->velocityBias)));
+
+			// b2Clamp the accumulated impulse
+			b2FloatW normalImpulse = b2LoadW(wcp->normalImpulse);
+			b2FloatW newImpulse = b2MaxW(b2AddW(normalImpulse, lambda), zero);
+			lambda = b2SubW(newImpulse, normalImpulse);
+			b2StoreW(wcp->normalImpulse, b2SelectW(mask, newImpulse, normalImpulse));
+
+			// Apply contact impulse
+			b2FloatW Px = b2MulW(lambda, normalx);
+			b2FloatW Py = b2MulW(lambda, normaly);
+			b2FloatW crossA = b2CrossW(b2LoadW(wcp->rAx), b2LoadW(wcp->rAy), Px, Py);
+			b2FloatW crossB = b2CrossW(b2LoadW(wcp->rBx), b2LoadW(wcp->rBy), Px, Py);
+			b2ApplyWideImpulse(v, mask, mA, iA, mB, iB, Px, Py, crossA, crossB);
+		}
+
+		// Block solve the two point lanes. All four cases are computed and the first valid
+		// case is selected for each lane. See SolveVelocityConstraints for the derivation.
+		if (g_blockSolve)
+		{
+			b2WideVelocityConstraintPoint* cp1 = wc->points + 0;
+			b2WideVelocityConstraintPoint* cp2 = wc->points + 1;
+
+			b2FloatW ax = b2LoadW(cp1->normalImpulse);
+			b2FloatW ay = b2LoadW(cp2->normalImpulse);
+
+			// Relative velocity at contact
+			b2FloatW dv1x, dv1y, dv2x, dv2y;
+			b2RelativeVelocityW(v, cp1, &dv1x, &dv1y);
+			b2RelativeVelocityW(v, cp2, &dv2x, &dv2y);
+
+			// Compute normal velocity
+			b2FloatW vn1 = b2AddW(b2MulW(dv1x, normalx), b2MulW(dv1y, normaly));
+			b2FloatW vn2 = b2AddW(b2MulW(dv2x, normalx), b2MulW(dv2y, normaly));
+
+			b2FloatW bx = b2SubW(vn1, b2LoadW(cp1->velocityBias));
+			b2FloatW by = b2SubW(vn2, b2LoadW(cp2->velocityBias));
+
+			// Compute b'
+			b2FloatW Kexx = b2LoadW(wc->Kexx);
+			b2FloatW Kexy = b2LoadW(wc->Kexy);
+			b2FloatW Keyx = b2LoadW(wc->Keyx);
+			b2FloatW Keyy = b2LoadW(wc->Keyy);
+			bx = b2SubW(bx, b2AddW(b2MulW(Kexx, ax), b2MulW(Keyx, ay)));
+			by = b2SubW(by, b2AddW(b2MulW(Kexy, ax), b2MulW(Keyy, ay)));
+
+			// Case 1: vn = 0
+			b2FloatW x1x = b2NegW(b2AddW(b2MulW(b2LoadW(wc->normalMassExx), bx), b2MulW(b2LoadW(wc->normalMassEyx), by)));
+			b2FloatW x1y = b2NegW(b2AddW(b2MulW(b2LoadW(wc->normalMassExy), bx), b2MulW(b2LoadW(wc->normalMassEyy), by)));
+			b2MaskW case1 = b2AndW(b2GreaterEqualW(x1x, zero), b2GreaterEqualW(x1y, zero));
+
+			// Case 2: vn1 = 0 and x2 = 0
+			b2FloatW x2x = b2MulW(b2NegW(b2LoadW(cp1->normalMass)), bx);
+			b2FloatW case2vn2 = b2AddW(b2MulW(Kexy, x2x), by);
+			b2MaskW case2 = b2AndW(b2GreaterEqualW(x2x, zero), b2GreaterEqualW(case2vn2, zero));
+
+			// Case 3: vn2 = 0 and x1 = 0
+			b2FloatW x3y = b2MulW(b2NegW(b2LoadW(cp2->normalMass)), by);
+			b2FloatW case3vn1 = b2AddW(b2MulW(Keyx, x3y), bx);
+			b2MaskW case3 = b2AndW(b2GreaterEqualW(x3y, zero), b2GreaterEqualW(case3vn1, zero));
+
+			// Case 4: x1 = 0 and x2 = 0
+			b2MaskW case4 = b2AndW(b2GreaterEqualW(bx, zero), b2GreaterEqualW(by, zero));
+
+			b2FloatW xx = b2SelectW(case1, x1x, b2SelectW(case2, x2x, zero));
+			b2FloatW xy = b2SelectW(case1, x1y, b2SelectW(case2, zero, b2SelectW(case3, x3y, zero)));
+
+			// Lanes without a solution are left unchanged.
+			b2MaskW solved = b2AndW(twoPoints, b2OrW(b2OrW(case1, case2), b2OrW(case3, case4)));
+
+			// Get the incremental impulse
+			b2FloatW dx = b2SubW(xx, ax);
+			b2FloatW dy = b2SubW(xy, ay);
+
+			// Apply incremental impulse
+			b2FloatW P1x = b2MulW(dx, normalx);
+			b2FloatW P1y = b2MulW(dx, normaly);
+			b2FloatW P2x = b2MulW(dy, normalx);
+			b2FloatW P2y = b2MulW(dy, normaly);
+			b2FloatW crossA = b2AddW(b2CrossW(b2LoadW(cp1->rAx), b2LoadW(cp1->rAy), P1x, P1y),
+				b2CrossW(b2LoadW(cp2->rAx), b2LoadW(cp2->rAy), P2x, P2y));
+			b2FloatW crossB = b2AddW(b2CrossW(b2LoadW(cp1->rBx), b2LoadW(cp1->rBy), P1x, P1y),
+				b2CrossW(b2LoadW(cp2->rBx), b2LoadW(cp2->rBy), P2x, P2y));
+			b2ApplyWideImpulse(v, solved, mA, iA, mB, iB, b2AddW(P1x, P2x), b2AddW(P1y, P2y), crossA, crossB);
+
+			// Accumulate
+			b2StoreW(cp1->normalImpulse, b2SelectW(solved, xx, ax));
+			b2StoreW(cp2->normalImpulse, b2SelectW(solved, xy, ay));
+		}
+
+		// Scatter the body velocities.
+		b2StoreW(vAx, v.vAx);
+		b2StoreW(vAy, v.vAy);
+		b2StoreW(wA, v.wA);
+		b2StoreW(vBx, v.vBx);
+		b2StoreW(vBy, v.vBy);
+		b2StoreW(wB, v.wB);
+		for (int32 lane = 0; lane < b2_wideLaneCount; ++lane)
+		{
+			if (wc->pointCount[lane] == 0)
+			{
+				continue;
+			}
+
+			if (wc->invMassA[lane] != 0.0f || wc->invIA[lane] != 0.0f)
+			{
+				b2Velocity& velocityA = m_velocities[wc->indexA[lane]];
+				velocityA.v.Set(vAx[lane], vAy[lane]);
+				velocityA.w = wA[lane];
+			}
+
+			if (wc->invMassB[lane] != 0.0f || wc->invIB[lane] != 0.0f)
+			{
+				b2Velocity& velocityB = m_velocities[wc->indexB[lane]];
+				velocityB.v.Set(vBx[lane], vBy[lane]);
+				velocityB.w = wB[lane];
+			}
+		}
+	}
+}
+
+void b2ContactSolver::StoreWideImpulses()
+{
+	b2Assert(m_wideConstraints != nullptr);
+
+	for (int32 i = 0; i < m_wideCount; ++i)
+	{
+		const b2WideContactConstraint* wc = m_wideConstraints + i;
+		for (int32 lane = 0; lane < b2_wideLaneCount; ++lane)
+		{
+			if (wc->pointCount[lane] == 0)
+			{
+				continue;
+			}
+
+			b2ContactVelocityConstraint* vc = m_velocityConstraints + wc->constraintIndex[lane];
+			for (int32 j = 0; j < vc->pointCount; ++j)
+			{
+				vc->points[j].normalImpulse = wc->points[j].normalImpulse[lane];
+				vc->points[j].tangentImpulse = wc->points[j].tangentImpulse[lane];
+			}
+		}
+	}
+}
+
 struct b2PositionSolverManifold
 {
 	void Initialize(b2ContactPositionConstraint* pc, const b2Transform& xfA, const b2Transform& xfB, int32 index)
@@ -674,10 +1074,15 @@ struct b2PositionSolverManifold
 
 // Sequential solver.
 bool b2ContactSolver::SolvePositionConstraints()
+{
+	return SolvePositionConstraints(0, m_count);
+}
+
+bool b2ContactSolver::SolvePositionConstraints(int32 begin, int32 end)
 {
 	float32 minSeparation = 0.0f;
 
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = begin; i < end; ++i)
 	{
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
 
@@ -739,11 +1144,17 @@ bool b2ContactSolver::SolvePositionConstraints()
 			aB += iB * b2Cross(rB, P);
 		}
 
-		m_positions[indexA].c = cA;
-		m_positions[indexA].a = aA;
+		if (mA != 0.0f || iA != 0.0f)
+		{
+			m_positions[indexA].c = cA;
+			m_positions[indexA].a = aA;
+		}
 
-		m_positions[indexB].c = cB;
-		m_positions[indexB].a = aB;
+		if (mB != 0.0f || iB != 0.0f)
+		{
+			m_positions[indexB].c = cB;
+			m_positions[indexB].a = aB;
+		}
 	}
 
 	// We can't expect minSpeparation >= -b2_linearSlop because we don't
@@ -27,6 +27,7 @@ class b2Contact;
 class b2Body;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2WideContactConstraint;
 
 struct b2VelocityConstraintPoint
 {
@@ -80,6 +81,22 @@ public:
 	void StoreImpulses();
 
 	bool SolvePositionConstraints();
+
+	// Solve the constraints in [begin, end). Ranges that don't share dynamic bodies
+	// can be solved at the same time.
+	void SolveVelocityConstraints(int32 begin, int32 end);
+	bool SolvePositionConstraints(int32 begin, int32 end);
+
+	// Pack the velocity constraints into batches that are solved with wide math. Color i holds the
+	// constraints in [colorBegin[i], colorBegin[i + 1]), which must not share dynamic bodies.
+	void PrepareWideConstraints(const int32* colorBegin, int32 colorCount);
+
+	// Solve the batches in [begin, end). The batches of color i are [m_wideBegin[i], m_wideBegin[i + 1]).
+	void SolveWideVelocityConstraints(int32 begin, int32 end);
+
+	// Copy the batched impulses back to the velocity constraints.
+	void StoreWideImpulses();
+
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
 	b2TimeStep m_step;
@@ -90,6 +107,9 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+	b2WideContactConstraint* m_wideConstraints;
+	int32 m_wideBegin[b2_maxConstraintColors + 1];
+	int32 m_wideCount;
 };
 
 #endif
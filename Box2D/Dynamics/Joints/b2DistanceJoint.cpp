@@ -18,6 +18,7 @@
 */
 
 #include "Box2D/Dynamics/Joints/b2DistanceJoint.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
 
@@ -149,10 +150,16 @@ void b2DistanceJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_impulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2DistanceJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -176,10 +183,16 @@ void b2DistanceJoint::SolveVelocityConstraints(const b2SolverData& data)
 	vB += m_invMassB * P;
 	wB += m_invIB * b2Cross(m_rB, P);
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2DistanceJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -213,10 +226,16 @@ bool b2DistanceJoint::SolvePositionConstraints(const b2SolverData& data)
 	cB += m_invMassB * P;
 	aB += m_invIB * b2Cross(rB, P);
 
-	data.positions[m_indexA].c = cA;
-	data.positions[m_indexA].a = aA;
-	data.positions[m_indexB].c = cB;
-	data.positions[m_indexB].a = aB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.positions[m_indexA].c = cA;
+		data.positions[m_indexA].a = aA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.positions[m_indexB].c = cB;
+		data.positions[m_indexB].a = aB;
+	}
 
 	return b2Abs(C) < b2_linearSlop;
 }
@@ -259,3 +278,15 @@ void b2DistanceJoint::Dump()
 	b2Log("  jd.dampingRatio = %.15lef;\n", m_dampingRatio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2DistanceJoint::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_frequencyHz);
+	stream.Transfer(m_dampingRatio);
+	stream.Transfer(m_bias);
+	stream.Transfer(m_localAnchorA);
+	stream.Transfer(m_localAnchorB);
+	stream.Transfer(m_gamma);
+	stream.Transfer(m_impulse);
+	stream.Transfer(m_length);
+}
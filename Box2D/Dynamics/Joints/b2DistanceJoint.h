@@ -109,6 +109,7 @@ protected:
 	void InitVelocityConstraints(const b2SolverData& data) override;
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
+	void TransferState(b2SnapshotStream& stream) override;
 
 	float32 m_frequencyHz;
 	float32 m_dampingRatio;
@@ -18,6 +18,7 @@
 */
 
 #include "Box2D/Dynamics/Joints/b2FrictionJoint.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
 
@@ -123,10 +124,16 @@ void b2FrictionJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_angularImpulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -180,10 +187,16 @@ void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
 		wB += iB * b2Cross(m_rB, impulse);
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2FrictionJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -250,3 +263,13 @@ void b2FrictionJoint::Dump()
 	b2Log("  jd.maxTorque = %.15lef;\n", m_maxTorque);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2FrictionJoint::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_localAnchorA);
+	stream.Transfer(m_localAnchorB);
+	stream.Transfer(m_linearImpulse);
+	stream.Transfer(m_angularImpulse);
+	stream.Transfer(m_maxForce);
+	stream.Transfer(m_maxTorque);
+}
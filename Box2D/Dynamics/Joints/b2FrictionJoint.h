@@ -91,6 +91,7 @@ protected:
 	void InitVelocityConstraints(const b2SolverData& data) override;
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
+	void TransferState(b2SnapshotStream& stream) override;
 
 	b2Vec2 m_localAnchorA;
 	b2Vec2 m_localAnchorB;
@@ -18,6 +18,7 @@
 */
 
 #include "Box2D/Dynamics/Joints/b2GearJoint.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Dynamics/Joints/b2RevoluteJoint.h"
 #include "Box2D/Dynamics/Joints/b2PrismaticJoint.h"
 #include "Box2D/Dynamics/b2Body.h"
@@ -418,3 +419,20 @@ void b2GearJoint::Dump()
 	b2Log("  jd.ratio = %.15lef;\n", m_ratio);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2GearJoint::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_typeA);
+	stream.Transfer(m_typeB);
+	stream.Transfer(m_localAnchorA);
+	stream.Transfer(m_localAnchorB);
+	stream.Transfer(m_localAnchorC);
+	stream.Transfer(m_localAnchorD);
+	stream.Transfer(m_localAxisC);
+	stream.Transfer(m_localAxisD);
+	stream.Transfer(m_referenceAngleA);
+	stream.Transfer(m_referenceAngleB);
+	stream.Transfer(m_constant);
+	stream.Transfer(m_ratio);
+	stream.Transfer(m_impulse);
+}
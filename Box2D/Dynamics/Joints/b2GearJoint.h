@@ -83,6 +83,7 @@ protected:
 	void InitVelocityConstraints(const b2SolverData& data) override;
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
+	void TransferState(b2SnapshotStream& stream) override;
 
 	b2Joint* m_joint1;
 	b2Joint* m_joint2;
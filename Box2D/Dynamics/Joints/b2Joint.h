@@ -25,6 +25,7 @@ class b2Body;
 class b2Joint;
 struct b2SolverData;
 class b2BlockAllocator;
+class b2SnapshotStream;
 
 enum b2JointType
 {
@@ -153,6 +154,7 @@ protected:
 	friend class b2World;
 	friend class b2Body;
 	friend class b2Island;
+	friend class b2SolveConstraintColorTask;
 	friend class b2GearJoint;
 
 	static b2Joint* Create(const b2JointDef* def, b2BlockAllocator* allocator);
@@ -161,12 +163,18 @@ protected:
 	b2Joint(const b2JointDef* def);
 	virtual ~b2Joint() {}
 
+	// Joints other than gear joints are solved in parallel with other joints that can share
+	// their static or kinematic bodies, so the state of those bodies must not be written back.
 	virtual void InitVelocityConstraints(const b2SolverData& data) = 0;
 	virtual void SolveVelocityConstraints(const b2SolverData& data) = 0;
 
 	// This returns true if the position errors are within tolerance.
 	virtual bool SolvePositionConstraints(const b2SolverData& data) = 0;
 
+	// Read or write the state that isn't set by the joint definition, which is the
+	// configuration that can be changed after creation and the accumulated impulses.
+	virtual void TransferState(b2SnapshotStream& stream) = 0;
+
 	b2JointType m_type;
 	b2Joint* m_prev;
 	b2Joint* m_next;
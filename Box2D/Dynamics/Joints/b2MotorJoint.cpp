@@ -18,6 +18,7 @@
 */
 
 #include "Box2D/Dynamics/Joints/b2MotorJoint.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
 
@@ -138,10 +139,16 @@ void b2MotorJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_angularImpulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2MotorJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -196,10 +203,16 @@ void b2MotorJoint::SolveVelocityConstraints(const b2SolverData& data)
 		wB += iB * b2Cross(m_rB, impulse);
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2MotorJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -308,3 +321,14 @@ void b2MotorJoint::Dump()
 	b2Log("  jd.correctionFactor = %.15lef;\n", m_correctionFactor);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2MotorJoint::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_linearOffset);
+	stream.Transfer(m_angularOffset);
+	stream.Transfer(m_linearImpulse);
+	stream.Transfer(m_angularImpulse);
+	stream.Transfer(m_maxForce);
+	stream.Transfer(m_maxTorque);
+	stream.Transfer(m_correctionFactor);
+}
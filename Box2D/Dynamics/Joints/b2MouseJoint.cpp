@@ -18,6 +18,7 @@
 */
 
 #include "Box2D/Dynamics/Joints/b2MouseJoint.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
 
@@ -162,8 +163,11 @@ void b2MouseJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_impulse.SetZero();
 	}
 
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -187,8 +191,11 @@ void b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
 	vB += m_invMassB * impulse;
 	wB += m_invIB * b2Cross(m_rB, impulse);
 
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2MouseJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -221,3 +228,15 @@ void b2MouseJoint::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_targetA -= newOrigin;
 }
+
+void b2MouseJoint::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_localAnchorB);
+	stream.Transfer(m_targetA);
+	stream.Transfer(m_frequencyHz);
+	stream.Transfer(m_dampingRatio);
+	stream.Transfer(m_beta);
+	stream.Transfer(m_impulse);
+	stream.Transfer(m_maxForce);
+	stream.Transfer(m_gamma);
+}
@@ -18,6 +18,7 @@
 */
 
 #include "Box2D/Dynamics/Joints/b2PrismaticJoint.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
 
@@ -255,10 +256,16 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_motorImpulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2PrismaticJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -352,10 +359,16 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2SolverData& data)
 		wB += iB * LB;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 // A velocity based solver computes reaction forces(impulses) using the velocity constraint solver.Under this context,
@@ -481,10 +494,16 @@ bool b2PrismaticJoint::SolvePositionConstraints(const b2SolverData& data)
 	cB += mB * P;
 	aB += iB * LB;
 
-	data.positions[m_indexA].c = cA;
-	data.positions[m_indexA].a = aA;
-	data.positions[m_indexB].c = cB;
-	data.positions[m_indexB].a = aB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.positions[m_indexA].c = cA;
+		data.positions[m_indexA].a = aA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.positions[m_indexB].c = cB;
+		data.positions[m_indexB].a = aB;
+	}
 
 	return linearError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
@@ -641,3 +660,21 @@ void b2PrismaticJoint::Dump()
 	b2Log("  jd.maxMotorForce = %.15lef;\n", m_maxMotorForce);
 	b2Log("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2PrismaticJoint::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_localAnchorA);
+	stream.Transfer(m_localAnchorB);
+	stream.Transfer(m_localXAxisA);
+	stream.Transfer(m_localYAxisA);
+	stream.Transfer(m_referenceAngle);
+	stream.Transfer(m_impulse);
+	stream.Transfer(m_motorImpulse);
+	stream.Transfer(m_lowerTranslation);
+	stream.Transfer(m_upperTranslation);
+	stream.Transfer(m_maxMotorForce);
+	stream.Transfer(m_motorSpeed);
+	stream.Transfer(m_enableLimit);
+	stream.Transfer(m_enableMotor);
+	stream.Transfer(m_limitState);
+}
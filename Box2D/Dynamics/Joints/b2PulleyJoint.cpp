@@ -18,6 +18,7 @@
 */
 
 #include "Box2D/Dynamics/Joints/b2PulleyJoint.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
 
@@ -155,10 +156,16 @@ void b2PulleyJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_impulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2PulleyJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -182,10 +189,16 @@ void b2PulleyJoint::SolveVelocityConstraints(const b2SolverData& data)
 	vB += m_invMassB * PB;
 	wB += m_invIB * b2Cross(m_rB, PB);
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2PulleyJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -252,10 +265,16 @@ bool b2PulleyJoint::SolvePositionConstraints(const b2SolverData& data)
 	cB += m_invMassB * PB;
 	aB += m_invIB * b2Cross(rB, PB);
 
-	data.positions[m_indexA].c = cA;
-	data.positions[m_indexA].a = aA;
-	data.positions[m_indexB].c = cB;
-	data.positions[m_indexB].a = aB;
+	if (m_invMassA != 0.0f || m_invIA != 0.0f)
+	{
+		data.positions[m_indexA].c = cA;
+		data.positions[m_indexA].a = aA;
+	}
+	if (m_invMassB != 0.0f || m_invIB != 0.0f)
+	{
+		data.positions[m_indexB].c = cB;
+		data.positions[m_indexB].a = aB;
+	}
 
 	return linearError < b2_linearSlop;
 }
@@ -347,3 +366,16 @@ void b2PulleyJoint::ShiftOrigin(const b2Vec2& newOrigin)
 	m_groundAnchorA -= newOrigin;
 	m_groundAnchorB -= newOrigin;
 }
+
+void b2PulleyJoint::TransferState(b2SnapshotStream& stream)
+{
+	stream.Transfer(m_groundAnchorA);
+	stream.Transfer(m_groundAnchorB);
+	stream.Transfer(m_lengthA);
+	stream.Transfer(m_lengthB);
+	stream.Transfer(m_localAnchorA);
+	stream.Transfer(m_localAnchorB);
+	stream.Transfer(m_constant);
+	stream.Transfer(m_ratio);
+	stream.Transfer(m_impulse);
+}
@@ -105,7 +105,8 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_fixtureList = nullptr;
 	m_fixtureCount = 0;
 
-	memset(m_islandIndex, 0, sizeof(m_islandIndex));
+	m_islandIndex = 0;
+	m_staticIslandIndices = nullptr;
 
 	m_worldIndex = -1;
 }
@@ -128,9 +129,11 @@ void b2Body::SetType(b2BodyType type)
 		return;
 	}
 
-	if (GetType() == b2_staticBody)
+	bool wasStatic = GetType() == b2_staticBody;
+	if (wasStatic)
 	{
 		// Remove from static bodies.
+		m_world->FreeStaticIslandIndices(this);
 		m_world->m_staticBodies.back()->m_worldIndex = m_worldIndex;
 		b2RemoveAndSwapBack(m_world->m_staticBodies, m_worldIndex);
 
@@ -158,6 +161,7 @@ void b2Body::SetType(b2BodyType type)
 		// Add to static bodies.
 		m_worldIndex = m_world->m_staticBodies.size();
 		m_world->m_staticBodies.push_back(this);
+		m_world->AllocateStaticIslandIndices(this);
 	}
 
 	SetAwake(true);
@@ -175,8 +179,22 @@ void b2Body::SetType(b2BodyType type)
 	}
 	m_contactList = nullptr;
 
-	// Touch the proxies so that new contacts will be created (when appropriate)
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+	if (broadPhase->GetSeparateStaticTree() && wasStatic != (GetType() == b2_staticBody))
+	{
+		// Move the proxies to the other tree. New proxies are buffered for new contacts.
+		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+		{
+			f->DestroyProxies(broadPhase);
+			if (IsActive())
+			{
+				f->CreateProxies(broadPhase, m_xf);
+			}
+		}
+		return;
+	}
+
+	// Touch the proxies so that new contacts will be created (when appropriate)
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
 		int32 proxyCount = f->m_proxyCount;
@@ -648,7 +666,7 @@ void b2Body::Dump()
 	b2Log("  bd.bullet = bool(%d);\n", m_flags & e_bulletFlag);
 	b2Log("  bd.active = bool(%d);\n", m_flags & e_activeFlag);
 	b2Log("  bd.gravityScale = %.15lef;\n", m_gravityScale);
-	b2Log("  bodies[%d] = m_world->CreateBody(&bd);\n", m_islandIndex);
+	b2Log("  bodies[%d] = m_world->CreateBody(&bd);\n", bodyIndex);
 	b2Log("\n");
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
@@ -423,6 +423,7 @@ private:
 	friend class b2ClearBodySolveTOIFlags;
 	friend class b2ClearForcesTask;
 	friend class b2FindMinToiContactTask;
+	friend class b2FindToiEventsTask;
 
 	friend class b2DistanceJoint;
 	friend class b2FrictionJoint;
@@ -445,7 +446,8 @@ private:
 		e_autoSleepFlag		= 0x0004,
 		e_bulletFlag		= 0x0008,
 		e_fixedRotationFlag	= 0x0010,
-		e_activeFlag		= 0x0020
+		e_activeFlag		= 0x0020,
+		e_activityChangedFlag	= 0x0040
 	};
 
 	b2Body(const b2BodyDef* bd, b2World* world);
@@ -494,7 +496,11 @@ private:
 
 	float32 m_sleepTime;
 
-	int32 m_islandIndex[b2_maxThreads];
+	int32 m_islandIndex;
+
+	// Static bodies can be in multiple islands that are solved simultaneously,
+	// so they get an island index per thread. This is null for other body types.
+	int32* m_staticIslandIndices;
 
 	int32 m_worldIndex;
 
@@ -983,12 +989,23 @@ inline const b2World* b2Body::GetWorld() const
 
 inline int32 b2Body::GetIslandIndex(int32 threadId) const
 {
-	return m_islandIndex[threadId];
+	if (m_staticIslandIndices)
+	{
+		return m_staticIslandIndices[threadId];
+	}
+	return m_islandIndex;
 }
 
 inline void b2Body::SetIslandIndex(int32 islandIndex, int32 threadId)
 {
-	m_islandIndex[threadId] = islandIndex;
+	if (m_staticIslandIndices)
+	{
+		m_staticIslandIndices[threadId] = islandIndex;
+	}
+	else
+	{
+		m_islandIndex = islandIndex;
+	}
 }
 
 #endif
@@ -17,14 +17,19 @@
 * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#include "Box2D/Collision/Shapes/b2PolygonShape.h"
+#include "Box2D/Common/b2BlockAllocator.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Common/b2Timer.h"
 #include "Box2D/Common/b2StackAllocator.h"
+#include "Box2D/Common/b2WideMath.h"
 #include "Box2D/Dynamics/b2ContactManager.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2Fixture.h"
 #include "Box2D/Dynamics/Contacts/b2Contact.h"
 #include "Box2D/MT/b2MtUtil.h"
 #include "Box2D/MT/b2ThreadDataSorter.h"
+#include <algorithm>
 
 /// A do-nothing contact listener.
 class b2DefaultContactListener : public b2ContactListener
@@ -63,32 +68,58 @@ b2DefaultContactListener b2_defaultListener;
 
 bool b2ContactPointerLessThan(const b2Contact* a, const b2Contact* b)
 {
-	return a->m_proxyIds < b->m_proxyIds;
+	return a->m_states->m_proxyIds[a->m_managerIndex] < b->m_states->m_proxyIds[b->m_managerIndex];
 }
 
-bool b2DeferredContactCreateLessThan(const b2DeferredContactCreate& a, const b2DeferredContactCreate& b)
+// Proxy ids are never negative here, so the unsigned key has the same order as the ids.
+inline uint64 b2ProxyIdsSortKey(const b2ContactProxyIds& proxyIds)
 {
-	return a.proxyIds < b.proxyIds;
+	b2Assert(proxyIds.low >= 0 && proxyIds.high >= 0);
+	return ((uint64)(uint32)proxyIds.low << 32) | (uint32)proxyIds.high;
 }
 
-bool b2DeferredMoveProxyLessThan(const b2DeferredMoveProxy& a, const b2DeferredMoveProxy& b)
+uint64 b2ContactSortKey(const b2Contact* c)
 {
-	return a.proxyId < b.proxyId;
+	return b2ProxyIdsSortKey(c->m_states->m_proxyIds[c->m_managerIndex]);
+}
+
+uint64 b2DeferredContactCreateSortKey(const b2DeferredContactCreate& create)
+{
+	return b2ProxyIdsSortKey(create.proxyIds);
+}
+
+uint64 b2DeferredMoveProxySortKey(const b2DeferredMoveProxy& move)
+{
+	b2Assert(move.proxyId >= 0);
+	return (uint32)move.proxyId;
 }
 
-bool b2DeferredPreSolveLessThan(const b2DeferredPreSolve& a, const b2DeferredPreSolve& b)
+uint64 b2DeferredPreSolveSortKey(const b2DeferredPreSolve& preSolve)
 {
-	return b2ContactPointerLessThan(a.contact, b.contact);
+	return b2ContactSortKey(preSolve.contact);
 }
 
-bool b2DeferredPostSolveLessThan(const b2DeferredPostSolve& a, const b2DeferredPostSolve& b)
+uint64 b2DeferredPostSolveSortKey(const b2DeferredPostSolve& postSolve)
 {
-	return b2ContactPointerLessThan(a.contact, b.contact);
+	return b2ContactSortKey(postSolve.contact);
 }
 
 bool b2ToiContactPointerLessThan(const b2Contact* a, const b2Contact* b)
 {
-	return b2Contact::ToiLessThan(a->m_toi, a, b->m_toi, b);
+	float32 toiA = a->m_states->m_tois[a->m_managerIndex].toi;
+	float32 toiB = b->m_states->m_tois[b->m_managerIndex].toi;
+	return b2Contact::ToiLessThan(toiA, a, toiB, b);
+}
+
+inline int32 b2ContactManager::GetPartition(uint32 flags)
+{
+	// Contacts flagged for filtering are collided even if they're inactive.
+	bool skip = (flags & (b2Contact::e_inactiveFlag | b2Contact::e_filterFlag)) == b2Contact::e_inactiveFlag;
+	if (flags & b2Contact::e_toiCandidateFlag)
+	{
+		return skip ? e_inactiveToiPartition : e_activeToiPartition;
+	}
+	return skip ? e_inactiveNonToiPartition : e_activeNonToiPartition;
 }
 
 inline bool b2ContactManager::IsContactActive(b2Contact* c)
@@ -106,15 +137,41 @@ inline bool b2ContactManager::IsContactActive(b2Contact* c)
 	return false;
 }
 
+// Polygon contacts that generate manifolds can be evaluated together by b2CollidePolygonsWide.
+inline bool b2ContactManager::IsWidePolygonContact(b2Contact* c)
+{
+	b2Fixture* fixtureA = c->m_fixtureA;
+	b2Fixture* fixtureB = c->m_fixtureB;
+	return fixtureA->GetType() == b2Shape::e_polygon && fixtureB->GetType() == b2Shape::e_polygon &&
+		fixtureA->IsSensor() == false && fixtureB->IsSensor() == false;
+}
+
 b2ContactManager::b2ContactManager()
-	: m_perThreadData{}
 {
 	m_contactList = nullptr;
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
-	m_allocator = nullptr;
 	m_deferCreates = false;
+	m_inactiveToiCount = 0;
 	m_toiCount = 0;
+	m_activeEnd = 0;
+	m_activityChanges = nullptr;
+	m_activityChangeCapacity = 0;
+	m_activityChangeCount = 0;
+
+	// Create the contact allocators for the initial thread count.
+	SetThreadCount(m_perThreadData.size());
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	// Contacts aren't destroyed with the world, so their memory is released with the allocators.
+	for (uint32 i = 0; i < m_contactAllocators.size(); ++i)
+	{
+		m_contactAllocators[i]->~b2BlockAllocator();
+		b2Free(m_contactAllocators[i]);
+	}
+	b2Free(m_activityChanges);
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -129,8 +186,12 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
+	// The manifold is discarded with the contact's slot in the contact array.
+	bool wake = c->GetManifold()->pointCount > 0 && fixtureA->IsSensor() == false && fixtureB->IsSensor() == false;
+
 	// Remove from the world.
 	RemoveFromContactList(c);
+	m_pairSet.Remove(m_contactStates.m_proxyIds[c->m_managerIndex], c);
 	RemoveFromContactArray(c);
 
 	// Remove from body 1
@@ -165,8 +226,14 @@ void b2ContactManager::Destroy(b2Contact* c)
 		bodyB->m_contactList = c->m_nodeB.next;
 	}
 
+	if (wake)
+	{
+		bodyA->SetAwake(true);
+		bodyB->SetAwake(true);
+	}
+
 	// Call the factory.
-	b2Contact::Destroy(c, m_allocator);
+	b2Contact::Destroy(c, c->m_allocator);
 
 	SanityCheck();
 }
@@ -178,19 +245,34 @@ void b2ContactManager::Collide(uint32 contactsBegin, uint32 contactsEnd, uint32
 {
 	b2ContactManagerPerThreadData& td = m_perThreadData[threadId];
 
+	// Polygon contacts are batched so their manifolds can be computed in SIMD lanes.
+	b2Contact* polygonContacts[b2_wideLaneCount];
+	int32 polygonCount = 0;
+
+	// The flags and proxy ids are read from the state arrays, so inactive contacts and contacts
+	// that stopped overlapping are found without touching the contact.
+	uint32* flags = m_contactStates.m_flags.data();
+	const b2ContactProxyIds* proxyIds = m_contactStates.m_proxyIds.data();
+
 	// Update awake contacts.
 	for (uint32 i = contactsBegin; i < contactsEnd; ++i)
 	{
-		b2Contact* c = m_contacts[i];
+		if ((flags[i] & (b2Contact::e_inactiveFlag | b2Contact::e_filterFlag)) == b2Contact::e_inactiveFlag)
+		{
+			b2Assert(IsContactActive(m_contacts[i]) == false);
+			continue;
+		}
 
-		b2Fixture* fixtureA = c->GetFixtureA();
-		b2Fixture* fixtureB = c->GetFixtureB();
-		b2Body* bodyA = fixtureA->GetBody();
-		b2Body* bodyB = fixtureB->GetBody();
+		b2Contact* c = m_contacts[i];
 
 		// Is this contact flagged for filtering?
-		if (c->m_flags & b2Contact::e_filterFlag)
+		if (flags[i] & b2Contact::e_filterFlag)
 		{
+			b2Fixture* fixtureA = c->GetFixtureA();
+			b2Fixture* fixtureB = c->GetFixtureB();
+			b2Body* bodyA = fixtureA->GetBody();
+			b2Body* bodyB = fixtureB->GetBody();
+
 			// Should these bodies collide?
 			if (bodyB->ShouldCollide(bodyA) == false)
 			{
@@ -206,16 +288,19 @@ void b2ContactManager::Collide(uint32 contactsBegin, uint32 contactsEnd, uint32
 			}
 
 			// Clear the filtering flag.
-			c->m_flags &= ~b2Contact::e_filterFlag;
-		}
+			flags[i] &= ~b2Contact::e_filterFlag;
 
-		if (c->m_flags & b2Contact::e_inactiveFlag)
-		{
-			b2Assert(IsContactActive(c) == false);
-			continue;
+			if (flags[i] & b2Contact::e_inactiveFlag)
+			{
+				// FlagForFiltering moved the contact into the active range. Its body is marked
+				// later so that the contact is moved back to its inactive partition.
+				b2Assert(IsContactActive(c) == false);
+				td.m_filteredInactives.push_back(c);
+				continue;
+			}
 		}
 
-		bool overlap = m_broadPhase.TestOverlap(c->m_proxyIds.low, c->m_proxyIds.high);
+		bool overlap = m_broadPhase.TestOverlap(proxyIds[i].low, proxyIds[i].high);
 
 		// Here we destroy contacts that cease to overlap in the broad-phase.
 		if (overlap == false)
@@ -225,8 +310,62 @@ void b2ContactManager::Collide(uint32 contactsBegin, uint32 contactsEnd, uint32
 		}
 
 		// The contact persists.
+		if (IsWidePolygonContact(c))
+		{
+			polygonContacts[polygonCount++] = c;
+			if (polygonCount == b2_wideLaneCount)
+			{
+				UpdatePolygonContacts(polygonContacts, polygonCount, threadId);
+				polygonCount = 0;
+			}
+			continue;
+		}
+
 		c->Update(td, m_contactListener, threadId);
 	}
+
+	if (polygonCount > 0)
+	{
+		UpdatePolygonContacts(polygonContacts, polygonCount, threadId);
+	}
+}
+
+void b2ContactManager::UpdatePolygonContacts(b2Contact** contacts, int32 count, uint32 threadId)
+{
+	b2ContactManagerPerThreadData& td = m_perThreadData[threadId];
+
+	b2Manifold manifolds[b2_wideLaneCount];
+	const b2PolygonShape* polygonsA[b2_wideLaneCount];
+	const b2PolygonShape* polygonsB[b2_wideLaneCount];
+	b2Transform xfsA[b2_wideLaneCount];
+	b2Transform xfsB[b2_wideLaneCount];
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Contact* c = contacts[i];
+
+		// Start from the old manifold so that unwritten fields match what Evaluate would leave.
+		manifolds[i] = *c->GetManifold();
+		polygonsA[i] = (const b2PolygonShape*)c->m_fixtureA->GetShape();
+		polygonsB[i] = (const b2PolygonShape*)c->m_fixtureB->GetShape();
+		xfsA[i] = c->m_fixtureA->GetBody()->GetTransform();
+		xfsB[i] = c->m_fixtureB->GetBody()->GetTransform();
+	}
+
+	// Unused lanes repeat the first pair and their results are ignored.
+	for (int32 i = count; i < b2_wideLaneCount; ++i)
+	{
+		polygonsA[i] = polygonsA[0];
+		polygonsB[i] = polygonsB[0];
+		xfsA[i] = xfsA[0];
+		xfsB[i] = xfsB[0];
+	}
+
+	b2CollidePolygonsWide(manifolds, polygonsA, xfsA, polygonsB, xfsB, count);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		contacts[i]->Update(td, m_contactListener, threadId, manifolds[i]);
+	}
 }
 
 void b2ContactManager::FindNewContacts(uint32 moveBegin, uint32 moveEnd, uint32 threadId)
@@ -253,24 +392,10 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB, uint3
 
 	b2ContactProxyIds proxyIds(proxyA->proxyId, proxyB->proxyId);
 
-	// TODO_ERIN use a hash table to remove a potential bottleneck when both
-	// bodies have a lot of contacts.
-	// Does a contact already exist?
-	b2ContactEdge* edge = bodyB->GetContactList();
-	while (edge)
+	// Does a contact already exist? The pair set isn't modified while pairs are being found.
+	if (m_pairSet.Find(proxyIds) != nullptr)
 	{
-		if (edge->other == bodyA)
-		{
-			const b2ContactProxyIds& edgeProxyIds = edge->contact->m_proxyIds;
-
-			if (edgeProxyIds == proxyIds)
-			{
-				// A contact already exists.
-				return;
-			}
-		}
-
-		edge = edge->next;
+		return;
 	}
 
 	// Does a joint override collision? Is at least one body dynamic?
@@ -290,18 +415,22 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB, uint3
 
 	if (m_deferCreates)
 	{
+		// Create the contact now, but link it to the world in a deterministic order later.
+		b2Contact* c = b2Contact::Create(fixtureA, indexA, fixtureB, indexB, GetContactAllocator(threadId));
+		if (c == nullptr)
+		{
+			return;
+		}
+
 		b2DeferredContactCreate deferredCreate;
-		deferredCreate.fixtureA = proxyA->fixture;
-		deferredCreate.fixtureB = proxyB->fixture;
-		deferredCreate.indexA = indexA;
-		deferredCreate.indexB = indexB;
+		deferredCreate.contact = c;
 		deferredCreate.proxyIds = proxyIds;
 		m_perThreadData[threadId].m_creates.push_back(deferredCreate);
 	}
 	else
 	{
 		// Call the factory.
-		b2Contact* c = b2Contact::Create(fixtureA, indexA, fixtureB, indexB, m_allocator);
+		b2Contact* c = b2Contact::Create(fixtureA, indexA, fixtureB, indexB, GetContactAllocator(threadId));
 		if (c == nullptr)
 		{
 			return;
@@ -367,7 +496,7 @@ void b2ContactManager::FinishFindNewContacts(b2TaskExecutor& executor, b2TaskGro
 {
 	m_broadPhase.ResetBuffers();
 	auto creates = b2MakeStackAllocThreadDataSorter<b2DeferredContactCreate>(m_perThreadData,
-		&b2ContactManagerPerThreadData::m_creates, b2DeferredContactCreateLessThan, allocator);
+		&b2ContactManagerPerThreadData::m_creates, b2DeferredContactCreateSortKey, allocator);
 
 	b2Sort(creates, executor, taskGroup, allocator);
 
@@ -375,29 +504,31 @@ void b2ContactManager::FinishFindNewContacts(b2TaskExecutor& executor, b2TaskGro
 
 	for (auto it = creates.begin(); it != creates.end(); ++it)
 	{
+		// The same pair can be found by more than one thread.
 		if (it->proxyIds == prevIds)
 		{
+			b2Contact::Destroy(it->contact, it->contact->m_allocator);
 			continue;
 		}
 		prevIds = it->proxyIds;
 
-		ConsumeCreate(*it);
+		OnContactCreate(it->contact, it->proxyIds);
 	}
 }
 
 void b2ContactManager::FinishCollide(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator)
 {
 	auto begins = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
-		&b2ContactManagerPerThreadData::m_beginContacts, b2ContactPointerLessThan, allocator);
+		&b2ContactManagerPerThreadData::m_beginContacts, b2ContactSortKey, allocator);
 
 	auto ends = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
-		&b2ContactManagerPerThreadData::m_endContacts, b2ContactPointerLessThan, allocator);
+		&b2ContactManagerPerThreadData::m_endContacts, b2ContactSortKey, allocator);
 
 	auto preSolves = b2MakeStackAllocThreadDataSorter<b2DeferredPreSolve>(m_perThreadData,
-		&b2ContactManagerPerThreadData::m_preSolves, b2DeferredPreSolveLessThan, allocator);
+		&b2ContactManagerPerThreadData::m_preSolves, b2DeferredPreSolveSortKey, allocator);
 
 	auto destroys = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
-		&b2ContactManagerPerThreadData::m_destroys, b2ContactPointerLessThan, allocator);
+		&b2ContactManagerPerThreadData::m_destroys, b2ContactSortKey, allocator);
 
 	while (true)
 	{
@@ -436,25 +567,153 @@ void b2ContactManager::FinishCollide(b2TaskExecutor& executor, b2TaskGroup* task
 	{
 		Destroy(*it);
 	}
+
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		b2GrowableArray<b2Contact*>& filteredInactives = m_perThreadData[i].m_filteredInactives;
+		while (filteredInactives.size())
+		{
+			b2Contact* c = filteredInactives.pop_back();
+			MarkActivityChanged(c->GetFixtureA()->GetBody());
+		}
+	}
+}
+
+#ifdef b2_dynamicTreeOfTrees
+// A move that stays within one sub-tree.
+struct b2SubTreeMove
+{
+	int32 subTree;
+	int32 proxyId;
+	b2AABB fatAABB;
+};
+
+inline bool b2SubTreeMoveLessThan(const b2SubTreeMove& a, const b2SubTreeMove& b)
+{
+	if (a.subTree != b.subTree)
+	{
+		return a.subTree < b.subTree;
+	}
+	return a.proxyId < b.proxyId;
 }
 
+// Moves the proxies of a range of sub-trees. Each sub-tree is only modified by one task.
+class b2MoveProxiesTask : public b2RangeTask
+{
+public:
+	b2MoveProxiesTask() {}
+	b2MoveProxiesTask(const b2RangeTaskRange& range, b2BroadPhase* broadPhase,
+		const b2SubTreeMove* moves, const int32* groupBegins)
+		: b2RangeTask(range)
+		, m_broadPhase(broadPhase)
+		, m_moves(moves)
+		, m_groupBegins(groupBegins)
+	{}
+
+	virtual b2Task::Type GetType() const override { return b2Task::e_moveProxies; }
+
+	virtual void Execute(const b2ThreadContext& threadCtx, const b2RangeTaskRange& range) override
+	{
+		B2_NOT_USED(threadCtx);
+		for (int32 i = m_groupBegins[range.begin]; i < m_groupBegins[range.end]; ++i)
+		{
+			m_broadPhase->MoveProxyInSubTree(m_moves[i].proxyId, m_moves[i].fatAABB);
+		}
+	}
+
+private:
+	b2BroadPhase* m_broadPhase;
+	const b2SubTreeMove* m_moves;
+	const int32* m_groupBegins;
+};
+#endif
+
 void b2ContactManager::FinishSynchronizeFixtures(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator)
 {
 	auto moves = b2MakeStackAllocThreadDataSorter<b2DeferredMoveProxy>(m_perThreadData,
-		&b2ContactManagerPerThreadData::m_moveProxies, b2DeferredMoveProxyLessThan, allocator);
+		&b2ContactManagerPerThreadData::m_moveProxies, b2DeferredMoveProxySortKey, allocator);
 
 	b2Sort(moves, executor, taskGroup, allocator);
 
+#ifdef b2_dynamicTreeOfTrees
+	// Proxies that stay within their sub-tree are moved in parallel, with one task per group of
+	// sub-trees. The remaining proxies can add or remove sub-trees, so they're moved afterwards.
+	// Sub-trees are always modified in proxy id order, so the result doesn't depend on the
+	// thread count.
+	uint32 moveCount = moves.size();
+	b2StackArray<bool> isLocal(allocator, moveCount);
+	b2StackArray<b2SubTreeMove> localMoves(allocator, moveCount);
+	int32 localCount = 0;
+	for (uint32 i = 0; i < moveCount; ++i)
+	{
+		const b2DeferredMoveProxy& move = moves.begin()[i];
+		isLocal[i] = false;
+		if (m_broadPhase.GetFatAABB(move.proxyId).Contains(move.aabb))
+		{
+			continue;
+		}
+
+		b2SubTreeMove& localMove = localMoves[localCount];
+		localMove.subTree = m_broadPhase.GetMoveSubTree(move.proxyId, move.aabb, move.displacement, &localMove.fatAABB);
+		if (localMove.subTree != b2_nullNode)
+		{
+			localMove.proxyId = move.proxyId;
+			isLocal[i] = true;
+			++localCount;
+		}
+	}
+
+	if (localCount > 0)
+	{
+		std::sort(localMoves.data(), localMoves.data() + localCount, b2SubTreeMoveLessThan);
+
+		b2StackArray<int32> groupBegins(allocator, localCount + 1);
+		int32 groupCount = 0;
+		for (int32 i = 0; i < localCount; ++i)
+		{
+			if (i == 0 || localMoves[i].subTree != localMoves[i - 1].subTree)
+			{
+				groupBegins[groupCount++] = i;
+			}
+		}
+		groupBegins[groupCount] = localCount;
+
+		b2PartitionedRange ranges;
+		executor.PartitionRange(b2Task::e_moveProxies, 0, groupCount, ranges);
+		b2StackArray<b2MoveProxiesTask> tasks(allocator, ranges.GetCount());
+		for (uint32 i = 0; i < ranges.GetCount(); ++i)
+		{
+			tasks[i] = b2MoveProxiesTask(ranges[i], &m_broadPhase, localMoves.data(), groupBegins.data());
+		}
+		b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+		executor.Wait(taskGroup, b2MainThreadCtx(&allocator));
+	}
+
+	// Buffer the moves in proxy id order.
+	for (uint32 i = 0; i < moveCount; ++i)
+	{
+		const b2DeferredMoveProxy& move = moves.begin()[i];
+		if (isLocal[i])
+		{
+			m_broadPhase.TouchProxy(move.proxyId);
+		}
+		else
+		{
+			m_broadPhase.MoveProxy(move.proxyId, move.aabb, move.displacement);
+		}
+	}
+#else
 	for (auto it = moves.begin(); it != moves.end(); ++it)
 	{
 		m_broadPhase.MoveProxy(it->proxyId, it->aabb, it->displacement);
 	}
+#endif
 }
 
 void b2ContactManager::FinishSolve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator)
 {
 	auto postSolves = b2MakeStackAllocThreadDataSorter<b2DeferredPostSolve>(m_perThreadData,
-		&b2ContactManagerPerThreadData::m_postSolves, b2DeferredPostSolveLessThan, allocator);
+		&b2ContactManagerPerThreadData::m_postSolves, b2DeferredPostSolveSortKey, allocator);
 
 	while (postSolves.IsSubmitRequired())
 	{
@@ -469,9 +728,62 @@ void b2ContactManager::FinishSolve(b2TaskExecutor& executor, b2TaskGroup* taskGr
 	}
 }
 
+void b2ContactManager::FinishSolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator)
+{
+	auto begins = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
+		&b2ContactManagerPerThreadData::m_beginContacts, b2ContactSortKey, allocator);
+
+	auto ends = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
+		&b2ContactManagerPerThreadData::m_endContacts, b2ContactSortKey, allocator);
+
+	auto preSolves = b2MakeStackAllocThreadDataSorter<b2DeferredPreSolve>(m_perThreadData,
+		&b2ContactManagerPerThreadData::m_preSolves, b2DeferredPreSolveSortKey, allocator);
+
+	auto postSolves = b2MakeStackAllocThreadDataSorter<b2DeferredPostSolve>(m_perThreadData,
+		&b2ContactManagerPerThreadData::m_postSolves, b2DeferredPostSolveSortKey, allocator);
+
+	while (true)
+	{
+		begins.SubmitSortTask(executor, taskGroup);
+		ends.SubmitSortTask(executor, taskGroup);
+		preSolves.SubmitSortTask(executor, taskGroup);
+		postSolves.SubmitSortTask(executor, taskGroup);
+
+		if (begins.IsSubmitRequired() == false && ends.IsSubmitRequired() == false &&
+			preSolves.IsSubmitRequired() == false && postSolves.IsSubmitRequired() == false)
+		{
+			ConsumeAwakes();
+			executor.Wait(taskGroup, b2MainThreadCtx(&allocator));
+			break;
+		}
+
+		executor.Wait(taskGroup, b2MainThreadCtx(&allocator));
+	}
+
+	for (auto it = begins.begin(); it != begins.end(); ++it)
+	{
+		m_contactListener->BeginContact(*it);
+	}
+
+	for (auto it = ends.begin(); it != ends.end(); ++it)
+	{
+		m_contactListener->EndContact(*it);
+	}
+
+	for (auto it = preSolves.begin(); it != preSolves.end(); ++it)
+	{
+		m_contactListener->PreSolve(it->contact, &it->oldManifold);
+	}
+
+	for (auto it = postSolves.begin(); it != postSolves.end(); ++it)
+	{
+		m_contactListener->PostSolve(it->contact, &it->impulse);
+	}
+}
+
 void b2ContactManager::ConsumeAwakes()
 {
-	for (uint32 i = 0; i < b2_maxThreads; ++i)
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
 	{
 		while (m_perThreadData[i].m_awakes.size())
 		{
@@ -485,49 +797,48 @@ void b2ContactManager::ConsumeAwakes()
 	}
 }
 
-void b2ContactManager::ConsumeCreate(const b2DeferredContactCreate& create)
-{
-	b2Fixture* fixtureA = create.fixtureA;
-	b2Fixture* fixtureB = create.fixtureB;
-
-	int32 indexA = create.indexA;
-	int32 indexB = create.indexB;
-
-	// Call the factory.
-	b2Contact* c = b2Contact::Create(fixtureA, indexA, fixtureB, indexB, m_allocator);
-	if (c == nullptr)
-	{
-		return;
-	}
-
-	// Finish creating.
-	OnContactCreate(c, create.proxyIds);
-}
-
 inline void b2ContactManager::OnContactCreate(b2Contact* c, b2ContactProxyIds proxyIds)
 {
 	b2Fixture* fixtureA = c->GetFixtureA();
 	b2Fixture* fixtureB = c->GetFixtureB();
 
-	c->m_proxyIds = proxyIds;
+	m_pairSet.Add(proxyIds, c);
+
+	// The contact has no state until it's added to the contact array.
+	uint32 flags = b2Contact::e_enabledFlag;
 
 	// Mark for TOI if needed.
 	if (b2Contact::IsToiCandidate(fixtureA, fixtureB))
 	{
-		c->m_flags |= b2Contact::e_toiCandidateFlag;
+		flags |= b2Contact::e_toiCandidateFlag;
 	}
 
-	// Connect to island graph.
-	b2Body* bodyA = fixtureA->GetBody();
-	b2Body* bodyB = fixtureB->GetBody();
-
 	// Wake up the bodies
 	if (fixtureA->IsSensor() == false && fixtureB->IsSensor() == false)
 	{
-		bodyA->SetAwake(true);
-		bodyB->SetAwake(true);
+		fixtureA->GetBody()->SetAwake(true);
+		fixtureB->GetBody()->SetAwake(true);
+	}
+
+	// Connect to island graph.
+	AddToBodyContactLists(c);
+
+	// Is the contact inactive?
+	if (IsContactActive(c) == false)
+	{
+		flags |= b2Contact::e_inactiveFlag;
 	}
 
+	// Insert into the world.
+	AddToContactList(c);
+	AddToContactArray(c, flags, proxyIds);
+}
+
+inline void b2ContactManager::AddToBodyContactLists(b2Contact* c)
+{
+	b2Body* bodyA = c->GetFixtureA()->GetBody();
+	b2Body* bodyB = c->GetFixtureB()->GetBody();
+
 	// Connect to body A
 	c->m_nodeA.contact = c;
 	c->m_nodeA.other = bodyB;
@@ -551,16 +862,6 @@ inline void b2ContactManager::OnContactCreate(b2Contact* c, b2ContactProxyIds pr
 		bodyB->m_contactList->prev = &c->m_nodeB;
 	}
 	bodyB->m_contactList = &c->m_nodeB;
-
-	// Is the contact inactive?
-	if (IsContactActive(c) == false)
-	{
-		c->m_flags |= b2Contact::e_inactiveFlag;
-	}
-
-	// Insert into the world.
-	AddToContactList(c);
-	AddToContactArray(c);
 }
 
 void b2ContactManager::RecalculateToiCandidacy(b2Body* body)
@@ -588,10 +889,17 @@ void b2ContactManager::RecalculateToiCandidacy(b2Fixture* fixture)
 
 void b2ContactManager::RecalculateToiCandidacy(b2Contact* c)
 {
+	// Contacts that aren't in the world yet get their candidacy when they're added.
+	if (c->m_managerIndex == -1)
+	{
+		return;
+	}
+
 	b2Fixture* fixtureA = c->GetFixtureA();
 	b2Fixture* fixtureB = c->GetFixtureB();
 
-	uint32 flags = c->m_flags;
+	uint32& contactFlags = m_contactStates.m_flags[c->m_managerIndex];
+	uint32 flags = contactFlags;
 
 	if (b2Contact::IsToiCandidate(fixtureA, fixtureB))
 	{
@@ -602,116 +910,412 @@ void b2ContactManager::RecalculateToiCandidacy(b2Contact* c)
 		flags &= ~b2Contact::e_toiCandidateFlag;
 	}
 
-	if (flags == c->m_flags)
+	if (flags == contactFlags)
 	{
 		return;
 	}
 
-	c->m_flags = flags & ~b2Contact::e_toiFlag;
-	c->m_toiCount = 0;
-	c->m_toi = 1.0f;
+	contactFlags = flags & ~b2Contact::e_toiFlag;
+	m_contactStates.m_tois[c->m_managerIndex].toiCount = 0;
+	m_contactStates.m_tois[c->m_managerIndex].toi = 1.0f;
 
-	if (c->m_managerIndex == -1)
-	{
-		SanityCheck();
-		return;
-	}
-
-	if (c->m_flags & b2Contact::e_toiCandidateFlag)
-	{
-		b2Assert(c->m_managerIndex >= (int32)m_toiCount);
-		m_contacts[m_toiCount]->m_managerIndex = c->m_managerIndex;
-		m_contacts[c->m_managerIndex] = m_contacts[m_toiCount];
-		m_contacts[m_toiCount] = c;
-		c->m_managerIndex = m_toiCount;
-		++m_toiCount;
-	}
-	else
-	{
-		b2Assert(c->m_managerIndex < (int32)m_toiCount);
-		--m_toiCount;
-		m_contacts[m_toiCount]->m_managerIndex = c->m_managerIndex;
-		m_contacts[c->m_managerIndex] = m_contacts[m_toiCount];
-		m_contacts[m_toiCount] = c;
-		c->m_managerIndex = m_toiCount;
-	}
+	MoveToPartition(c, GetPartition(contactFlags));
 
 	SanityCheck();
 }
 
 void b2ContactManager::RecalculateSleeping(b2Body* body)
 {
+	bool changed = false;
 	for (b2ContactEdge* ce = body->GetContactList(); ce; ce = ce->next)
 	{
 		b2Contact* c = ce->contact;
+		uint32& contactFlags = m_contactStates.m_flags[c->m_managerIndex];
+		uint32 flags = contactFlags;
 
 		if (IsContactActive(c) == false)
 		{
-			c->m_flags |= b2Contact::e_inactiveFlag;
+			contactFlags |= b2Contact::e_inactiveFlag;
 		}
 		else
 		{
-			c->m_flags &= ~b2Contact::e_inactiveFlag;
+			contactFlags &= ~b2Contact::e_inactiveFlag;
 		}
+
+		changed = changed || flags != contactFlags;
+	}
+
+	// The contacts can't be moved now, because this may be called while contacts are iterated.
+	if (changed)
+	{
+		MarkActivityChanged(body);
 	}
 }
 
-inline void b2ContactManager::AddToContactArray(b2Contact* c)
+void b2ContactManager::MarkActivityChanged(b2Body* body)
 {
-	b2Assert(c->m_managerIndex == -1);
+	// A body is only modified by one thread at a time, so the flag keeps it from being added twice.
+	if (body->m_flags & b2Body::e_activityChangedFlag)
+	{
+		return;
+	}
+	body->m_flags |= b2Body::e_activityChangedFlag;
 
-	if (c->m_flags & b2Contact::e_toiCandidateFlag)
+	uint32 index = m_activityChangeCount.fetch_add(1, std::memory_order_relaxed);
+	b2Assert(index < m_activityChangeCapacity);
+	m_activityChanges[index] = body;
+}
+
+// Orders marked bodies so that contacts are moved in the same order for any thread count.
+bool b2ContactManager::ActivityChangeLessThan(const b2Body* a, const b2Body* b)
+{
+	bool aStatic = a->GetType() == b2_staticBody;
+	bool bStatic = b->GetType() == b2_staticBody;
+	if (aStatic != bStatic)
+	{
+		return bStatic;
+	}
+	return a->m_worldIndex < b->m_worldIndex;
+}
+
+void b2ContactManager::ApplyActivityChanges()
+{
+	uint32 count = m_activityChangeCount.load(std::memory_order_relaxed);
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::sort(m_activityChanges, m_activityChanges + count, ActivityChangeLessThan);
+
+	for (uint32 i = 0; i < count; ++i)
 	{
-		if (m_toiCount < m_contacts.size())
+		b2Body* body = m_activityChanges[i];
+		body->m_flags &= ~b2Body::e_activityChangedFlag;
+
+		for (b2ContactEdge* ce = body->GetContactList(); ce; ce = ce->next)
 		{
-			c->m_managerIndex = m_toiCount;
-			b2Assert((m_contacts[m_toiCount]->m_flags & b2Contact::e_toiCandidateFlag) == 0);
-			m_contacts[m_toiCount]->m_managerIndex = m_contacts.size();
-			m_contacts.push_back(m_contacts[m_toiCount]);
-			m_contacts[m_toiCount] = c;
-			++m_toiCount;
+			b2Contact* c = ce->contact;
+			int32 partition = GetPartition(m_contactStates.m_flags[c->m_managerIndex]);
+			MoveToPartition(c, partition);
+
+			// Solve flags aren't cleared for inactive partitions.
+			if (partition == e_inactiveToiPartition || partition == e_inactiveNonToiPartition)
+			{
+				m_contactStates.m_flags[c->m_managerIndex] &= ~b2Contact::e_islandFlag;
+			}
 		}
-		else
+	}
+
+	m_activityChangeCount.store(0, std::memory_order_relaxed);
+
+	SanityCheck();
+}
+
+void b2ContactManager::ReserveActivityChanges(uint32 bodyCount)
+{
+	if (bodyCount <= m_activityChangeCapacity)
+	{
+		return;
+	}
+
+	uint32 capacity = b2Max(2 * m_activityChangeCapacity, bodyCount);
+	b2Body** changes = (b2Body**)b2Alloc(capacity * sizeof(b2Body*));
+	uint32 count = m_activityChangeCount.load(std::memory_order_relaxed);
+	if (count > 0)
+	{
+		memcpy(changes, m_activityChanges, count * sizeof(b2Body*));
+	}
+	b2Free(m_activityChanges);
+	m_activityChanges = changes;
+	m_activityChangeCapacity = capacity;
+}
+
+void b2ContactManager::RemoveActivityChange(b2Body* body)
+{
+	if ((body->m_flags & b2Body::e_activityChangedFlag) == 0)
+	{
+		return;
+	}
+	body->m_flags &= ~b2Body::e_activityChangedFlag;
+
+	uint32 count = m_activityChangeCount.load(std::memory_order_relaxed);
+	for (uint32 i = 0; i < count; ++i)
+	{
+		if (m_activityChanges[i] == body)
 		{
-			c->m_managerIndex = m_contacts.size();
-			m_contacts.push_back(c);
-			++m_toiCount;
+			m_activityChanges[i] = m_activityChanges[count - 1];
+			m_activityChangeCount.store(count - 1, std::memory_order_relaxed);
+			return;
 		}
 	}
-	else
+	b2Assert(false);
+}
+
+void b2ContactManager::FlagForFiltering(b2Contact* c)
+{
+	b2Assert(c->m_managerIndex != -1);
+
+	uint32& flags = m_contactStates.m_flags[c->m_managerIndex];
+	flags |= b2Contact::e_filterFlag;
+
+	// Filtering may destroy the contact, so it can't wait in an inactive partition. A contact
+	// that stays inactive is moved back after the next collide.
+	MoveToPartition(c, GetPartition(flags));
+}
+
+void b2ContactManager::SetThreadCount(uint32 threadCount)
+{
+	if (threadCount != m_perThreadData.size())
+	{
+		m_perThreadData.resize(threadCount);
+	}
+	m_broadPhase.SetThreadCount(threadCount);
+
+	while (m_contactAllocators.size() < threadCount)
 	{
-		c->m_managerIndex = m_contacts.size();
-		m_contacts.push_back(c);
+		void* mem = b2Alloc(sizeof(b2BlockAllocator));
+		m_contactAllocators.push_back(new (mem) b2BlockAllocator());
 	}
 }
 
-inline void b2ContactManager::RemoveFromContactArray(b2Contact* c)
+void b2ContactManager::Reserve(uint32 contactCount, uint32 proxyCount)
 {
-	b2Assert(c->m_managerIndex >= 0);
+	m_contacts.reserve(contactCount);
+	m_contactStates.Reserve(contactCount);
+	m_pairSet.Reserve(contactCount);
+
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		b2ContactManagerPerThreadData& td = m_perThreadData[i];
+		td.m_beginContacts.reserve(contactCount);
+		td.m_endContacts.reserve(contactCount);
+		td.m_preSolves.reserve(contactCount);
+		td.m_postSolves.reserve(contactCount);
+		td.m_awakes.reserve(contactCount);
+		td.m_filteredInactives.reserve(contactCount);
+		td.m_destroys.reserve(contactCount);
+		td.m_creates.reserve(contactCount);
+		td.m_moveProxies.reserve(proxyCount);
+	}
+
+	// The contact types don't add members to b2Contact, so they all use the same block size.
+	for (uint32 i = 0; i < m_contactAllocators.size(); ++i)
+	{
+		m_contactAllocators[i]->Reserve(sizeof(b2Contact), contactCount);
+	}
+
+	// Moved proxies find their existing contacts again, and a pair can be found from both sides.
+	m_broadPhase.Reserve(proxyCount, 2 * contactCount);
+}
+
+int32 b2ContactManager::GetContactChunkCount() const
+{
+	int32 count = 0;
+	for (uint32 i = 0; i < m_contactAllocators.size(); ++i)
+	{
+		count += m_contactAllocators[i]->GetChunkCount();
+	}
+	return count;
+}
+
+b2BlockAllocator* b2ContactManager::GetContactAllocator(uint32 threadId)
+{
+	b2Assert(threadId < m_contactAllocators.size());
+	return m_contactAllocators[threadId];
+}
 
-	if (c->m_managerIndex < (int32)m_toiCount)
+void b2ContactManager::TransferState(b2SnapshotStream& stream)
+{
+	int32 contactCount = m_contacts.size();
+	stream.Transfer(contactCount);
+
+	b2Contact* c = nullptr;
+	if (stream.IsReading())
 	{
-		b2Assert((c->m_flags & b2Contact::e_toiCandidateFlag) == b2Contact::e_toiCandidateFlag);
-		--m_toiCount;
-		m_contacts[m_toiCount]->m_managerIndex = c->m_managerIndex;
-		m_contacts[c->m_managerIndex] = m_contacts[m_toiCount];
-		b2Contact* backContact = m_contacts.pop_back();
-		if (m_contacts.size() > m_toiCount)
+		b2Assert(m_contactList == nullptr && m_contacts.size() == 0);
+		if (stream.CanRead(contactCount, 3 * sizeof(int32) + sizeof(b2Manifold)) == false)
+		{
+			return;
+		}
+
+		// Contacts are placed by their saved index, and their state is read into the slot.
+		m_contacts.reserve(contactCount);
+		m_contactStates.Reserve(contactCount);
+		for (int32 i = 0; i < contactCount; ++i)
 		{
-			m_contacts[m_toiCount] = backContact;
-			m_contacts[m_toiCount]->m_managerIndex = m_toiCount;
+			m_contacts.push_back(nullptr);
+			m_contactStates.PushBack(0, b2ContactProxyIds(), 0.0f, 0.0f);
 		}
+		m_pairSet.Reserve(contactCount);
 	}
 	else
 	{
-		b2Assert((c->m_flags & b2Contact::e_toiCandidateFlag) == 0);
-		m_contacts.back()->m_managerIndex = c->m_managerIndex;
-		b2RemoveAndSwapBack(m_contacts, c->m_managerIndex);
+		// Write from the tail of the list, so that prepending while reading restores its order.
+		for (c = m_contactList; c && c->m_next; c = c->m_next)
+		{
+		}
 	}
 
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		int32 proxyIdA = 0;
+		int32 proxyIdB = 0;
+		int32 managerIndex = 0;
+		if (stream.IsReading() == false)
+		{
+			proxyIdA = c->m_fixtureA->m_proxies[c->m_indexA].proxyId;
+			proxyIdB = c->m_fixtureB->m_proxies[c->m_indexB].proxyId;
+			managerIndex = c->m_managerIndex;
+		}
+
+		stream.Transfer(proxyIdA);
+		stream.Transfer(proxyIdB);
+		stream.Transfer(managerIndex);
+
+		if (stream.IsReading())
+		{
+			if (stream.HasFailed() || managerIndex < 0 || managerIndex >= contactCount ||
+				m_contacts[managerIndex] != nullptr)
+			{
+				stream.SetFailed();
+				return;
+			}
+
+			// The proxies were saved in the same order, so the contact isn't swapped by its factory.
+			b2FixtureProxy* proxyA = (b2FixtureProxy*)m_broadPhase.GetUserData(proxyIdA);
+			b2FixtureProxy* proxyB = (b2FixtureProxy*)m_broadPhase.GetUserData(proxyIdB);
+			c = b2Contact::Create(proxyA->fixture, proxyA->childIndex, proxyB->fixture, proxyB->childIndex, GetContactAllocator(0));
+			b2Assert(c != nullptr && c->m_fixtureA == proxyA->fixture);
+
+			m_contactStates.m_proxyIds[managerIndex] = b2ContactProxyIds(proxyIdA, proxyIdB);
+			m_pairSet.Add(m_contactStates.m_proxyIds[managerIndex], c);
+			AddToBodyContactLists(c);
+			AddToContactList(c);
+			c->m_states = &m_contactStates;
+			PlaceContact(c, managerIndex);
+		}
+
+		stream.Transfer(m_contactStates.m_flags[managerIndex]);
+		stream.Transfer(m_contactStates.m_manifolds[managerIndex]);
+		stream.Transfer(m_contactStates.m_tois[managerIndex].toiCount);
+		stream.Transfer(m_contactStates.m_tois[managerIndex].toi);
+		stream.Transfer(m_contactStates.m_materials[managerIndex].friction);
+		stream.Transfer(m_contactStates.m_materials[managerIndex].restitution);
+		stream.Transfer(m_contactStates.m_materials[managerIndex].tangentSpeed);
+
+		if (stream.IsReading() == false)
+		{
+			c = c->m_prev;
+		}
+	}
+
+	stream.Transfer(m_inactiveToiCount);
+	stream.Transfer(m_toiCount);
+	stream.Transfer(m_activeEnd);
+
+	if (stream.IsReading() &&
+		(m_inactiveToiCount > m_toiCount || m_toiCount > m_activeEnd || m_activeEnd > m_contacts.size()))
+	{
+		stream.SetFailed();
+	}
+
+	SanityCheck();
+}
+
+inline void b2ContactManager::GetPartitionEnds(uint32 ends[e_partitionCount]) const
+{
+	ends[e_inactiveToiPartition] = m_inactiveToiCount;
+	ends[e_activeToiPartition] = m_toiCount;
+	ends[e_activeNonToiPartition] = m_activeEnd;
+	ends[e_inactiveNonToiPartition] = m_contacts.size();
+}
+
+inline void b2ContactManager::SetPartitionEnds(const uint32 ends[e_partitionCount])
+{
+	m_inactiveToiCount = ends[e_inactiveToiPartition];
+	m_toiCount = ends[e_activeToiPartition];
+	m_activeEnd = ends[e_activeNonToiPartition];
+	b2Assert(ends[e_inactiveNonToiPartition] == m_contacts.size());
+}
+
+inline void b2ContactManager::PlaceContact(b2Contact* c, uint32 index)
+{
+	m_contacts[index] = c;
+	c->m_managerIndex = index;
+}
+
+inline void b2ContactManager::SwapContacts(uint32 index1, uint32 index2)
+{
+	b2Contact* c1 = m_contacts[index1];
+	b2Contact* c2 = m_contacts[index2];
+	m_contactStates.Swap(index1, index2);
+	PlaceContact(c1, index2);
+	PlaceContact(c2, index1);
+}
+
+// The order of contacts within a partition doesn't matter, so inserting or removing a contact
+// only moves one contact of each later partition.
+inline void b2ContactManager::AddToContactArray(b2Contact* c, uint32 flags, const b2ContactProxyIds& proxyIds)
+{
+	b2Assert(c->m_managerIndex == -1);
+
+	float32 friction = b2MixFriction(c->m_fixtureA->m_friction, c->m_fixtureB->m_friction);
+	float32 restitution = b2MixRestitution(c->m_fixtureA->m_restitution, c->m_fixtureB->m_restitution);
+
+	// Append the contact to the last partition, then move it to its own partition.
+	c->m_states = &m_contactStates;
+	m_contactStates.PushBack(flags, proxyIds, friction, restitution);
+	m_contacts.push_back(c);
+	c->m_managerIndex = m_contacts.size() - 1;
+
+	MoveToPartition(c, GetPartition(flags));
+}
+
+inline void b2ContactManager::RemoveFromContactArray(b2Contact* c)
+{
+	b2Assert(c->m_managerIndex >= 0);
+
+	// Move the contact to the last partition, then to the end of the array.
+	MoveToPartition(c, e_inactiveNonToiPartition);
+	SwapContacts(c->m_managerIndex, m_contacts.size() - 1);
+
+	m_contacts.pop_back();
+	m_contactStates.PopBack();
+
 	c->m_managerIndex = -1;
 }
 
+void b2ContactManager::MoveToPartition(b2Contact* c, int32 partition)
+{
+	uint32 ends[e_partitionCount];
+	GetPartitionEnds(ends);
+
+	int32 current = 0;
+	while ((uint32)c->m_managerIndex >= ends[current])
+	{
+		++current;
+	}
+
+	// Cross one partition boundary at a time by swapping with the contact at the boundary.
+	while (current < partition)
+	{
+		uint32 last = ends[current] - 1;
+		SwapContacts(c->m_managerIndex, last);
+		--ends[current];
+		++current;
+	}
+	while (current > partition)
+	{
+		uint32 first = ends[current - 1];
+		SwapContacts(c->m_managerIndex, first);
+		++ends[current - 1];
+		--current;
+	}
+
+	SetPartitionEnds(ends);
+}
+
 inline void b2ContactManager::AddToContactList(b2Contact* c)
 {
 	c->m_prev = nullptr;
@@ -746,8 +1350,11 @@ void b2ContactManager::SanityCheck()
 	{
 		b2Contact* c = m_contacts[i];
 		b2Assert(c->m_managerIndex == (int32)i);
+		b2Assert(c->m_states == &m_contactStates);
 	}
+	b2Assert(m_contactStates.GetCount() == m_contacts.size());
 
+	bool pendingChanges = m_activityChangeCount.load(std::memory_order_relaxed) > 0;
 	for (b2Contact* c = m_contactList; c; c = c->m_next)
 	{
 		int32 index = c->m_managerIndex;
@@ -762,6 +1369,14 @@ void b2ContactManager::SanityCheck()
 		{
 			b2Assert(index >= (int32)m_toiCount);
 		}
+		// Contacts are only moved out of the inactive partitions when changes are applied.
+		if (pendingChanges == false && (index < (int32)m_inactiveToiCount || index >= (int32)m_activeEnd))
+		{
+			int32 partition = GetPartition(m_contactStates.m_flags[index]);
+			b2Assert(partition == e_inactiveToiPartition || partition == e_inactiveNonToiPartition);
+		}
+		b2Assert(m_pairSet.Find(m_contactStates.m_proxyIds[index]) == c);
 	}
+	b2Assert(m_pairSet.GetCount() == m_contacts.size());
 #endif
 }
\ No newline at end of file
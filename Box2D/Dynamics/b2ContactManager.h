@@ -23,24 +23,27 @@
 #include "Box2D/Collision/b2BroadPhase.h"
 #include "Box2D/Common/b2GrowableArray.h"
 #include "Box2D/Dynamics/Contacts/b2Contact.h"
+#include "Box2D/Dynamics/b2ContactStateStore.h"
+#include "Box2D/Dynamics/b2PairSet.h"
 #include "Box2D/Dynamics/b2WorldCallbacks.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
+#include "Box2D/MT/b2ThreadDataArray.h"
+#include <atomic>
 
 class b2BlockAllocator;
 class b2Body;
 class b2ContactFilter;
 class b2ContactListener;
+class b2SnapshotStream;
 class b2StackAllocator;
 class b2TaskExecutor;
 class b2TaskGroup;
 struct b2FixtureProxy;
 
+// A contact that was created on a worker thread but isn't linked to the world yet.
 struct b2DeferredContactCreate
 {
-	b2Fixture* fixtureA;
-	b2Fixture* fixtureB;
-	int32 indexA;
-	int32 indexB;
+	b2Contact* contact;
 	b2ContactProxyIds proxyIds;
 };
 
@@ -63,12 +66,19 @@ struct b2DeferredPostSolve
 	b2ContactImpulse impulse;
 };
 
-/// These are used to sort deferred events so their effects are applied in a deterministic order.
+/// Orders contacts by their proxy ids.
 bool b2ContactPointerLessThan(const b2Contact* l, const b2Contact* r);
-bool b2DeferredContactCreateLessThan(const b2DeferredContactCreate& l, const b2DeferredContactCreate& r);
-bool b2DeferredMoveProxyLessThan(const b2DeferredMoveProxy& l, const b2DeferredMoveProxy& r);
-bool b2DeferredPreSolveLessThan(const b2DeferredPreSolve& l, const b2DeferredPreSolve& r);
-bool b2DeferredPostSolveLessThan(const b2DeferredPostSolve& l, const b2DeferredPostSolve& r);
+
+/// Orders contacts by their cached TOI, then by their proxy ids.
+bool b2ToiContactPointerLessThan(const b2Contact* a, const b2Contact* b);
+
+/// These are used to sort deferred events so their effects are applied in a deterministic order.
+/// The keys have the same order as the proxy ids of the event.
+uint64 b2ContactSortKey(const b2Contact* c);
+uint64 b2DeferredContactCreateSortKey(const b2DeferredContactCreate& create);
+uint64 b2DeferredMoveProxySortKey(const b2DeferredMoveProxy& move);
+uint64 b2DeferredPreSolveSortKey(const b2DeferredPreSolve& preSolve);
+uint64 b2DeferredPostSolveSortKey(const b2DeferredPostSolve& postSolve);
 
 struct b2ContactManagerPerThreadData
 {
@@ -77,6 +87,7 @@ struct b2ContactManagerPerThreadData
 	b2GrowableArray<b2DeferredPreSolve> m_preSolves;
 	b2GrowableArray<b2DeferredPostSolve> m_postSolves;
 	b2GrowableArray<b2Contact*> m_awakes;
+	b2GrowableArray<b2Contact*> m_filteredInactives;
 	b2GrowableArray<b2Contact*> m_destroys;
 	b2GrowableArray<b2DeferredContactCreate> m_creates;
 	b2GrowableArray<b2DeferredMoveProxy> m_moveProxies;
@@ -90,6 +101,7 @@ class b2ContactManager
 {
 public:
 	b2ContactManager();
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB, uint32 threadId);
@@ -105,6 +117,7 @@ public:
 	void FinishCollide(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator);
 	void FinishSynchronizeFixtures(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator);
 	void FinishSolve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator);
+	void FinishSolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2StackAllocator& allocator);
 
 	// Finish multithreaded work without consistency sorting.
 	void FinishFindNewContacts();
@@ -118,39 +131,122 @@ public:
 	b2Contact** GetNonToiBegin();
 	uint32 GetNonToiCount();
 
+	// Each partition is split again by activity, so that the active contacts are contiguous:
+	// [inactive TOI | active TOI | active non-TOI | inactive non-TOI]
+	// Contacts before GetActiveBegin() or from GetActiveEnd() on are inactive and aren't flagged
+	// for filtering, so they can be skipped by Collide and when clearing solve flags. Contacts
+	// within the active range may also be inactive, since contacts only move between partitions
+	// in ApplyActivityChanges.
+	uint32 GetActiveBegin() const;
+	uint32 GetActiveEnd() const;
+
 	// Reorder contacts when TOI eligibility changes.
 	void RecalculateToiCandidacy(b2Body* body);
 	void RecalculateToiCandidacy(b2Fixture* fixture);
 
-	// Update the active flag for this body's contacts.
+	// Update the active flag for this body's contacts. This can be called from multiple
+	// threads for different bodies. Contacts are moved to their new partition later.
 	void RecalculateSleeping(b2Body* body);
 
+	// Record that the activity of a body's contacts may have changed. This can be called from
+	// multiple threads for different bodies.
+	void MarkActivityChanged(b2Body* body);
+
+	// Move the contacts of bodies marked since the last call to their activity partition. This
+	// must be called from the user thread, while contacts aren't being iterated.
+	void ApplyActivityChanges();
+
+	// Make room to mark every body, and forget a destroyed body.
+	void ReserveActivityChanges(uint32 bodyCount);
+	void RemoveActivityChange(b2Body* body);
+
+	// Flag a contact for filtering at the next collide.
+	void FlagForFiltering(b2Contact* contact);
+
+	// Resize per-thread data. Must be called before executing tasks with a different thread count.
+	void SetThreadCount(uint32 threadCount);
+
+	// Make room for contactCount contacts and proxyCount moved proxies, so that finding, updating,
+	// and solving contacts doesn't allocate while there are no more of them. The buffers and contact
+	// allocator of every thread are sized as if that thread did all of the work.
+	void Reserve(uint32 contactCount, uint32 proxyCount);
+
+	// Get the number of chunks allocated by the contact allocators.
+	int32 GetContactChunkCount() const;
+
+	// Get the allocator that new contacts are created with on a thread.
+	b2BlockAllocator* GetContactAllocator(uint32 threadId);
+
+	// Read or write the contacts, keeping their order in the contact list, the body contact lists,
+	// and the contact array. The fixtures and their proxies must be restored before reading, and
+	// there must be no contacts.
+	void TransferState(b2SnapshotStream& stream);
+
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
-	b2BlockAllocator* m_allocator;
+
+	// Each thread creates contacts with its own allocator while new contacts are found, and the
+	// user thread uses the first one. Contacts remember their allocator and are freed to it from
+	// the user thread, which is safe because allocation and freeing never overlap. The allocators
+	// are kept until the manager is destroyed, so there can be more of them than threads.
+	b2GrowableArray<b2BlockAllocator*> m_contactAllocators;
 
 	// This contacts array makes it easier to assign ranges of contacts to different tasks.
 	// Note: TOI partitioning is also done in this array rather than in the contact list,
 	// but it might be better to do that in the contact list.
 	b2GrowableArray<b2Contact*> m_contacts;
+
+	// The state of the contacts, in the same order as the contacts array. Contacts are only
+	// reordered by SwapContacts, which keeps the two in sync.
+	b2ContactStateStore m_contactStates;
+	uint32 m_inactiveToiCount;
 	uint32 m_toiCount;
+	uint32 m_activeEnd;
+
+	// Bodies marked by MarkActivityChanged.
+	b2Body** m_activityChanges;
+	uint32 m_activityChangeCapacity;
+	std::atomic<uint32> m_activityChangeCount;
 
-	b2ContactManagerPerThreadData m_perThreadData[b2_maxThreads];
+	// The contacts keyed by proxy ids, so AddPair can reject existing pairs in constant time.
+	b2PairSet m_pairSet;
+
+	b2ThreadDataArray<b2ContactManagerPerThreadData> m_perThreadData;
 
 	bool m_deferCreates;
 
 private:
+	// Contact array partitions, in array order.
+	enum
+	{
+		e_inactiveToiPartition,
+		e_activeToiPartition,
+		e_activeNonToiPartition,
+		e_inactiveNonToiPartition,
+		e_partitionCount
+	};
+
 	static bool IsContactActive(b2Contact* contact);
+	static int32 GetPartition(uint32 contactFlags);
+	static bool ActivityChangeLessThan(const b2Body* a, const b2Body* b);
+	static bool IsWidePolygonContact(b2Contact* contact);
+
+	void UpdatePolygonContacts(b2Contact** contacts, int32 count, uint32 threadId);
 
 	void ConsumeAwakes();
-	void ConsumeCreate(const b2DeferredContactCreate& create);
 
 	void RecalculateToiCandidacy(b2Contact* contact);
 	void OnContactCreate(b2Contact* contact, b2ContactProxyIds proxyIds);
-	void AddToContactArray(b2Contact* contact);
+	void AddToBodyContactLists(b2Contact* contact);
+	void AddToContactArray(b2Contact* contact, uint32 flags, const b2ContactProxyIds& proxyIds);
 	void RemoveFromContactArray(b2Contact* contact);
+	void MoveToPartition(b2Contact* contact, int32 partition);
+	void GetPartitionEnds(uint32 ends[e_partitionCount]) const;
+	void SetPartitionEnds(const uint32 ends[e_partitionCount]);
+	void PlaceContact(b2Contact* contact, uint32 index);
+	void SwapContacts(uint32 index1, uint32 index2);
 	void AddToContactList(b2Contact* contact);
 	void RemoveFromContactList(b2Contact* contact);
 
@@ -172,4 +268,14 @@ inline uint32 b2ContactManager::GetNonToiCount()
 	return m_contacts.size() - m_toiCount;
 }
 
+inline uint32 b2ContactManager::GetActiveBegin() const
+{
+	return m_inactiveToiCount;
+}
+
+inline uint32 b2ContactManager::GetActiveEnd() const
+{
+	return m_activeEnd;
+}
+
 #endif
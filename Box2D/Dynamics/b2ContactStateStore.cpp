@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Box2D/Dynamics/b2ContactStateStore.h"
+#include "Box2D/Dynamics/Contacts/b2Contact.h"
+
+void b2ContactStateStore::PushBack(uint32 flags, const b2ContactProxyIds& proxyIds, float32 friction, float32 restitution)
+{
+	m_flags.push_back(flags);
+	m_proxyIds.push_back(proxyIds);
+
+	b2ContactToi toi;
+	toi.toi = 1.0f;
+	toi.toiCount = 0;
+	m_tois.push_back(toi);
+
+	b2ContactMaterial material;
+	material.friction = friction;
+	material.restitution = restitution;
+	material.tangentSpeed = 0.0f;
+	m_materials.push_back(material);
+
+	b2Manifold manifold;
+	manifold.localNormal.SetZero();
+	manifold.localPoint.SetZero();
+	manifold.type = b2Manifold::e_circles;
+	manifold.pointCount = 0;
+	m_manifolds.push_back(manifold);
+}
+
+void b2ContactStateStore::PopBack()
+{
+	m_flags.pop_back();
+	m_proxyIds.pop_back();
+	m_tois.pop_back();
+	m_materials.pop_back();
+	m_manifolds.pop_back();
+}
+
+template <typename T>
+inline void b2SwapElements(b2GrowableArray<T>& array, uint32 index1, uint32 index2)
+{
+	T tmp = array[index1];
+	array[index1] = array[index2];
+	array[index2] = tmp;
+}
+
+void b2ContactStateStore::Swap(uint32 index1, uint32 index2)
+{
+	b2Assert(index1 < GetCount() && index2 < GetCount());
+
+	b2SwapElements(m_flags, index1, index2);
+	b2SwapElements(m_proxyIds, index1, index2);
+	b2SwapElements(m_tois, index1, index2);
+	b2SwapElements(m_materials, index1, index2);
+	b2SwapElements(m_manifolds, index1, index2);
+}
+
+void b2ContactStateStore::Reserve(uint32 count)
+{
+	m_flags.reserve(count);
+	m_proxyIds.reserve(count);
+	m_tois.reserve(count);
+	m_materials.reserve(count);
+	m_manifolds.reserve(count);
+}
+
+void b2ContactStateStore::ClearIslandFlags(uint32 begin, uint32 end)
+{
+	b2Assert(begin <= end && end <= GetCount());
+
+	for (uint32 i = begin; i < end; ++i)
+	{
+		m_flags[i] &= ~b2Contact::e_islandFlag;
+	}
+}
+
+void b2ContactStateStore::ClearToiState(uint32 begin, uint32 end)
+{
+	b2Assert(begin <= end && end <= GetCount());
+
+	for (uint32 i = begin; i < end; ++i)
+	{
+		m_flags[i] &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+		m_tois[i].toiCount = 0;
+		m_tois[i].toi = 1.0f;
+	}
+}
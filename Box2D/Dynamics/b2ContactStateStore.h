@@ -0,0 +1,111 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_CONTACT_STATE_STORE_H
+#define B2_CONTACT_STATE_STORE_H
+
+#include "Box2D/Collision/b2BroadPhase.h"
+#include "Box2D/Collision/b2Collision.h"
+#include "Box2D/Common/b2GrowableArray.h"
+
+/// Stores the proxy ids of a contact's fixtures in a consistent order.
+struct b2ContactProxyIds
+{
+	b2ContactProxyIds()
+		: low(b2BroadPhase::e_nullProxy)
+		, high(b2BroadPhase::e_nullProxy)
+	{}
+	b2ContactProxyIds(int32 proxyIdA, int32 proxyIdB)
+		: low(proxyIdA < proxyIdB ? proxyIdA : proxyIdB)
+		, high(proxyIdA < proxyIdB ? proxyIdB : proxyIdA)
+	{}
+	int32 low;
+	int32 high;
+};
+
+inline bool operator==(const b2ContactProxyIds& lhs, const b2ContactProxyIds& rhs)
+{
+	return lhs.low == rhs.low && lhs.high == rhs.high;
+}
+
+inline bool operator<(const b2ContactProxyIds& lhs, const b2ContactProxyIds& rhs)
+{
+	if (lhs.low < rhs.low)
+	{
+		return true;
+	}
+
+	if (lhs.low == rhs.low)
+	{
+		return lhs.high < rhs.high;
+	}
+
+	return false;
+}
+
+/// This is an internal structure.
+struct b2ContactToi
+{
+	float32 toi;
+	int32 toiCount;
+};
+
+/// This is an internal structure.
+struct b2ContactMaterial
+{
+	float32 friction;
+	float32 restitution;
+	float32 tangentSpeed;
+};
+
+/// The state that is read and written by the passes over the contact array, stored as separate
+/// arrays indexed by b2Contact::m_managerIndex. The arrays have the same order as the contact
+/// array, so those passes stream through memory instead of following a pointer to each contact.
+/// A contact only has state while it's in the contact array.
+/// This is an internal class.
+class b2ContactStateStore
+{
+public:
+	/// Add a slot at the end with the state of a new contact.
+	void PushBack(uint32 flags, const b2ContactProxyIds& proxyIds, float32 friction, float32 restitution);
+
+	/// Remove the last slot.
+	void PopBack();
+
+	/// Exchange the state of two slots.
+	void Swap(uint32 index1, uint32 index2);
+
+	/// Make room for count slots.
+	void Reserve(uint32 count);
+
+	/// Clear the island flags of the slots in [begin, end).
+	void ClearIslandFlags(uint32 begin, uint32 end);
+
+	/// Clear the island and TOI flags and reset the TOI of the slots in [begin, end).
+	void ClearToiState(uint32 begin, uint32 end);
+
+	uint32 GetCount() const { return m_flags.size(); }
+
+	b2GrowableArray<uint32> m_flags;
+	b2GrowableArray<b2ContactProxyIds> m_proxyIds;
+	b2GrowableArray<b2ContactToi> m_tois;
+	b2GrowableArray<b2ContactMaterial> m_materials;
+	b2GrowableArray<b2Manifold> m_manifolds;
+};
+
+#endif
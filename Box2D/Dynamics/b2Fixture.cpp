@@ -134,7 +134,14 @@ void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 	{
 		b2FixtureProxy* proxy = m_proxies + i;
 		m_shape->ComputeAABB(&proxy->aabb, xf, i);
-		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		if (m_body->GetType() == b2_staticBody)
+		{
+			proxy->proxyId = broadPhase->CreateStaticProxy(proxy->aabb, proxy);
+		}
+		else
+		{
+			proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		}
 		proxy->fixture = this;
 		proxy->childIndex = i;
 	}
@@ -203,7 +210,7 @@ void b2Fixture::Refilter()
 		b2Fixture* fixtureB = contact->GetFixtureB();
 		if (fixtureA == this || fixtureB == this)
 		{
-			contact->m_flags |= b2Contact::e_filterFlag;
+			world->m_contactManager.FlagForFiltering(contact);
 		}
 
 		edge = edge->next;
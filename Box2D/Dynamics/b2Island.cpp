@@ -27,6 +27,7 @@
 #include "Box2D/Dynamics/Joints/b2Joint.h"
 #include "Box2D/Common/b2StackAllocator.h"
 #include "Box2D/Common/b2Timer.h"
+#include "Box2D/MT/b2MtUtil.h"
 
 /*
 Position Correction Notes
@@ -146,6 +147,175 @@ This might be faster than computing sin+cos.
 However, we can compute sin+cos of the same angle fast.
 */
 
+// Solves the joints and then the contacts of one constraint color. Wide tasks solve batches of
+// velocity constraints instead of single contacts.
+class b2SolveConstraintColorTask : public b2RangeTask
+{
+public:
+	b2SolveConstraintColorTask() {}
+	b2SolveConstraintColorTask(const b2RangeTaskRange& range, b2Task::Type type,
+		b2Joint** joints, int32 jointCount, b2ContactSolver* contactSolver, int32 contactBegin,
+		bool wide, const b2SolverData* solverData)
+		: b2RangeTask(range)
+		, m_type(type)
+		, m_joints(joints)
+		, m_jointCount(jointCount)
+		, m_contactSolver(contactSolver)
+		, m_contactBegin(contactBegin)
+		, m_wide(wide)
+		, m_solverData(solverData)
+		, m_positionSolved(true)
+	{}
+
+	virtual b2Task::Type GetType() const override { return m_type; }
+
+	virtual void Execute(const b2ThreadContext&, const b2RangeTaskRange& range) override
+	{
+		int32 begin = range.begin;
+		int32 end = range.end;
+		int32 jointEnd = b2Min(end, m_jointCount);
+		int32 contactBegin = m_contactBegin + b2Max(begin - m_jointCount, 0);
+		int32 contactEnd = m_contactBegin + b2Max(end - m_jointCount, 0);
+
+		if (m_type == b2Task::e_solveVelocityConstraints)
+		{
+			for (int32 i = begin; i < jointEnd; ++i)
+			{
+				m_joints[i]->SolveVelocityConstraints(*m_solverData);
+			}
+
+			if (m_wide)
+			{
+				m_contactSolver->SolveWideVelocityConstraints(contactBegin, contactEnd);
+			}
+			else
+			{
+				m_contactSolver->SolveVelocityConstraints(contactBegin, contactEnd);
+			}
+		}
+		else
+		{
+			bool jointsOkay = true;
+			for (int32 i = begin; i < jointEnd; ++i)
+			{
+				bool jointOkay = m_joints[i]->SolvePositionConstraints(*m_solverData);
+				jointsOkay = jointsOkay && jointOkay;
+			}
+
+			bool contactsOkay = m_contactSolver->SolvePositionConstraints(contactBegin, contactEnd);
+
+			m_positionSolved = jointsOkay && contactsOkay;
+		}
+	}
+
+	bool IsPositionSolved() const { return m_positionSolved; }
+
+private:
+	b2Task::Type m_type;
+	b2Joint** m_joints;
+	int32 m_jointCount;
+	b2ContactSolver* m_contactSolver;
+	int32 m_contactBegin;
+	bool m_wide;
+	const b2SolverData* m_solverData;
+	bool m_positionSolved;
+};
+
+// Solve each color with range tasks, then solve the uncolored constraints on this thread.
+// Colors are solved on this thread when there is no executor. Velocity constraints use the
+// wide batches when the contact solver has them. Returns false if a position constraint isn't solved.
+static bool b2SolveConstraintColors(b2Task::Type type, const b2ConstraintColors& colors, b2Joint** joints,
+	b2ContactSolver* contactSolver, const b2SolverData& solverData, b2TaskExecutor* executor,
+	b2TaskGroup* taskGroup, b2StackAllocator* allocator)
+{
+	bool wide = type == b2Task::e_solveVelocityConstraints && contactSolver->m_wideConstraints != nullptr;
+
+	bool positionSolved = true;
+	for (int32 color = 0; color <= b2_maxConstraintColors; ++color)
+	{
+		int32 jointBegin = colors.jointBegin[color];
+		int32 jointCount = colors.jointBegin[color + 1] - jointBegin;
+		int32 contactBegin = colors.contactBegin[color];
+		int32 contactCount = colors.contactBegin[color + 1] - contactBegin;
+		bool wideColor = wide && color < b2_maxConstraintColors;
+		if (wideColor)
+		{
+			contactBegin = contactSolver->m_wideBegin[color];
+			contactCount = contactSolver->m_wideBegin[color + 1] - contactBegin;
+		}
+		uint32 count = jointCount + contactCount;
+		if (count == 0)
+		{
+			continue;
+		}
+
+		b2SolveConstraintColorTask task(b2RangeTaskRange(0, count), type,
+			joints + jointBegin, jointCount, contactSolver, contactBegin, wideColor, &solverData);
+
+		if (color == b2_maxConstraintColors || executor == nullptr)
+		{
+			// Uncolored constraints may share bodies.
+			task.Execute(b2MainThreadCtx(allocator), task.GetRange());
+			positionSolved = positionSolved && task.IsPositionSolved();
+			continue;
+		}
+
+		b2PartitionedRange ranges;
+		executor->PartitionRange(type, 0, count, ranges);
+		b2StackArray<b2SolveConstraintColorTask> tasks(*allocator, ranges.GetCount());
+		for (uint32 i = 0; i < ranges.GetCount(); ++i)
+		{
+			tasks[i] = task;
+			tasks[i].SetRange(ranges[i]);
+		}
+		b2SubmitTasks(*executor, taskGroup, tasks.data(), ranges.GetCount());
+
+		executor->Wait(taskGroup, b2MainThreadCtx(allocator));
+
+		for (uint32 i = 0; i < ranges.GetCount(); ++i)
+		{
+			positionSolved = positionSolved && tasks[i].IsPositionSolved();
+		}
+	}
+	return positionSolved;
+}
+
+// Find the first color that isn't used by either body. Bodies that aren't dynamic have an index of -1,
+// because the solver never changes their velocity or position. Constraints skip writing back the state
+// of those bodies, so constraints of the same color can share them.
+static int32 b2AssignConstraintColor(uint32* bodyColors, int32 indexA, int32 indexB)
+{
+	uint32 usedColors = 0;
+	if (indexA != -1)
+	{
+		usedColors |= bodyColors[indexA];
+	}
+	if (indexB != -1)
+	{
+		usedColors |= bodyColors[indexB];
+	}
+
+	int32 color = 0;
+	while (color < b2_maxConstraintColors && (usedColors & (1u << color)))
+	{
+		++color;
+	}
+
+	if (color < b2_maxConstraintColors)
+	{
+		if (indexA != -1)
+		{
+			bodyColors[indexA] |= 1u << color;
+		}
+		if (indexB != -1)
+		{
+			bodyColors[indexB] |= 1u << color;
+		}
+	}
+
+	return color;
+}
+
 b2Island::b2Island()
 {
 
@@ -182,7 +352,8 @@ b2Island::b2Island(int32 bodyCount, int32 contactCount, int32 jointCount,
 }
 
 void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, b2StackAllocator* allocator,
-		b2ContactListener* listener, uint32 threadId, bool allowSleep, b2GrowableArray<b2DeferredPostSolve>& postSolves)
+		b2ContactListener* listener, uint32 threadId, bool allowSleep, b2GrowableArray<b2DeferredPostSolve>& postSolves,
+		b2TaskExecutor* executor, b2TaskGroup* taskGroup)
 {
 	b2Timer timer;
 
@@ -231,6 +402,14 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 	timer.Reset();
 
+	// Colors are needed to solve in parallel and to batch contacts for the wide solver.
+	bool colored = executor || step.wideContactSolver;
+	b2ConstraintColors colors;
+	if (colored)
+	{
+		ColorConstraints(&colors, allocator, threadId);
+	}
+
 	// Solver data
 	b2SolverData solverData;
 	solverData.step = step;
@@ -261,12 +440,24 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		m_joints[i]->InitVelocityConstraints(solverData);
 	}
 
+	if (step.wideContactSolver)
+	{
+		contactSolver.PrepareWideConstraints(colors.contactBegin, b2_maxConstraintColors);
+	}
+
 	profile->solveInit += timer.GetMilliseconds();
 
 	// Solve velocity constraints
 	timer.Reset();
 	for (int32 i = 0; i < step.velocityIterations; ++i)
 	{
+		if (colored)
+		{
+			b2SolveConstraintColors(b2Task::e_solveVelocityConstraints, colors, m_joints,
+				&contactSolver, solverData, executor, taskGroup, allocator);
+			continue;
+		}
+
 		for (int32 j = 0; j < m_jointCount; ++j)
 		{
 			m_joints[j]->SolveVelocityConstraints(solverData);
@@ -276,6 +467,10 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	}
 
 	// Store impulses for warm starting
+	if (step.wideContactSolver)
+	{
+		contactSolver.StoreWideImpulses();
+	}
 	contactSolver.StoreImpulses();
 	profile->solveVelocity += timer.GetMilliseconds();
 
@@ -317,6 +512,17 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	bool positionSolved = false;
 	for (int32 i = 0; i < step.positionIterations; ++i)
 	{
+		if (executor)
+		{
+			if (b2SolveConstraintColors(b2Task::e_solvePositionConstraints, colors, m_joints,
+				&contactSolver, solverData, executor, taskGroup, allocator))
+			{
+				positionSolved = true;
+				break;
+			}
+			continue;
+		}
+
 		bool contactsOkay = contactSolver.SolvePositionConstraints();
 
 		bool jointsOkay = true;
@@ -396,7 +602,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 }
 
 void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB, b2StackAllocator* allocator,
-		b2ContactListener* listener)
+		b2ContactListener* listener, uint32 threadId, b2GrowableArray<b2DeferredPostSolve>* postSolves)
 {
 	b2Assert(toiIndexA < m_bodyCount);
 	b2Assert(toiIndexB < m_bodyCount);
@@ -414,7 +620,7 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 	b2ContactSolverDef contactSolverDef;
 	contactSolverDef.contacts = m_contacts;
 	contactSolverDef.count = m_contactCount;
-	contactSolverDef.threadId = 0;
+	contactSolverDef.threadId = threadId;
 	contactSolverDef.allocator = allocator;
 	contactSolverDef.step = subStep;
 	contactSolverDef.positions = m_positions;
@@ -465,10 +671,16 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 #endif
 
 	// Leap of faith to new safe state.
-	m_bodies[toiIndexA]->m_sweep.c0 = m_positions[toiIndexA].c;
-	m_bodies[toiIndexA]->m_sweep.a0 = m_positions[toiIndexA].a;
-	m_bodies[toiIndexB]->m_sweep.c0 = m_positions[toiIndexB].c;
-	m_bodies[toiIndexB]->m_sweep.a0 = m_positions[toiIndexB].a;
+	if (m_bodies[toiIndexA]->GetType() != b2_staticBody)
+	{
+		m_bodies[toiIndexA]->m_sweep.c0 = m_positions[toiIndexA].c;
+		m_bodies[toiIndexA]->m_sweep.a0 = m_positions[toiIndexA].a;
+	}
+	if (m_bodies[toiIndexB]->GetType() != b2_staticBody)
+	{
+		m_bodies[toiIndexB]->m_sweep.c0 = m_positions[toiIndexB].c;
+		m_bodies[toiIndexB]->m_sweep.a0 = m_positions[toiIndexB].a;
+	}
 
 	// No warm starting is needed for TOI events because warm
 	// starting impulses were applied in the discrete solver.
@@ -517,8 +729,12 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 		m_velocities[i].v = v;
 		m_velocities[i].w = w;
 
-		// Sync bodies
+		// Sync bodies. Static bodies don't move.
 		b2Body* body = m_bodies[i];
+		if (body->GetType() == b2_staticBody)
+		{
+			continue;
+		}
 		body->m_sweep.c = c;
 		body->m_sweep.a = a;
 		body->m_linearVelocity = v;
@@ -526,7 +742,99 @@ void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiInd
 		body->SynchronizeTransform();
 	}
 
-	Report<true>(contactSolver.m_velocityConstraints, listener, 0, nullptr);
+	if (postSolves)
+	{
+		Report<false>(contactSolver.m_velocityConstraints, listener, threadId, postSolves);
+	}
+	else
+	{
+		Report<true>(contactSolver.m_velocityConstraints, listener, 0, nullptr);
+	}
+}
+
+void b2Island::ColorConstraints(b2ConstraintColors* colors, b2StackAllocator* allocator, uint32 threadId)
+{
+	const int32 colorCount = b2_maxConstraintColors + 1;
+
+	// The colors used by each body's constraints, as bit flags.
+	uint32* bodyColors = (uint32*)allocator->Allocate(m_bodyCount * sizeof(uint32));
+	memset(bodyColors, 0, m_bodyCount * sizeof(uint32));
+
+	int32* jointColors = (int32*)allocator->Allocate(m_jointCount * sizeof(int32));
+	int32* contactColors = (int32*)allocator->Allocate(m_contactCount * sizeof(int32));
+
+	int32 jointCounts[colorCount] = {};
+	int32 contactCounts[colorCount] = {};
+
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		b2Body* bA = joint->GetBodyA();
+		b2Body* bB = joint->GetBodyB();
+
+		// Gear joints also constrain the bodies of their connected joints.
+		int32 color = b2_maxConstraintColors;
+		if (joint->GetType() != e_gearJoint)
+		{
+			int32 indexA = bA->GetType() == b2_dynamicBody ? bA->GetIslandIndex(threadId) : -1;
+			int32 indexB = bB->GetType() == b2_dynamicBody ? bB->GetIslandIndex(threadId) : -1;
+			color = b2AssignConstraintColor(bodyColors, indexA, indexB);
+		}
+
+		jointColors[i] = color;
+		++jointCounts[color];
+	}
+
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		b2Contact* contact = m_contacts[i];
+		b2Body* bA = contact->GetFixtureA()->GetBody();
+		b2Body* bB = contact->GetFixtureB()->GetBody();
+
+		int32 indexA = bA->GetType() == b2_dynamicBody ? bA->GetIslandIndex(threadId) : -1;
+		int32 indexB = bB->GetType() == b2_dynamicBody ? bB->GetIslandIndex(threadId) : -1;
+		int32 color = b2AssignConstraintColor(bodyColors, indexA, indexB);
+
+		contactColors[i] = color;
+		++contactCounts[color];
+	}
+
+	colors->jointBegin[0] = 0;
+	colors->contactBegin[0] = 0;
+	for (int32 i = 0; i < colorCount; ++i)
+	{
+		colors->jointBegin[i + 1] = colors->jointBegin[i] + jointCounts[i];
+		colors->contactBegin[i + 1] = colors->contactBegin[i] + contactCounts[i];
+	}
+
+	// Sort by color. Constraints keep their island order within a color, so the
+	// solve order doesn't depend on the thread count.
+	b2Joint** joints = (b2Joint**)allocator->Allocate(m_jointCount * sizeof(b2Joint*));
+	b2Contact** contacts = (b2Contact**)allocator->Allocate(m_contactCount * sizeof(b2Contact*));
+
+	int32 jointOffsets[colorCount];
+	int32 contactOffsets[colorCount];
+	memcpy(jointOffsets, colors->jointBegin, sizeof(jointOffsets));
+	memcpy(contactOffsets, colors->contactBegin, sizeof(contactOffsets));
+
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		joints[jointOffsets[jointColors[i]]++] = m_joints[i];
+	}
+
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		contacts[contactOffsets[contactColors[i]]++] = m_contacts[i];
+	}
+
+	memcpy(m_joints, joints, m_jointCount * sizeof(b2Joint*));
+	memcpy(m_contacts, contacts, m_contactCount * sizeof(b2Contact*));
+
+	allocator->Free(contacts);
+	allocator->Free(joints);
+	allocator->Free(contactColors);
+	allocator->Free(jointColors);
+	allocator->Free(bodyColors);
 }
 
 template<bool isSingleThread>
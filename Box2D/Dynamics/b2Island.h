@@ -32,6 +32,18 @@ class b2ContactListener;
 struct b2ContactVelocityConstraint;
 struct b2Profile;
 struct b2DeferredPostSolve;
+class b2TaskExecutor;
+class b2TaskGroup;
+
+/// Constraint ranges of an island that is solved by multiple threads. Color i contains
+/// the joints in [jointBegin[i], jointBegin[i + 1]) and the contacts in
+/// [contactBegin[i], contactBegin[i + 1]). The last range contains the constraints
+/// that couldn't be colored.
+struct b2ConstraintColors
+{
+	int32 jointBegin[b2_maxConstraintColors + 2];
+	int32 contactBegin[b2_maxConstraintColors + 2];
+};
 
 /// This is an internal class.
 class b2Island
@@ -51,15 +63,20 @@ public:
 		m_jointCount = 0;
 	}
 
+	/// If an executor is provided the constraints are colored and each color is solved by
+	/// parallel range tasks. This must only be done on the user thread.
 	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, b2StackAllocator* allocator,
-		b2ContactListener* listener, uint32 threadId, bool allowSleep, b2GrowableArray<b2DeferredPostSolve>& postSolves);
+		b2ContactListener* listener, uint32 threadId, bool allowSleep, b2GrowableArray<b2DeferredPostSolve>& postSolves,
+		b2TaskExecutor* executor = nullptr, b2TaskGroup* taskGroup = nullptr);
 
+	/// If postSolves is provided the PostSolve callbacks are deferred to it. Static bodies
+	/// aren't written, so they can be shared by TOI islands that are solved simultaneously.
 	void SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB, b2StackAllocator* allocator,
-		b2ContactListener* listener);
+		b2ContactListener* listener, uint32 threadId = 0, b2GrowableArray<b2DeferredPostSolve>* postSolves = nullptr);
 
-	void Add(b2Body* body)
+	void Add(b2Body* body, uint32 threadId = 0)
 	{
-		body->SetIslandIndex(m_bodyCount, 0);
+		body->SetIslandIndex(m_bodyCount, threadId);
 		m_bodies[m_bodyCount] = body;
 		++m_bodyCount;
 	}
@@ -74,6 +91,10 @@ public:
 		m_joints[m_jointCount++] = joint;
 	}
 
+	/// Sort the joints and contacts by color. Constraints of the same color don't share
+	/// dynamic bodies.
+	void ColorConstraints(b2ConstraintColors* colors, b2StackAllocator* allocator, uint32 threadId);
+
 	template<bool isSingleThread>
 	void Report(const b2ContactVelocityConstraint* constraints, b2ContactListener* listener, uint32 threadId,
 		b2GrowableArray<b2DeferredPostSolve>* postSolves);
@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Box2D/Dynamics/b2IslandCostModel.h"
+#include <cstring>
+
+// The weight of a step's samples is multiplied by this after each step, so samples from
+// about 1 / (1 - decay) steps ago still count.
+static const float64 b2_costModelDecay = 0.9;
+
+// Pulls the fit towards the previous coefficients, relative to the average sample weight.
+// This keeps the fit stable when a count doesn't vary, such as scenes without joints.
+static const float64 b2_costModelRegularization = 0.001;
+
+static float64 b2Determinant(const float64 m[3][3])
+{
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+		- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+		+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+b2IslandCostModel::b2IslandCostModel()
+{
+	Reset();
+}
+
+void b2IslandCostModel::Reset()
+{
+	memset(m_xx, 0, sizeof(m_xx));
+	memset(m_xy, 0, sizeof(m_xy));
+	m_newSampleCount = 0;
+	m_coefficients.SetZero();
+	m_trained = false;
+}
+
+void b2IslandCostModel::AddSample(const b2IslandCostSample& sample)
+{
+	float64 x[3] = { float64(sample.bodyCount), float64(sample.contactCount), float64(sample.jointCount) };
+	for (int32 i = 0; i < 3; ++i)
+	{
+		for (int32 j = 0; j < 3; ++j)
+		{
+			m_xx[i][j] += x[i] * x[j];
+		}
+		m_xy[i] += x[i] * sample.nanoseconds;
+	}
+	++m_newSampleCount;
+}
+
+void b2IslandCostModel::Update()
+{
+	if (m_newSampleCount == 0)
+	{
+		return;
+	}
+	m_newSampleCount = 0;
+
+	// Solve (xx + r * I) * c = xy + r * c0 with Cramer's rule.
+	float64 r = b2_costModelRegularization * (m_xx[0][0] + m_xx[1][1] + m_xx[2][2]) / 3.0 + 1.0e-9;
+	float64 a[3][3];
+	float64 b[3];
+	float64 c0[3] = { m_coefficients.x, m_coefficients.y, m_coefficients.z };
+	for (int32 i = 0; i < 3; ++i)
+	{
+		for (int32 j = 0; j < 3; ++j)
+		{
+			a[i][j] = m_xx[i][j] + (i == j ? r : 0.0);
+		}
+		b[i] = m_xy[i] + r * c0[i];
+	}
+
+	float64 det = b2Determinant(a);
+	if (det > 0.0)
+	{
+		float64 c[3];
+		for (int32 k = 0; k < 3; ++k)
+		{
+			float64 ak[3][3];
+			memcpy(ak, a, sizeof(a));
+			for (int32 i = 0; i < 3; ++i)
+			{
+				ak[i][k] = b[i];
+			}
+
+			// Negative coefficients come from noise. Islands never get cheaper as they grow.
+			c[k] = b2Max(b2Determinant(ak) / det, 0.0);
+		}
+
+		m_coefficients.Set(float32(c[0]), float32(c[1]), float32(c[2]));
+		m_trained = true;
+	}
+
+	for (int32 i = 0; i < 3; ++i)
+	{
+		for (int32 j = 0; j < 3; ++j)
+		{
+			m_xx[i][j] *= b2_costModelDecay;
+		}
+		m_xy[i] *= b2_costModelDecay;
+	}
+}
@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_ISLAND_COST_MODEL_H
+#define B2_ISLAND_COST_MODEL_H
+
+#include "Box2D/Common/b2Math.h"
+
+/// A measured island solve time. This is an internal structure.
+struct b2IslandCostSample
+{
+	int32 bodyCount;
+	int32 contactCount;
+	int32 jointCount;
+	float32 nanoseconds;
+};
+
+/// Learns how long islands take to solve, as a linear function of their body, contact, and joint
+/// counts, from measured solve times. The coefficients are an exponentially weighted least squares
+/// fit, so they follow changes in the scene and in the load on the machine.
+/// This is an internal class.
+class b2IslandCostModel
+{
+public:
+	b2IslandCostModel();
+
+	/// Forget all samples.
+	void Reset();
+
+	/// Add a sample to the current step.
+	void AddSample(const b2IslandCostSample& sample);
+
+	/// Refit the coefficients to include the samples of the current step, then fade out all
+	/// samples so that later steps carry more weight. Call this once per step.
+	void Update();
+
+	/// Have any samples been fitted?
+	bool IsTrained() const;
+
+	/// Estimate the nanoseconds it takes to solve an island. The model must be trained.
+	uint32 Estimate(int32 bodyCount, int32 contactCount, int32 jointCount) const;
+
+	/// Get the fitted nanoseconds per body, contact, and joint.
+	b2Vec3 GetCoefficients() const;
+
+private:
+	// The weighted sums of x * x^T and x * y, where x holds the counts and y the time.
+	float64 m_xx[3][3];
+	float64 m_xy[3];
+	int32 m_newSampleCount;
+	b2Vec3 m_coefficients;
+	bool m_trained;
+};
+
+inline bool b2IslandCostModel::IsTrained() const
+{
+	return m_trained;
+}
+
+inline uint32 b2IslandCostModel::Estimate(int32 bodyCount, int32 contactCount, int32 jointCount) const
+{
+	float32 nanoseconds = m_coefficients.x * bodyCount + m_coefficients.y * contactCount + m_coefficients.z * jointCount;
+	return (uint32)b2Clamp(nanoseconds, 1.0f, 4.0e9f);
+}
+
+inline b2Vec3 b2IslandCostModel::GetCoefficients() const
+{
+	return m_coefficients;
+}
+
+#endif
@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Box2D/Dynamics/b2PairSet.h"
+#include <cstring>
+
+// The table is kept at most half full so probe sequences stay short.
+static const uint32 b2_pairSetInitialCapacity = 256;
+
+b2PairSet::b2PairSet()
+{
+	m_slots = nullptr;
+	m_capacity = 0;
+	m_count = 0;
+	Resize(b2_pairSetInitialCapacity);
+}
+
+b2PairSet::~b2PairSet()
+{
+	b2Free(m_slots);
+}
+
+void b2PairSet::Add(const b2ContactProxyIds& proxyIds, b2Contact* contact)
+{
+	if (2 * (m_count + 1) > m_capacity)
+	{
+		Resize(2 * m_capacity);
+	}
+
+	uint64 key = GetKey(proxyIds);
+	b2Assert(key != 0);
+	uint32 mask = m_capacity - 1;
+	uint32 i = Hash(key) & mask;
+	while (m_slots[i].key != 0)
+	{
+		if (m_slots[i].key == key)
+		{
+			m_slots[i].contact = contact;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+	m_slots[i].key = key;
+	m_slots[i].contact = contact;
+	++m_count;
+}
+
+void b2PairSet::Remove(const b2ContactProxyIds& proxyIds, b2Contact* contact)
+{
+	uint64 key = GetKey(proxyIds);
+	uint32 mask = m_capacity - 1;
+	uint32 i = Hash(key) & mask;
+	while (m_slots[i].key != key)
+	{
+		if (m_slots[i].key == 0)
+		{
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+
+	if (m_slots[i].contact != contact)
+	{
+		return;
+	}
+
+	// Shift later entries of the probe sequence back so that no tombstones are needed.
+	uint32 hole = i;
+	for (uint32 j = (i + 1) & mask; m_slots[j].key != 0; j = (j + 1) & mask)
+	{
+		uint32 home = Hash(m_slots[j].key) & mask;
+
+		// The entry can fill the hole if its home isn't cyclically within (hole, j].
+		bool movable = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+		if (movable)
+		{
+			m_slots[hole] = m_slots[j];
+			hole = j;
+		}
+	}
+
+	m_slots[hole].key = 0;
+	m_slots[hole].contact = nullptr;
+	--m_count;
+}
+
+void b2PairSet::Reserve(uint32 count)
+{
+	if (2 * count > m_capacity)
+	{
+		Resize(b2NextPowerOfTwo(2 * count));
+	}
+}
+
+void b2PairSet::Resize(uint32 capacity)
+{
+	b2Assert(b2IsPowerOfTwo(capacity));
+
+	b2PairSlot* oldSlots = m_slots;
+	uint32 oldCapacity = m_capacity;
+
+	m_slots = (b2PairSlot*)b2Alloc(capacity * sizeof(b2PairSlot));
+	memset(m_slots, 0, capacity * sizeof(b2PairSlot));
+	m_capacity = capacity;
+
+	uint32 mask = m_capacity - 1;
+	for (uint32 i = 0; i < oldCapacity; ++i)
+	{
+		if (oldSlots[i].key == 0)
+		{
+			continue;
+		}
+
+		uint32 j = Hash(oldSlots[i].key) & mask;
+		while (m_slots[j].key != 0)
+		{
+			j = (j + 1) & mask;
+		}
+		m_slots[j] = oldSlots[i];
+	}
+
+	b2Free(oldSlots);
+}
@@ -0,0 +1,106 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_PAIR_SET_H
+#define B2_PAIR_SET_H
+
+#include "Box2D/Dynamics/Contacts/b2Contact.h"
+
+/// A hash set of the contacts of the world, keyed by their proxy ids. This is used to find
+/// existing contacts in constant time, rather than by searching the contact list of a body.
+/// The set persists across steps and only changes when contacts are created or destroyed.
+/// Find is safe to call from multiple threads while the set isn't being modified.
+/// This is meant for internal use only.
+class b2PairSet
+{
+public:
+	b2PairSet();
+	~b2PairSet();
+
+	b2PairSet(const b2PairSet&) = delete;
+	b2PairSet& operator=(const b2PairSet&) = delete;
+
+	/// Add a contact. A contact that was added with the same proxy ids is replaced.
+	void Add(const b2ContactProxyIds& proxyIds, b2Contact* contact);
+
+	/// Remove a contact if it's the one stored for its proxy ids.
+	void Remove(const b2ContactProxyIds& proxyIds, b2Contact* contact);
+
+	/// Get the contact with the proxy ids, or nullptr if there isn't one.
+	b2Contact* Find(const b2ContactProxyIds& proxyIds) const;
+
+	/// Get the number of contacts in the set.
+	uint32 GetCount() const;
+
+	/// Make room for a number of contacts, so adding them won't grow the table.
+	void Reserve(uint32 count);
+
+private:
+	struct b2PairSlot
+	{
+		uint64 key;
+		b2Contact* contact;
+	};
+
+	// Keys are never zero because the proxy ids of a pair are different.
+	static uint64 GetKey(const b2ContactProxyIds& proxyIds);
+	static uint32 Hash(uint64 key);
+
+	void Resize(uint32 capacity);
+
+	b2PairSlot* m_slots;
+	uint32 m_capacity;
+	uint32 m_count;
+};
+
+inline uint64 b2PairSet::GetKey(const b2ContactProxyIds& proxyIds)
+{
+	return ((uint64)(uint32)proxyIds.low << 32) | (uint32)proxyIds.high;
+}
+
+inline uint32 b2PairSet::Hash(uint64 key)
+{
+	// The 64-bit finalizer of MurmurHash3.
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return (uint32)key;
+}
+
+inline b2Contact* b2PairSet::Find(const b2ContactProxyIds& proxyIds) const
+{
+	uint64 key = GetKey(proxyIds);
+	uint32 mask = m_capacity - 1;
+	for (uint32 i = Hash(key) & mask; m_slots[i].key != 0; i = (i + 1) & mask)
+	{
+		if (m_slots[i].key == key)
+		{
+			return m_slots[i].contact;
+		}
+	}
+	return nullptr;
+}
+
+inline uint32 b2PairSet::GetCount() const
+{
+	return m_count;
+}
+
+#endif
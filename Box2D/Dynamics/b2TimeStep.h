@@ -48,6 +48,7 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool wideContactSolver;
 };
 
 /// This is an internal structure.
@@ -21,7 +21,17 @@
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2Fixture.h"
 #include "Box2D/Dynamics/b2Island.h"
+#include "Box2D/Dynamics/Joints/b2DistanceJoint.h"
+#include "Box2D/Dynamics/Joints/b2FrictionJoint.h"
+#include "Box2D/Dynamics/Joints/b2GearJoint.h"
+#include "Box2D/Dynamics/Joints/b2MotorJoint.h"
+#include "Box2D/Dynamics/Joints/b2MouseJoint.h"
+#include "Box2D/Dynamics/Joints/b2PrismaticJoint.h"
 #include "Box2D/Dynamics/Joints/b2PulleyJoint.h"
+#include "Box2D/Dynamics/Joints/b2RevoluteJoint.h"
+#include "Box2D/Dynamics/Joints/b2RopeJoint.h"
+#include "Box2D/Dynamics/Joints/b2WeldJoint.h"
+#include "Box2D/Dynamics/Joints/b2WheelJoint.h"
 #include "Box2D/Dynamics/Contacts/b2Contact.h"
 #include "Box2D/Dynamics/Contacts/b2ContactSolver.h"
 #include "Box2D/Collision/b2Collision.h"
@@ -32,15 +42,69 @@
 #include "Box2D/Collision/Shapes/b2PolygonShape.h"
 #include "Box2D/Collision/b2TimeOfImpact.h"
 #include "Box2D/Common/b2Draw.h"
+#include "Box2D/Common/b2Snapshot.h"
 #include "Box2D/Common/b2Timer.h"
 #include "Box2D/MT/b2MtUtil.h"
+#include "Box2D/MT/b2TaskThread.h"
 #include "Box2D/MT/b2ThreadDataSorter.h"
+#include "Box2D/MT/b2Tracer.h"
+#include <algorithm>
 #include <new>
 #include <mutex>
 
 static int32 b2_toiBodyCapacity = 2 * b2_maxTOIContacts;
 static int32 b2_toiContactCapacity = b2_maxTOIContacts;
 
+static const int32 b2_noIslandSeed = 0x7FFFFFFF;
+
+// With adaptive costs, islands are packed into about this many solve tasks per thread, but
+// tasks are filled to at least the minimum cost in nanoseconds to keep scheduling overhead low.
+static const uint64 b2_adaptiveSolveTasksPerThread = 4;
+static const uint32 b2_adaptiveMinSolveTaskCost = 20000;
+
+// Find the root of a set, halving the path along the way.
+static int32 b2FindIslandSet(std::atomic<int32>* sets, int32 i)
+{
+	int32 parent = sets[i].load(std::memory_order_relaxed);
+	while (parent != i)
+	{
+		int32 grandparent = sets[parent].load(std::memory_order_relaxed);
+		if (grandparent != parent)
+		{
+			// Other threads may have relinked the parent, but the grandparent is always
+			// in the same set, so losing this race is harmless.
+			sets[i].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+		}
+		i = parent;
+		parent = grandparent;
+	}
+	return i;
+}
+
+// Merge two sets. The larger root is always linked below the smaller root, so the
+// root of each set is its smallest index regardless of the order of unions.
+static void b2UniteIslandSets(std::atomic<int32>* sets, int32 a, int32 b)
+{
+	for (;;)
+	{
+		a = b2FindIslandSet(sets, a);
+		b = b2FindIslandSet(sets, b);
+		if (a == b)
+		{
+			return;
+		}
+		if (a < b)
+		{
+			b2Swap(a, b);
+		}
+		int32 expected = a;
+		if (sets[a].compare_exchange_weak(expected, b, std::memory_order_relaxed))
+		{
+			return;
+		}
+	}
+}
+
 class b2SolveTask : public b2Task
 {
 public:
@@ -78,13 +142,27 @@ public:
 		b2Vec2 gravity = m_world->m_gravity;
 		bool allowSleep = m_world->m_allowSleep;
 
+		bool adaptiveCosts = m_world->m_adaptiveCosts;
+
 		b2TimeStep timestep = *m_timestep;
 		for (uint32 islandIndex = 0; islandIndex < m_islandCount; ++islandIndex)
 		{
 			b2Island& island = m_islands[islandIndex];
 
+			uint64 begin = adaptiveCosts ? b2Timer::GetNanoseconds() : 0;
+
 			island.Solve(&td.m_profile, timestep, gravity, threadCtx.stack, contactListener,
 				threadCtx.threadId, allowSleep, td.m_postSolves);
+
+			if (adaptiveCosts)
+			{
+				b2IslandCostSample sample;
+				sample.bodyCount = island.m_bodyCount;
+				sample.contactCount = island.m_contactCount;
+				sample.jointCount = island.m_jointCount;
+				sample.nanoseconds = float32(b2Timer::GetNanoseconds() - begin);
+				m_world->m_perThreadData[threadCtx.threadId].m_islandCostSamples.push_back(sample);
+			}
 		}
 	}
 
@@ -97,6 +175,48 @@ private:
 	uint32 m_islandCount;
 };
 
+class b2FindIslandsTask : public b2RangeTask
+{
+public:
+	b2FindIslandsTask() {}
+	b2FindIslandsTask(const b2RangeTaskRange& range, b2World* world, b2Task::Type type)
+		: b2RangeTask(range)
+		, m_world(world)
+		, m_type(type)
+	{}
+
+	virtual b2Task::Type GetType() const override { return m_type; }
+
+	virtual void Execute(const b2ThreadContext& threadCtx, const b2RangeTaskRange& range) override
+	{
+		switch (m_type)
+		{
+		case b2Task::e_resetIslandSets:
+			m_world->ResetIslandSets(range.begin, range.end);
+			break;
+		case b2Task::e_uniteIslandSets:
+			m_world->UniteIslandSets(range.begin, range.end);
+			break;
+		case b2Task::e_findIslandSeeds:
+			m_world->FindIslandSeeds(range.begin, range.end);
+			break;
+		case b2Task::e_activateIslandContacts:
+			m_world->ActivateIslandContacts(range.begin, range.end);
+			break;
+		case b2Task::e_buildIslands:
+			m_world->BuildIslands(range.begin, range.end, threadCtx.threadId);
+			break;
+		default:
+			b2Assert(false);
+			break;
+		}
+	}
+
+private:
+	b2World* m_world;
+	b2Task::Type m_type;
+};
+
 class b2CollideTask : public b2RangeTask
 {
 public:
@@ -163,50 +283,40 @@ class b2ClearContactSolveFlags : public b2RangeTask
 {
 public:
 	b2ClearContactSolveFlags() {}
-	b2ClearContactSolveFlags(const b2RangeTaskRange& range, b2Contact** contacts)
+	b2ClearContactSolveFlags(const b2RangeTaskRange& range, b2ContactStateStore* contactStates)
 		: b2RangeTask(range)
-		, m_contacts(contacts)
+		, m_contactStates(contactStates)
 	{}
 
 	virtual b2Task::Type GetType() const override { return b2Task::e_clearContactSolveFlags; }
 
 	virtual void Execute(const b2ThreadContext&, const b2RangeTaskRange& range) override
 	{
-		for (uint32 i = range.begin; i < range.end; ++i)
-		{
-			b2Contact* c = m_contacts[i];
-			c->m_flags &= ~b2Contact::e_islandFlag;
-		}
+		m_contactStates->ClearIslandFlags(range.begin, range.end);
 	}
 
 private:
-	b2Contact** m_contacts;
+	b2ContactStateStore* m_contactStates;
 };
 
 class b2ClearContactSolveTOIFlags : public b2RangeTask
 {
 public:
 	b2ClearContactSolveTOIFlags() {}
-	b2ClearContactSolveTOIFlags(const b2RangeTaskRange& range, b2Contact** contacts)
+	b2ClearContactSolveTOIFlags(const b2RangeTaskRange& range, b2ContactStateStore* contactStates)
 		: b2RangeTask(range)
-		, m_contacts(contacts)
+		, m_contactStates(contactStates)
 	{}
 
 	virtual b2Task::Type GetType() const override { return b2Task::e_clearContactSolveToiFlags; }
 
 	virtual void Execute(const b2ThreadContext&, const b2RangeTaskRange& range) override
 	{
-		for (uint32 i = range.begin; i < range.end; ++i)
-		{
-			b2Contact* c = m_contacts[i];
-			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-			c->m_toiCount = 0;
-			c->m_toi = 1.0f;
-		}
+		m_contactStates->ClearToiState(range.begin, range.end);
 	}
 
 private:
-	b2Contact** m_contacts;
+	b2ContactStateStore* m_contactStates;
 };
 
 class b2ClearBodySolveFlags : public b2RangeTask
@@ -284,10 +394,12 @@ class alignas(b2_cacheLineSize) b2FindMinToiContactTask : public b2RangeTask
 {
 public:
 	b2FindMinToiContactTask() {}
-	b2FindMinToiContactTask(const b2RangeTaskRange& range, b2Contact** contacts, b2World* world)
+	b2FindMinToiContactTask(const b2RangeTaskRange& range, b2Contact** contacts,
+		const b2ContactStateStore* contactStates, b2World* world)
 		: b2RangeTask(range)
 		, m_world(world)
 		, m_contacts(contacts)
+		, m_contactStates(contactStates)
 		, m_minContact(nullptr)
 		, m_minAlpha(1.0f)
 	{}
@@ -299,31 +411,33 @@ public:
 	{
 		auto& outOfSyncSweeps = m_world->m_perThreadData[threadCtx.threadId].m_outOfSyncSweeps;
 
+		const uint32* flags = m_contactStates->m_flags.data();
+		const b2ContactToi* tois = m_contactStates->m_tois.data();
+
 		float32 alpha = 1.0f;
 
 		for (uint32 i = range.begin; i < range.end; ++i)
 		{
-			b2Contact* c = m_contacts[i];
-
-			b2Assert((c->m_flags & b2Contact::e_toiCandidateFlag) == b2Contact::e_toiCandidateFlag);
+			b2Assert((flags[i] & b2Contact::e_toiCandidateFlag) == b2Contact::e_toiCandidateFlag);
+			b2Assert((flags[i] & b2Contact::e_toiFlag) == 0);
 
-			b2Fixture* fA = c->GetFixtureA();
-			b2Fixture* fB = c->GetFixtureB();
-
-			b2Assert(b2Contact::IsToiCandidate(fA, fB));
-
-			b2Assert((c->m_flags & b2Contact::e_toiFlag) == 0);
-
-			if (c->m_flags & b2Contact::e_inactiveFlag)
+			if (flags[i] & b2Contact::e_inactiveFlag)
 			{
 				continue;
 			}
 
-			if (c->IsMinToiCandidate() == false)
+			if (b2Contact::IsMinToiCandidate(flags[i], tois[i]) == false)
 			{
 				continue;
 			}
 
+			b2Contact* c = m_contacts[i];
+
+			b2Fixture* fA = c->GetFixtureA();
+			b2Fixture* fB = c->GetFixtureB();
+
+			b2Assert(b2Contact::IsToiCandidate(fA, fB));
+
 			b2Body* bA = fA->GetBody();
 			b2Body* bB = fB->GetBody();
 
@@ -355,18 +469,116 @@ private:
 
 	b2World* m_world;
 	b2Contact** m_contacts;
+	const b2ContactStateStore* m_contactStates;
 	b2Contact* m_minContact;
 	float32 m_minAlpha;
 };
 
+class b2FindToiEventsTask : public b2RangeTask
+{
+public:
+	b2FindToiEventsTask() {}
+	b2FindToiEventsTask(const b2RangeTaskRange& range, b2Contact** contacts,
+		const b2ContactStateStore* contactStates, b2World* world)
+		: b2RangeTask(range)
+		, m_world(world)
+		, m_contacts(contacts)
+		, m_contactStates(contactStates)
+		, m_computedToi(false)
+	{}
+
+	// Were any TOI flags set by this task?
+	bool ComputedToi() const { return m_computedToi; }
+
+	virtual b2Task::Type GetType() const override { return b2Task::e_findToiEvents; }
+
+	virtual void Execute(const b2ThreadContext& threadCtx, const b2RangeTaskRange& range) override
+	{
+		auto& td = m_world->m_perThreadData[threadCtx.threadId];
+
+		const uint32* flags = m_contactStates->m_flags.data();
+		const b2ContactToi* tois = m_contactStates->m_tois.data();
+
+		for (uint32 i = range.begin; i < range.end; ++i)
+		{
+			if (flags[i] & b2Contact::e_inactiveFlag)
+			{
+				continue;
+			}
+
+			if (b2Contact::IsMinToiCandidate(flags[i], tois[i]) == false)
+			{
+				continue;
+			}
+
+			b2Contact* c = m_contacts[i];
+
+			// Cached TOIs are still valid because the bodies haven't moved since they were computed.
+			if ((flags[i] & b2Contact::e_toiFlag) == 0)
+			{
+				// MT Note: see b2FindMinToiContactTask.
+				if (c->GetFixtureA()->GetBody()->m_sweep.alpha0 != c->GetFixtureB()->GetBody()->m_sweep.alpha0)
+				{
+					td.m_outOfSyncSweeps.push_back(c);
+					continue;
+				}
+
+				m_computedToi = true;
+			}
+
+			float32 alpha = b2World::ComputeToi(c);
+
+			if (alpha < 1.0f - 10.0f * b2_epsilon)
+			{
+				td.m_toiEvents.push_back(c);
+			}
+		}
+	}
+
+private:
+	b2World* m_world;
+	b2Contact** m_contacts;
+	const b2ContactStateStore* m_contactStates;
+	bool m_computedToi;
+};
+
+class b2SolveToiEventsTask : public b2RangeTask
+{
+public:
+	b2SolveToiEventsTask() {}
+	b2SolveToiEventsTask(const b2RangeTaskRange& range, b2World* world, const b2TimeStep* step,
+		b2World::ToiEventRecord* events)
+		: b2RangeTask(range)
+		, m_world(world)
+		, m_step(step)
+		, m_events(events)
+	{}
+
+	virtual b2Task::Type GetType() const override { return b2Task::e_solveToiEvents; }
+
+	virtual void Execute(const b2ThreadContext& threadCtx, const b2RangeTaskRange& range) override
+	{
+		for (uint32 i = range.begin; i < range.end; ++i)
+		{
+			m_world->SolveToiEvent(*m_step, m_events + i, threadCtx);
+		}
+	}
+
+private:
+	b2World* m_world;
+	const b2TimeStep* m_step;
+	b2World::ToiEventRecord* m_events;
+};
+
 b2_forceInline float32 b2World::ComputeToi(b2Contact* c)
 {
-	b2Assert((c->m_flags & b2Contact::e_toiCandidateFlag) == b2Contact::e_toiCandidateFlag);
+	uint32 flags = c->m_states->m_flags[c->m_managerIndex];
+	b2Assert((flags & b2Contact::e_toiCandidateFlag) == b2Contact::e_toiCandidateFlag);
 	b2Assert(c->IsMinToiCandidate());
 
-	if (c->m_flags & b2Contact::e_toiFlag)
+	if (flags & b2Contact::e_toiFlag)
 	{
-		return c->m_toi;
+		return c->m_states->m_tois[c->m_managerIndex].toi;
 	}
 
 	b2Fixture* fA = c->GetFixtureA();
@@ -374,7 +586,7 @@ b2_forceInline float32 b2World::ComputeToi(b2Contact* c)
 
 	b2Assert(b2Contact::IsToiCandidate(fA, fB));
 
-	b2Assert((c->m_flags & b2Contact::e_inactiveFlag) == 0);
+	b2Assert((flags & b2Contact::e_inactiveFlag) == 0);
 
 	b2Body* bA = fA->GetBody();
 	b2Body* bB = fB->GetBody();
@@ -403,7 +615,7 @@ b2_forceInline float32 b2World::ComputeToi(b2Contact* c)
 
 b2_forceInline float32 b2World::ComputeToi(b2Contact* c, float32 alpha0)
 {
-	b2Assert((c->m_flags & b2Contact::e_toiFlag) == 0);
+	b2Assert((c->m_states->m_flags[c->m_managerIndex] & b2Contact::e_toiFlag) == 0);
 
 	// Compute the TOI for this contact.
 	float32 alpha = 1.0f;
@@ -437,8 +649,8 @@ b2_forceInline float32 b2World::ComputeToi(b2Contact* c, float32 alpha0)
 		alpha = 1.0f;
 	}
 
-	c->m_toi = alpha;
-	c->m_flags |= b2Contact::e_toiFlag;
+	c->m_states->m_tois[c->m_managerIndex].toi = alpha;
+	c->m_states->m_flags[c->m_managerIndex] |= b2Contact::e_toiFlag;
 
 	return alpha;
 }
@@ -467,6 +679,11 @@ b2World::b2World(const b2Vec2& gravity)
 	m_contactCost = 10;
 	m_jointCost = 10;
 	m_solveTaskCostThreshold = 100;
+	m_parallelIslandCostThreshold = 5000;
+	m_parallelIslandSolving = false;
+	m_wideContactSolving = false;
+	m_parallelToiSolving = false;
+	m_adaptiveCosts = false;
 
 	m_allowSleep = true;
 	m_gravity = gravity;
@@ -475,13 +692,32 @@ b2World::b2World(const b2Vec2& gravity)
 
 	m_inv_dt0 = 0.0f;
 
-	m_contactManager.m_allocator = &m_blockAllocator;
+	m_islandSets = nullptr;
+	m_islandSeeds = nullptr;
+
+	m_capacityOverflowCount = 0;
+	m_capacityReserved = false;
+
+	m_stepThread = nullptr;
+	m_stepTask = nullptr;
+	m_asyncStepCount = 0;
+	m_finishedAsyncStepCount.store(0, std::memory_order_relaxed);
+
+	m_tracer = nullptr;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
 }
 
 b2World::~b2World()
 {
+	if (m_stepThread)
+	{
+		// Finish the asynchronous step before anything is destroyed.
+		m_stepThread->~b2TaskThread();
+		b2Free(m_stepThread);
+		b2Free(m_stepTask);
+	}
+
 	// Some shapes allocate using b2Alloc.
 	b2Body* b = m_bodyList;
 	while (b)
@@ -497,6 +733,9 @@ b2World::~b2World()
 			f = fNext;
 		}
 
+		// These can also use b2Alloc with enough threads.
+		FreeStaticIslandIndices(b);
+
 		b = bNext;
 	}
 }
@@ -526,6 +765,56 @@ void b2World::SetSubTreeSize(float32 subTreeWidth, float32 subTreeHeight)
 }
 #endif
 
+void b2World::SetSeparateStaticTree(bool flag)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked() || flag == GetSeparateStaticTree())
+	{
+		return;
+	}
+
+	// Contacts refer to proxy ids, so they're destroyed with the proxies.
+	while (m_contactManager.m_contacts.size() > 0)
+	{
+		m_contactManager.Destroy(m_contactManager.m_contacts.back());
+	}
+
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			f->DestroyProxies(broadPhase);
+		}
+	}
+
+	broadPhase->SetSeparateStaticTree(flag);
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (b->IsActive() == false)
+		{
+			continue;
+		}
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			f->CreateProxies(broadPhase, b->m_xf);
+		}
+	}
+}
+
+bool b2World::GetSeparateStaticTree() const
+{
+	return m_contactManager.m_broadPhase.GetSeparateStaticTree();
+}
+
+void b2World::RebuildStaticTree(b2TaskExecutor& executor)
+{
+	b2Assert(IsLocked() == false);
+	m_contactManager.m_broadPhase.RebuildStaticTree(executor);
+}
+
 void b2World::SetDestructionListener(b2DestructionListener* listener)
 {
 	m_destructionListener = listener;
@@ -566,6 +855,7 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	}
 	m_bodyList = b;
 	++m_bodyCount;
+	m_contactManager.ReserveActivityChanges(m_bodyCount);
 
 	// Add to bodies array.
 	if (def->type != b2_staticBody)
@@ -577,6 +867,7 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	{
 		b->m_worldIndex = m_staticBodies.size();
 		m_staticBodies.push_back(b);
+		AllocateStaticIslandIndices(b);
 	}
 
 	return b;
@@ -667,10 +958,13 @@ void b2World::DestroyBody(b2Body* b)
 	}
 	else
 	{
+		FreeStaticIslandIndices(b);
 		m_staticBodies.back()->m_worldIndex = index;
 		b2RemoveAndSwapBack(m_staticBodies, index);
 	}
 
+	m_contactManager.RemoveActivityChange(b);
+
 	--m_bodyCount;
 	b->~b2Body();
 	m_blockAllocator.Free(b, sizeof(b2Body));
@@ -724,7 +1018,7 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 			{
 				// Flag the contact for filtering at the next time step (where either
 				// body is awake).
-				edge->contact->m_flags |= b2Contact::e_filterFlag;
+				m_contactManager.FlagForFiltering(edge->contact);
 			}
 
 			edge = edge->next;
@@ -823,7 +1117,7 @@ void b2World::DestroyJoint(b2Joint* j)
 			{
 				// Flag the contact for filtering at the next time step (where either
 				// body is awake).
-				edge->contact->m_flags |= b2Contact::e_filterFlag;
+				m_contactManager.FlagForFiltering(edge->contact);
 			}
 
 			edge = edge->next;
@@ -831,6 +1125,26 @@ void b2World::DestroyJoint(b2Joint* j)
 	}
 }
 
+void b2World::SetTracer(b2Tracer* tracer)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_tracer = tracer;
+}
+
+void b2World::SetAdaptiveCosts(bool flag)
+{
+	if (flag && m_adaptiveCosts == false)
+	{
+		m_islandCostModel.Reset();
+	}
+	m_adaptiveCosts = flag;
+}
+
 void b2World::SetAllowSleeping(bool flag)
 {
 	if (flag == m_allowSleep)
@@ -850,6 +1164,8 @@ void b2World::SetAllowSleeping(bool flag)
 
 void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact* minContact, float32 minAlpha)
 {
+	island.Clear();
+
 	// Advance the bodies to the TOI.
 	b2Fixture* fA = minContact->GetFixtureA();
 	b2Fixture* fB = minContact->GetFixtureB();
@@ -864,8 +1180,8 @@ void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact*
 
 	// The TOI contact likely has some new contact points.
 	minContact->Update(m_contactManager.m_contactListener);
-	minContact->m_flags &= ~b2Contact::e_toiFlag;
-	++minContact->m_toiCount;
+	minContact->m_states->m_flags[minContact->m_managerIndex] &= ~b2Contact::e_toiFlag;
+	++minContact->m_states->m_tois[minContact->m_managerIndex].toiCount;
 
 	// Is the contact solid?
 	if (minContact->IsEnabled() == false || minContact->IsTouching() == false)
@@ -883,14 +1199,13 @@ void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact*
 	bB->SetAwake(true);
 
 	// Build the island
-	island.Clear();
 	island.Add(bA);
 	island.Add(bB);
 	island.Add(minContact);
 
 	bA->m_flags |= b2Body::e_islandFlag;
 	bB->m_flags |= b2Body::e_islandFlag;
-	minContact->m_flags |= b2Contact::e_islandFlag;
+	minContact->m_states->m_flags[minContact->m_managerIndex] |= b2Contact::e_islandFlag;
 
 	// Get contacts on bodyA and bodyB.
 	b2Body* bodies[2] = {bA, bB};
@@ -914,7 +1229,7 @@ void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact*
 				b2Contact* contact = ce->contact;
 
 				// Has this contact already been added to the island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
+				if (contact->m_states->m_flags[contact->m_managerIndex] & b2Contact::e_islandFlag)
 				{
 					continue;
 				}
@@ -962,7 +1277,7 @@ void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact*
 				}
 
 				// Add the contact to the island
-				contact->m_flags |= b2Contact::e_islandFlag;
+				contact->m_states->m_flags[contact->m_managerIndex] |= b2Contact::e_islandFlag;
 				island.Add(contact);
 
 				// Has the other body already been added to the island?
@@ -991,6 +1306,7 @@ void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact*
 	subStep.positionIterations = 20;
 	subStep.velocityIterations = step.velocityIterations;
 	subStep.warmStarting = false;
+	subStep.wideContactSolver = false;
 	island.SolveTOI(subStep, bA->GetIslandIndex(0), bB->GetIslandIndex(0), &m_stackAllocator, m_contactManager.m_contactListener);
 
 	// Reset island flags and synchronize broad-phase proxies.
@@ -1011,7 +1327,7 @@ void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact*
 		{
 			b2Contact* c = ce->contact;
 
-			c->m_flags &= ~(b2Contact::e_islandFlag | b2Contact::e_toiFlag);
+			c->m_states->m_flags[c->m_managerIndex] &= ~(b2Contact::e_islandFlag | b2Contact::e_toiFlag);
 		}
 	}
 
@@ -1023,69 +1339,707 @@ void b2World::StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact*
 	}
 }
 
-void b2World::SolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step)
+void b2World::SolveToiEvent(const b2TimeStep& step, ToiEventRecord* event, const b2ThreadContext& threadCtx)
 {
-	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Body*));
-	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(b2_toiContactCapacity * sizeof(b2Contact*));
+	// This is StepSolveTOI for a thread. Other events can share the static bodies, so they aren't
+	// modified here. Waking bodies, callbacks, and broad-phase updates are done after the tasks.
+	uint32 threadId = threadCtx.threadId;
+	b2ContactManagerPerThreadData& td = m_contactManager.m_perThreadData[threadId];
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+	b2GrowableArray<b2Body*>& toiBodies = m_perThreadData[threadId].m_toiBodies;
 
-	b2Velocity* velocities = (b2Velocity*)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Velocity));
-	b2Position* positions = (b2Position*)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Position));
+	event->threadId = threadId;
+	event->bodyBegin = toiBodies.size();
+	event->bodyCount = 0;
 
-	b2Island island(bodies, contacts, velocities, positions);
+	b2Contact* minContact = event->contact;
+	float32 minAlpha = event->alpha;
 
-	b2Contact* minContact = nullptr;
-	float32 minAlpha = 1.0f;
+	// Advance the bodies to the TOI.
+	b2Fixture* fA = minContact->GetFixtureA();
+	b2Fixture* fB = minContact->GetFixtureB();
+	b2Body* bA = fA->GetBody();
+	b2Body* bB = fB->GetBody();
 
+	bool isStaticA = bA->GetType() == b2_staticBody;
+	bool isStaticB = bB->GetType() == b2_staticBody;
 
-	// Do the initial TOI computation on multiple threads.
-	bool useMultithreadedFind = m_stepComplete;
+	b2Sweep backup1 = bA->m_sweep;
+	b2Sweep backup2 = bB->m_sweep;
 
-	// Only clear flags if any were modified.
-	// If the step is not complete then they were modified during a previous sub step.
-	bool clearPostSolveTOI = m_stepComplete == false;
+	if (isStaticA == false)
+	{
+		bA->Advance(minAlpha);
+	}
+	if (isStaticB == false)
+	{
+		bB->Advance(minAlpha);
+	}
 
-	// Find TOI events and solve them.
-	for (;;)
+	// The TOI contact likely has some new contact points.
+	minContact->Update(td, listener, threadId);
+	minContact->m_states->m_flags[minContact->m_managerIndex] &= ~b2Contact::e_toiFlag;
+	++minContact->m_states->m_tois[minContact->m_managerIndex].toiCount;
+
+	// Is the contact solid?
+	if (minContact->IsEnabled() == false || minContact->IsTouching() == false)
 	{
-		if (useMultithreadedFind)
+		// Restore the sweeps.
+		minContact->SetEnabled(false);
+		if (isStaticA == false)
 		{
-			b2Timer timer;
-			FindMinToiContact(executor, taskGroup, &minContact, &minAlpha);
-			m_profile.solveTOIFindMinContact += timer.GetMilliseconds();
-
-			useMultithreadedFind = false;
-			if (minContact != nullptr)
-			{
-				clearPostSolveTOI = true;
-			}
+			bA->m_sweep = backup1;
+			bA->SynchronizeTransform();
 		}
-		else
+		if (isStaticB == false)
 		{
-			b2Timer timer;
-			FindMinToiContact(&minContact, &minAlpha);
-			m_profile.solveTOIFindMinContact += timer.GetMilliseconds();
+			bB->m_sweep = backup2;
+			bB->SynchronizeTransform();
 		}
+		return;
+	}
 
-		if (minContact == nullptr || 1.0f - 10.0f * b2_epsilon < minAlpha)
-		{
-			// No more TOI events. Done!
-			m_stepComplete = true;
-			if (clearPostSolveTOI)
-			{
-				ClearPostSolveTOI(executor, taskGroup);
-			}
-			break;
-		}
+	b2StackAllocator* allocator = threadCtx.stack;
+	b2Body** bodies = (b2Body**)allocator->Allocate(b2_toiBodyCapacity * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)allocator->Allocate(b2_toiContactCapacity * sizeof(b2Contact*));
+	b2Velocity* velocities = (b2Velocity*)allocator->Allocate(b2_toiBodyCapacity * sizeof(b2Velocity));
+	b2Position* positions = (b2Position*)allocator->Allocate(b2_toiBodyCapacity * sizeof(b2Position));
 
-		StepSolveTOI(step, island, minContact, minAlpha);
+	// Build the island
+	b2Island island(bodies, contacts, velocities, positions);
+	island.Add(bA, threadId);
+	island.Add(bB, threadId);
+	island.Add(minContact);
+
+	if (isStaticA == false)
+	{
+		bA->m_flags |= b2Body::e_islandFlag;
+	}
+	if (isStaticB == false)
+	{
+		bB->m_flags |= b2Body::e_islandFlag;
+	}
+	minContact->m_states->m_flags[minContact->m_managerIndex] |= b2Contact::e_islandFlag;
+
+	// Get contacts on bodyA and bodyB.
+	b2Body* eventBodies[2] = {bA, bB};
+	for (int32 i = 0; i < 2; ++i)
+	{
+		b2Body* body = eventBodies[i];
+		if (body->GetType() == b2_dynamicBody)
+		{
+			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+			{
+				if (island.m_bodyCount == b2_toiBodyCapacity)
+				{
+					break;
+				}
+
+				if (island.m_contactCount == b2_toiContactCapacity)
+				{
+					break;
+				}
+
+				b2Contact* contact = ce->contact;
+
+				// Has this contact already been added to the island?
+				if (contact->m_states->m_flags[contact->m_managerIndex] & b2Contact::e_islandFlag)
+				{
+					continue;
+				}
+
+				// Only add static, kinematic, or bullet bodies.
+				b2Body* other = ce->other;
+				if (other->GetType() == b2_dynamicBody &&
+					body->IsBullet() == false && other->IsBullet() == false)
+				{
+					continue;
+				}
+
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
+				{
+					continue;
+				}
+
+				// Tentatively advance the body to the TOI.
+				bool isStaticOther = other->GetType() == b2_staticBody;
+				b2Sweep backup = other->m_sweep;
+				if (isStaticOther == false && (other->m_flags & b2Body::e_islandFlag) == 0)
+				{
+					other->Advance(minAlpha);
+				}
+
+				// Update the contact points
+				contact->Update(td, listener, threadId);
+
+				// Was the contact disabled by the user? Are there contact points?
+				if (contact->IsEnabled() == false || contact->IsTouching() == false)
+				{
+					if (isStaticOther == false)
+					{
+						other->m_sweep = backup;
+						other->SynchronizeTransform();
+					}
+					continue;
+				}
+
+				// Add the contact to the island
+				contact->m_states->m_flags[contact->m_managerIndex] |= b2Contact::e_islandFlag;
+				island.Add(contact);
+
+				// Has the other body already been added to the island?
+				if (isStaticOther)
+				{
+					bool isAdded = false;
+					for (int32 j = 0; j < island.m_bodyCount && isAdded == false; ++j)
+					{
+						isAdded = island.m_bodies[j] == other;
+					}
+
+					if (isAdded)
+					{
+						continue;
+					}
+				}
+				else
+				{
+					if (other->m_flags & b2Body::e_islandFlag)
+					{
+						continue;
+					}
+
+					other->m_flags |= b2Body::e_islandFlag;
+				}
+
+				island.Add(other, threadId);
+			}
+		}
+	}
+
+	b2TimeStep subStep;
+	subStep.dt = (1.0f - minAlpha) * step.dt;
+	subStep.inv_dt = 1.0f / subStep.dt;
+	subStep.dtRatio = 1.0f;
+	subStep.positionIterations = 20;
+	subStep.velocityIterations = step.velocityIterations;
+	subStep.warmStarting = false;
+	subStep.wideContactSolver = false;
+	island.SolveTOI(subStep, bA->GetIslandIndex(threadId), bB->GetIslandIndex(threadId), allocator, listener,
+		threadId, &td.m_postSolves);
+
+	for (int32 i = 0; i < island.m_bodyCount; ++i)
+	{
+		toiBodies.push_back(island.m_bodies[i]);
+	}
+	event->bodyCount = island.m_bodyCount;
+
+	allocator->Free(positions);
+	allocator->Free(velocities);
+	allocator->Free(contacts);
+	allocator->Free(bodies);
+}
+
+void b2World::SolveToiBatch(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step,
+	b2Contact** events, uint32 eventCount)
+{
+	b2StackArray<ToiEventRecord> records(m_stackAllocator, eventCount);
+	for (uint32 i = 0; i < eventCount; ++i)
+	{
+		records[i].contact = events[i];
+		records[i].alpha = events[i]->m_states->m_tois[events[i]->m_managerIndex].toi;
+	}
+
+	SetMtLock(e_mtLocked | e_mtCollisionLocked);
+
+	{
+		b2PartitionedRange ranges;
+		executor.PartitionRange(b2Task::e_solveToiEvents, 0, eventCount, ranges);
+		b2StackArray<b2SolveToiEventsTask> tasks(m_stackAllocator, ranges.GetCount());
+		for (uint32 i = 0; i < ranges.GetCount(); ++i)
+		{
+			tasks[i] = b2SolveToiEventsTask(ranges[i], this, &step, records.data());
+		}
+		b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+		executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+	}
+
+	SetMtLock(0);
+
+	// Finish the events in TOI order.
+	for (uint32 i = 0; i < eventCount; ++i)
+	{
+		const ToiEventRecord& event = records[i];
+		b2Body** bodies = m_perThreadData[event.threadId].m_toiBodies.data() + event.bodyBegin;
+
+		for (uint32 j = 0; j < event.bodyCount; ++j)
+		{
+			b2Body* body = bodies[j];
+
+			// The first two bodies belong to the TOI contact.
+			if (j < 2 || body->GetType() != b2_staticBody)
+			{
+				body->SetAwake(true);
+			}
+
+			if (body->GetType() == b2_staticBody)
+			{
+				body->Advance(event.alpha);
+			}
+		}
+
+		// Reset island flags and synchronize broad-phase proxies.
+		for (uint32 j = 0; j < event.bodyCount; ++j)
+		{
+			b2Body* body = bodies[j];
+			body->m_flags &= ~b2Body::e_islandFlag;
+
+			if (body->GetType() != b2_dynamicBody)
+			{
+				continue;
+			}
+
+			body->SynchronizeFixtures();
+
+			// Recalculate all contact TOIs on this displaced body.
+			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* c = ce->contact;
+
+				c->m_states->m_flags[c->m_managerIndex] &= ~(b2Contact::e_islandFlag | b2Contact::e_toiFlag);
+			}
+		}
+	}
+
+	// The contacts of the displaced bodies are recomputed by the next search.
+	for (uint32 i = 0; i < eventCount; ++i)
+	{
+		const ToiEventRecord& event = records[i];
+		b2Body** bodies = m_perThreadData[event.threadId].m_toiBodies.data() + event.bodyBegin;
+
+		for (uint32 j = 0; j < event.bodyCount; ++j)
+		{
+			if (bodies[j]->GetType() == b2_dynamicBody)
+			{
+				AddToiDirtyContacts(bodies[j]);
+			}
+		}
+	}
+
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		m_perThreadData[i].m_toiBodies.clear();
+	}
+
+	m_contactManager.FinishSolveTOI(executor, taskGroup, m_stackAllocator);
+
+	// Commit fixture proxy movements to the broad-phase so that new contacts are created.
+	m_contactManager.FindNewContacts(0, m_contactManager.m_broadPhase.GetMoveCount(), 0);
+	m_contactManager.m_broadPhase.ResetBuffers();
+}
+
+// Calls f for each non-static body that can be read or written while solving the TOI event of a contact.
+template<typename Func>
+static void b2ForEachToiEventBody(b2Contact* c, Func f)
+{
+	b2Body* bodies[2] = {c->GetFixtureA()->GetBody(), c->GetFixtureB()->GetBody()};
+	for (int32 i = 0; i < 2; ++i)
+	{
+		b2Body* body = bodies[i];
+		if (body->GetType() != b2_staticBody)
+		{
+			f(body);
+		}
+
+		if (body->GetType() == b2_dynamicBody)
+		{
+			for (b2ContactEdge* ce = body->GetContactList(); ce; ce = ce->next)
+			{
+				if (ce->other->GetType() != b2_staticBody)
+				{
+					f(ce->other);
+				}
+			}
+		}
+	}
+}
+
+uint32 b2World::SelectToiBatch(b2Contact** batch)
+{
+	// Take each event that doesn't share a body with an earlier event. The bodies of skipped
+	// events are marked too, so an event is never solved before an earlier event it depends on.
+	uint32 batchCount = 0;
+	for (uint32 i = 0; i < m_toiEvents.size(); ++i)
+	{
+		b2Contact* c = m_toiEvents[i];
+
+		bool isIndependent = true;
+		b2ForEachToiEventBody(c, [&isIndependent](b2Body* b)
+		{
+			if (b->m_flags & b2Body::e_islandFlag)
+			{
+				isIndependent = false;
+			}
+		});
+
+		if (isIndependent)
+		{
+			batch[batchCount++] = c;
+		}
+
+		b2ForEachToiEventBody(c, [](b2Body* b) { b->m_flags |= b2Body::e_islandFlag; });
+	}
+
+	for (uint32 i = 0; i < m_toiEvents.size(); ++i)
+	{
+		b2ForEachToiEventBody(m_toiEvents[i], [](b2Body* b) { b->m_flags &= ~b2Body::e_islandFlag; });
+	}
+
+	return batchCount;
+}
+
+bool b2World::FindToiEvents(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
+{
+	m_toiEvents.clear();
+
+	if (m_contactManager.m_toiCount == 0)
+	{
+		return false;
+	}
+
+	b2PartitionedRange ranges;
+	executor.PartitionRange(b2Task::e_findToiEvents, 0, m_contactManager.m_toiCount, ranges);
+	b2StackArray<b2FindToiEventsTask> tasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		tasks[i] = b2FindToiEventsTask(ranges[i], m_contactManager.GetToiBegin(), &m_contactManager.m_contactStates, this);
+	}
+	b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+
+	bool computedToi = false;
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		computedToi = computedToi || tasks[i].ComputedToi();
+	}
+
+	// Contacts between bodies with out of sync sweeps need to be processed on a single thread.
+	auto outOfSyncSweeps = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
+		&PerThreadData::m_outOfSyncSweeps, b2ContactSortKey, m_stackAllocator);
+
+	b2Sort(outOfSyncSweeps, executor, taskGroup, m_stackAllocator);
+
+	for (auto it = outOfSyncSweeps.begin(); it != outOfSyncSweeps.end(); ++it)
+	{
+		b2Contact* c = *it;
+
+		computedToi = true;
+
+		float32 alpha = ComputeToi(c);
+
+		if (alpha < 1.0f - 10.0f * b2_epsilon)
+		{
+			m_toiEvents.push_back(c);
+		}
+	}
+
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		b2GrowableArray<b2Contact*>& events = m_perThreadData[i].m_toiEvents;
+		for (uint32 j = 0; j < events.size(); ++j)
+		{
+			m_toiEvents.push_back(events[j]);
+		}
+		events.clear();
+	}
+
+	std::sort(m_toiEvents.begin(), m_toiEvents.end(), b2ToiContactPointerLessThan);
+
+	return computedToi;
+}
+
+bool b2World::UpdateToiEvents()
+{
+	uint32* flags = m_contactManager.m_contactStates.m_flags.data();
+
+	// Drop the events of the dirty contacts. The others keep their cached TOIs and their order.
+	uint32 eventCount = 0;
+	for (uint32 i = 0; i < m_toiEvents.size(); ++i)
+	{
+		b2Contact* c = m_toiEvents[i];
+		if ((flags[c->m_managerIndex] & b2Contact::e_islandFlag) == 0)
+		{
+			m_toiEvents[eventCount++] = c;
+		}
+	}
+	while (m_toiEvents.size() > eventCount)
+	{
+		m_toiEvents.pop_back();
+	}
+
+	// Like a full search, the TOIs of contacts with synchronized sweeps are computed first. The
+	// others can advance a sweep, so they are computed afterwards in sort key order.
+	bool computedToi = false;
+	uint32 outOfSyncCount = 0;
+	for (uint32 i = 0; i < m_toiDirtyContacts.size(); ++i)
+	{
+		b2Contact* c = m_toiDirtyContacts[i];
+		uint32& contactFlags = flags[c->m_managerIndex];
+		contactFlags &= ~b2Contact::e_islandFlag;
+
+		if (contactFlags & b2Contact::e_inactiveFlag)
+		{
+			continue;
+		}
+
+		if (c->IsMinToiCandidate() == false)
+		{
+			continue;
+		}
+
+		if ((contactFlags & b2Contact::e_toiFlag) == 0)
+		{
+			if (c->GetFixtureA()->GetBody()->m_sweep.alpha0 != c->GetFixtureB()->GetBody()->m_sweep.alpha0)
+			{
+				m_toiDirtyContacts[outOfSyncCount++] = c;
+				continue;
+			}
+
+			computedToi = true;
+		}
+
+		float32 alpha = ComputeToi(c);
+
+		if (alpha < 1.0f - 10.0f * b2_epsilon)
+		{
+			m_toiEvents.push_back(c);
+		}
+	}
+
+	std::sort(m_toiDirtyContacts.begin(), m_toiDirtyContacts.begin() + outOfSyncCount,
+		[](const b2Contact* a, const b2Contact* b) { return b2ContactSortKey(a) < b2ContactSortKey(b); });
+
+	for (uint32 i = 0; i < outOfSyncCount; ++i)
+	{
+		b2Contact* c = m_toiDirtyContacts[i];
+
+		computedToi = true;
+
+		float32 alpha = ComputeToi(c);
+
+		if (alpha < 1.0f - 10.0f * b2_epsilon)
+		{
+			m_toiEvents.push_back(c);
+		}
+	}
+
+	m_toiDirtyContacts.clear();
+
+	// Merge the new events into the kept ones from the back.
+	uint32 newCount = m_toiEvents.size() - eventCount;
+	if (newCount > 0)
+	{
+		b2StackArray<b2Contact*> newEvents(m_stackAllocator, newCount);
+		memcpy(newEvents.data(), m_toiEvents.data() + eventCount, newCount * sizeof(b2Contact*));
+		std::sort(newEvents.data(), newEvents.data() + newCount, b2ToiContactPointerLessThan);
+
+		int32 i = (int32)eventCount - 1;
+		int32 j = (int32)newCount - 1;
+		for (int32 k = (int32)m_toiEvents.size() - 1; j >= 0; --k)
+		{
+			if (i >= 0 && b2ToiContactPointerLessThan(newEvents[j], m_toiEvents[i]))
+			{
+				m_toiEvents[k] = m_toiEvents[i--];
+			}
+			else
+			{
+				m_toiEvents[k] = newEvents[j--];
+			}
+		}
+	}
+
+	return computedToi;
+}
+
+void b2World::SolveToiEvents(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step)
+{
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(b2_toiContactCapacity * sizeof(b2Contact*));
+
+	b2Velocity* velocities = (b2Velocity*)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Velocity));
+	b2Position* positions = (b2Position*)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Position));
+
+	b2Island island(bodies, contacts, velocities, positions);
+
+	// Only clear flags if any were modified.
+	// If the step is not complete then they were modified during a previous sub step.
+	bool clearPostSolveTOI = m_stepComplete == false;
+
+	// The first search scans all contacts. After that only the contacts affected by the previous
+	// batch are recomputed.
+	bool useFullSearch = true;
+
+	// Find TOI events and solve the independent ones together.
+	for (;;)
+	{
+		b2Timer timer;
+		bool computedToi = useFullSearch ? FindToiEvents(executor, taskGroup) : UpdateToiEvents();
+		if (computedToi)
+		{
+			clearPostSolveTOI = true;
+		}
+		useFullSearch = false;
+		m_profile.solveTOIFindMinContact += timer.GetMilliseconds();
+
+		if (m_toiEvents.size() == 0)
+		{
+			// No more TOI events. Done!
+			m_stepComplete = true;
+			if (clearPostSolveTOI)
+			{
+				ClearPostSolveTOI(executor, taskGroup);
+			}
+			break;
+		}
+
+		b2StackArray<b2Contact*> batch(m_stackAllocator, m_toiEvents.size());
+		uint32 batchCount = SelectToiBatch(batch.data());
+		b2Assert(batchCount > 0);
+
+		uint32 toiCount = m_contactManager.m_toiCount;
+		m_toiDirtyContacts.clear();
+
+		m_flags |= e_trackToiWakes;
+		if (batchCount == 1)
+		{
+			StepSolveTOI(step, island, batch[0], batch[0]->m_states->m_tois[batch[0]->m_managerIndex].toi);
+
+			for (int32 i = 0; i < island.m_bodyCount; ++i)
+			{
+				if (island.m_bodies[i]->GetType() == b2_dynamicBody)
+				{
+					AddToiDirtyContacts(island.m_bodies[i]);
+				}
+			}
+		}
+		else
+		{
+			SolveToiBatch(executor, taskGroup, step, batch.data(), batchCount);
+		}
+		m_flags &= ~e_trackToiWakes;
+
+		// An event's contact changes even if it wasn't solid, and then it has no bodies.
+		for (uint32 i = 0; i < batchCount; ++i)
+		{
+			AddToiDirtyContact(batch[i]);
+		}
+
+		AddWokenAndNewToiDirtyContacts(toiCount);
+	}
+
+	m_stackAllocator.Free(positions);
+	m_stackAllocator.Free(velocities);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(bodies);
+}
+
+void b2World::SolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step)
+{
+	if (m_parallelToiSolving && m_subStepping == false)
+	{
+		SolveToiEvents(executor, taskGroup, step);
+		return;
+	}
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(b2_toiContactCapacity * sizeof(b2Contact*));
+
+	b2Velocity* velocities = (b2Velocity*)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Velocity));
+	b2Position* positions = (b2Position*)m_stackAllocator.Allocate(b2_toiBodyCapacity * sizeof(b2Position));
+
+	b2Island island(bodies, contacts, velocities, positions);
+
+	b2Contact* minContact = nullptr;
+	float32 minAlpha = 1.0f;
+
+
+	// Do the initial TOI computation on multiple threads.
+	bool useMultithreadedFind = m_stepComplete;
+
+	// Only clear flags if any were modified.
+	// If the step is not complete then they were modified during a previous sub step.
+	bool clearPostSolveTOI = m_stepComplete == false;
+
+	// The first search scans all contacts. After that the cached TOIs are kept in a queue,
+	// and only the contacts that were affected by the previous event are recomputed.
+	bool useToiQueue = false;
+
+	// Find TOI events and solve them.
+	for (;;)
+	{
+		if (useMultithreadedFind)
+		{
+			b2Timer timer;
+			FindMinToiContact(executor, taskGroup, &minContact, &minAlpha);
+			m_profile.solveTOIFindMinContact += timer.GetMilliseconds();
+
+			useMultithreadedFind = false;
+			if (minContact != nullptr)
+			{
+				clearPostSolveTOI = true;
+			}
+		}
+		else if (useToiQueue)
+		{
+			b2Timer timer;
+			PopMinToiContact(&minContact, &minAlpha);
+			m_profile.solveTOIFindMinContact += timer.GetMilliseconds();
+		}
+		else
+		{
+			b2Timer timer;
+			FindMinToiContact(&minContact, &minAlpha);
+			m_profile.solveTOIFindMinContact += timer.GetMilliseconds();
+		}
+
+		if (minContact == nullptr || 1.0f - 10.0f * b2_epsilon < minAlpha)
+		{
+			// No more TOI events. Done!
+			m_stepComplete = true;
+			if (clearPostSolveTOI)
+			{
+				ClearPostSolveTOI(executor, taskGroup);
+			}
+			break;
+		}
 
 		if (m_subStepping)
 		{
+			StepSolveTOI(step, island, minContact, minAlpha);
 			m_stepComplete = false;
 			break;
 		}
+
+		if (useToiQueue == false)
+		{
+			BuildToiQueue();
+			useToiQueue = true;
+		}
+
+		uint32 toiCount = m_contactManager.m_toiCount;
+
+		m_flags |= e_trackToiWakes;
+		StepSolveTOI(step, island, minContact, minAlpha);
+		m_flags &= ~e_trackToiWakes;
+
+		UpdateToiQueue(island, toiCount);
 	}
 
+	m_toiQueue.clear();
+
 	m_stackAllocator.Free(positions);
 	m_stackAllocator.Free(velocities);
 	m_stackAllocator.Free(contacts);
@@ -1101,15 +2055,15 @@ void b2World::FindNewContacts(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 
 	SetMtLock(e_mtLocked | e_mtCollisionLocked);
 
-	b2BroadphaseFindNewContactsTask tasks[b2_maxRangeSubTasks];
 	b2PartitionedRange ranges;
 	executor.PartitionRange(b2Task::e_broadPhaseFindContacts, 0, m_contactManager.m_broadPhase.GetMoveCount(), ranges);
-	for (uint32 i = 0; i < ranges.count; ++i)
+	b2StackArray<b2BroadphaseFindNewContactsTask> tasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
 	{
 		tasks[i] = b2BroadphaseFindNewContactsTask(ranges[i], &m_contactManager);
 	}
 	m_contactManager.m_deferCreates = true;
-	b2SubmitTasks(executor, taskGroup, tasks, ranges.count);
+	b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
 	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
 	m_contactManager.m_deferCreates = false;
 
@@ -1119,215 +2073,488 @@ void b2World::FindNewContacts(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 
 void b2World::Collide(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 {
-	if (m_contactManager.m_contacts.size() == 0)
+	// Only the active contacts are collided.
+	m_contactManager.ApplyActivityChanges();
+	uint32 activeBegin = m_contactManager.GetActiveBegin();
+	uint32 activeEnd = m_contactManager.GetActiveEnd();
+	if (activeBegin == activeEnd)
+	{
+		return;
+	}
+
+	SetMtLock(e_mtLocked | e_mtCollisionLocked);
+
+	b2PartitionedRange ranges;
+	executor.PartitionRange(b2Task::e_collide, activeBegin, activeEnd, ranges);
+	b2StackArray<b2CollideTask> tasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		tasks[i] = b2CollideTask(ranges[i], &m_contactManager);
+	}
+	b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+
+	SetMtLock(0);
+	m_contactManager.FinishCollide(executor, taskGroup, m_stackAllocator);
+}
+
+void b2World::SynchronizeFixtures(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
+{
+	if (m_nonStaticBodies.size() == 0)
+	{
+		return;
+	}
+
+	SetMtLock(e_mtLocked | e_mtCollisionLocked);
+
+	b2PartitionedRange ranges;
+	executor.PartitionRange(b2Task::e_broadPhaseSyncFixtures, 0, m_nonStaticBodies.size(), ranges);
+	b2StackArray<b2BroadphaseSyncFixturesTask> moveTasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		moveTasks[i] = b2BroadphaseSyncFixturesTask(ranges[i], &m_contactManager, m_nonStaticBodies.data());
+	}
+	b2SubmitTasks(executor, taskGroup, moveTasks.data(), ranges.GetCount());
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+
+	SetMtLock(0);
+	m_contactManager.FinishSynchronizeFixtures(executor, taskGroup, m_stackAllocator);
+}
+
+void b2World::FindIslands(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
+{
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		PerThreadData& td = m_perThreadData[i];
+		td.m_islands.clear();
+		td.m_islandBodies.clear();
+		td.m_islandContacts.clear();
+		td.m_islandJoints.clear();
+
+		td.ReserveStaticBodyCounters(m_staticBodies.size());
+	}
+
+	if (m_nonStaticBodies.size() == 0)
+	{
+		return;
+	}
+
+	b2StackArray<std::atomic<int32>> islandSets(m_stackAllocator, m_nonStaticBodies.size());
+	b2StackArray<std::atomic<int32>> islandSeeds(m_stackAllocator, m_nonStaticBodies.size());
+	m_islandSets = islandSets.data();
+	m_islandSeeds = islandSeeds.data();
+
+	uint32 bodyCount = m_nonStaticBodies.size();
+	uint32 contactCount = m_contactManager.m_contacts.size();
+
+	ExecuteFindIslandsTasks(executor, taskGroup, b2Task::e_resetIslandSets, bodyCount);
+
+	// Joints are much less common than contacts, so they are united here.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		b2Body* bA = j->m_bodyA;
+		b2Body* bB = j->m_bodyB;
+		if (bA->GetType() == b2_staticBody || bB->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		// Joints connected to inactive bodies are not simulated.
+		if (bA->IsActive() == false || bB->IsActive() == false)
+		{
+			continue;
+		}
+
+		b2UniteIslandSets(m_islandSets, bA->m_worldIndex, bB->m_worldIndex);
+	}
+
+	ExecuteFindIslandsTasks(executor, taskGroup, b2Task::e_uniteIslandSets, contactCount);
+	ExecuteFindIslandsTasks(executor, taskGroup, b2Task::e_findIslandSeeds, bodyCount);
+	ExecuteFindIslandsTasks(executor, taskGroup, b2Task::e_activateIslandContacts, contactCount);
+	ExecuteFindIslandsTasks(executor, taskGroup, b2Task::e_buildIslands, bodyCount);
+
+	m_islandSets = nullptr;
+	m_islandSeeds = nullptr;
+}
+
+void b2World::ExecuteFindIslandsTasks(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2Task::Type type, uint32 count)
+{
+	if (count == 0)
 	{
 		return;
 	}
 
-	SetMtLock(e_mtLocked | e_mtCollisionLocked);
+	b2PartitionedRange ranges;
+	executor.PartitionRange(type, 0, count, ranges);
+	b2StackArray<b2FindIslandsTask> tasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		tasks[i] = b2FindIslandsTask(ranges[i], this, type);
+	}
+	b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+}
+
+void b2World::ResetIslandSets(uint32 bodiesBegin, uint32 bodiesEnd)
+{
+	for (uint32 i = bodiesBegin; i < bodiesEnd; ++i)
+	{
+		m_islandSets[i].store(i, std::memory_order_relaxed);
+		m_islandSeeds[i].store(b2_noIslandSeed, std::memory_order_relaxed);
+	}
+}
+
+void b2World::UniteIslandSets(uint32 contactsBegin, uint32 contactsEnd)
+{
+	for (uint32 i = contactsBegin; i < contactsEnd; ++i)
+	{
+		b2Contact* contact = m_contactManager.m_contacts[i];
+
+		// Only solid touching contacts connect islands.
+		if (contact->IsEnabled() == false ||
+			contact->IsTouching() == false)
+		{
+			continue;
+		}
+
+		if (contact->m_fixtureA->m_isSensor || contact->m_fixtureB->m_isSensor)
+		{
+			continue;
+		}
+
+		// Islands don't propagate across static bodies.
+		b2Body* bA = contact->m_fixtureA->m_body;
+		b2Body* bB = contact->m_fixtureB->m_body;
+		if (bA->GetType() == b2_staticBody || bB->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		b2UniteIslandSets(m_islandSets, bA->m_worldIndex, bB->m_worldIndex);
+	}
+}
+
+void b2World::FindIslandSeeds(uint32 bodiesBegin, uint32 bodiesEnd)
+{
+	for (uint32 i = bodiesBegin; i < bodiesEnd; ++i)
+	{
+		int32 root = b2FindIslandSet(m_islandSets, i);
+		m_islandSets[i].store(root, std::memory_order_relaxed);
+
+		b2Body* b = m_nonStaticBodies[i];
+		if (b->IsAwake() == false || b->IsActive() == false)
+		{
+			continue;
+		}
+
+		// The seed is the first awake body of the island, which is the body the serial
+		// traversal would have started from.
+		int32 seed = m_islandSeeds[root].load(std::memory_order_relaxed);
+		while ((int32)i < seed &&
+			m_islandSeeds[root].compare_exchange_weak(seed, i, std::memory_order_relaxed) == false)
+		{
+		}
+	}
+}
 
-	b2CollideTask tasks[b2_maxRangeSubTasks];
-	b2PartitionedRange ranges;
-	executor.PartitionRange(b2Task::e_collide, 0, m_contactManager.m_contacts.size(), ranges);
-	for (uint32 i = 0; i < ranges.count; ++i)
+bool b2World::IsInAwakeIsland(const b2Body* b) const
+{
+	if (b->GetType() == b2_staticBody)
 	{
-		tasks[i] = b2CollideTask(ranges[i], &m_contactManager);
+		return false;
 	}
-	b2SubmitTasks(executor, taskGroup, tasks, ranges.count);
-	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
-
-	SetMtLock(0);
-	m_contactManager.FinishCollide(executor, taskGroup, m_stackAllocator);
+	int32 root = m_islandSets[b->m_worldIndex].load(std::memory_order_relaxed);
+	return m_islandSeeds[root].load(std::memory_order_relaxed) != b2_noIslandSeed;
 }
 
-void b2World::SynchronizeFixtures(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
+void b2World::ActivateIslandContacts(uint32 contactsBegin, uint32 contactsEnd)
 {
-	if (m_nonStaticBodies.size() == 0)
+	for (uint32 i = contactsBegin; i < contactsEnd; ++i)
 	{
-		return;
-	}
+		b2Contact* contact = m_contactManager.m_contacts[i];
 
-	SetMtLock(e_mtLocked | e_mtCollisionLocked);
+		// Make sure contacts touching an awake island are active.
+		if (IsInAwakeIsland(contact->m_fixtureA->m_body) ||
+			IsInAwakeIsland(contact->m_fixtureB->m_body))
+		{
+			contact->m_states->m_flags[contact->m_managerIndex] &= ~b2Contact::e_inactiveFlag;
+		}
+	}
+}
 
-	b2BroadphaseSyncFixturesTask moveTasks[b2_maxRangeSubTasks];
-	b2PartitionedRange ranges;
-	executor.PartitionRange(b2Task::e_broadPhaseSyncFixtures, 0, m_nonStaticBodies.size(), ranges);
-	for (uint32 i = 0; i < ranges.count; ++i)
+void b2World::BuildIslands(uint32 bodiesBegin, uint32 bodiesEnd, uint32 threadId)
+{
+	for (uint32 i = bodiesBegin; i < bodiesEnd; ++i)
 	{
-		moveTasks[i] = b2BroadphaseSyncFixturesTask(ranges[i], &m_contactManager, m_nonStaticBodies.data());
+		int32 root = m_islandSets[i].load(std::memory_order_relaxed);
+		if (m_islandSeeds[root].load(std::memory_order_relaxed) == (int32)i)
+		{
+			BuildIsland(m_nonStaticBodies[i], threadId);
+		}
 	}
-	b2SubmitTasks(executor, taskGroup, moveTasks, ranges.count);
-	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
-
-	SetMtLock(0);
-	m_contactManager.FinishSynchronizeFixtures(executor, taskGroup, m_stackAllocator);
 }
 
-void b2World::Solve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step)
+void b2World::BuildIsland(b2Body* seed, uint32 threadId)
 {
-	// A single static body can be included in multiple islands.
-	// In the worst case every non static body is in its own island with every static body.
-	uint32 maxStaticBodySolveCount = m_nonStaticBodies.size() * m_staticBodies.size();
-
-	// A static body can only be brought into an island by a contact or joint connecting
-	// it to a non-static body.
-	maxStaticBodySolveCount = b2Min(maxStaticBodySolveCount, m_contactManager.m_contacts.size() + m_jointCount);
-
-	int32 allBodiesCapacity = m_nonStaticBodies.size() + maxStaticBodySolveCount;
-	int32 allContactsCapacity = m_contactManager.m_contacts.size();
-	int32 allJointsCapacity = m_jointCount;
-
-	b2Body** allBodies = (b2Body**)m_stackAllocator.Allocate(allBodiesCapacity * sizeof(b2Body*));
-	b2Contact** allContacts = (b2Contact**)m_stackAllocator.Allocate(allContactsCapacity * sizeof(b2Contact*));
-	b2Joint** allJoints = (b2Joint**)m_stackAllocator.Allocate(allJointsCapacity * sizeof(b2Joint*));
-	b2Velocity* allVelocities = (b2Velocity*)m_stackAllocator.Allocate(allBodiesCapacity * sizeof(b2Velocity));
-	b2Position* allPositions = (b2Position*)m_stackAllocator.Allocate(allBodiesCapacity * sizeof(b2Position));
-	int32 allBodiesCount = 0;
-	int32 allContactsCount = 0;
-	int32 allJointsCount = 0;
-
-	b2Body** bodies = allBodies;
-	b2Contact** contacts = allContacts;
-	b2Joint** joints = allJoints;
-	b2Velocity* velocities = allVelocities;
-	b2Position* positions = allPositions;
-	int32 bodyCount = 0;
-	int32 contactCount = 0;
-	int32 jointCount = 0;
-
-	SetMtLock(e_mtLocked | e_mtSolveLocked);
+	b2Assert(seed->GetType() != b2_staticBody);
+	b2Assert(seed->IsAwake() && seed->IsActive());
 
-	b2Timer traversalTimer;
+	PerThreadData& td = m_perThreadData[threadId];
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	b2SolveTask* solveTaskList = nullptr;
-    b2SolveTask* currSolveTask = nullptr;
-	for (uint32 i = 0; i < m_nonStaticBodies.size(); ++i)
+	// Static bodies are marked with a per-island counter rather than a flag, because
+	// the same static body may be added to islands being built on other threads.
+	if (++td.m_islandCounter == 0)
 	{
-		b2Body* seed = m_nonStaticBodies[i];
-
-		b2Assert(seed->GetType() != b2_staticBody);
-
-		if (seed->m_flags & b2Body::e_islandFlag)
+		memset(td.m_staticBodyCounters, 0, td.m_staticBodyCounterCapacity * sizeof(uint32));
+		td.m_islandCounter = 1;
+	}
+	uint32 islandCounter = td.m_islandCounter;
+	uint32* staticBodyCounters = td.m_staticBodyCounters;
+
+	IslandRecord island;
+	island.seed = seed->m_worldIndex;
+	island.threadId = threadId;
+	island.bodyBegin = td.m_islandBodies.size();
+	island.contactBegin = td.m_islandContacts.size();
+	island.jointBegin = td.m_islandJoints.size();
+
+	b2GrowableArray<b2Body*>& stack = td.m_islandStack;
+	b2Assert(stack.size() == 0);
+	stack.push_back(seed);
+	seed->m_flags |= b2Body::e_islandFlag;
+
+	// Perform a depth first search (DFS) on the constraint graph.
+	while (stack.size() > 0)
+	{
+		// Grab the next body off the stack and add it to the island.
+		b2Body* b = stack.pop_back();
+		b2Assert(b->IsActive() == true);
+		td.m_islandBodies.push_back(b);
+
+		// To keep islands as small as possible, we don't
+		// propagate islands across static bodies.
+		if (b->GetType() == b2_staticBody)
 		{
 			continue;
 		}
 
-		if (seed->IsAwake() == false || seed->IsActive() == false)
+		// Make sure the body is awake (without resetting sleep timer). Its contacts were
+		// activated by ActivateIslandContacts.
+		if ((b->m_flags & b2Body::e_awakeFlag) == 0)
 		{
-			continue;
+			b->m_flags |= b2Body::e_awakeFlag;
+			m_contactManager.MarkActivityChanged(b);
 		}
 
-		// Reset stack.
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
-
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+		// Search all contacts connected to this body.
+		for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
 		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
-			b2Assert(b->IsActive() == true);
-			bodies[bodyCount++] = b;
+			b2Contact* contact = ce->contact;
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
+			// Has this contact already been added to an island?
+			if (contact->m_states->m_flags[contact->m_managerIndex] & b2Contact::e_islandFlag)
 			{
 				continue;
 			}
 
-			// Make sure the body is awake (without resetting sleep timer).
-			b->m_flags |= b2Body::e_awakeFlag;
+			// Is this contact solid and touching?
+			if (contact->IsEnabled() == false ||
+				contact->IsTouching() == false)
+			{
+				continue;
+			}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			// Skip sensors.
+			bool sensorA = contact->m_fixtureA->m_isSensor;
+			bool sensorB = contact->m_fixtureB->m_isSensor;
+			if (sensorA || sensorB)
 			{
-				b2Contact* contact = ce->contact;
+				continue;
+			}
 
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
-				{
-					continue;
-				}
+			td.m_islandContacts.push_back(contact);
+			contact->m_states->m_flags[contact->m_managerIndex] |= b2Contact::e_islandFlag;
 
-				// Make sure the contact is active.
-				contact->m_flags &= ~b2Contact::e_inactiveFlag;
+			b2Body* other = ce->other;
 
-				// Is this contact solid and touching?
-				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
+			// Was the other body already added to this island?
+			if (other->GetType() == b2_staticBody)
+			{
+				if (staticBodyCounters[other->m_worldIndex] == islandCounter)
 				{
 					continue;
 				}
-
-				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
-				if (sensorA || sensorB)
+				staticBodyCounters[other->m_worldIndex] = islandCounter;
+			}
+			else
+			{
+				if (other->m_flags & b2Body::e_islandFlag)
 				{
 					continue;
 				}
+				other->m_flags |= b2Body::e_islandFlag;
+			}
 
-				contacts[contactCount++] = contact;
-				contact->m_flags |= b2Contact::e_islandFlag;
+			stack.push_back(other);
+		}
 
-				b2Body* other = ce->other;
+		// Search all joints connected to this body.
+		for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+		{
+			if (je->joint->m_islandFlag == true)
+			{
+				continue;
+			}
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+			b2Body* other = je->other;
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+			// Don't simulate joints connected to inactive bodies.
+			if (other->IsActive() == false)
+			{
+				continue;
 			}
 
-			// Search all joints connected to this body.
-			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			td.m_islandJoints.push_back(je->joint);
+			je->joint->m_islandFlag = true;
+
+			if (other->GetType() == b2_staticBody)
 			{
-				if (je->joint->m_islandFlag == true)
+				if (staticBodyCounters[other->m_worldIndex] == islandCounter)
 				{
 					continue;
 				}
-
-				b2Body* other = je->other;
-
-				// Don't simulate joints connected to inactive bodies.
-				if (other->IsActive() == false)
+				staticBodyCounters[other->m_worldIndex] = islandCounter;
+			}
+			else
+			{
+				if (other->m_flags & b2Body::e_islandFlag)
 				{
 					continue;
 				}
+				other->m_flags |= b2Body::e_islandFlag;
+			}
 
-				joints[jointCount++] = je->joint;
-				je->joint->m_islandFlag = true;
+			stack.push_back(other);
+		}
+	}
 
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	island.bodyCount = td.m_islandBodies.size() - island.bodyBegin;
+	island.contactCount = td.m_islandContacts.size() - island.contactBegin;
+	island.jointCount = td.m_islandJoints.size() - island.jointBegin;
+	island.cost = m_bodyCost * island.bodyCount + m_contactCost * island.contactCount + m_jointCost * island.jointCount;
+	td.m_islands.push_back(island);
+}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+void b2World::Solve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step)
+{
+	SetMtLock(e_mtLocked | e_mtSolveLocked);
+
+	b2Timer traversalTimer;
+
+	// Find all awake islands. Islands are found in parallel, so they are sorted
+	// by seed to keep the solve order independent of the thread count.
+	{
+		b2TraceScope traceScope(m_tracer, "FindIslands");
+		FindIslands(executor, taskGroup);
+	}
+
+	uint32 islandCount = 0;
+	uint32 allBodiesCount = 0;
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		islandCount += m_perThreadData[i].m_islands.size();
+		allBodiesCount += m_perThreadData[i].m_islandBodies.size();
+	}
+
+	IslandRecord* islands = (IslandRecord*)m_stackAllocator.Allocate(islandCount * sizeof(IslandRecord));
+	b2Velocity* allVelocities = (b2Velocity*)m_stackAllocator.Allocate(allBodiesCount * sizeof(b2Velocity));
+	b2Position* allPositions = (b2Position*)m_stackAllocator.Allocate(allBodiesCount * sizeof(b2Position));
+
+	IslandRecord* islandsEnd = islands;
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		const b2GrowableArray<IslandRecord>& threadIslands = m_perThreadData[i].m_islands;
+		memcpy(islandsEnd, threadIslands.data(), threadIslands.size() * sizeof(IslandRecord));
+		islandsEnd += threadIslands.size();
+	}
+	std::sort(islands, islandsEnd, [](const IslandRecord& l, const IslandRecord& r)
+	{
+		return l.seed < r.seed;
+	});
+
+	// Large islands are solved on this thread, with each constraint color solved by range tasks.
+	// This is done before any solve tasks are submitted so that waiting on a color doesn't
+	// also wait on the solve tasks.
+	if (m_parallelIslandSolving)
+	{
+		b2TraceScope traceScope(m_tracer, "SolveLargeIslands");
+		b2Timer largeIslandTimer;
+
+		b2ContactManagerPerThreadData& cmtd = m_contactManager.m_perThreadData[0];
+		b2Velocity* velocities = allVelocities;
+		b2Position* positions = allPositions;
+		for (uint32 i = 0; i < islandCount; ++i)
+		{
+			const IslandRecord& island = islands[i];
+			PerThreadData& td = m_perThreadData[island.threadId];
+
+			if (IsLargeIsland(island))
+			{
+				b2Island largeIsland(island.bodyCount, island.contactCount, island.jointCount,
+					td.m_islandBodies.data() + island.bodyBegin,
+					td.m_islandContacts.data() + island.contactBegin,
+					td.m_islandJoints.data() + island.jointBegin,
+					velocities, positions);
+
+				largeIsland.Solve(&cmtd.m_profile, step, m_gravity, &m_stackAllocator,
+					m_contactManager.m_contactListener, 0, m_allowSleep, cmtd.m_postSolves,
+					&executor, taskGroup);
 			}
+
+			velocities += island.bodyCount;
+			positions += island.bodyCount;
 		}
 
-		// Post island traversal cleanup.
-		for (int32 j = 0; j < bodyCount; ++j)
+		// Solving isn't part of the traversal.
+		m_profile.solveTraversal -= largeIslandTimer.GetMilliseconds();
+	}
+
+	// Adaptive costs replace the cost scales and the cost threshold for packing islands into
+	// solve tasks. Each thread gets several tasks so that idle threads can take up the slack.
+	bool adaptiveCosts = m_adaptiveCosts && m_islandCostModel.IsTrained();
+	uint32 solveTaskCostThreshold = m_solveTaskCostThreshold;
+	if (adaptiveCosts)
+	{
+		uint64 totalCost = 0;
+		for (uint32 i = 0; i < islandCount; ++i)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = bodies[j];
-			if (b->GetType() == b2_staticBody)
+			const IslandRecord& island = islands[i];
+			if (IsLargeIsland(island) == false)
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
+				totalCost += m_islandCostModel.Estimate(island.bodyCount, island.contactCount, island.jointCount);
 			}
 		}
+		uint64 taskCount = b2_adaptiveSolveTasksPerThread * executor.GetThreadCount();
+		solveTaskCostThreshold = (uint32)b2Max(totalCost / taskCount, (uint64)b2_adaptiveMinSolveTaskCost);
+	}
+
+	// Build and simulate all other awake islands.
+	b2Velocity* velocities = allVelocities;
+	b2Position* positions = allPositions;
+	b2SolveTask* solveTaskList = nullptr;
+	b2SolveTask* currSolveTask = nullptr;
+	for (uint32 i = 0; i < islandCount; ++i)
+	{
+		const IslandRecord& island = islands[i];
+		PerThreadData& td = m_perThreadData[island.threadId];
+
+		if (IsLargeIsland(island))
+		{
+			velocities += island.bodyCount;
+			positions += island.bodyCount;
+			continue;
+		}
 
 		if (currSolveTask == nullptr)
 		{
@@ -1339,30 +2566,22 @@ void b2World::Solve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2Ti
 			solveTaskList = currSolveTask;
 		}
 
-		uint32 cost = m_bodyCost * bodyCount + m_contactCost * contactCount + m_jointCost * jointCount;
-
-		currSolveTask->AddIsland(bodyCount, contactCount, jointCount,
-			bodies, contacts, joints, velocities, positions, cost);
-
-		bodies += bodyCount;
-		contacts += contactCount;
-		joints += jointCount;
-		velocities += bodyCount;
-		positions += bodyCount;
-
-		allBodiesCount += bodyCount;
-		allContactsCount += contactCount;
-		allJointsCount += jointCount;
+		uint32 cost = island.cost;
+		if (adaptiveCosts)
+		{
+			cost = m_islandCostModel.Estimate(island.bodyCount, island.contactCount, island.jointCount);
+		}
 
-		bodyCount = 0;
-		contactCount = 0;
-		jointCount = 0;
+		currSolveTask->AddIsland(island.bodyCount, island.contactCount, island.jointCount,
+			td.m_islandBodies.data() + island.bodyBegin,
+			td.m_islandContacts.data() + island.contactBegin,
+			td.m_islandJoints.data() + island.jointBegin,
+			velocities, positions, cost);
 
-		b2Assert(allBodiesCount <= allBodiesCapacity);
-		b2Assert(allContactsCount <= allContactsCapacity);
-		b2Assert(allJointsCount <= allJointsCapacity);
+		velocities += island.bodyCount;
+		positions += island.bodyCount;
 
-		if (currSolveTask->GetCost() >= m_solveTaskCostThreshold ||
+		if (currSolveTask->GetCost() >= solveTaskCostThreshold ||
 			currSolveTask->GetIslandCount() >= b2_maxIslandsPerSolveTask)
 		{
 			b2SubmitTask(executor, taskGroup, currSolveTask);
@@ -1380,7 +2599,24 @@ void b2World::Solve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2Ti
 	m_profile.solveTraversal += traversalTimer.GetMilliseconds();
 
 	// Wait for solve tasks to finish.
-	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+	{
+		b2TraceScope traceScope(m_tracer, "SolveIslands");
+		executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+	}
+
+	if (m_adaptiveCosts)
+	{
+		for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+		{
+			b2GrowableArray<b2IslandCostSample>& samples = m_perThreadData[i].m_islandCostSamples;
+			for (uint32 j = 0; j < samples.size(); ++j)
+			{
+				m_islandCostModel.AddSample(samples[j]);
+			}
+			samples.clear();
+		}
+		m_islandCostModel.Update();
+	}
 
 	// Deallocate tasks.
 	while (solveTaskList)
@@ -1394,26 +2630,28 @@ void b2World::Solve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2Ti
 		m_blockAllocator.Free(task, sizeof(b2SolveTask));
 	}
 
-	// Free stack
-	m_stackAllocator.Free(stack);
-
 	// Free island memory.
 	m_stackAllocator.Free(allPositions);
 	m_stackAllocator.Free(allVelocities);
-	m_stackAllocator.Free(allJoints);
-	m_stackAllocator.Free(allContacts);
-	m_stackAllocator.Free(allBodies);
+	m_stackAllocator.Free(islands);
 
 	SetMtLock(0);
-	m_contactManager.FinishSolve(executor, taskGroup, m_stackAllocator);
+	{
+		b2TraceScope traceScope(m_tracer, "FinishSolve");
+		m_contactManager.FinishSolve(executor, taskGroup, m_stackAllocator);
+	}
 
 	{
 		b2Timer timer;
 
-		SynchronizeFixtures(executor, taskGroup);
+		{
+			b2TraceScope traceScope(m_tracer, "SynchronizeFixtures");
+			SynchronizeFixtures(executor, taskGroup);
+		}
 		m_profile.broadphaseSyncFixtures += timer.GetMilliseconds();
 
 		{
+			b2TraceScope traceScope(m_tracer, "FindNewContacts");
 			b2Timer timer2;
 
 			FindNewContacts(executor, taskGroup);
@@ -1427,33 +2665,40 @@ void b2World::Solve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2Ti
 	}
 
 	// Clear all the island flags.
+	b2TraceScope traceScope(m_tracer, "ClearPostSolve");
 	ClearPostSolve(executor, taskGroup);
 }
 
 void b2World::ClearPostSolve(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 {
-	b2ClearContactSolveFlags contactsTasks[b2_maxRangeSubTasks];
-	if (m_contactManager.m_contacts.size() > 0)
+	// Contacts in the inactive partitions have no solve flags.
+	m_contactManager.ApplyActivityChanges();
+	uint32 activeBegin = m_contactManager.GetActiveBegin();
+	uint32 activeEnd = m_contactManager.GetActiveEnd();
+
+	b2PartitionedRange contactRanges;
+	if (activeBegin < activeEnd)
 	{
-		b2PartitionedRange ranges;
-		executor.PartitionRange(b2Task::e_clearContactSolveFlags, 0, m_contactManager.m_contacts.size(), ranges);
-		for (uint32 i = 0; i < ranges.count; ++i)
-		{
-			contactsTasks[i] = b2ClearContactSolveFlags(ranges[i], m_contactManager.m_contacts.data());
-		}
-		b2SubmitTasks(executor, taskGroup, contactsTasks, ranges.count);
+		executor.PartitionRange(b2Task::e_clearContactSolveFlags, activeBegin, activeEnd, contactRanges);
 	}
-	b2ClearBodySolveFlags bodyTasks[b2_maxRangeSubTasks];
+	b2StackArray<b2ClearContactSolveFlags> contactsTasks(m_stackAllocator, contactRanges.GetCount());
+	for (uint32 i = 0; i < contactRanges.GetCount(); ++i)
+	{
+		contactsTasks[i] = b2ClearContactSolveFlags(contactRanges[i], &m_contactManager.m_contactStates);
+	}
+	b2SubmitTasks(executor, taskGroup, contactsTasks.data(), contactRanges.GetCount());
+
+	b2PartitionedRange bodyRanges;
 	if (m_nonStaticBodies.size() > 0)
 	{
-		b2PartitionedRange ranges;
-		executor.PartitionRange(b2Task::e_clearBodySolveFlags, 0, m_nonStaticBodies.size(), ranges);
-		for (uint32 i = 0; i < ranges.count; ++i)
-		{
-			bodyTasks[i] = b2ClearBodySolveFlags(ranges[i], m_nonStaticBodies.data());
-		}
-		b2SubmitTasks(executor, taskGroup, bodyTasks, ranges.count);
+		executor.PartitionRange(b2Task::e_clearBodySolveFlags, 0, m_nonStaticBodies.size(), bodyRanges);
+	}
+	b2StackArray<b2ClearBodySolveFlags> bodyTasks(m_stackAllocator, bodyRanges.GetCount());
+	for (uint32 i = 0; i < bodyRanges.GetCount(); ++i)
+	{
+		bodyTasks[i] = b2ClearBodySolveFlags(bodyRanges[i], m_nonStaticBodies.data());
 	}
+	b2SubmitTasks(executor, taskGroup, bodyTasks.data(), bodyRanges.GetCount());
 
 	// TODO_MT
 	for (b2Joint* j = m_jointList; j; j = j->m_next)
@@ -1466,137 +2711,290 @@ void b2World::ClearPostSolve(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 
 void b2World::ClearPostSolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 {
-	b2ClearContactSolveTOIFlags contactsTasks[b2_maxRangeSubTasks];
+	b2PartitionedRange contactRanges;
 	if (m_contactManager.m_contacts.size() > 0)
 	{
-		b2PartitionedRange ranges;
-		executor.PartitionRange(b2Task::e_clearContactSolveToiFlags, 0, m_contactManager.m_contacts.size(), ranges);
-		for (uint32 i = 0; i < ranges.count; ++i)
+		executor.PartitionRange(b2Task::e_clearContactSolveToiFlags, 0, m_contactManager.m_contacts.size(), contactRanges);
+	}
+	b2StackArray<b2ClearContactSolveTOIFlags> contactsTasks(m_stackAllocator, contactRanges.GetCount());
+	for (uint32 i = 0; i < contactRanges.GetCount(); ++i)
+	{
+		contactsTasks[i] = b2ClearContactSolveTOIFlags(contactRanges[i], &m_contactManager.m_contactStates);
+	}
+	b2SubmitTasks(executor, taskGroup, contactsTasks.data(), contactRanges.GetCount());
+
+	b2PartitionedRange bodyRanges;
+	if (m_nonStaticBodies.size() > 0)
+	{
+		executor.PartitionRange(b2Task::e_clearBodySolveToiFlags, 0, m_nonStaticBodies.size(), bodyRanges);
+	}
+	b2StackArray<b2ClearBodySolveTOIFlags> bodyTasks(m_stackAllocator, bodyRanges.GetCount());
+	for (uint32 i = 0; i < bodyRanges.GetCount(); ++i)
+	{
+		bodyTasks[i] = b2ClearBodySolveTOIFlags(bodyRanges[i], m_nonStaticBodies.data());
+	}
+	b2SubmitTasks(executor, taskGroup, bodyTasks.data(), bodyRanges.GetCount());
+
+	b2PartitionedRange staticBodyRanges;
+	if (m_staticBodies.size() > 0)
+	{
+		executor.PartitionRange(b2Task::e_clearBodySolveToiFlags, 0, m_staticBodies.size(), staticBodyRanges);
+	}
+	b2StackArray<b2ClearBodySolveTOIFlags> staticBodyTasks(m_stackAllocator, staticBodyRanges.GetCount());
+	for (uint32 i = 0; i < staticBodyRanges.GetCount(); ++i)
+	{
+		staticBodyTasks[i] = b2ClearBodySolveTOIFlags(staticBodyRanges[i], m_staticBodies.data());
+	}
+	b2SubmitTasks(executor, taskGroup, staticBodyTasks.data(), staticBodyRanges.GetCount());
+
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+}
+
+void b2World::ClearForces(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
+{
+	if (m_nonStaticBodies.size() == 0)
+	{
+		return;
+	}
+
+	b2PartitionedRange ranges;
+	executor.PartitionRange(b2Task::e_clearForces, 0, m_nonStaticBodies.size(), ranges);
+	b2StackArray<b2ClearForcesTask> forcesTasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		forcesTasks[i] = b2ClearForcesTask(ranges[i], m_nonStaticBodies.data());
+	}
+	b2SubmitTasks(executor, taskGroup, forcesTasks.data(), ranges.GetCount());
+
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+}
+
+void b2World::FindMinToiContact(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2Contact** contactOut, float* alphaOut)
+{
+	if (m_contactManager.m_toiCount == 0)
+	{
+		return;
+	}
+
+	b2PartitionedRange ranges;
+	executor.PartitionRange(b2Task::e_findMinToiContact, 0, m_contactManager.m_toiCount, ranges);
+	b2StackArray<b2FindMinToiContactTask> tasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		tasks[i] = b2FindMinToiContactTask(ranges[i], m_contactManager.GetToiBegin(), &m_contactManager.m_contactStates, this);
+	}
+	b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+
+	b2Contact* minContact = tasks[0].GetMinContact();
+	float32 minAlpha = tasks[0].GetMinAlpha();
+
+	// Contacts between bodies with out of sync sweeps need to be processed on a single thread.
+	auto outOfSyncSweeps = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
+		&PerThreadData::m_outOfSyncSweeps, b2ContactSortKey, m_stackAllocator);
+
+	b2Sort(outOfSyncSweeps, executor, taskGroup, m_stackAllocator);
+
+	for (auto it = outOfSyncSweeps.begin(); it != outOfSyncSweeps.end(); ++it)
+	{
+		b2Contact* c = *it;
+
+		float32 alpha = ComputeToi(c);
+
+		if (minContact == nullptr || b2Contact::ToiLessThan(alpha, c, minAlpha, minContact))
 		{
-			contactsTasks[i] = b2ClearContactSolveTOIFlags(ranges[i], m_contactManager.m_contacts.data());
+			minContact = c;
+			minAlpha = alpha;
 		}
-		b2SubmitTasks(executor, taskGroup, contactsTasks, ranges.count);
 	}
-	b2ClearBodySolveTOIFlags bodyTasks[b2_maxRangeSubTasks];
-	if (m_nonStaticBodies.size() > 0)
+
+	// Find minimum of all tasks.
+	for (uint32 i = 1; i < ranges.GetCount(); ++i)
 	{
-		b2PartitionedRange ranges;
-		executor.PartitionRange(b2Task::e_clearBodySolveToiFlags, 0, m_nonStaticBodies.size(), ranges);
-		for (uint32 i = 0; i < ranges.count; ++i)
+		float32 alpha = tasks[i].GetMinAlpha();
+		b2Contact* contact = tasks[i].GetMinContact();
+
+		if (contact && (minContact == nullptr || b2Contact::ToiLessThan(alpha, contact, minAlpha, minContact)))
+		{
+			minContact = contact;
+			minAlpha = alpha;
+		}
+	}
+
+	*contactOut = minContact;
+	*alphaOut = minAlpha;
+}
+
+// Orders the TOI queue so that the minimum TOI is at the front of the heap.
+inline bool b2World::ToiQueueGreater(const ToiQueueEntry& a, const ToiQueueEntry& b)
+{
+	return b2Contact::ToiLessThan(b.alpha, b.contact, a.alpha, a.contact);
+}
+
+void b2World::BuildToiQueue()
+{
+	m_toiQueue.clear();
+
+	const uint32* flags = m_contactManager.m_contactStates.m_flags.data();
+	const b2ContactToi* tois = m_contactManager.m_contactStates.m_tois.data();
+
+	// Every candidate has a cached TOI after a full search.
+	for (uint32 i = 0; i < m_contactManager.m_toiCount; ++i)
+	{
+		if (flags[i] & b2Contact::e_inactiveFlag)
 		{
-			bodyTasks[i] = b2ClearBodySolveTOIFlags(ranges[i], m_nonStaticBodies.data());
+			continue;
 		}
-		b2SubmitTasks(executor, taskGroup, bodyTasks, ranges.count);
-	}
-	b2ClearBodySolveTOIFlags staticBodyTasks[b2_maxRangeSubTasks];
-	if (m_staticBodies.size() > 0)
-	{
-		b2PartitionedRange ranges;
-		executor.PartitionRange(b2Task::e_clearBodySolveToiFlags, 0, m_staticBodies.size(), ranges);
-		for (uint32 i = 0; i < ranges.count; ++i)
+
+		if (b2Contact::IsMinToiCandidate(flags[i], tois[i]) == false)
+		{
+			continue;
+		}
+
+		b2Assert(flags[i] & b2Contact::e_toiFlag);
+
+		if (tois[i].toi < 1.0f - 10.0f * b2_epsilon)
 		{
-			staticBodyTasks[i] = b2ClearBodySolveTOIFlags(ranges[i], m_staticBodies.data());
+			ToiQueueEntry entry = {tois[i].toi, m_contactManager.m_contacts[i]};
+			m_toiQueue.push_back(entry);
 		}
-		b2SubmitTasks(executor, taskGroup, staticBodyTasks, ranges.count);
 	}
 
-	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+	std::make_heap(m_toiQueue.begin(), m_toiQueue.end(), ToiQueueGreater);
 }
 
-void b2World::ClearForces(b2TaskExecutor& executor, b2TaskGroup* taskGroup)
+inline void b2World::AddToiDirtyContact(b2Contact* c)
 {
-	if (m_nonStaticBodies.size() == 0)
+	// The island flag is used to skip duplicates.
+	uint32& contactFlags = m_contactManager.m_contactStates.m_flags[c->m_managerIndex];
+	if ((contactFlags & (b2Contact::e_toiCandidateFlag | b2Contact::e_islandFlag)) == b2Contact::e_toiCandidateFlag)
 	{
-		return;
+		contactFlags |= b2Contact::e_islandFlag;
+		m_toiDirtyContacts.push_back(c);
 	}
+}
 
-	b2ClearForcesTask forcesTasks[b2_maxRangeSubTasks];
-	b2PartitionedRange ranges;
-	executor.PartitionRange(b2Task::e_clearForces, 0, m_nonStaticBodies.size(), ranges);
-	for (uint32 i = 0; i < ranges.count; ++i)
+void b2World::AddToiDirtyContacts(b2Body* b)
+{
+	for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
 	{
-		forcesTasks[i] = b2ClearForcesTask(ranges[i], m_nonStaticBodies.data());
+		AddToiDirtyContact(ce->contact);
 	}
-	b2SubmitTasks(executor, taskGroup, forcesTasks, ranges.count);
-
-	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
 }
 
-void b2World::FindMinToiContact(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2Contact** contactOut, float* alphaOut)
+void b2World::AddWokenAndNewToiDirtyContacts(uint32 toiCountBefore)
 {
-	if (m_contactManager.m_toiCount == 0)
+	for (uint32 i = 0; i < m_toiWokenBodies.size(); ++i)
 	{
-		return;
+		AddToiDirtyContacts(m_toiWokenBodies[i]);
 	}
+	m_toiWokenBodies.clear();
 
-	b2FindMinToiContactTask tasks[b2_maxRangeSubTasks];
-	b2PartitionedRange ranges;
-	executor.PartitionRange(b2Task::e_findMinToiContact, 0, m_contactManager.m_toiCount, ranges);
-	for (uint32 i = 0; i < ranges.count; ++i)
+	uint32* flags = m_contactManager.m_contactStates.m_flags.data();
+	for (uint32 i = toiCountBefore; i < m_contactManager.m_toiCount; ++i)
 	{
-		tasks[i] = b2FindMinToiContactTask(ranges[i], m_contactManager.GetToiBegin(), this);
+		if ((flags[i] & b2Contact::e_islandFlag) == 0)
+		{
+			flags[i] |= b2Contact::e_islandFlag;
+			m_toiDirtyContacts.push_back(m_contactManager.m_contacts[i]);
+		}
 	}
-	b2SubmitTasks(executor, taskGroup, tasks, ranges.count);
+}
 
-	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+void b2World::UpdateToiQueue(const b2Island& island, uint32 toiCountBefore)
+{
+	// Find the contacts that a full search would compute: the contacts of displaced and
+	// woken bodies, and the new contacts.
+	m_toiDirtyContacts.clear();
 
-	b2Contact* minContact = tasks[0].GetMinContact();
-	float32 minAlpha = tasks[0].GetMinAlpha();
+	for (int32 i = 0; i < island.m_bodyCount; ++i)
+	{
+		if (island.m_bodies[i]->GetType() == b2_dynamicBody)
+		{
+			AddToiDirtyContacts(island.m_bodies[i]);
+		}
+	}
 
-	// Contacts between bodies with out of sync sweeps need to be processed on a single thread.
-	auto outOfSyncSweeps = b2MakeStackAllocThreadDataSorter<b2Contact*>(m_perThreadData,
-		&PerThreadData::m_outOfSyncSweeps, b2ContactPointerLessThan, m_stackAllocator);
+	AddWokenAndNewToiDirtyContacts(toiCountBefore);
 
-	b2Sort(outOfSyncSweeps, executor, taskGroup, m_stackAllocator);
+	uint32* flags = m_contactManager.m_contactStates.m_flags.data();
 
-	for (auto it = outOfSyncSweeps.begin(); it != outOfSyncSweeps.end(); ++it)
+	// Computing a TOI can advance a sweep, so this is done in the same order as a full search.
+	std::sort(m_toiDirtyContacts.begin(), m_toiDirtyContacts.end(),
+		[](const b2Contact* a, const b2Contact* b) { return a->m_managerIndex < b->m_managerIndex; });
+
+	for (uint32 i = 0; i < m_toiDirtyContacts.size(); ++i)
 	{
-		b2Contact* c = *it;
+		b2Contact* c = m_toiDirtyContacts[i];
+		uint32& contactFlags = flags[c->m_managerIndex];
+		contactFlags &= ~b2Contact::e_islandFlag;
+
+		if (contactFlags & b2Contact::e_inactiveFlag)
+		{
+			continue;
+		}
+
+		if (c->IsMinToiCandidate() == false)
+		{
+			continue;
+		}
 
 		float32 alpha = ComputeToi(c);
 
-		if (minContact == nullptr || b2Contact::ToiLessThan(alpha, c, minAlpha, minContact))
+		if (alpha < 1.0f - 10.0f * b2_epsilon)
 		{
-			minContact = c;
-			minAlpha = alpha;
+			ToiQueueEntry entry = {alpha, c};
+			m_toiQueue.push_back(entry);
+			std::push_heap(m_toiQueue.begin(), m_toiQueue.end(), ToiQueueGreater);
 		}
 	}
+}
 
-	// Find minimum of all tasks.
-	for (uint32 i = 1; i < ranges.count; ++i)
+void b2World::PopMinToiContact(b2Contact** contactOut, float* alphaOut)
+{
+	// Entries aren't removed when a contact changes, so skip the ones that no longer match.
+	while (m_toiQueue.size())
 	{
-		float32 alpha = tasks[i].GetMinAlpha();
-		b2Contact* contact = tasks[i].GetMinContact();
-
-		if (contact && (minContact == nullptr || b2Contact::ToiLessThan(alpha, contact, minAlpha, minContact)))
+		ToiQueueEntry entry = m_toiQueue[0];
+		std::pop_heap(m_toiQueue.begin(), m_toiQueue.end(), ToiQueueGreater);
+		m_toiQueue.pop_back();
+
+		b2Contact* c = entry.contact;
+		uint32 flags = c->m_states->m_flags[c->m_managerIndex];
+		if ((flags & (b2Contact::e_toiFlag | b2Contact::e_inactiveFlag)) == b2Contact::e_toiFlag &&
+			c->m_states->m_tois[c->m_managerIndex].toi == entry.alpha && c->IsMinToiCandidate())
 		{
-			minContact = contact;
-			minAlpha = alpha;
+			*contactOut = c;
+			*alphaOut = entry.alpha;
+			return;
 		}
 	}
 
-	*contactOut = minContact;
-	*alphaOut = minAlpha;
+	*contactOut = nullptr;
+	*alphaOut = 1.0f;
 }
 
 void b2World::FindMinToiContact(b2Contact** contactOut, float* alphaOut)
 {
+	const uint32* flags = m_contactManager.m_contactStates.m_flags.data();
+	const b2ContactToi* tois = m_contactManager.m_contactStates.m_tois.data();
+
 	b2Contact* minContact = nullptr;
 	float32 minAlpha = 1.0f;
 	for(uint32 i = 0; i < m_contactManager.m_toiCount; ++i)
 	{
-		b2Contact* c = m_contactManager.m_contacts[i];
-
-		if (c->m_flags & b2Contact::e_inactiveFlag)
+		if (flags[i] & b2Contact::e_inactiveFlag)
 		{
 			continue;
 		}
 
-		if (c->IsMinToiCandidate() == false)
+		if (b2Contact::IsMinToiCandidate(flags[i], tois[i]) == false)
 		{
 			continue;
 		}
 
+		b2Contact* c = m_contactManager.m_contacts[i];
 		float32 alpha = ComputeToi(c);
 
 		if (minContact == nullptr || b2Contact::ToiLessThan(alpha, c, minAlpha, minContact))
@@ -1613,7 +3011,13 @@ void b2World::FindMinToiContact(b2Contact** contactOut, float* alphaOut)
 void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations, b2TaskExecutor& executor)
 {
 	uint32 threadCount = executor.GetThreadCount();
+	bool threadCountChanged = threadCount != m_perThreadData.size();
+	SetThreadCount(threadCount);
+
+	int32 stackMallocCount = m_stackAllocator.GetMallocCount() + executor.GetStackMallocCount();
+	int32 chunkCount = GetChunkCount();
 
+	b2TraceScope stepTraceScope(m_tracer, "Step");
 	b2Timer stepTimer;
 
 	memset(&m_profile, 0, sizeof(m_profile));
@@ -1627,6 +3031,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	// If new fixtures were added, we need to find the new contacts.
 	if (m_flags & e_newFixture)
 	{
+		b2TraceScope traceScope(m_tracer, "FindNewContacts");
 		b2Timer timer;
 
 		FindNewContacts(executor, taskGroup);
@@ -1642,6 +3047,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 
 	// Update contacts. This is where some contacts are destroyed.
 	{
+		b2TraceScope traceScope(m_tracer, "Collide");
 		b2Timer timer;
 		Collide(executor, taskGroup);
 		m_profile.collide = timer.GetMilliseconds();
@@ -1663,10 +3069,12 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.wideContactSolver = m_wideContactSolving;
 
 	// Integrate velocities, solve velocity constraints, and integrate positions.
 	if (m_stepComplete && step.dt > 0.0f)
 	{
+		b2TraceScope traceScope(m_tracer, "Solve");
 		b2Timer timer;
 		Solve(executor, taskGroup, step);
 		m_profile.solve += timer.GetMilliseconds();
@@ -1675,6 +3083,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	// Handle TOI events.
 	if (m_continuousPhysics && step.dt > 0.0f)
 	{
+		b2TraceScope traceScope(m_tracer, "SolveTOI");
 		b2Timer timer;
 		SolveTOI(executor, taskGroup, step);
 		m_profile.solveTOI += timer.GetMilliseconds();
@@ -1687,6 +3096,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 
 	if (m_flags & e_clearForces)
 	{
+		b2TraceScope traceScope(m_tracer, "ClearForces");
 		ClearForces(executor, taskGroup);
 	}
 
@@ -1703,12 +3113,232 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 		m_profile.solvePosition += td.m_profile.solvePosition;
 	}
 
+	if (m_capacityReserved)
+	{
+		UpdateCapacityOverflowCount(executor, threadCountChanged, stackMallocCount, chunkCount);
+	}
+
 	m_profile.step = stepTimer.GetMilliseconds();
 	stepTimer.Reset();
 
 	m_profile.step += stepTimer.GetMilliseconds();
 }
 
+// Runs an asynchronous step on the world's step thread.
+class b2StepTask : public b2Task
+{
+public:
+	b2StepTask(b2World* world)
+		: m_world(world)
+	{ }
+
+	virtual void Execute(const b2ThreadContext& ctx) override
+	{
+		B2_NOT_USED(ctx);
+
+		m_world->Step(m_timeStep, m_velocityIterations, m_positionIterations, *m_executor);
+		m_world->m_finishedAsyncStepCount.fetch_add(1, std::memory_order_release);
+	}
+
+	b2World* m_world;
+	b2TaskExecutor* m_executor;
+	float32 m_timeStep;
+	int32 m_velocityIterations;
+	int32 m_positionIterations;
+};
+
+b2StepHandle b2World::StepAsync(float32 dt, int32 velocityIterations, int32 positionIterations, b2TaskExecutor& executor)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return b2StepHandle();
+	}
+
+	if (m_stepThread == nullptr)
+	{
+		void* mem = b2Alloc(sizeof(b2TaskThread));
+		m_stepThread = new (mem) b2TaskThread();
+		mem = b2Alloc(sizeof(b2StepTask));
+		m_stepTask = new (mem) b2StepTask(this);
+	}
+
+	// The previous step can be complete while its task is returning.
+	m_stepThread->Wait();
+
+	m_stepTask->m_executor = &executor;
+	m_stepTask->m_timeStep = dt;
+	m_stepTask->m_velocityIterations = velocityIterations;
+	m_stepTask->m_positionIterations = positionIterations;
+
+	++m_asyncStepCount;
+	m_stepThread->Submit(m_stepTask);
+
+	return b2StepHandle(this, m_asyncStepCount);
+}
+
+void b2StepHandle::Wait()
+{
+	if (IsComplete())
+	{
+		return;
+	}
+
+	// This is only reached before a later step starts, so the thread's task is this step.
+	m_world->m_stepThread->Wait();
+}
+
+void b2World::SetThreadCount(uint32 threadCount)
+{
+	b2Assert(threadCount > 0);
+	if (threadCount == m_perThreadData.size())
+	{
+		return;
+	}
+
+	// Static island indices are sized by the old thread count, so free them before resizing.
+	for (uint32 i = 0; i < m_staticBodies.size(); ++i)
+	{
+		FreeStaticIslandIndices(m_staticBodies[i]);
+	}
+
+	m_perThreadData.resize(threadCount);
+
+	for (uint32 i = 0; i < m_staticBodies.size(); ++i)
+	{
+		AllocateStaticIslandIndices(m_staticBodies[i]);
+	}
+
+	m_contactManager.SetThreadCount(threadCount);
+
+	// The new per-thread data doesn't have the reserved capacity.
+	if (m_capacityReserved)
+	{
+		ApplyCapacity();
+	}
+}
+
+void b2World::Reserve(const b2WorldCapacity& capacity)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_capacity.bodyCount = b2Max(m_capacity.bodyCount, capacity.bodyCount);
+	m_capacity.contactCount = b2Max(m_capacity.contactCount, capacity.contactCount);
+	m_capacity.proxyCount = b2Max(m_capacity.proxyCount, capacity.proxyCount);
+	m_capacity.jointCount = b2Max(m_capacity.jointCount, capacity.jointCount);
+	m_capacity.threadCount = capacity.threadCount;
+	m_capacity.stackSize = b2Max(m_capacity.stackSize, capacity.stackSize);
+	m_capacity.largePageStack = capacity.largePageStack;
+	m_capacityReserved = true;
+	m_capacityOverflowCount = 0;
+
+	// This applies the capacity if the thread count changed.
+	uint32 threadCount = m_perThreadData.size();
+	SetThreadCount(capacity.threadCount);
+	if (threadCount == m_perThreadData.size())
+	{
+		ApplyCapacity();
+	}
+}
+
+void b2World::ApplyCapacity()
+{
+	uint32 bodyCount = m_capacity.bodyCount;
+	uint32 contactCount = m_capacity.contactCount;
+	uint32 jointCount = m_capacity.jointCount;
+
+	m_nonStaticBodies.reserve(bodyCount);
+	m_staticBodies.reserve(bodyCount);
+
+	m_toiEvents.reserve(contactCount);
+	m_toiQueue.reserve(contactCount);
+	m_toiWokenBodies.reserve(bodyCount);
+	m_toiDirtyContacts.reserve(contactCount);
+
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		PerThreadData& td = m_perThreadData[i];
+		td.m_outOfSyncSweeps.reserve(contactCount);
+		td.m_toiEvents.reserve(contactCount);
+		td.m_toiBodies.reserve(bodyCount);
+		td.m_islands.reserve(bodyCount);
+
+		// Static bodies are added to every island they touch through a contact or joint.
+		td.m_islandBodies.reserve(bodyCount + contactCount + jointCount);
+		td.m_islandContacts.reserve(contactCount);
+		td.m_islandJoints.reserve(jointCount);
+		td.m_islandStack.reserve(bodyCount);
+		td.m_islandCostSamples.reserve(bodyCount);
+		td.ReserveStaticBodyCounters(bodyCount);
+	}
+
+	// There's at most one solve task per island.
+	m_blockAllocator.Reserve(sizeof(b2SolveTask), bodyCount);
+
+	m_contactManager.ReserveActivityChanges(bodyCount);
+	m_contactManager.Reserve(contactCount, m_capacity.proxyCount);
+
+	m_stackAllocator.SetLargePages(m_capacity.largePageStack);
+	m_stackAllocator.Reserve(m_capacity.stackSize);
+}
+
+int32 b2World::GetChunkCount() const
+{
+	return m_blockAllocator.GetChunkCount() + m_contactManager.GetContactChunkCount();
+}
+
+void b2World::UpdateCapacityOverflowCount(const b2TaskExecutor& executor, bool threadCountChanged,
+	int32 stackMallocCount, int32 chunkCount)
+{
+	// The worker stacks are owned by the executor, which counts their overflows.
+	uint32 count = m_stackAllocator.GetMallocCount() + executor.GetStackMallocCount() - stackMallocCount;
+	count += GetChunkCount() - chunkCount;
+
+	if (threadCountChanged)
+	{
+		++count;
+	}
+	if (m_bodyCount > m_capacity.bodyCount)
+	{
+		++count;
+	}
+	if (GetContactCount() > m_capacity.contactCount)
+	{
+		++count;
+	}
+	if (GetProxyCount() > m_capacity.proxyCount)
+	{
+		++count;
+	}
+	if (m_jointCount > m_capacity.jointCount)
+	{
+		++count;
+	}
+
+	m_capacityOverflowCount += count;
+}
+
+void b2World::AllocateStaticIslandIndices(b2Body* b)
+{
+	b2Assert(b->m_staticIslandIndices == nullptr);
+	int32 size = m_perThreadData.size() * sizeof(int32);
+	b->m_staticIslandIndices = (int32*)m_blockAllocator.Allocate(size);
+	memset(b->m_staticIslandIndices, 0, size);
+}
+
+void b2World::FreeStaticIslandIndices(b2Body* b)
+{
+	if (b->m_staticIslandIndices)
+	{
+		m_blockAllocator.Free(b->m_staticIslandIndices, m_perThreadData.size() * sizeof(int32));
+		b->m_staticIslandIndices = nullptr;
+	}
+}
+
 void b2World::RecalculateToiCandidacy(b2Body* b)
 {
 	b2Assert(IsMtLocked() == false);
@@ -1726,6 +3356,12 @@ void b2World::RecalculateToiCandidacy(b2Fixture* f)
 void b2World::RecalculateSleeping(b2Body* b)
 {
 	m_contactManager.RecalculateSleeping(b);
+
+	// The contacts of a static body don't depend on whether it's awake.
+	if ((m_flags & e_trackToiWakes) && b->GetType() != b2_staticBody)
+	{
+		m_toiWokenBodies.push_back(b);
+	}
 }
 
 void b2World::ClearForces()
@@ -1757,7 +3393,132 @@ void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb)
 	m_contactManager.m_broadPhase.Query(&wrapper, aabb, 0);
 }
 
-struct b2WorldRayCastWrapper
+struct b2WorldRayCastWrapper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		void* userData = broadPhase->GetUserData(proxyId);
+		b2FixtureProxy* proxy = (b2FixtureProxy*)userData;
+		b2Fixture* fixture = proxy->fixture;
+		int32 index = proxy->childIndex;
+		b2RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input, index);
+
+		if (hit)
+		{
+			float32 fraction = output.fraction;
+			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+			return callback->ReportFixture(fixture, point, output.normal, fraction);
+		}
+
+		return input.maxFraction;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2RayCastCallback* callback;
+};
+
+void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2)
+{
+	b2WorldRayCastWrapper wrapper;
+	wrapper.broadPhase = &m_contactManager.m_broadPhase;
+	wrapper.callback = callback;
+	b2RayCastInput input;
+	input.maxFraction = 1.0f;
+	input.p1 = point1;
+	input.p2 = point2;
+	m_contactManager.m_broadPhase.RayCast(&wrapper, input, 0);
+}
+
+// Collects the fixtures of one AABB query into a fixed size buffer.
+struct b2WorldQueryBufferWrapper
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		fixtures[count] = proxy->fixture;
+		++count;
+		return count < capacity;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2Fixture** fixtures;
+	int32 count;
+	int32 capacity;
+};
+
+class b2QueryAABBTask : public b2RangeTask
+{
+public:
+	b2QueryAABBTask() {}
+	b2QueryAABBTask(const b2RangeTaskRange& range, b2BroadPhase* broadPhase, const b2AABB* aabbs,
+		b2Fixture** fixtures, int32* fixtureCounts, int32 capacity)
+		: b2RangeTask(range)
+		, m_broadPhase(broadPhase)
+		, m_aabbs(aabbs)
+		, m_fixtures(fixtures)
+		, m_fixtureCounts(fixtureCounts)
+		, m_capacity(capacity)
+	{}
+
+	virtual b2Task::Type GetType() const override { return b2Task::e_queryAABB; }
+
+	virtual void Execute(const b2ThreadContext& threadCtx, const b2RangeTaskRange& range) override
+	{
+		b2WorldQueryBufferWrapper wrapper;
+		wrapper.broadPhase = m_broadPhase;
+		wrapper.capacity = m_capacity;
+		for (uint32 i = range.begin; i < range.end; ++i)
+		{
+			wrapper.fixtures = m_fixtures + i * m_capacity;
+			wrapper.count = 0;
+			if (m_capacity > 0)
+			{
+				m_broadPhase->Query(&wrapper, m_aabbs[i], threadCtx.threadId);
+			}
+			m_fixtureCounts[i] = wrapper.count;
+		}
+	}
+
+private:
+	b2BroadPhase* m_broadPhase;
+	const b2AABB* m_aabbs;
+	b2Fixture** m_fixtures;
+	int32* m_fixtureCounts;
+	int32 m_capacity;
+};
+
+void b2World::QueryAABB(const b2AABB* aabbs, int32 count, b2Fixture** fixtures, int32* fixtureCounts,
+	int32 capacity, b2TaskExecutor& executor)
+{
+	b2Assert(IsLocked() == false);
+	b2Assert(capacity >= 0);
+	if (IsLocked() || count <= 0)
+	{
+		return;
+	}
+
+	SetThreadCount(executor.GetThreadCount());
+
+	b2TaskGroup* taskGroup = executor.AcquireTaskGroup();
+
+	b2PartitionedRange ranges;
+	executor.PartitionRange(b2Task::e_queryAABB, 0, count, ranges);
+	b2StackArray<b2QueryAABBTask> tasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		tasks[i] = b2QueryAABBTask(ranges[i], &m_contactManager.m_broadPhase, aabbs,
+			fixtures, fixtureCounts, capacity);
+	}
+	b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+
+	executor.ReleaseTaskGroup(taskGroup);
+}
+
+// Keeps the closest hit of one ray.
+struct b2WorldRayCastClosestWrapper
 {
 	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
 	{
@@ -1771,27 +3532,83 @@ struct b2WorldRayCastWrapper
 		if (hit)
 		{
 			float32 fraction = output.fraction;
-			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
-			return callback->ReportFixture(fixture, point, output.normal, fraction);
+			result->fixture = fixture;
+			result->point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+			result->normal = output.normal;
+			result->fraction = fraction;
+			return fraction;
 		}
 
 		return input.maxFraction;
 	}
 
 	const b2BroadPhase* broadPhase;
-	b2RayCastCallback* callback;
+	b2RayCastResult* result;
 };
 
-void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2)
+class b2RayCastClosestTask : public b2RangeTask
 {
-	b2WorldRayCastWrapper wrapper;
-	wrapper.broadPhase = &m_contactManager.m_broadPhase;
-	wrapper.callback = callback;
-	b2RayCastInput input;
-	input.maxFraction = 1.0f;
-	input.p1 = point1;
-	input.p2 = point2;
-	m_contactManager.m_broadPhase.RayCast(&wrapper, input, 0);
+public:
+	b2RayCastClosestTask() {}
+	b2RayCastClosestTask(const b2RangeTaskRange& range, b2BroadPhase* broadPhase,
+		const b2RayCastInput* inputs, b2RayCastResult* results)
+		: b2RangeTask(range)
+		, m_broadPhase(broadPhase)
+		, m_inputs(inputs)
+		, m_results(results)
+	{}
+
+	virtual b2Task::Type GetType() const override { return b2Task::e_rayCast; }
+
+	virtual void Execute(const b2ThreadContext& threadCtx, const b2RangeTaskRange& range) override
+	{
+		b2WorldRayCastClosestWrapper wrapper;
+		wrapper.broadPhase = m_broadPhase;
+		for (uint32 i = range.begin; i < range.end; ++i)
+		{
+			b2RayCastResult* result = m_results + i;
+			result->fixture = nullptr;
+			result->point.SetZero();
+			result->normal.SetZero();
+			result->fraction = m_inputs[i].maxFraction;
+
+			wrapper.result = result;
+
+			m_broadPhase->RayCast(&wrapper, m_inputs[i], threadCtx.threadId);
+		}
+	}
+
+private:
+	b2BroadPhase* m_broadPhase;
+	const b2RayCastInput* m_inputs;
+	b2RayCastResult* m_results;
+};
+
+void b2World::RayCastClosest(const b2RayCastInput* inputs, int32 count, b2RayCastResult* results,
+	b2TaskExecutor& executor)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked() || count <= 0)
+	{
+		return;
+	}
+
+	SetThreadCount(executor.GetThreadCount());
+
+	b2TaskGroup* taskGroup = executor.AcquireTaskGroup();
+
+	b2PartitionedRange ranges;
+	executor.PartitionRange(b2Task::e_rayCast, 0, count, ranges);
+	b2StackArray<b2RayCastClosestTask> tasks(m_stackAllocator, ranges.GetCount());
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		tasks[i] = b2RayCastClosestTask(ranges[i], &m_contactManager.m_broadPhase, inputs, results);
+	}
+	b2SubmitTasks(executor, taskGroup, tasks.data(), ranges.GetCount());
+
+	executor.Wait(taskGroup, b2MainThreadCtx(&m_stackAllocator));
+
+	executor.ReleaseTaskGroup(taskGroup);
 }
 
 void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
@@ -2081,6 +3898,21 @@ float32 b2World::GetTreeQuality() const
 	return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+int32 b2World::GetStaticTreeHeight() const
+{
+	return m_contactManager.m_broadPhase.GetStaticTreeHeight();
+}
+
+int32 b2World::GetStaticTreeBalance() const
+{
+	return m_contactManager.m_broadPhase.GetStaticTreeBalance();
+}
+
+float32 b2World::GetStaticTreeQuality() const
+{
+	return m_contactManager.m_broadPhase.GetStaticTreeQuality();
+}
+
 void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	b2Assert((m_flags & e_locked) == 0);
@@ -2162,3 +3994,537 @@ void b2World::Dump()
 	b2Log("joints = nullptr;\n");
 	b2Log("bodies = nullptr;\n");
 }
+
+#ifndef b2_dynamicTreeOfTrees
+// "B2SN" in memory order. The version must change whenever the layout of a snapshot changes.
+static const uint32 b2_snapshotMagic = 0x4E533242;
+static const uint32 b2_snapshotVersion = 2;
+
+struct b2SnapshotHeader
+{
+	uint32 magic;
+	uint32 version;
+	int32 size;
+};
+
+void b2World::SaveSnapshot(b2Snapshot& snapshot)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	snapshot.Clear();
+	b2SnapshotStream stream(&snapshot);
+
+	b2SnapshotHeader header;
+	header.magic = b2_snapshotMagic;
+	header.version = b2_snapshotVersion;
+	header.size = 0;
+	stream.Transfer(header);
+
+	TransferState(stream);
+
+	// The size is known once everything has been written.
+	header.size = snapshot.GetSize();
+	memcpy(snapshot.GetData(), &header, sizeof(header));
+}
+
+bool b2World::RestoreSnapshot(const b2Snapshot& snapshot)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return false;
+	}
+
+	b2SnapshotStream stream(&snapshot);
+
+	b2SnapshotHeader header;
+	stream.Transfer(header);
+	if (stream.HasFailed() || header.magic != b2_snapshotMagic || header.version != b2_snapshotVersion ||
+		header.size != snapshot.GetSize())
+	{
+		return false;
+	}
+
+	// Clear the world without notifying the listeners.
+	b2DestructionListener* destructionListener = m_destructionListener;
+	b2ContactListener* contactListener = m_contactManager.m_contactListener;
+	m_destructionListener = nullptr;
+	m_contactManager.m_contactListener = nullptr;
+	while (m_bodyList)
+	{
+		DestroyBody(m_bodyList);
+	}
+	m_destructionListener = destructionListener;
+	m_contactManager.m_contactListener = contactListener;
+
+	TransferState(stream);
+
+	b2Assert(stream.HasFailed() == false && stream.GetOffset() == snapshot.GetSize());
+	return stream.HasFailed() == false;
+}
+
+// Read or write the geometry of a shape of a known type.
+static void b2TransferShape(b2SnapshotStream& stream, b2Shape* shape)
+{
+	stream.Transfer(shape->m_radius);
+
+	switch (shape->m_type)
+	{
+	case b2Shape::e_circle:
+		{
+			b2CircleShape* circle = (b2CircleShape*)shape;
+			stream.Transfer(circle->m_p);
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			b2EdgeShape* edge = (b2EdgeShape*)shape;
+			stream.Transfer(edge->m_vertex0);
+			stream.Transfer(edge->m_vertex1);
+			stream.Transfer(edge->m_vertex2);
+			stream.Transfer(edge->m_vertex3);
+			stream.Transfer(edge->m_hasVertex0);
+			stream.Transfer(edge->m_hasVertex3);
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			b2PolygonShape* polygon = (b2PolygonShape*)shape;
+			stream.Transfer(polygon->m_centroid);
+			stream.Transfer(polygon->m_count);
+			if (polygon->m_count < 3 || polygon->m_count > b2_maxPolygonVertices)
+			{
+				stream.SetFailed();
+				polygon->m_count = 0;
+				return;
+			}
+			stream.TransferArray(polygon->m_vertices, polygon->m_count);
+			stream.TransferArray(polygon->m_normals, polygon->m_count);
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			b2ChainShape* chain = (b2ChainShape*)shape;
+			stream.Transfer(chain->m_count);
+			if (stream.IsReading())
+			{
+				b2Assert(chain->m_vertices == nullptr);
+				if (chain->m_count < 2 || stream.CanRead(chain->m_count, sizeof(b2Vec2)) == false)
+				{
+					stream.SetFailed();
+					chain->m_count = 0;
+					return;
+				}
+				chain->m_vertices = (b2Vec2*)b2Alloc(chain->m_count * sizeof(b2Vec2));
+			}
+			stream.TransferArray(chain->m_vertices, chain->m_count);
+			stream.Transfer(chain->m_prevVertex);
+			stream.Transfer(chain->m_nextVertex);
+			stream.Transfer(chain->m_hasPrevVertex);
+			stream.Transfer(chain->m_hasNextVertex);
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+}
+
+void b2World::TransferState(b2SnapshotStream& stream)
+{
+	int32 flags = m_flags & (e_newFixture | e_clearForces);
+	stream.Transfer(flags);
+	stream.Transfer(m_gravity);
+	stream.Transfer(m_inv_dt0);
+	stream.Transfer(m_stepComplete);
+	stream.Transfer(m_allowSleep);
+	stream.Transfer(m_warmStarting);
+	stream.Transfer(m_continuousPhysics);
+	stream.Transfer(m_subStepping);
+	m_flags = (m_flags & ~(e_newFixture | e_clearForces)) | (flags & (e_newFixture | e_clearForces));
+
+	m_contactManager.m_broadPhase.TransferState(stream);
+
+	// Bodies are written from the tail of the list, so that prepending them while reading restores
+	// the order of the list. They're numbered in that order, which is also the order of their solver
+	// slots after reading.
+	int32 bodyCount = m_bodyCount;
+	stream.Transfer(bodyCount);
+
+	b2Body* b = nullptr;
+	if (stream.IsReading())
+	{
+		b2Assert(m_bodyCount == 0);
+		if (stream.CanRead(bodyCount, sizeof(b2Transform) + sizeof(b2Sweep)) == false)
+		{
+			return;
+		}
+	}
+	else
+	{
+		for (b = m_bodyList; b && b->m_next; b = b->m_next)
+		{
+		}
+	}
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		int32 type = 0;
+		if (stream.IsReading() == false)
+		{
+			type = b->m_type;
+			b->SetIslandIndex(i, 0);
+		}
+		stream.Transfer(type);
+
+		if (stream.IsReading())
+		{
+			if (stream.HasFailed() || type < b2_staticBody || type > b2_dynamicBody)
+			{
+				stream.SetFailed();
+				return;
+			}
+
+			b2BodyDef bd;
+			bd.type = (b2BodyType)type;
+			b = CreateBody(&bd);
+		}
+
+		int32 worldIndex = b->m_worldIndex;
+		uint64 userData = (uint64)(uintptr_t)b->m_userData;
+		stream.Transfer(b->m_flags);
+		stream.Transfer(b->m_xf);
+		stream.Transfer(b->m_sweep);
+		stream.Transfer(b->m_mass);
+		stream.Transfer(b->m_invMass);
+		stream.Transfer(b->m_I);
+		stream.Transfer(b->m_invI);
+		stream.Transfer(b->m_sleepTime);
+		stream.Transfer(worldIndex);
+		stream.Transfer(userData);
+
+		stream.Transfer(b->m_linearVelocity);
+		stream.Transfer(b->m_angularVelocity);
+		stream.Transfer(b->m_force);
+		stream.Transfer(b->m_torque);
+		stream.Transfer(b->m_linearDamping);
+		stream.Transfer(b->m_angularDamping);
+		stream.Transfer(b->m_gravityScale);
+
+		if (stream.IsReading())
+		{
+			// Move the body from the end of its bodies array to its saved index. The array is full
+			// once every body is read.
+			b2GrowableArray<b2Body*>& bodies = type == b2_staticBody ? m_staticBodies : m_nonStaticBodies;
+			b2Assert(bodies.back() == b);
+			bodies.pop_back();
+			if (worldIndex < 0 || worldIndex >= bodyCount)
+			{
+				stream.SetFailed();
+				return;
+			}
+			while (bodies.size() <= (uint32)worldIndex)
+			{
+				bodies.push_back(nullptr);
+			}
+			if (bodies[worldIndex] != nullptr)
+			{
+				stream.SetFailed();
+				return;
+			}
+			bodies[worldIndex] = b;
+			b->m_worldIndex = worldIndex;
+			b->m_userData = (void*)(uintptr_t)userData;
+		}
+
+		TransferFixtures(stream, b);
+
+		if (stream.IsReading() == false)
+		{
+			b = b->m_prev;
+		}
+	}
+
+	if (stream.IsReading() && m_nonStaticBodies.size() + m_staticBodies.size() != (uint32)bodyCount)
+	{
+		// An index was skipped.
+		stream.SetFailed();
+		return;
+	}
+
+	TransferJoints(stream);
+	if (stream.HasFailed())
+	{
+		return;
+	}
+
+	m_contactManager.TransferState(stream);
+
+	if (stream.IsReading())
+	{
+		// Bodies that were marked when the snapshot was written are marked again.
+		for (b = m_bodyList; b; b = b->m_next)
+		{
+			if (b->m_flags & b2Body::e_activityChangedFlag)
+			{
+				b->m_flags &= ~b2Body::e_activityChangedFlag;
+				m_contactManager.MarkActivityChanged(b);
+			}
+		}
+	}
+}
+
+void b2World::TransferFixtures(b2SnapshotStream& stream, b2Body* b)
+{
+	int32 fixtureCount = b->m_fixtureCount;
+	stream.Transfer(fixtureCount);
+	if (stream.IsReading() && stream.CanRead(fixtureCount, 2 * sizeof(int32)) == false)
+	{
+		return;
+	}
+
+	// Fixtures are appended while reading, so they keep their order.
+	b2Fixture* f = b->m_fixtureList;
+	b2Fixture** link = &b->m_fixtureList;
+	for (int32 i = 0; i < fixtureCount; ++i)
+	{
+		int32 shapeType = f ? f->m_shape->m_type : 0;
+		stream.Transfer(shapeType);
+
+		if (stream.IsReading())
+		{
+			b2CircleShape circle;
+			b2EdgeShape edge;
+			b2PolygonShape polygon;
+			b2ChainShape chain;
+
+			b2FixtureDef def;
+			switch (shapeType)
+			{
+			case b2Shape::e_circle:
+				def.shape = &circle;
+				break;
+			case b2Shape::e_edge:
+				def.shape = &edge;
+				break;
+			case b2Shape::e_polygon:
+				def.shape = &polygon;
+				break;
+			case b2Shape::e_chain:
+				def.shape = &chain;
+				break;
+			default:
+				stream.SetFailed();
+				return;
+			}
+
+			b2TransferShape(stream, (b2Shape*)def.shape);
+			if (stream.HasFailed())
+			{
+				return;
+			}
+
+			// The mass data of the body was read, so it isn't reset.
+			void* memory = m_blockAllocator.Allocate(sizeof(b2Fixture));
+			f = new (memory) b2Fixture;
+			f->Create(&m_blockAllocator, b, &def);
+			*link = f;
+			++b->m_fixtureCount;
+		}
+		else
+		{
+			b2TransferShape(stream, f->m_shape);
+		}
+
+		uint64 userData = (uint64)(uintptr_t)f->m_userData;
+		stream.Transfer(f->m_density);
+		stream.Transfer(f->m_friction);
+		stream.Transfer(f->m_restitution);
+		stream.Transfer(f->m_filter);
+		stream.Transfer(f->m_isSensor);
+		stream.Transfer(f->m_isThickShape);
+		stream.Transfer(userData);
+		stream.Transfer(f->m_proxyCount);
+
+		if (stream.IsReading())
+		{
+			f->m_userData = (void*)(uintptr_t)userData;
+			if (f->m_proxyCount != 0 && f->m_proxyCount != f->m_shape->GetChildCount())
+			{
+				stream.SetFailed();
+				f->m_proxyCount = 0;
+				return;
+			}
+		}
+
+		for (int32 j = 0; j < f->m_proxyCount; ++j)
+		{
+			b2FixtureProxy* proxy = f->m_proxies + j;
+			stream.Transfer(proxy->aabb);
+			stream.Transfer(proxy->proxyId);
+
+			if (stream.IsReading())
+			{
+				proxy->fixture = f;
+				proxy->childIndex = j;
+				m_contactManager.m_broadPhase.SetUserData(proxy->proxyId, proxy);
+			}
+		}
+
+		link = &f->m_next;
+		f = f->m_next;
+	}
+}
+
+void b2World::TransferJoints(b2SnapshotStream& stream)
+{
+	// Joints are written from the tail of the list like bodies, so a gear joint is always written
+	// after the joints it refers to.
+	int32 jointCount = m_jointCount;
+	stream.Transfer(jointCount);
+
+	// Bodies were read in the order they were numbered, and each one was pushed to the head of the
+	// body list, so the list runs from the highest index down.
+	int32 bodyCount = stream.IsReading() ? m_bodyCount : 0;
+	b2StackArray<b2Body*> bodies(m_stackAllocator, bodyCount);
+	int32 bodyIndex = bodyCount;
+	for (b2Body* b = m_bodyList; b && bodyIndex > 0; b = b->m_next)
+	{
+		bodies[--bodyIndex] = b;
+	}
+
+	b2Joint* j = nullptr;
+	if (stream.IsReading())
+	{
+		b2Assert(m_jointCount == 0);
+		if (stream.CanRead(jointCount, 3 * sizeof(int32)) == false)
+		{
+			return;
+		}
+	}
+	else
+	{
+		for (j = m_jointList; j && j->m_next; j = j->m_next)
+		{
+		}
+	}
+
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		int32 type = 0;
+		int32 indexA = 0;
+		int32 indexB = 0;
+		int32 collideConnected = 0;
+		uint64 userData = 0;
+		int32 jointIndex1 = -1;
+		int32 jointIndex2 = -1;
+		if (stream.IsReading() == false)
+		{
+			j->m_index = i;
+			type = j->m_type;
+			indexA = j->m_bodyA->GetIslandIndex(0);
+			indexB = j->m_bodyB->GetIslandIndex(0);
+			collideConnected = j->m_collideConnected;
+			userData = (uint64)(uintptr_t)j->m_userData;
+			if (type == e_gearJoint)
+			{
+				b2GearJoint* gear = (b2GearJoint*)j;
+				jointIndex1 = gear->GetJoint1()->m_index;
+				jointIndex2 = gear->GetJoint2()->m_index;
+			}
+		}
+
+		stream.Transfer(type);
+		stream.Transfer(indexA);
+		stream.Transfer(indexB);
+		stream.Transfer(collideConnected);
+		stream.Transfer(userData);
+		stream.Transfer(jointIndex1);
+		stream.Transfer(jointIndex2);
+
+		if (stream.IsReading())
+		{
+			if (stream.HasFailed() || indexA < 0 || indexA >= bodyCount || indexB < 0 || indexB >= bodyCount ||
+				indexA == indexB)
+			{
+				stream.SetFailed();
+				return;
+			}
+
+			b2DistanceJointDef distanceDef;
+			b2FrictionJointDef frictionDef;
+			b2GearJointDef gearDef;
+			b2MotorJointDef motorDef;
+			b2MouseJointDef mouseDef;
+			b2PrismaticJointDef prismaticDef;
+			b2PulleyJointDef pulleyDef;
+			b2RevoluteJointDef revoluteDef;
+			b2RopeJointDef ropeDef;
+			b2WeldJointDef weldDef;
+			b2WheelJointDef wheelDef;
+
+			b2JointDef* def;
+			switch (type)
+			{
+			case e_distanceJoint: def = &distanceDef; break;
+			case e_frictionJoint: def = &frictionDef; break;
+			case e_gearJoint: def = &gearDef; break;
+			case e_motorJoint: def = &motorDef; break;
+			case e_mouseJoint: def = &mouseDef; break;
+			case e_prismaticJoint: def = &prismaticDef; break;
+			case e_pulleyJoint: def = &pulleyDef; break;
+			case e_revoluteJoint: def = &revoluteDef; break;
+			case e_ropeJoint: def = &ropeDef; break;
+			case e_weldJoint: def = &weldDef; break;
+			case e_wheelJoint: def = &wheelDef; break;
+			default:
+				stream.SetFailed();
+				return;
+			}
+
+			if (type == e_gearJoint)
+			{
+				// The joints of a gear joint were read before it.
+				for (b2Joint* other = m_jointList; other; other = other->m_next)
+				{
+					if (other->m_index == jointIndex1)
+					{
+						gearDef.joint1 = other;
+					}
+					if (other->m_index == jointIndex2)
+					{
+						gearDef.joint2 = other;
+					}
+				}
+				if (gearDef.joint1 == nullptr || gearDef.joint2 == nullptr)
+				{
+					stream.SetFailed();
+					return;
+				}
+			}
+
+			def->bodyA = bodies[indexA];
+			def->bodyB = bodies[indexB];
+			def->collideConnected = collideConnected != 0;
+			def->userData = (void*)(uintptr_t)userData;
+			j = CreateJoint(def);
+			j->m_index = i;
+		}
+
+		j->TransferState(stream);
+
+		if (stream.IsReading() == false)
+		{
+			j = j->m_prev;
+		}
+	}
+}
+#endif
@@ -25,20 +25,98 @@
 #include "Box2D/Common/b2GrowableArray.h"
 #include "Box2D/Common/b2StackAllocator.h"
 #include "Box2D/Dynamics/b2ContactManager.h"
+#include "Box2D/Dynamics/b2IslandCostModel.h"
 #include "Box2D/Dynamics/b2WorldCallbacks.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
 #include "Box2D/MT/b2MtUtil.h"
+#include "Box2D/MT/b2ThreadDataArray.h"
+#include <atomic>
 
 struct b2AABB;
 struct b2BodyDef;
 struct b2Color;
 struct b2JointDef;
+struct b2RayCastInput;
 class b2Body;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2Snapshot;
+class b2SnapshotStream;
 class b2TaskExecutor;
+class b2TaskThread;
+class b2Tracer;
 class b2Island;
+class b2StepTask;
+class b2World;
+
+/// The closest hit of a ray. See b2World::RayCastClosest.
+struct b2RayCastResult
+{
+	b2Fixture* fixture;	///< the fixture hit by the ray, or nullptr if there was no hit
+	b2Vec2 point;		///< the point of initial intersection
+	b2Vec2 normal;		///< the normal vector at the point of intersection
+	float32 fraction;	///< the fraction along the ray of the intersection
+};
+
+/// The capacities reserved by b2World::Reserve. A world that doesn't exceed them doesn't
+/// allocate heap memory while stepping.
+struct b2WorldCapacity
+{
+	b2WorldCapacity()
+	{
+		bodyCount = 0;
+		contactCount = 0;
+		proxyCount = 0;
+		jointCount = 0;
+		threadCount = 1;
+		stackSize = b2_stackSize;
+		largePageStack = false;
+	}
+
+	/// The maximum number of bodies.
+	int32 bodyCount;
+
+	/// The maximum number of contacts.
+	int32 contactCount;
+
+	/// The maximum number of broad-phase proxies. Each child of a fixture's shape has a proxy.
+	int32 proxyCount;
+
+	/// The maximum number of joints.
+	int32 jointCount;
+
+	/// The thread count of the executors passed to Step.
+	int32 threadCount;
+
+	/// The size in bytes of the stack allocator used by the user thread. Worker threads have their
+	/// own stack allocators, see b2ThreadPoolOptions::stackSize.
+	int32 stackSize;
+
+	/// Back the user thread's stack allocator with large pages when the platform allows it.
+	bool largePageStack;
+};
+
+/// Refers to a step started by b2World::StepAsync. A default constructed handle is complete.
+class b2StepHandle
+{
+public:
+	b2StepHandle();
+
+	/// Has the step finished? This doesn't block.
+	bool IsComplete() const;
+
+	/// Block until the step finishes.
+	void Wait();
+
+private:
+	friend class b2World;
+
+	b2StepHandle(b2World* world, uint32 stepIndex);
+
+	b2World* m_world;
+	uint32 m_stepIndex;
+};
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -107,6 +185,17 @@ public:
 				int32 positionIterations,
 				b2TaskExecutor& executor);
 
+	/// Start a time step that runs on a background thread and return immediately. The background
+	/// thread takes the place of the user thread in the executor, so the user thread can do other
+	/// work while the executor's threads run the step. The world is locked until the returned
+	/// handle is complete, and callbacks are called from the background thread.
+	/// @warning the user thread must not use the world or the executor until the step is complete,
+	/// other than to check the handle or call IsLocked.
+	b2StepHandle StepAsync(	float32 timeStep,
+							int32 velocityIterations,
+							int32 positionIterations,
+							b2TaskExecutor& executor);
+
 	/// Manually clear the force buffer on all bodies. By default, forces are cleared automatically
 	/// after each call to Step. The default behavior is modified by calling SetAutoClearForces.
 	/// The purpose of this function is to support sub-stepping. Sub-stepping is often used to maintain
@@ -133,6 +222,28 @@ public:
 	/// @param point2 the ray ending point
 	void RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2);
 
+	/// Query the world with many AABBs, using the executor's threads. The fixtures that potentially
+	/// overlap aabbs[i] are written to fixtures[i * capacity] and their number to fixtureCounts[i].
+	/// A query stops after it finds capacity fixtures.
+	/// @param aabbs the query boxes.
+	/// @param count the number of query boxes.
+	/// @param fixtures receives the fixtures. Must hold count * capacity elements.
+	/// @param fixtureCounts receives the number of fixtures found by each query.
+	/// @param capacity the maximum number of fixtures reported per query.
+	/// @param executor executes the query tasks.
+	void QueryAABB(const b2AABB* aabbs, int32 count, b2Fixture** fixtures, int32* fixtureCounts,
+		int32 capacity, b2TaskExecutor& executor);
+
+	/// Ray-cast the world with many rays, using the executor's threads. Each result receives the
+	/// closest fixture hit by the ray, or a null fixture if nothing was hit. Like RayCast, this
+	/// ignores shapes that contain the starting point.
+	/// @param inputs the rays. Each ray extends from p1 to p1 + maxFraction * (p2 - p1).
+	/// @param count the number of rays.
+	/// @param results receives the closest hit of each ray. Must hold count elements.
+	/// @param executor executes the ray-cast tasks.
+	void RayCastClosest(const b2RayCastInput* inputs, int32 count, b2RayCastResult* results,
+		b2TaskExecutor& executor);
+
 	/// Get the world body list. With the returned body, use b2Body::GetNext to get
 	/// the next body in the world list. A nullptr body indicates the end of the list.
 	/// @return the head of the world body list.
@@ -167,6 +278,59 @@ public:
 	void SetSolveTaskCostThreshold(uint32 cost) { m_solveTaskCostThreshold = cost; }
 	uint32 GetSolveTaskCostThreshold() const { return m_solveTaskCostThreshold; }
 
+	/// Enable/disable adaptive solve costs. Solve tasks measure how long each island takes, and the
+	/// nanoseconds per body, contact, and joint are fitted to the measured times. Once a step has been
+	/// measured, the fitted costs replace the cost scales when islands are packed into solve tasks, and
+	/// the solve task cost threshold is replaced by one that divides the estimated solve time among
+	/// the executor's threads. The parallel island cost threshold still uses the cost scales, so the
+	/// results don't depend on the measured times.
+	void SetAdaptiveCosts(bool flag);
+	bool GetAdaptiveCosts() const { return m_adaptiveCosts; }
+
+	/// Get the fitted nanoseconds per body (x), contact (y), and joint (z). These are zero until
+	/// a step has been measured with adaptive costs.
+	b2Vec3 GetAdaptiveCostScales() const { return m_islandCostModel.GetCoefficients(); }
+
+	/// Enable/disable solving large islands with multiple threads. The contacts and joints of these
+	/// islands are colored so that constraints of the same color don't share a dynamic body, and each
+	/// color is solved in parallel. The results don't depend on the thread count, but they differ from
+	/// solving the island on a single thread because the constraints are solved in a different order.
+	void SetParallelIslandSolving(bool flag) { m_parallelIslandSolving = flag; }
+	bool GetParallelIslandSolving() const { return m_parallelIslandSolving; }
+
+	/// Get/set the island cost at which parallel island solving is used.
+	void SetParallelIslandCostThreshold(uint32 cost) { m_parallelIslandCostThreshold = cost; }
+	uint32 GetParallelIslandCostThreshold() const { return m_parallelIslandCostThreshold; }
+
+	/// Enable/disable the wide contact solver, which solves the velocity constraints of several
+	/// contacts at once with SIMD instructions. The contacts of each island are colored like they are
+	/// for parallel island solving, so the results match solving the colored constraints one at a time.
+	/// The results don't depend on SIMD support.
+	void SetWideContactSolving(bool flag) { m_wideContactSolving = flag; }
+	bool GetWideContactSolving() const { return m_wideContactSolving; }
+
+	/// Enable/disable solving TOI events in parallel. Each round, the pending TOI events are
+	/// walked in TOI order and every event that doesn't share a non-static body with an earlier
+	/// event is solved by a range task. The results don't depend on the thread count, but they
+	/// differ from solving one event at a time when solving an event causes an earlier TOI event
+	/// on the bodies of an event in the same round. This is not used while sub-stepping.
+	void SetParallelToiSolving(bool flag) { m_parallelToiSolving = flag; }
+	bool GetParallelToiSolving() const { return m_parallelToiSolving; }
+
+	/// Enable/disable keeping the proxies of static bodies in a separate broad-phase tree. Moving
+	/// proxies only query the static tree, so it isn't modified while stepping, and proxies of
+	/// static bodies aren't paired with each other. Changing this destroys all contacts and
+	/// re-creates all proxies, so it's best done before creating bodies. Touching contacts report
+	/// EndContact, and their manifolds and warm starting impulses are lost. The next step creates
+	/// the contacts again, which then report BeginContact.
+	void SetSeparateStaticTree(bool flag);
+	bool GetSeparateStaticTree() const;
+
+	/// Rebuild the static broad-phase tree top-down. This gives a better tree than inserting
+	/// proxies one at a time, so it's worth doing after the static bodies of a level are created.
+	/// This does nothing useful unless the static tree is separate.
+	void RebuildStaticTree(b2TaskExecutor& executor);
+
 	/// Enable/disable sleep.
 	void SetAllowSleeping(bool flag);
 	bool GetAllowSleeping() const { return m_allowSleep; }
@@ -195,7 +359,8 @@ public:
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
-	/// Get the height of the dynamic tree.
+	/// Get the height of the dynamic tree. With a separate static tree, this doesn't include
+	/// the proxies of static bodies.
 	int32 GetTreeHeight() const;
 
 	/// Get the balance of the dynamic tree.
@@ -205,6 +370,15 @@ public:
 	/// The minimum is 1.
 	float32 GetTreeQuality() const;
 
+	/// Get the height of the static tree. This is 0 unless the static tree is separate.
+	int32 GetStaticTreeHeight() const;
+
+	/// Get the balance of the static tree.
+	int32 GetStaticTreeBalance() const;
+
+	/// Get the quality metric of the static tree.
+	float32 GetStaticTreeQuality() const;
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 
@@ -239,6 +413,34 @@ public:
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Record the stages of each step into a tracer as events of thread 0, or stop recording with
+	/// nullptr. Give the same tracer to the thread pool to see the tasks executed in each stage.
+	/// A tracer must not be used by worlds that are stepped at the same time.
+	/// @warning This function is locked during callbacks.
+	void SetTracer(b2Tracer* tracer);
+
+	/// Get the tracer, or nullptr if steps aren't being recorded.
+	b2Tracer* GetTracer() const;
+
+	/// Reserve memory so that stepping doesn't allocate while the world stays within the capacity.
+	/// Reserving never shrinks the world's memory, and capacities are kept across calls, so they
+	/// can be raised one at a time. Per-thread buffers are sized as if one thread did all of the
+	/// work, so their memory grows with the thread count.
+	/// @warning This function is locked during callbacks.
+	void Reserve(const b2WorldCapacity& capacity);
+
+	/// Get the capacity reserved by Reserve.
+	const b2WorldCapacity& GetCapacity() const { return m_capacity; }
+
+	/// Get the number of allocations made by steps since Reserve was last called. Stack allocator
+	/// overflows and the growth that follows them, new allocator chunks, and thread count changes
+	/// are counted exactly. Overflows of the executor's worker stacks are included when the executor
+	/// reports them through b2TaskExecutor::GetStackMallocCount, which b2ThreadPoolTaskExecutor does.
+	/// Worker stacks shared with worlds that step concurrently count those worlds' overflows too. Exceeding the reserved number of bodies, contacts, proxies, or joints is
+	/// counted once per step, since the buffers that depend on it may grow. This is always zero if
+	/// Reserve hasn't been called.
+	uint32 GetCapacityOverflowCount() const { return m_capacityOverflowCount; }
+
 	/// Set the amount of time (milliseconds) an executor spent locking during the last step.
 	/// This is used in the testbed but custom executors aren't required to call this.
 	void SetLockingTime(float32 ms);
@@ -247,6 +449,24 @@ public:
 	/// @warning this should be called outside of a time step.
 	void Dump();
 
+#ifndef b2_dynamicTreeOfTrees
+	/// Write the state of the world to a snapshot, replacing its contents. This includes the
+	/// bodies, fixtures, joints, contacts with their warm starting impulses, and the broad-phase,
+	/// so stepping a world restored from the snapshot gives the same results as stepping this
+	/// world. Listeners, the contact filter, debug draw, and the multithreading and solver options
+	/// aren't stored. User data is stored as a pointer value.
+	/// @warning this should be called outside of a time step.
+	void SaveSnapshot(b2Snapshot& snapshot);
+
+	/// Replace the contents of the world with a snapshot written by SaveSnapshot. The existing
+	/// bodies, fixtures, and joints are destroyed without calling the destruction listener.
+	/// Returns false and leaves the world unchanged if the snapshot has a different format or
+	/// size. The snapshot must have been written by the same build of Box2D, since its contents
+	/// are trusted once its header has been checked.
+	/// @warning this should be called outside of a time step.
+	bool RestoreSnapshot(const b2Snapshot& snapshot);
+#endif
+
 private:
 
 	// m_flags
@@ -258,34 +478,109 @@ private:
 		e_mtLocked				= 0x0008,
 		e_mtCollisionLocked		= 0x0010,
 		e_mtSolveLocked			= 0x0020,
+		e_trackToiWakes			= 0x0040,
 	};
 
 	friend class b2Body;
+	friend class b2StepHandle;
+	friend class b2StepTask;
 	friend class b2Fixture;
 	friend class b2ContactManager;
 	friend class b2Controller;
 	friend class b2FindMinToiContactTask;
+	friend class b2FindToiEventsTask;
+	friend class b2SolveToiEventsTask;
+	friend class b2FindIslandsTask;
 	friend class b2SolveTask;
 
+	// A TOI event solved by a b2SolveToiEventsTask. The bodies of its island are stored in the
+	// per-thread TOI body array of the thread that solved it. The body count is zero if the
+	// contact wasn't solid.
+	struct ToiEventRecord
+	{
+		b2Contact* contact;
+		float32 alpha;
+		uint32 threadId;
+		uint32 bodyBegin;
+		uint32 bodyCount;
+	};
+
 	void StepSolveTOI(const b2TimeStep& step, b2Island& island, b2Contact* minContact, float32 minaAlpha);
+	void SolveToiEvent(const b2TimeStep& step, ToiEventRecord* event, const b2ThreadContext& threadCtx);
 
 	void BaselineSolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step);
 	void SolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step);
+	void SolveToiEvents(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step);
+	void SolveToiBatch(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step,
+		b2Contact** events, uint32 eventCount);
+	bool FindToiEvents(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
+	bool UpdateToiEvents();
+	uint32 SelectToiBatch(b2Contact** batch);
 	void SynchronizeFixtures(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
 	void FindNewContacts(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
 	void Collide(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
 	void Solve(b2TaskExecutor& executor, b2TaskGroup* taskGroup, const b2TimeStep& step);
+	void FindIslands(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
+	void ExecuteFindIslandsTasks(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2Task::Type type, uint32 count);
 	void ClearPostSolve(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
 	void ClearPostSolveTOI(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
 	void ClearForces(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
 	void FindMinToiContact(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2Contact** contactOut, float* alphaOut);
 	void FindMinToiContact(b2Contact** contactOut, float* alphaOut);
 
+	// The serial TOI solver keeps the cached TOIs in a queue so that each event only recomputes
+	// the TOIs of the contacts it affected. The parallel TOI solver does the same for each batch
+	// with its sorted event array.
+	struct ToiQueueEntry
+	{
+		float32 alpha;
+		b2Contact* contact;
+	};
+
+	static bool ToiQueueGreater(const ToiQueueEntry& a, const ToiQueueEntry& b);
+
+	void BuildToiQueue();
+	void UpdateToiQueue(const b2Island& island, uint32 toiCountBefore);
+	void AddToiDirtyContact(b2Contact* c);
+	void AddToiDirtyContacts(b2Body* b);
+	void AddWokenAndNewToiDirtyContacts(uint32 toiCountBefore);
+	void PopMinToiContact(b2Contact** contactOut, float* alphaOut);
+
 	void RecalculateToiCandidacy(b2Body* b);
 	void RecalculateToiCandidacy(b2Fixture* f);
 
 	void RecalculateSleeping(b2Body* b);
 
+	// Island discovery steps. These are called from multithreaded tasks.
+	void ResetIslandSets(uint32 bodiesBegin, uint32 bodiesEnd);
+	void UniteIslandSets(uint32 contactsBegin, uint32 contactsEnd);
+	void FindIslandSeeds(uint32 bodiesBegin, uint32 bodiesEnd);
+	void ActivateIslandContacts(uint32 contactsBegin, uint32 contactsEnd);
+	void BuildIslands(uint32 bodiesBegin, uint32 bodiesEnd, uint32 threadId);
+	void BuildIsland(b2Body* seed, uint32 threadId);
+	bool IsInAwakeIsland(const b2Body* b) const;
+
+	// Resize per-thread data to match the executor.
+	void SetThreadCount(uint32 threadCount);
+
+	// Reserve memory for the current thread count.
+	void ApplyCapacity();
+
+	// Count the allocations made by a step.
+	void UpdateCapacityOverflowCount(const b2TaskExecutor& executor, bool threadCountChanged,
+		int32 stackMallocCount, int32 chunkCount);
+	int32 GetChunkCount() const;
+
+	// Static bodies have an island index per thread.
+	void AllocateStaticIslandIndices(b2Body* b);
+	void FreeStaticIslandIndices(b2Body* b);
+
+#ifndef b2_dynamicTreeOfTrees
+	void TransferState(b2SnapshotStream& stream);
+	void TransferFixtures(b2SnapshotStream& stream, b2Body* body);
+	void TransferJoints(b2SnapshotStream& stream);
+#endif
+
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
@@ -298,14 +593,83 @@ private:
 	static float32 ComputeToi(b2Contact* contact);
 	static float32 ComputeToi(b2Contact* contact, float32 alpha0);
 
+	// An island found by BuildIslands. The ranges index into the per-thread island arrays.
+	struct IslandRecord
+	{
+		int32 seed;
+		uint32 threadId;
+		uint32 cost;
+		uint32 bodyBegin;
+		uint32 bodyCount;
+		uint32 contactBegin;
+		uint32 contactCount;
+		uint32 jointBegin;
+		uint32 jointCount;
+	};
+
+	// Is the island solved with parallel island solving?
+	bool IsLargeIsland(const IslandRecord& island) const
+	{
+		return m_parallelIslandSolving && island.cost >= m_parallelIslandCostThreshold;
+	}
+
 	struct PerThreadData
 	{
+		PerThreadData()
+			: m_staticBodyCounters(nullptr)
+			, m_staticBodyCounterCapacity(0)
+			, m_islandCounter(0)
+		{}
+
+		~PerThreadData()
+		{
+			b2Free(m_staticBodyCounters);
+		}
+
+		// Make room for the counters of count static bodies.
+		void ReserveStaticBodyCounters(uint32 count)
+		{
+			if (m_staticBodyCounterCapacity < count)
+			{
+				b2Free(m_staticBodyCounters);
+				m_staticBodyCounterCapacity = b2Max(2 * m_staticBodyCounterCapacity, count);
+				m_staticBodyCounters = (uint32*)b2Alloc(m_staticBodyCounterCapacity * sizeof(uint32));
+				memset(m_staticBodyCounters, 0, m_staticBodyCounterCapacity * sizeof(uint32));
+				m_islandCounter = 0;
+			}
+		}
+
 		b2GrowableArray<b2Contact*> m_outOfSyncSweeps;
 
+		// Pending TOI events found by this thread, and the island bodies of the TOI events it solved.
+		b2GrowableArray<b2Contact*> m_toiEvents;
+		b2GrowableArray<b2Body*> m_toiBodies;
+
+		// Islands built by this thread during the current step.
+		b2GrowableArray<IslandRecord> m_islands;
+		b2GrowableArray<b2Body*> m_islandBodies;
+		b2GrowableArray<b2Contact*> m_islandContacts;
+		b2GrowableArray<b2Joint*> m_islandJoints;
+		b2GrowableArray<b2Body*> m_islandStack;
+
+		// Island solve times measured by this thread for adaptive costs.
+		b2GrowableArray<b2IslandCostSample> m_islandCostSamples;
+
+		// A static body can be in multiple islands that are built simultaneously, so instead of
+		// flagging it we store the counter of the last island that added it, indexed by m_worldIndex.
+		uint32* m_staticBodyCounters;
+		uint32 m_staticBodyCounterCapacity;
+		uint32 m_islandCounter;
+
 		uint8 _padding[b2_cacheLineSize];
 	};
 
-	PerThreadData m_perThreadData[b2_maxThreads];
+	b2ThreadDataArray<PerThreadData> m_perThreadData;
+
+	// Disjoint sets of non-static bodies, indexed by m_worldIndex. Each set is identified by
+	// its smallest index. These are only valid during FindIslands.
+	std::atomic<int32>* m_islandSets;
+	std::atomic<int32>* m_islandSeeds;
 
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
@@ -329,6 +693,22 @@ private:
 	uint32 m_contactCost;
 	uint32 m_jointCost;
 	uint32 m_solveTaskCostThreshold;
+	uint32 m_parallelIslandCostThreshold;
+	bool m_parallelIslandSolving;
+	bool m_wideContactSolving;
+	bool m_parallelToiSolving;
+
+	bool m_adaptiveCosts;
+	b2IslandCostModel m_islandCostModel;
+
+	// The pending TOI events in TOI order. Used by parallel TOI solving.
+	b2GrowableArray<b2Contact*> m_toiEvents;
+
+	// A heap of cached TOIs below the TOI threshold, with the minimum first. An entry is
+	// stale if the contact's TOI changed or it stopped being a candidate.
+	b2GrowableArray<ToiQueueEntry> m_toiQueue;
+	b2GrowableArray<b2Body*> m_toiWokenBodies;
+	b2GrowableArray<b2Contact*> m_toiDirtyContacts;
 
 	bool m_allowSleep;
 
@@ -346,6 +726,21 @@ private:
 
 	bool m_stepComplete;
 
+	b2WorldCapacity m_capacity;
+	uint32 m_capacityOverflowCount;
+	bool m_capacityReserved;
+
+	// Runs the steps started by StepAsync. These are created by the first asynchronous step.
+	b2TaskThread* m_stepThread;
+	b2StepTask* m_stepTask;
+
+	// The number of asynchronous steps that were started and that finished. The finished count
+	// is stored by the background thread after the step's last write to the world.
+	uint32 m_asyncStepCount;
+	std::atomic<uint32> m_finishedAsyncStepCount;
+
+	b2Tracer* m_tracer;
+
 	b2Profile m_profile;
 };
 
@@ -406,6 +801,11 @@ inline b2Vec2 b2World::GetGravity() const
 
 inline bool b2World::IsLocked() const
 {
+	// The flags mustn't be read while an asynchronous step might be writing them.
+	if (m_finishedAsyncStepCount.load(std::memory_order_acquire) != m_asyncStepCount)
+	{
+		return true;
+	}
 	return (m_flags & e_locked) == e_locked;
 }
 
@@ -442,6 +842,11 @@ inline const b2Profile& b2World::GetProfile() const
 	return m_profile;
 }
 
+inline b2Tracer* b2World::GetTracer() const
+{
+	return m_tracer;
+}
+
 inline void b2World::SetLockingTime(float32 ms)
 {
 	m_profile.locking = ms;
@@ -466,4 +871,26 @@ inline bool b2World::IsMtSolveLocked() const
 	return (m_flags & e_mtSolveLocked) == e_mtSolveLocked;
 }
 
+inline b2StepHandle::b2StepHandle()
+	: m_world(nullptr)
+	, m_stepIndex(0)
+{ }
+
+inline b2StepHandle::b2StepHandle(b2World* world, uint32 stepIndex)
+	: m_world(world)
+	, m_stepIndex(stepIndex)
+{ }
+
+inline bool b2StepHandle::IsComplete() const
+{
+	if (m_world == nullptr)
+	{
+		return true;
+	}
+
+	// Steps finish in order, so this works after later steps have started.
+	uint32 finished = m_world->m_finishedAsyncStepCount.load(std::memory_order_acquire);
+	return (int32)(finished - m_stepIndex) >= 0;
+}
+
 #endif
@@ -39,12 +39,7 @@ b2DynamicTreeOfTrees::b2DynamicTreeOfTrees(float32 subTreeWidth, float32 subTree
 	memset((char*)m_nodes, 0xcd, m_nodeCapacity * sizeof(Node));
 #endif
 
-    for (uint32 i = 0; i < b2_maxThreads; ++i)
-    {
-        m_perThreadData[i].m_proxyQueryCounters = (uint32*)b2Alloc(m_nodeCapacity * sizeof(uint32));
-        memset(m_perThreadData[i].m_proxyQueryCounters, 0, m_nodeCapacity * sizeof(uint32));
-        m_perThreadData[i].m_queryCounter = 0;
-    }
+	AllocateQueryCounters();
 
 	// Build a linked list for the free list.
 	for (int32 i = 0; i < m_nodeCapacity - 1; ++i)
@@ -69,6 +64,27 @@ b2DynamicTreeOfTrees::~b2DynamicTreeOfTrees()
 	b2Free(m_nodes);
 }
 
+void b2DynamicTreeOfTrees::SetThreadCount(uint32 threadCount)
+{
+	if (threadCount != m_perThreadData.size())
+	{
+		m_perThreadData.resize(threadCount);
+		AllocateQueryCounters();
+	}
+}
+
+void b2DynamicTreeOfTrees::AllocateQueryCounters()
+{
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		PerThreadData& td = m_perThreadData[i];
+		b2Free(td.m_proxyQueryCounters);
+		td.m_proxyQueryCounters = (uint32*)b2Alloc(m_nodeCapacity * sizeof(uint32));
+		memset(td.m_proxyQueryCounters, 0, m_nodeCapacity * sizeof(uint32));
+		td.m_queryCounter = 0;
+	}
+}
+
 // Allocate a node from the pool. Grow the pool if necessary.
 int32 b2DynamicTreeOfTrees::AllocateNode()
 {
@@ -84,14 +100,7 @@ int32 b2DynamicTreeOfTrees::AllocateNode()
 		memcpy(m_nodes, oldNodes, m_nodeCount * sizeof(Node));
 		b2Free(oldNodes);
 
-        for (uint32 i = 0; i < b2_maxThreads; ++i)
-        {
-            uint32* oldCounters = m_perThreadData[i].m_proxyQueryCounters;
-            m_perThreadData[i].m_proxyQueryCounters = (uint32*)b2Alloc(m_nodeCapacity * sizeof(uint32));
-            memset(m_perThreadData[i].m_proxyQueryCounters, 0, m_nodeCapacity * sizeof(uint32));
-            b2Free(oldCounters);
-            m_perThreadData[i].m_queryCounter = 0;
-        }
+		AllocateQueryCounters();
 
 		// Build a linked list for the free list. The parent
 		// pointer becomes the "next" pointer.
@@ -189,19 +198,9 @@ void b2DynamicTreeOfTrees::DestroyProxy(int32 proxyId)
     }
 }
 
-bool b2DynamicTreeOfTrees::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+// Extend the AABB and predict its displacement.
+static b2_forceInline b2AABB b2ComputeFatAABB(const b2AABB& aabb, const b2Vec2& displacement)
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
-
-	b2Assert(m_nodes[proxyId].IsLeaf());
-
-	if (m_nodes[proxyId].aabb.Contains(aabb))
-	{
-		return false;
-	}
-
-	RemoveLeaf(proxyId);
-
 	// Extend AABB.
 	b2AABB b = aabb;
 	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
@@ -229,12 +228,71 @@ bool b2DynamicTreeOfTrees::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2
 		b.upperBound.y += d.y;
 	}
 
-	m_nodes[proxyId].aabb = b;
+	return b;
+}
+
+bool b2DynamicTreeOfTrees::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	if (m_nodes[proxyId].aabb.Contains(aabb))
+	{
+		return false;
+	}
+
+	RemoveLeaf(proxyId);
+
+	m_nodes[proxyId].aabb = b2ComputeFatAABB(aabb, displacement);
 
 	InsertLeaf(proxyId);
 	return true;
 }
 
+int32 b2DynamicTreeOfTrees::GetMoveSubTree(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement,
+	b2AABB* fatAABB) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	*fatAABB = b2ComputeFatAABB(aabb, displacement);
+
+	const Node* node = m_nodes + proxyId;
+	if (node->nextProxy != b2_nullNode)
+	{
+		return b2_nullNode;
+	}
+
+	// Sub-trees form a grid, so a fat AABB that is strictly inside the sub-tree's bounds can't
+	// overlap another sub-tree.
+	int32 baseTreeLeaf = node->baseTreeLeaf;
+	const b2AABB& bounds = m_nodes[baseTreeLeaf].aabb;
+	if (bounds.lowerBound.x < fatAABB->lowerBound.x && bounds.lowerBound.y < fatAABB->lowerBound.y &&
+		fatAABB->upperBound.x < bounds.upperBound.x && fatAABB->upperBound.y < bounds.upperBound.y)
+	{
+		return baseTreeLeaf;
+	}
+
+	return b2_nullNode;
+}
+
+void b2DynamicTreeOfTrees::MoveProxyInSubTree(int32 proxyId, const b2AABB& fatAABB)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+	b2Assert(m_nodes[proxyId].nextProxy == b2_nullNode);
+
+	int32 baseTreeLeaf = m_nodes[proxyId].baseTreeLeaf;
+	int32& subTreeRoot = m_nodes[baseTreeLeaf].subTreeRoot;
+
+	// Reuse the old parent so the shared node pool isn't touched.
+	int32 parent = DetachLeaf(subTreeRoot, proxyId);
+	m_nodes[proxyId].aabb = fatAABB;
+	InsertLeaf(subTreeRoot, proxyId, parent);
+	m_nodes[proxyId].baseTreeLeaf = baseTreeLeaf;
+}
+
 struct b2InsertLeafQueryCallback
 {
     b2InsertLeafQueryCallback(b2DynamicTreeOfTrees* tree, int32 proxy)
@@ -317,7 +375,7 @@ b2_forceInline void b2DynamicTreeOfTrees::InsertLeaf(int32 proxy)
     // Insert the leaf into all existing overlapped sub-trees.
     b2InsertLeafQueryCallback insertQuery(this, proxy);
 
-    uint32 threadId = 0; // TODO_MT parallel SynchronizeFixtures
+    uint32 threadId = 0; // Only called from the user thread.
     Query<false, false>(m_root, &insertQuery, proxyAABB, threadId);
 
     // Is the leaf fully contained by the sub-trees it was inserted into?
@@ -448,7 +506,7 @@ b2_forceInline void b2DynamicTreeOfTrees::RemoveLeaf(int32 proxy)
     }
 }
 
-b2_forceInline void b2DynamicTreeOfTrees::InsertLeaf(int32& root, int32 leaf)
+b2_forceInline void b2DynamicTreeOfTrees::InsertLeaf(int32& root, int32 leaf, int32 newParent)
 {
 	m_nodes[leaf].parent = b2_nullNode;
 
@@ -533,7 +591,10 @@ b2_forceInline void b2DynamicTreeOfTrees::InsertLeaf(int32& root, int32 leaf)
 
 	// Create a new parent.
 	int32 oldParent = m_nodes[sibling].parent;
-	int32 newParent = AllocateNode();
+	if (newParent == b2_nullNode)
+	{
+		newParent = AllocateNode();
+	}
 	m_nodes[newParent].parent = oldParent;
 	m_nodes[newParent].userData = nullptr;
 	m_nodes[newParent].aabb.Combine(leafAABB, m_nodes[sibling].aabb);
@@ -586,11 +647,24 @@ b2_forceInline void b2DynamicTreeOfTrees::InsertLeaf(int32& root, int32 leaf)
 }
 
 void b2DynamicTreeOfTrees::RemoveLeaf(int32& root, int32 leaf)
+{
+	int32 parent = DetachLeaf(root, leaf);
+	if (parent != b2_nullNode)
+	{
+		FreeNode(parent);
+	}
+
+#ifdef b2_validateTree
+	Validate();
+#endif
+}
+
+int32 b2DynamicTreeOfTrees::DetachLeaf(int32& root, int32 leaf)
 {
 	if (leaf == root)
 	{
 		root = b2_nullNode;
-		return;
+		return b2_nullNode;
 	}
 
 	int32 parent = m_nodes[leaf].parent;
@@ -621,7 +695,6 @@ void b2DynamicTreeOfTrees::RemoveLeaf(int32& root, int32 leaf)
 			m_nodes[grandParent].child2 = sibling;
 		}
 		m_nodes[sibling].parent = grandParent;
-		FreeNode(parent);
 
 		// Adjust ancestor bounds.
 		int32 index = grandParent;
@@ -644,12 +717,9 @@ void b2DynamicTreeOfTrees::RemoveLeaf(int32& root, int32 leaf)
 	{
 		root = sibling;
 		m_nodes[sibling].parent = b2_nullNode;
-		FreeNode(parent);
 	}
 
-#ifdef b2_validateTree
-	Validate();
-#endif
+	return parent;
 }
 
 // Perform a left or right rotation if node A is imbalanced.
@@ -23,6 +23,7 @@
 
 #include "Box2D/Collision/b2Collision.h"
 #include "Box2D/Common/b2GrowableStack.h"
+#include "Box2D/MT/b2ThreadDataArray.h"
 #include <algorithm>
 
 #define b2_nullNode (-1)
@@ -30,8 +31,8 @@
 /// A dynamic AABB tree-of-trees broad-phase, based on Erin Cato's b2DynamicTree.
 /// The base tree's leaves form a sparse grid, with each containing the root node
 /// of a sub-tree. This can improve tree quality in the case of thousands of proxies,
-/// and allows parallel sub-tree proxy insertion/removal (in theory; TODO_MT:
-/// implement parallel SynchronizeFixtures).
+/// and allows proxies that stay within one sub-tree to be moved in parallel with
+/// proxies of other sub-trees (see GetMoveSubTree).
 ///
 /// A dynamic tree arranges data in a binary tree to accelerate
 /// queries such as volume queries and ray casts. Leafs are proxies
@@ -50,6 +51,10 @@ public:
 	/// Destroy all proxies and set the sub-tree dimensions.
 	void Reset(float32 subTreeWidth, float32 subTreeHeight);
 
+	/// Set the number of threads that can query the tree.
+	/// @warning must not be called while the tree is being queried.
+	void SetThreadCount(uint32 threadCount);
+
 	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
@@ -62,6 +67,19 @@ public:
 	/// @return true if the proxy was re-inserted.
 	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
 
+	/// Get the sub-tree that a proxy can be moved within. A proxy that stays in one sub-tree can be
+	/// moved with MoveProxyInSubTree, which only modifies that sub-tree.
+	/// @param fatAABB receives the fattened AABB that MoveProxy would give the proxy.
+	/// @return the base tree leaf of the sub-tree, or b2_nullNode if the proxy is in or would be
+	/// moved into other sub-trees. MoveProxy must be used in that case.
+	int32 GetMoveSubTree(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement, b2AABB* fatAABB) const;
+
+	/// Re-insert a proxy into its sub-tree with a fattened AABB from GetMoveSubTree. This doesn't
+	/// allocate or free nodes, so proxies in different sub-trees can be moved simultaneously.
+	/// @warning proxies in the same sub-tree must not be moved simultaneously, and the base
+	/// tree must not be modified at the same time.
+	void MoveProxyInSubTree(int32 proxyId, const b2AABB& fatAABB);
+
 	/// Get proxy user data.
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
@@ -158,6 +176,16 @@ private:
 
 	struct PerThreadData
 	{
+		PerThreadData()
+			: m_proxyQueryCounters(nullptr)
+			, m_queryCounter(0)
+		{}
+
+		~PerThreadData()
+		{
+			b2Free(m_proxyQueryCounters);
+		}
+
 		uint32* m_proxyQueryCounters;
 		uint32 m_queryCounter;
 
@@ -169,12 +197,20 @@ private:
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
+	// Allocate cleared query counters for every thread, sized to the node capacity.
+	void AllocateQueryCounters();
+
 	void InsertLeaf(int32 node);
-	void InsertLeaf(int32& root, int32 node);
+
+	// Insert a leaf under a new parent. The parent is allocated if it's null and the tree isn't empty.
+	void InsertLeaf(int32& root, int32 node, int32 newParent = b2_nullNode);
 
 	void RemoveLeaf(int32 node);
 	void RemoveLeaf(int32& root, int32 node);
 
+	// Remove a leaf without freeing its parent. Returns the parent, or b2_nullNode if the leaf was the root.
+	int32 DetachLeaf(int32& root, int32 node);
+
 	int32 Balance(int32& root, int32 index);
 
 	int32 GetHeight(int32 nodeId) const;
@@ -197,7 +233,7 @@ private:
 	template <bool querySubTrees, typename T>
 	bool RayCast(int32 root, T* callback, const b2RayCastInput& input, uint32 threadId);
 
-	PerThreadData m_perThreadData[b2_maxThreads];
+	b2ThreadDataArray<PerThreadData> m_perThreadData;
 
 	// The root tree. Its leaves hold sub-trees.
 	int32 m_root;
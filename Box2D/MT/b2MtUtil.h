@@ -19,9 +19,11 @@
 #ifndef B2_MT_UTIL_H
 #define B2_MT_UTIL_H
 
+#include "Box2D/Common/b2Math.h"
 #include "Box2D/Common/b2StackAllocator.h"
 #include "Box2D/MT/b2Task.h"
 #include "Box2D/MT/b2TaskExecutor.h"
+#include <new>
 
 // Submit a task to an executor.
 inline void b2SubmitTask(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2Task* task)
@@ -34,15 +36,76 @@ inline void b2SubmitTask(b2TaskExecutor& executor, b2TaskGroup* taskGroup, b2Tas
 template<typename TaskType>
 inline void b2SubmitTasks(b2TaskExecutor& executor, b2TaskGroup* taskGroup, TaskType* tasks, uint32 count)
 {
-	b2Task* taskPtrs[b2_maxRangeSubTasks];
-	for (uint32 i = 0; i < count; ++i)
+	// Submit in batches so the pointer array stays on the stack regardless of the count.
+	const uint32 batchSize = 64;
+	b2Task* taskPtrs[batchSize];
+	for (uint32 batchBegin = 0; batchBegin < count; batchBegin += batchSize)
 	{
-		taskPtrs[i] = tasks + i;
-		taskPtrs[i]->SetTaskGroup(taskGroup);
+		uint32 batchCount = b2Min(count - batchBegin, batchSize);
+		for (uint32 i = 0; i < batchCount; ++i)
+		{
+			taskPtrs[i] = tasks + batchBegin + i;
+			taskPtrs[i]->SetTaskGroup(taskGroup);
+		}
+		executor.SubmitTasks(taskGroup, taskPtrs, batchCount);
 	}
-	executor.SubmitTasks(taskGroup, taskPtrs, count);
 }
 
+// An array of default constructed objects allocated from a stack allocator.
+// The objects are destroyed and the memory is freed when the array goes out of scope,
+// so the usual stack allocator ordering rules apply.
+template<typename T>
+class b2StackArray
+{
+public:
+	b2StackArray(b2StackAllocator& allocator, uint32 count)
+		: m_allocator(allocator)
+		, m_count(count)
+	{
+		// Over-allocate so that cache line aligned types keep their alignment.
+		m_mem = m_allocator.Allocate((int32)(count * sizeof(T) + alignof(T) - 1));
+		m_array = (T*)(((uintptr_t)m_mem + alignof(T) - 1) & ~(uintptr_t)(alignof(T) - 1));
+		for (uint32 i = 0; i < count; ++i)
+		{
+			new (m_array + i) T();
+		}
+	}
+
+	~b2StackArray()
+	{
+		for (uint32 i = 0; i < m_count; ++i)
+		{
+			m_array[i].~T();
+		}
+		m_allocator.Free(m_mem);
+	}
+
+	b2StackArray(const b2StackArray&) = delete;
+	b2StackArray& operator=(const b2StackArray&) = delete;
+
+	T& operator[](size_t i)
+	{
+		b2Assert(i < m_count);
+		return m_array[i];
+	}
+
+	T* data()
+	{
+		return m_array;
+	}
+
+	uint32 size() const
+	{
+		return m_count;
+	}
+
+private:
+	b2StackAllocator& m_allocator;
+	void* m_mem;
+	T* m_array;
+	uint32 m_count;
+};
+
 // Initialize a thread context for the user thread.
 inline b2ThreadContext b2MainThreadCtx(b2StackAllocator* stackAllocator)
 {
@@ -57,18 +120,23 @@ template<typename RangeTaskType, typename... Args>
 inline void b2ExecuteRangeTask(b2TaskExecutor& executor, RangeTaskType& task)
 {
 	b2TaskGroup* taskGroup = executor.AcquireTaskGroup();
-	RangeTaskType tasks[b2_maxRangeSubTasks];
 	b2RangeTaskRange r = task.GetRange();
 	b2PartitionedRange ranges;
 	executor.PartitionRange(task.GetType(), r.begin, r.end, ranges);
-	for (uint32 i = 0; i < ranges.count; ++i)
+	RangeTaskType* tasks = (RangeTaskType*)b2Alloc(ranges.GetCount() * sizeof(RangeTaskType));
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
 	{
-		tasks[i] = task;
+		new (tasks + i) RangeTaskType(task);
 		tasks[i].SetRange(ranges[i]);
 	}
-	b2SubmitTasks(executor, taskGroup, tasks, ranges.count);
+	b2SubmitTasks(executor, taskGroup, tasks, ranges.GetCount());
 	executor.Wait(taskGroup, b2MainThreadCtx(nullptr));
 	executor.ReleaseTaskGroup(taskGroup);
+	for (uint32 i = 0; i < ranges.GetCount(); ++i)
+	{
+		tasks[i].~RangeTaskType();
+	}
+	b2Free(tasks);
 }
 
 // Replace an element in a vector
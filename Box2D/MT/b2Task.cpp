@@ -21,17 +21,14 @@
 
 void b2PartitionRange(uint32 begin, uint32 end, uint32 maxOutputRanges, uint32 minElementsPerRange, b2PartitionedRange& output)
 {
-	b2Assert(maxOutputRanges <= b2_maxRangeSubTasks);
+	b2Assert(maxOutputRanges > 0);
 	b2Assert(begin < end);
 
 	uint32 elementCount = end - begin;
 
 	if (elementCount <= minElementsPerRange)
 	{
-		b2Assert(output.count < b2_maxRangeSubTasks);
-		output[output.count].begin = begin;
-		output[output.count].end = end;
-		output.count += 1;
+		output.Add(begin, end);
 		return;
 	}
 
@@ -58,10 +55,7 @@ void b2PartitionRange(uint32 begin, uint32 end, uint32 maxOutputRanges, uint32 m
 		{
 			endIndex = end;
 		}
-		b2Assert(output.count < b2_maxRangeSubTasks);
-		output[output.count].begin = beginIndex;
-		output[output.count].end = endIndex;
-		output.count += 1;
+		output.Add(beginIndex, endIndex);
 		if (endIndex == end)
 		{
 			break;
@@ -19,6 +19,7 @@
 #ifndef B2_TASK_H
 #define B2_TASK_H
 
+#include "Box2D/Common/b2GrowableStack.h"
 #include "Box2D/Common/b2Settings.h"
 
 class b2StackAllocator;
@@ -49,6 +50,19 @@ public:
 		e_clearForces,
 		e_collide,
 		e_findMinToiContact,
+		e_resetIslandSets,
+		e_uniteIslandSets,
+		e_findIslandSeeds,
+		e_activateIslandContacts,
+		e_buildIslands,
+		e_solveVelocityConstraints,
+		e_solvePositionConstraints,
+		e_queryAABB,
+		e_rayCast,
+		e_moveProxies,
+		e_findToiEvents,
+		e_solveToiEvents,
+		e_buildTree,
 
 		e_rangeTypeCount,
 
@@ -120,18 +134,24 @@ struct b2RangeTaskRange
 	uint32 end;
 };
 
+const int32 b2_partitionedRangeCapacity = 64;
+
 /// A set of sequential ranges.
+/// The number of ranges is not bounded, so executors with many threads can split
+/// ranges as finely as they need to. The first b2_partitionedRangeCapacity ranges are
+/// stored inline, so partitioning a range usually doesn't allocate.
 struct b2PartitionedRange
 {
-	b2PartitionedRange()
-		: count(0)
-	{ }
+	/// Append a range.
+	void Add(uint32 begin, uint32 end);
+
+	/// Get the number of ranges.
+	uint32 GetCount() const;
 
 	b2RangeTaskRange& operator[](size_t i);
 	const b2RangeTaskRange& operator[](size_t i) const;
 
-	b2RangeTaskRange ranges[b2_maxRangeSubTasks];
-	uint32 count;
+	b2GrowableStack<b2RangeTaskRange, b2_partitionedRangeCapacity> ranges;
 };
 
 /// The base class for tasks that operate on a range of items.
@@ -181,14 +201,24 @@ inline b2TaskGroup* b2Task::GetTaskGroup() const
 	return m_taskGroup;
 }
 
+inline void b2PartitionedRange::Add(uint32 begin, uint32 end)
+{
+	ranges.Push(b2RangeTaskRange(begin, end));
+}
+
+inline uint32 b2PartitionedRange::GetCount() const
+{
+	return (uint32)ranges.GetCount();
+}
+
 inline b2RangeTaskRange& b2PartitionedRange::operator[](size_t i)
 {
-	return ranges[i];
+	return ranges[(int32)i];
 }
 
 inline const b2RangeTaskRange& b2PartitionedRange::operator[](size_t i) const
 {
-	return ranges[i];
+	return ranges[(int32)i];
 }
 
 inline void b2RangeTask::Execute(const b2ThreadContext& ctx)
@@ -29,7 +29,7 @@ class b2TaskExecutor
 public:
 
 	/// The total number of threads that can be executed.
-	/// Must be between 1 and b2_maxThreads.
+	/// Must be at least 1.
 	virtual uint32 GetThreadCount() const = 0;
 
 	/// Submit a single task for execution.
@@ -72,9 +72,14 @@ public:
 	{
 		B2_NOT_USED(type);
 
-		output.ranges[0].begin = begin;
-		output.ranges[0].end = end;
-		output.count = 1;
+		output.Add(begin, end);
+	}
+
+	/// The number of times the stack allocators owned by the executor's threads have used b2Alloc.
+	/// The world adds the allocations made during a step to its capacity overflow count.
+	virtual int32 GetStackMallocCount() const
+	{
+		return 0;
 	}
 };
 
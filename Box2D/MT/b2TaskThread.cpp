@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Box2D/MT/b2TaskThread.h"
+#include "Box2D/MT/b2MtUtil.h"
+
+b2TaskThread::b2TaskThread()
+{
+	m_task = nullptr;
+	m_signalShutdown = false;
+	m_thread = std::thread(&b2TaskThread::ThreadMain, this);
+}
+
+b2TaskThread::~b2TaskThread()
+{
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		m_signalShutdown = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+}
+
+void b2TaskThread::Submit(b2Task* task)
+{
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		b2Assert(m_task == nullptr);
+		m_task = task;
+	}
+	m_condition.notify_all();
+}
+
+bool b2TaskThread::IsIdle() const
+{
+	std::lock_guard<std::mutex> lk(m_mutex);
+	return m_task == nullptr;
+}
+
+void b2TaskThread::Wait()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_condition.wait(lk, [this]()
+	{
+		return m_task == nullptr;
+	});
+}
+
+void b2TaskThread::ThreadMain()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	while (true)
+	{
+		// The destructor waits for a submitted task before shutting down.
+		m_condition.wait(lk, [this]()
+		{
+			return m_task != nullptr || m_signalShutdown;
+		});
+		if (m_task == nullptr)
+		{
+			return;
+		}
+
+		b2Task* task = m_task;
+		lk.unlock();
+		task->Execute(b2MainThreadCtx(nullptr));
+		lk.lock();
+
+		m_task = nullptr;
+		m_condition.notify_all();
+	}
+}
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TASK_THREAD_H
+#define B2_TASK_THREAD_H
+
+#include "Box2D/MT/b2Task.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// A thread that executes one task at a time in the background. The task is executed with
+/// thread id 0, so it can submit tasks to an executor and wait on them in place of the user
+/// thread. The user thread must not use that executor until the task is finished.
+class b2TaskThread
+{
+public:
+	/// Start the thread.
+	b2TaskThread();
+
+	/// Wait for the current task and join with the thread.
+	~b2TaskThread();
+
+	b2TaskThread(const b2TaskThread&) = delete;
+	b2TaskThread& operator=(const b2TaskThread&) = delete;
+
+	/// Execute a task on the thread. The previous task must be finished.
+	void Submit(b2Task* task);
+
+	/// Is there no task executing?
+	bool IsIdle() const;
+
+	/// Wait for the current task to finish.
+	void Wait();
+
+private:
+	void ThreadMain();
+
+	std::thread m_thread;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	b2Task* m_task;
+	bool m_signalShutdown;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_THREAD_DATA_ARRAY_H
+#define B2_THREAD_DATA_ARRAY_H
+
+#include "Box2D/Common/b2Settings.h"
+#include <new>
+
+/// An array with one element per thread, sized from the executor's thread count.
+/// Elements are constructed in place and never moved, so they may contain atomics
+/// and other non-copyable members. Per-thread structs should still pad themselves
+/// to avoid false sharing with their neighbors.
+/// This is meant for internal use only.
+template <typename T>
+class b2ThreadDataArray
+{
+public:
+	b2ThreadDataArray(uint32 count = 1)
+		: m_array(nullptr)
+		, m_size(0)
+	{
+		resize(count);
+	}
+
+	~b2ThreadDataArray()
+	{
+		Destroy();
+	}
+
+	b2ThreadDataArray(const b2ThreadDataArray&) = delete;
+	b2ThreadDataArray& operator=(const b2ThreadDataArray&) = delete;
+
+	/// Destroy all elements and default construct count new elements.
+	/// @warning no other thread may be accessing the array.
+	void resize(uint32 count)
+	{
+		Destroy();
+
+		m_size = count;
+		if (count > 0)
+		{
+			m_array = (T*)b2Alloc(count * sizeof(T));
+			for (uint32 i = 0; i < count; ++i)
+			{
+				new (m_array + i) T();
+			}
+		}
+	}
+
+	T& operator[](size_t i)
+	{
+		b2Assert(i < m_size);
+		return m_array[i];
+	}
+
+	const T& operator[](size_t i) const
+	{
+		b2Assert(i < m_size);
+		return m_array[i];
+	}
+
+	uint32 size() const
+	{
+		return m_size;
+	}
+
+	T* data()
+	{
+		return m_array;
+	}
+
+	const T* data() const
+	{
+		return m_array;
+	}
+
+	T* begin()
+	{
+		return m_array;
+	}
+
+	const T* begin() const
+	{
+		return m_array;
+	}
+
+	T* end()
+	{
+		return m_array + m_size;
+	}
+
+	const T* end() const
+	{
+		return m_array + m_size;
+	}
+
+private:
+	void Destroy()
+	{
+		for (uint32 i = 0; i < m_size; ++i)
+		{
+			m_array[i].~T();
+		}
+		b2Free(m_array);
+		m_array = nullptr;
+		m_size = 0;
+	}
+
+	T* m_array;
+	uint32 m_size;
+};
+
+#endif
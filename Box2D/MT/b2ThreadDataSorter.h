@@ -23,98 +23,255 @@
 #include "Box2D/MT/b2Task.h"
 #include "Box2D/MT/b2TaskExecutor.h"
 #include "Box2D/MT/b2MtUtil.h"
+#include "Box2D/MT/b2ThreadDataArray.h"
 #include <algorithm>
 
-// Merge two sorted arrays. No std::merge because we're not requiring C++17 support yet.
-template<typename InputIt, typename OutputIt, typename Compare>
-OutputIt b2Merge(InputIt beginA, InputIt endA, InputIt beginB, InputIt endB, OutputIt output, Compare comp)
+// An element's sort key and its index in the unsorted input.
+struct b2SortKey
 {
-	for (; beginA != endA; ++output)
+	uint64 key;
+	uint32 index;
+};
+
+// Inputs smaller than this are sorted with std::sort instead of a radix sort.
+#define b2_radixSortThreshold 64
+
+// Sort keys by key and then by index, using keys as the input and scratch as temporary storage.
+// Returns the buffer that holds the sorted keys, which is either keys or scratch.
+inline b2SortKey* b2RadixSort(b2SortKey* keys, b2SortKey* scratch, uint32 count)
+{
+	if (count < b2_radixSortThreshold)
+	{
+		std::sort(keys, keys + count, [](const b2SortKey& a, const b2SortKey& b)
+		{
+			return a.key < b.key || (a.key == b.key && a.index < b.index);
+		});
+		return keys;
+	}
+
+	// Count each byte of the keys in one pass, and find the bytes that differ.
+	uint32 counts[8][256] = {};
+	uint64 varying = 0;
+	for (uint32 i = 0; i < count; ++i)
 	{
-		if (beginB == endB)
+		uint64 key = keys[i].key;
+		varying |= key ^ keys[0].key;
+		for (uint32 b = 0; b < 8; ++b)
 		{
-			return std::copy(beginA, endA, output);
+			++counts[b][(key >> (8 * b)) & 0xFF];
 		}
-		if (comp(*beginB, *beginA))
+	}
+
+	// A stable counting sort per varying byte, least significant first. Input order is index
+	// order, so ties stay in index order.
+	for (uint32 b = 0; b < 8; ++b)
+	{
+		if (((varying >> (8 * b)) & 0xFF) == 0)
 		{
-			*output = *beginB;
-			++beginB;
+			continue;
 		}
-		else
+
+		uint32 offset = 0;
+		for (uint32 d = 0; d < 256; ++d)
+		{
+			uint32 n = counts[b][d];
+			counts[b][d] = offset;
+			offset += n;
+		}
+
+		for (uint32 i = 0; i < count; ++i)
 		{
-			*output = *beginA;
-			++beginA;
+			uint32 d = (keys[i].key >> (8 * b)) & 0xFF;
+			scratch[counts[b][d]++] = keys[i];
 		}
+
+		std::swap(keys, scratch);
 	}
-    return std::copy(beginB, endB, output);
+
+	return keys;
 }
 
-// A task for sorting.
-template<typename InputIt, typename Compare>
-class b2SortTask : public b2Task
+// A task for sorting the data of one thread. The keys are extracted once and radix sorted,
+// then the values are copied to the output in sorted order.
+template<typename T, typename KeyFunc>
+class b2ThreadDataSortTask : public b2Task
 {
 public:
-	b2SortTask() {}
-	b2SortTask(InputIt begin, InputIt end, Compare comp)
-		: m_begin(begin)
-		, m_end(end)
-		, m_comp(comp)
+	b2ThreadDataSortTask() {}
+	b2ThreadDataSortTask(const T* input, uint32 count, T* output, b2SortKey* keys, b2SortKey* scratch,
+		b2SortKey** sortedKeys, KeyFunc keyFunc)
+		: m_input(input)
+		, m_count(count)
+		, m_output(output)
+		, m_keys(keys)
+		, m_scratch(scratch)
+		, m_sortedKeys(sortedKeys)
+		, m_keyFunc(keyFunc)
 	{}
 
 	virtual b2Task::Type GetType() const override { return b2Task::e_sort; }
 
 	virtual void Execute(const b2ThreadContext&) override
 	{
-		std::sort(m_begin, m_end, m_comp);
+		for (uint32 i = 0; i < m_count; ++i)
+		{
+			m_keys[i].key = m_keyFunc(m_input[i]);
+			m_keys[i].index = i;
+		}
+
+		b2SortKey* sorted = b2RadixSort(m_keys, m_scratch, m_count);
+
+		for (uint32 i = 0; i < m_count; ++i)
+		{
+			m_output[i] = m_input[sorted[i].index];
+		}
+
+		*m_sortedKeys = sorted;
 	}
 
 private:
-	InputIt m_begin;
-	InputIt m_end;
-	Compare m_comp;
+	const T* m_input;
+	uint32 m_count;
+	T* m_output;
+	b2SortKey* m_keys;
+	b2SortKey* m_scratch;
+	b2SortKey** m_sortedKeys;
+	KeyFunc m_keyFunc;
 };
 
-// A task for merging two sorted inputs.
-template<typename InputIt, typename OutputIt, typename Compare>
-class b2MergeTask : public b2Task
+// A task for merging one key range of several sorted runs. Ties are taken from the earliest run.
+// The runs that have elements left are kept in a binary heap ordered by their next key, so each
+// element is merged in O(log k) for k runs.
+template<typename T>
+class b2KWayMergeTask : public b2Task
 {
 public:
-	b2MergeTask() {}
-	b2MergeTask(InputIt beginA, InputIt endA, InputIt beginB, InputIt endB, OutputIt output, Compare comp)
-		: m_beginA(beginA)
-		, m_endA(endA)
-		, m_beginB(beginB)
-		, m_endB(endB)
+	b2KWayMergeTask() {}
+	b2KWayMergeTask(uint32 runCount, const uint32* runOffsets, b2SortKey* const* runKeys, const T* values,
+		const uint32* begins, const uint32* ends, uint32* cursors, uint32* heap, T* output)
+		: m_runCount(runCount)
+		, m_runOffsets(runOffsets)
+		, m_runKeys(runKeys)
+		, m_values(values)
+		, m_begins(begins)
+		, m_ends(ends)
+		, m_cursors(cursors)
+		, m_heap(heap)
 		, m_output(output)
-		, m_comp(comp)
 	{}
 
 	virtual b2Task::Type GetType() const override { return b2Task::e_merge; }
 
 	virtual void Execute(const b2ThreadContext&) override
 	{
-		b2Merge(m_beginA, m_endA, m_beginB, m_endB, m_output, m_comp);
+		uint32 outputIndex = 0;
+		uint32 heapCount = 0;
+		for (uint32 r = 0; r < m_runCount; ++r)
+		{
+			m_cursors[r] = m_begins[r];
+			outputIndex += m_begins[r];
+			if (m_begins[r] < m_ends[r])
+			{
+				m_heap[heapCount++] = r;
+			}
+		}
+
+		for (uint32 i = heapCount / 2; i > 0; --i)
+		{
+			SiftDown(i - 1, heapCount);
+		}
+
+		while (heapCount > 0)
+		{
+			uint32 run = m_heap[0];
+			m_output[outputIndex++] = m_values[m_runOffsets[run] + m_cursors[run]];
+
+			if (++m_cursors[run] == m_ends[run])
+			{
+				m_heap[0] = m_heap[--heapCount];
+			}
+
+			SiftDown(0, heapCount);
+		}
 	}
+
 private:
-	InputIt m_beginA;
-	InputIt m_endA;
-	InputIt m_beginB;
-	InputIt m_endB;
-	OutputIt m_output;
-	Compare m_comp;
+	// Compare the next keys of two runs. Runs never compare equal, which keeps ties in run order.
+	bool RunLessThan(uint32 runA, uint32 runB) const
+	{
+		uint64 keyA = m_runKeys[runA][m_cursors[runA]].key;
+		uint64 keyB = m_runKeys[runB][m_cursors[runB]].key;
+		return keyA < keyB || (keyA == keyB && runA < runB);
+	}
+
+	// Move the run at index down the heap until neither child is less than it.
+	void SiftDown(uint32 index, uint32 heapCount)
+	{
+		if (heapCount == 0)
+		{
+			return;
+		}
+
+		uint32 run = m_heap[index];
+		while (true)
+		{
+			uint32 child = 2 * index + 1;
+			if (child >= heapCount)
+			{
+				break;
+			}
+
+			if (child + 1 < heapCount && RunLessThan(m_heap[child + 1], m_heap[child]))
+			{
+				++child;
+			}
+
+			if (RunLessThan(m_heap[child], run) == false)
+			{
+				break;
+			}
+
+			m_heap[index] = m_heap[child];
+			index = child;
+		}
+		m_heap[index] = run;
+	}
+
+	uint32 m_runCount;
+	const uint32* m_runOffsets;
+	b2SortKey* const* m_runKeys;
+	const T* m_values;
+	const uint32* m_begins;
+	const uint32* m_ends;
+	uint32* m_cursors;
+	uint32* m_heap;
+	T* m_output;
 };
 
-// A class for async sorting of per thread data.
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount = b2_maxThreads>
+// A class for async sorting of per thread data by 64-bit keys.
+// Each thread data array is radix sorted into its own run of the output buffer. The runs are then
+// split into key ranges and each range is merged from all runs at once, so the sort takes two
+// rounds of tasks regardless of the thread data count.
+// KeyFunc maps an element to its key. Elements with equal keys must be interchangeable, otherwise
+// their order depends on the thread data they came from.
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
 class b2ThreadDataSorter
 {
 public:
 	b2ThreadDataSorter() {}
 
 	// Construct the sorter.
+	// workMemory must be aligned for tasks and hold GetWorkMemorySize(threadDataCount) bytes.
 	// outputDoubleBuffer must be large enough to hold 2 * outputCount.
-	b2ThreadDataSorter(ThreadData* threadDataArray, Member ThreadData::* members,
-		T* outputDoubleBuffer, uint32 outputCount, Compare comp);
+	// keyDoubleBuffer must be large enough to hold 2 * outputCount.
+	b2ThreadDataSorter(ThreadData* threadDataArray, uint32 threadDataCount, Member ThreadData::* members,
+		void* workMemory, T* outputDoubleBuffer, b2SortKey* keyDoubleBuffer, uint32 outputCount, KeyFunc keyFunc);
+
+	// The number of bytes of work memory needed to sort threadDataCount arrays.
+	static uint32 GetWorkMemorySize(uint32 threadDataCount);
+
+	// The required alignment of the work memory.
+	static uint32 GetWorkMemoryAlignment();
 
 	// Submit a sorting task.
 	// Note: this gives better parallelism when called on multiple sorters before waiting.
@@ -123,14 +280,14 @@ public:
 	// Have all required sort tasks been submitted?
 	bool IsSubmitRequired() const
 	{
-		return m_sortedRangeCount > 1;
+		return m_nextPhase != e_done;
 	}
 
 	// Get the sorted output.
 	T* GetSortedOutput() const
 	{
 		b2Assert(IsSubmitRequired() == false);
-		return m_outputBuffer;
+		return m_sortedOutput;
 	}
 
 	// Get the number of elements in the output.
@@ -140,58 +297,79 @@ public:
 	}
 
 private:
-	using SortTask = b2SortTask<T*, Compare>;
-	using MergeTask = b2MergeTask<T*, T*, Compare>;
+	using SortTask = b2ThreadDataSortTask<T, KeyFunc>;
+	using MergeTask = b2KWayMergeTask<T>;
 
 	// Track the phase of our work.
 	enum Phase
 	{
 		e_threadDataSort,
-		e_threadDataToBufferMerge,
-		e_clearThreadData,
-		e_bufferToBufferMerge
+		e_merge,
+		e_done
 	};
 
-	// Sort the per thread data.
+	// Sort each thread data into its run of the output buffer.
 	void SubmitThreadDataSort(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
 
-	// Merge the sorted per thread data into the output buffer.
-	void SubmitThreadDataToBufferMerge(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
+	// Merge the runs into the working buffer.
+	void SubmitMerge(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
+
+	// Offsets of the work memory arrays.
+	static uint32 GetMergeTasksOffset(uint32 threadDataCount);
+	static uint32 GetRunKeysOffset(uint32 threadDataCount);
+	static uint32 GetRunOffsetsOffset(uint32 threadDataCount);
+	static uint32 GetSplitsOffset(uint32 threadDataCount);
+	static uint32 GetCursorsOffset(uint32 threadDataCount);
+	static uint32 GetHeapsOffset(uint32 threadDataCount);
+	static uint32 GetSamplesOffset(uint32 threadDataCount);
 
-	// Merge the sorted ranges within the output buffer.
-	void SubmitBufferToBufferMerge(b2TaskExecutor& executor, b2TaskGroup* taskGroup);
+	// Tasks and arrays live in the work memory. The sort and merge tasks have no
+	// resources to release, so they are never destroyed.
+	SortTask* m_sortTasks;
+	MergeTask* m_mergeTasks;
 
-	// Not expected to work under these conditions.
-	// Create an issue or submit a pull request if you want to lift these restrictions.
-	static_assert(ThreadDataCount > 1, "b2ThreadDataSorter expects ThreadDataCount to be greater than 1.");
-	static_assert((ThreadDataCount & 1) == 0, "b2ThreadDataSorter expects ThreadDataCount to be even.");
+	// The sorted keys of each run.
+	b2SortKey** m_runKeys;
 
-	SortTask m_sortTasks[ThreadDataCount];
-	MergeTask m_mergeTasks[ThreadDataCount / 2];
+	// Boundaries of the runs in the output buffer, so there is one more entry than runs.
+	uint32* m_runOffsets;
 
-	T* m_sortedRanges[ThreadDataCount / 2 + 1];
+	// The run positions where each merge task begins, with one row per merge task plus an end row.
+	uint32* m_splits;
 
-	uint16 m_sortedRangeCount;
-	uint16 m_nextPhase;
+	// Merge task cursors, one row per merge task.
+	uint32* m_cursors;
+
+	// Merge task heaps of runs, one row per merge task.
+	uint32* m_heaps;
+
+	// Keys sampled from the runs for choosing the merge ranges.
+	uint64* m_samples;
+
+	uint32 m_threadDataCount;
+	uint32 m_nextPhase;
 	uint32 m_outputCount;
 
 	T* m_outputBuffer;
 	T* m_workingBuffer;
+	T* m_sortedOutput;
+	b2SortKey* m_keyBuffer;
+	b2SortKey* m_keyScratchBuffer;
 
 	ThreadData* m_td;
 	Member ThreadData::* m_member;
-	Compare m_comp;
+	KeyFunc m_keyFunc;
 };
 
-// A thread data sorter that uses b2StackAllocator for output storage.
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount = b2_maxThreads>
+// A thread data sorter that uses b2StackAllocator for output and task storage.
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
 class b2StackAllocThreadDataSorter
 {
 public:
 	// Construct the sorter.
-	// Allocate output storage using allocator.
-	b2StackAllocThreadDataSorter(ThreadData* threadDataArray, Member ThreadData::* member,
-		Compare comp, b2StackAllocator& allocator);
+	// Allocate output and task storage using allocator.
+	b2StackAllocThreadDataSorter(ThreadData* threadDataArray, uint32 threadDataCount, Member ThreadData::* member,
+		KeyFunc keyFunc, b2StackAllocator& allocator);
 
 	// No copies.
 	b2StackAllocThreadDataSorter(b2StackAllocThreadDataSorter&) = delete;
@@ -237,166 +415,261 @@ public:
 	}
 
 private:
+	using Sorter = b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>;
 
-	b2ThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount> m_sorter;
+	Sorter m_sorter;
 	b2StackAllocator* m_allocator;
 	void* m_mem;
 };
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-b2ThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::b2ThreadDataSorter(ThreadData* td,
-		Member ThreadData::* member, T* outputDoubleBuffer, uint32 outputCount, Compare comp)
-	: m_sortedRangeCount(ThreadDataCount)
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::b2ThreadDataSorter(ThreadData* td, uint32 threadDataCount,
+		Member ThreadData::* member, void* workMemory, T* outputDoubleBuffer, b2SortKey* keyDoubleBuffer,
+		uint32 outputCount, KeyFunc keyFunc)
+	: m_threadDataCount(threadDataCount)
 	, m_nextPhase(e_threadDataSort)
 	, m_outputCount(outputCount)
 	, m_outputBuffer(outputDoubleBuffer)
 	, m_workingBuffer(outputDoubleBuffer + outputCount)
+	, m_sortedOutput(outputDoubleBuffer)
+	, m_keyBuffer(keyDoubleBuffer)
+	, m_keyScratchBuffer(keyDoubleBuffer + outputCount)
 	, m_td(td)
 	, m_member(member)
-	, m_comp(comp)
+	, m_keyFunc(keyFunc)
 {
+	b2Assert(threadDataCount > 0);
+	b2Assert(((uintptr_t)workMemory & (GetWorkMemoryAlignment() - 1)) == 0);
+
+	uint8* mem = (uint8*)workMemory;
+	m_sortTasks = (SortTask*)mem;
+	m_mergeTasks = (MergeTask*)(mem + GetMergeTasksOffset(threadDataCount));
+	m_runKeys = (b2SortKey**)(mem + GetRunKeysOffset(threadDataCount));
+	m_runOffsets = (uint32*)(mem + GetRunOffsetsOffset(threadDataCount));
+	m_splits = (uint32*)(mem + GetSplitsOffset(threadDataCount));
+	m_cursors = (uint32*)(mem + GetCursorsOffset(threadDataCount));
+	m_heaps = (uint32*)(mem + GetHeapsOffset(threadDataCount));
+	m_samples = (uint64*)(mem + GetSamplesOffset(threadDataCount));
+
+	for (uint32 i = 0; i < threadDataCount; ++i)
+	{
+		new (m_sortTasks + i) SortTask();
+		new (m_mergeTasks + i) MergeTask();
+	}
+}
 
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetMergeTasksOffset(uint32 threadDataCount)
+{
+	uint32 offset = threadDataCount * sizeof(SortTask);
+	return (offset + alignof(MergeTask) - 1) & ~(uint32)(alignof(MergeTask) - 1);
 }
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-void b2ThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::SubmitSortTask(
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetRunKeysOffset(uint32 threadDataCount)
+{
+	uint32 offset = GetMergeTasksOffset(threadDataCount) + threadDataCount * sizeof(MergeTask);
+	return (offset + alignof(b2SortKey*) - 1) & ~(uint32)(alignof(b2SortKey*) - 1);
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetRunOffsetsOffset(uint32 threadDataCount)
+{
+	return GetRunKeysOffset(threadDataCount) + threadDataCount * sizeof(b2SortKey*);
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetSplitsOffset(uint32 threadDataCount)
+{
+	return GetRunOffsetsOffset(threadDataCount) + (threadDataCount + 1) * sizeof(uint32);
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetCursorsOffset(uint32 threadDataCount)
+{
+	return GetSplitsOffset(threadDataCount) + (threadDataCount + 1) * threadDataCount * sizeof(uint32);
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetHeapsOffset(uint32 threadDataCount)
+{
+	return GetCursorsOffset(threadDataCount) + threadDataCount * threadDataCount * sizeof(uint32);
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetSamplesOffset(uint32 threadDataCount)
+{
+	uint32 offset = GetHeapsOffset(threadDataCount) + threadDataCount * threadDataCount * sizeof(uint32);
+	return (offset + alignof(uint64) - 1) & ~(uint32)(alignof(uint64) - 1);
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetWorkMemorySize(uint32 threadDataCount)
+{
+	uint32 size = GetSamplesOffset(threadDataCount) + threadDataCount * threadDataCount * sizeof(uint64);
+	return (size + GetWorkMemoryAlignment() - 1) & ~(GetWorkMemoryAlignment() - 1);
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+uint32 b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::GetWorkMemoryAlignment()
+{
+	return (uint32)b2Max(b2Max(alignof(SortTask), alignof(MergeTask)), b2Max(alignof(T), alignof(b2SortKey)));
+}
+
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+void b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::SubmitSortTask(
 	b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 {
 	switch(m_nextPhase)
 	{
 	case e_threadDataSort:
 		SubmitThreadDataSort(executor, taskGroup);
-		m_nextPhase = e_threadDataToBufferMerge;
-		break;
-	case e_threadDataToBufferMerge:
-		SubmitThreadDataToBufferMerge(executor, taskGroup);
-		m_nextPhase = e_clearThreadData;
 		break;
-	case e_clearThreadData:
-		for (uint32 i = 0; i < ThreadDataCount; ++i)
+	case e_merge:
+		// The thread data has been copied to the output buffer.
+		for (uint32 i = 0; i < m_threadDataCount; ++i)
 		{
 			(m_td[i].*m_member).clear();
 		}
-		m_nextPhase = e_bufferToBufferMerge;
-		// C++17 TODO: [[fallthrough]];
-		// The following comment prevents a warning in gcc.
-		// fall through
-	case e_bufferToBufferMerge:
-		SubmitBufferToBufferMerge(executor, taskGroup);
+		SubmitMerge(executor, taskGroup);
+		m_nextPhase = e_done;
+		break;
+	case e_done:
 		break;
 	default:
 		b2Assert(false);
 	}
 }
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-void b2ThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::SubmitThreadDataSort(
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+void b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::SubmitThreadDataSort(
 	b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 {
-	b2Assert(m_sortedRangeCount == ThreadDataCount);
-
-	if (m_outputCount <= 1)
+	if (m_outputCount == 0)
 	{
+		m_nextPhase = e_done;
 		return;
 	}
 
-	for (uint32 i = 0; i < ThreadDataCount; ++i)
+	uint32 sortCount = 0;
+	m_runOffsets[0] = 0;
+	for (uint32 i = 0; i < m_threadDataCount; ++i)
 	{
 		auto& m = m_td[i].*m_member;
+		uint32 offset = m_runOffsets[i];
+		m_runOffsets[i + 1] = offset + m.size();
+		m_runKeys[i] = nullptr;
 
-		m_sortTasks[i] = SortTask(m.begin(), m.end(), m_comp);
+		if (m.size() > 0)
+		{
+			m_sortTasks[sortCount++] = SortTask(m.data(), m.size(), m_outputBuffer + offset,
+				m_keyBuffer + offset, m_keyScratchBuffer + offset, m_runKeys + i, m_keyFunc);
+		}
 	}
+	b2Assert(m_runOffsets[m_threadDataCount] == m_outputCount);
 
-	b2SubmitTasks(executor, taskGroup, m_sortTasks, ThreadDataCount);
+	b2SubmitTasks(executor, taskGroup, m_sortTasks, sortCount);
+
+	m_nextPhase = e_merge;
 }
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-void b2ThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::SubmitThreadDataToBufferMerge(
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+void b2ThreadDataSorter<T, ThreadData, Member, KeyFunc>::SubmitMerge(
 	b2TaskExecutor& executor, b2TaskGroup* taskGroup)
 {
-	b2Assert(m_sortedRangeCount == ThreadDataCount);
-
-	if (m_outputCount == 0)
+	// Gather the non-empty runs.
+	uint32 runCount = 0;
+	for (uint32 i = 0; i < m_threadDataCount; ++i)
 	{
-		return;
+		if (m_runOffsets[i + 1] > m_runOffsets[i])
+		{
+			m_runOffsets[runCount] = m_runOffsets[i];
+			m_runKeys[runCount] = m_runKeys[i];
+			++runCount;
+		}
 	}
+	m_runOffsets[runCount] = m_outputCount;
 
-	// Initialize sorted ranges with the first output locations.
-	m_sortedRanges[0] = m_outputBuffer;
-	m_sortedRanges[ThreadDataCount / 2] = m_outputBuffer + m_outputCount;
-	for (uint32 i = 2; i < ThreadDataCount; i += 2)
+	// A single run is already sorted.
+	if (runCount <= 1)
 	{
-		const auto& mA = m_td[i - 1].*m_member;
-		const auto& mB = m_td[i - 2].*m_member;
-		const uint32 outputIndex = i / 2;
-
-		m_sortedRanges[outputIndex] = m_sortedRanges[outputIndex - 1] + mA.size() + mB.size();
+		m_sortedOutput = m_outputBuffer;
+		return;
 	}
 
-	for (uint32 i = 0; i < ThreadDataCount; i += 2)
+	// Use one merge task per run. Sample evenly spaced keys from every run and use every
+	// runCount-th sample as the beginning of a merge range. Each range begins at the lower bound
+	// of its key in every run, so equal keys are always merged by the same task.
+	const uint32 mergeCount = runCount;
+	uint32 sampleCount = 0;
+	for (uint32 r = 0; r < runCount; ++r)
 	{
-		auto& mA = m_td[i].*m_member;
-		auto& mB = m_td[i + 1].*m_member;
-		const uint32 outputIndex = i / 2;
-
-		m_mergeTasks[outputIndex] = MergeTask(mA.begin(), mA.end(), mB.begin(), mB.end(), m_sortedRanges[outputIndex], m_comp);
+		uint32 runSize = m_runOffsets[r + 1] - m_runOffsets[r];
+		for (uint32 q = 1; q < mergeCount; ++q)
+		{
+			m_samples[sampleCount++] = m_runKeys[r][(uint64)q * runSize / mergeCount].key;
+		}
 	}
-	b2SubmitTasks(executor, taskGroup, m_mergeTasks, ThreadDataCount / 2);
-
-	m_sortedRangeCount /= 2;
-}
+	std::sort(m_samples, m_samples + sampleCount);
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-void b2ThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::SubmitBufferToBufferMerge(
-	b2TaskExecutor& executor, b2TaskGroup* taskGroup)
-{
-	if (m_outputCount <= 1)
+	for (uint32 r = 0; r < runCount; ++r)
 	{
-		m_sortedRangeCount = 1;
-		return;
+		m_splits[r] = 0;
+		m_splits[mergeCount * runCount + r] = m_runOffsets[r + 1] - m_runOffsets[r];
 	}
-
-	if (m_sortedRangeCount > 1)
+	for (uint32 q = 1; q < mergeCount; ++q)
 	{
-		std::swap(m_outputBuffer, m_workingBuffer);
-
-		T* outputPtr = m_outputBuffer;
-		for (uint32 i = 0; i < m_sortedRangeCount; i += 2)
+		uint64 splitKey = m_samples[q * sampleCount / mergeCount];
+		for (uint32 r = 0; r < runCount; ++r)
 		{
-			const uint32 outputIndex = i / 2;
-
-			m_mergeTasks[outputIndex] = MergeTask(m_sortedRanges[i], m_sortedRanges[i + 1],
-				m_sortedRanges[i + 1], m_sortedRanges[i + 2], outputPtr, m_comp);
-
-			uint32 count = (uint32)(m_sortedRanges[i + 2] - m_sortedRanges[i]);
-			m_sortedRanges[outputIndex] = outputPtr;
-			outputPtr += count;
+			const b2SortKey* keys = m_runKeys[r];
+			uint32 runSize = m_runOffsets[r + 1] - m_runOffsets[r];
+			m_splits[q * runCount + r] = (uint32)(std::lower_bound(keys, keys + runSize, splitKey,
+				[](const b2SortKey& a, uint64 key) { return a.key < key; }) - keys);
 		}
-		m_sortedRangeCount /= 2;
-		m_sortedRanges[m_sortedRangeCount] = m_outputBuffer + m_outputCount;
+	}
 
-		b2SubmitTasks(executor, taskGroup, m_mergeTasks, m_sortedRangeCount);
+	for (uint32 i = 0; i < mergeCount; ++i)
+	{
+		m_mergeTasks[i] = MergeTask(runCount, m_runOffsets, m_runKeys, m_outputBuffer,
+			m_splits + i * runCount, m_splits + (i + 1) * runCount, m_cursors + i * runCount,
+			m_heaps + i * runCount, m_workingBuffer);
 	}
+
+	b2SubmitTasks(executor, taskGroup, m_mergeTasks, mergeCount);
+
+	m_sortedOutput = m_workingBuffer;
 }
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-b2StackAllocThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::b2StackAllocThreadDataSorter(
-	ThreadData* threadDataArray, Member ThreadData::* member, Compare comp, b2StackAllocator& allocator)
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+b2StackAllocThreadDataSorter<T, ThreadData, Member, KeyFunc>::b2StackAllocThreadDataSorter(
+	ThreadData* threadDataArray, uint32 threadDataCount, Member ThreadData::* member, KeyFunc keyFunc,
+	b2StackAllocator& allocator)
 	: m_allocator(&allocator)
 {
 	uint32 outputCount = 0;
-	for (int32 i = 0; i < b2_maxThreads; ++i)
+	for (uint32 i = 0; i < threadDataCount; ++i)
 	{
 		outputCount += (threadDataArray[i].*member).size();
 	}
-	m_mem = allocator.Allocate(2 * outputCount * sizeof(T));
 
-	m_sorter = b2ThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>(
-		threadDataArray, member, (T*)m_mem, outputCount, comp);
+	// Work memory comes first so that it can be aligned, followed by the output double buffer
+	// and the key double buffer.
+	const uint32 workSize = Sorter::GetWorkMemorySize(threadDataCount);
+	const uint32 alignment = Sorter::GetWorkMemoryAlignment();
+	const uint32 outputSize = (2 * outputCount * sizeof(T) + alignof(b2SortKey) - 1) & ~(uint32)(alignof(b2SortKey) - 1);
+	const uint32 keySize = 2 * outputCount * sizeof(b2SortKey);
+	m_mem = allocator.Allocate((int32)(alignment - 1 + workSize + outputSize + keySize));
+
+	uint8* workMemory = (uint8*)(((uintptr_t)m_mem + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	T* output = (T*)(workMemory + workSize);
+	b2SortKey* keys = (b2SortKey*)(workMemory + workSize + outputSize);
+
+	m_sorter = Sorter(threadDataArray, threadDataCount, member, workMemory, output, keys, outputCount, keyFunc);
 }
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-b2StackAllocThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::b2StackAllocThreadDataSorter(
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+b2StackAllocThreadDataSorter<T, ThreadData, Member, KeyFunc>::b2StackAllocThreadDataSorter(
 		b2StackAllocThreadDataSorter&& rhs)
 	: m_sorter(rhs.m_sorter)
 	, m_allocator(rhs.m_allocator)
@@ -405,8 +678,8 @@ b2StackAllocThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::b
 	rhs.m_mem = nullptr;
 }
 
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount>
-b2StackAllocThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::~b2StackAllocThreadDataSorter()
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+b2StackAllocThreadDataSorter<T, ThreadData, Member, KeyFunc>::~b2StackAllocThreadDataSorter()
 {
 	if (m_mem)
 	{
@@ -415,12 +688,13 @@ b2StackAllocThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>::~
 }
 
 // Convenience function to make a sorter with template argument deduction.
-template<typename T, typename ThreadData, typename Member, typename Compare, uint32 ThreadDataCount = b2_maxThreads>
-b2StackAllocThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>
-	b2MakeStackAllocThreadDataSorter(ThreadData* threadDataArray, Member ThreadData::* member, Compare comp,
-		b2StackAllocator& allocator)
+template<typename T, typename ThreadData, typename Member, typename KeyFunc>
+b2StackAllocThreadDataSorter<T, ThreadData, Member, KeyFunc>
+	b2MakeStackAllocThreadDataSorter(b2ThreadDataArray<ThreadData>& threadData, Member ThreadData::* member,
+		KeyFunc keyFunc, b2StackAllocator& allocator)
 {
-	return b2StackAllocThreadDataSorter<T, ThreadData, Member, Compare, ThreadDataCount>(threadDataArray, member, comp, allocator);
+	return b2StackAllocThreadDataSorter<T, ThreadData, Member, KeyFunc>(threadData.data(), threadData.size(),
+		member, keyFunc, allocator);
 }
 
 // Convenience function to run all sorting tasks and wait for them to finish.
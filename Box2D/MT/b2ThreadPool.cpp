@@ -63,6 +63,17 @@ void b2NonAtomicAdd(std::atomic<T>& a, U b)
 	a.store(value, std::memory_order_relaxed);
 }
 
+// Sort tasks by cost from highest to lowest.
+inline bool b2TaskCostGreaterThan(const b2Task* a, const b2Task* b)
+{
+	return a->GetCost() > b->GetCost();
+}
+
+// Identifies the pool that owns the current thread, so tasks submitted by a worker
+// are pushed onto that worker's deque. Threads outside of the pool use deque 0.
+static thread_local const b2ThreadPool* t_workerThreadPool = nullptr;
+static thread_local uint32 t_workerThreadId = 0;
+
 b2ThreadPoolTaskGroup::b2ThreadPoolTaskGroup(b2ThreadPool& threadPool)
 {
 	m_threadPool = &threadPool;
@@ -82,7 +93,6 @@ b2ThreadPool::b2ThreadPool(const b2ThreadPoolOptions& options)
 {
 	int32 totalThreadCount = options.totalThreadCount;
 
-	b2Assert(totalThreadCount <= b2_maxThreads);
 	b2Assert(totalThreadCount >= -1);
 
 	if (totalThreadCount == -1)
@@ -93,19 +103,22 @@ b2ThreadPool::b2ThreadPool(const b2ThreadPoolOptions& options)
 
 	m_lockMilliseconds = 0;
 	m_pendingTaskCount.store(0, std::memory_order_relaxed);
+	m_sleepingThreadCount.store(0, std::memory_order_relaxed);
 	m_busyWaitTimeout.store(options.busyWaitTimeoutMs, std::memory_order_relaxed);
-	m_signalShutdown = false;
+	m_workStealing = options.workStealing;
+	m_stackSize = options.stackSize;
+	m_largePageStacks = options.largePageStacks;
+	m_tracer.store(nullptr, std::memory_order_relaxed);
+	m_signalShutdown.store(false, std::memory_order_relaxed);
 
 	// This prevents DRD from generating false positive data races.
 	b2_drdIgnoreVar(m_pendingTaskCount);
+	b2_drdIgnoreVar(m_sleepingThreadCount);
 	b2_drdIgnoreVar(m_busyWaitTimeout);
+	b2_drdIgnoreVar(m_tracer);
+	b2_drdIgnoreVar(m_signalShutdown);
 
-	// Minus one for the user thread.
-	m_threadCount = b2Clamp(totalThreadCount - 1, 0, b2_maxThreads - 1);
-	for (uint32 i = 0; i < m_threadCount; ++i)
-	{
-		m_threads[i] = std::thread(&b2ThreadPool::WorkerMain, this, 1 + i);
-	}
+	Start(b2Max(totalThreadCount, 1));
 }
 
 b2ThreadPool::~b2ThreadPool()
@@ -120,6 +133,12 @@ void b2ThreadPool::SetBusyWaitTimeout(float32 busyWaitTimeoutMs)
 
 void b2ThreadPool::SubmitTasks(b2ThreadPoolTaskGroup& group, b2Task** tasks, uint32 count)
 {
+	if (m_workStealing)
+	{
+		PushTasks(group, tasks, count);
+		return;
+	}
+
 	b2_notifyLockScopeBegin
 		b2Timer lockTimer;
 		std::lock_guard<std::mutex> lk(m_mutex);
@@ -138,6 +157,12 @@ void b2ThreadPool::SubmitTasks(b2ThreadPoolTaskGroup& group, b2Task** tasks, uin
 
 void b2ThreadPool::SubmitTask(b2ThreadPoolTaskGroup& group, b2Task* task)
 {
+	if (m_workStealing)
+	{
+		PushTasks(group, &task, 1);
+		return;
+	}
+
 	b2_notifyLockScopeBegin
 		b2Timer lockTimer;
 		std::lock_guard<std::mutex> lk(m_mutex);
@@ -157,6 +182,14 @@ void b2ThreadPool::Wait(const b2ThreadPoolTaskGroup& group, const b2ThreadContex
 	// We don't expect worker threads to call wait.
 	b2Assert(context.threadId == 0);
 
+	b2TraceScope traceScope(m_tracer.load(std::memory_order_relaxed), "wait", b2TraceEvent::e_wait, context.threadId);
+
+	if (m_workStealing)
+	{
+		WaitStealing(group, context);
+		return;
+	}
+
 	b2Timer lockTimer;
 	std::unique_lock<std::mutex> lk(m_mutex);
 	m_lockMilliseconds += lockTimer.GetMilliseconds();
@@ -187,7 +220,7 @@ void b2ThreadPool::Wait(const b2ThreadPoolTaskGroup& group, const b2ThreadContex
 
 		lk.unlock();
 
-		task->Execute(context);
+		ExecuteTask(task, context);
 
 		lockTimer.Reset();
 		lk.lock();
@@ -205,11 +238,43 @@ void b2ThreadPool::Restart(uint32 threadCount)
 	float32 busyWaitTimeout = m_busyWaitTimeout.load(std::memory_order_relaxed);
 
 	Shutdown();
-	m_signalShutdown = false;
+	m_signalShutdown.store(false, std::memory_order_relaxed);
+
+	m_busyWaitTimeout.store(busyWaitTimeout, std::memory_order_relaxed);
+
+	Start(threadCount);
+}
+
+void b2ThreadPool::SetWorkStealing(bool flag)
+{
+	if (flag == m_workStealing)
+	{
+		return;
+	}
+
+	// The workers must be stopped while the mode changes.
+	uint32 threadCount = GetThreadCount();
+	float32 busyWaitTimeout = m_busyWaitTimeout.load(std::memory_order_relaxed);
+
+	Shutdown();
+	m_signalShutdown.store(false, std::memory_order_relaxed);
 
 	m_busyWaitTimeout.store(busyWaitTimeout, std::memory_order_relaxed);
+	m_workStealing = flag;
 
-	m_threadCount = b2Clamp((int32)threadCount - 1, 0, b2_maxThreads - 1);
+	Start(threadCount);
+}
+
+void b2ThreadPool::Start(uint32 threadCount)
+{
+	// Minus one for the user thread.
+	m_threadCount = b2Max((int32)threadCount - 1, 0);
+	m_threads.resize(m_threadCount);
+	m_perThreadData.resize(m_threadCount + 1);
+	for (uint32 i = 0; i < m_threadCount + 1; ++i)
+	{
+		m_perThreadData[i].m_stackMallocCount.store(0, std::memory_order_relaxed);
+	}
 	for (uint32 i = 0; i < m_threadCount; ++i)
 	{
 		m_threads[i] = std::thread(&b2ThreadPool::WorkerMain, this, 1 + i);
@@ -228,14 +293,56 @@ b2Task* b2ThreadPool::PopTask()
 	return task;
 }
 
+void b2ThreadPool::ExecuteTask(b2Task* task, const b2ThreadContext& context)
+{
+	b2Tracer* tracer = m_tracer.load(std::memory_order_relaxed);
+	if (tracer == nullptr)
+	{
+		task->Execute(context);
+	}
+	else
+	{
+		b2TraceEvent event;
+		event.name = nullptr;
+		event.taskType = task->GetType();
+		event.cost = task->GetCost();
+		event.kind = b2TraceEvent::e_task;
+		event.begin = b2Timer::GetNanoseconds();
+
+		task->Execute(context);
+
+		event.end = b2Timer::GetNanoseconds();
+		tracer->Record(context.threadId, event);
+	}
+
+	// Publish the worker's stack overflows before the task is marked complete, so they're visible
+	// to the thread that waits on the group. The submitting thread's stack isn't owned by the pool.
+	if (context.threadId != 0)
+	{
+		int32 mallocCount = context.stack->GetMallocCount();
+		m_perThreadData[context.threadId].m_stackMallocCount.store(mallocCount, std::memory_order_relaxed);
+	}
+}
+
 void b2ThreadPool::WorkerMain(uint32 threadId)
 {
 	b2StackAllocator stack;
+	stack.SetLargePages(m_largePageStacks);
+	stack.Reserve(m_stackSize);
 
 	b2ThreadContext context;
 	context.stack = &stack;
 	context.threadId = threadId;
 
+	t_workerThreadPool = this;
+	t_workerThreadId = threadId;
+
+	if (m_workStealing)
+	{
+		WorkerMainStealing(context);
+		return;
+	}
+
 	b2Timer lockTimer;
 	std::unique_lock<std::mutex> lk(m_mutex);
 
@@ -272,14 +379,14 @@ void b2ThreadPool::WorkerMain(uint32 threadId)
 				{
 					return true;
 				}
-				if (m_signalShutdown)
+				if (m_signalShutdown.load(std::memory_order_relaxed))
 				{
 					return true;
 				}
 				return false;
 			});
 
-			if (m_signalShutdown)
+			if (m_signalShutdown.load(std::memory_order_relaxed))
 			{
 				// Shutting down in the middle of processing tasks is not supported.
 				b2Assert(m_pendingTaskCount.load(std::memory_order_relaxed) == 0);
@@ -292,7 +399,7 @@ void b2ThreadPool::WorkerMain(uint32 threadId)
 
 		lk.unlock();
 
-		task->Execute(context);
+		ExecuteTask(task, context);
 
 		lockTimer.Reset();
 		lk.lock();
@@ -302,12 +409,191 @@ void b2ThreadPool::WorkerMain(uint32 threadId)
 	}
 }
 
+uint32 b2ThreadPool::GetSubmitThreadId() const
+{
+	return t_workerThreadPool == this ? t_workerThreadId : 0;
+}
+
+void b2ThreadPool::PushTasks(b2ThreadPoolTaskGroup& group, b2Task** tasks, uint32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	PerThreadData& td = m_perThreadData[GetSubmitThreadId()];
+
+	// Count the tasks before they can be taken by another thread.
+	group.m_remainingTasks.fetch_add(count, std::memory_order_relaxed);
+	m_pendingTaskCount.fetch_add(count, std::memory_order_seq_cst);
+
+	// Thieves take from the top of the deque, so the most expensive tasks are pushed first.
+	bool isSorted = true;
+	for (uint32 i = 1; i < count; ++i)
+	{
+		if (tasks[i - 1]->GetCost() < tasks[i]->GetCost())
+		{
+			isSorted = false;
+			break;
+		}
+	}
+
+	if (isSorted == false)
+	{
+		td.m_submitBuffer.assign(tasks, tasks + count);
+		std::stable_sort(td.m_submitBuffer.begin(), td.m_submitBuffer.end(), b2TaskCostGreaterThan);
+		tasks = td.m_submitBuffer.data();
+	}
+
+	// The owner pops from the bottom, so the most expensive task is pushed last to start it right
+	// away. Popping from the top instead would run the oldest task of the deque, which can belong
+	// to an outer group when tasks are submitted from a task.
+	for (uint32 i = 1; i < count; ++i)
+	{
+		td.m_deque.Push(tasks[i]);
+	}
+	td.m_deque.Push(tasks[0]);
+
+	// The mutex is only needed to wake sleeping workers.
+	if (m_sleepingThreadCount.load(std::memory_order_seq_cst) > 0)
+	{
+		b2_notifyLockScopeBegin
+			b2Timer lockTimer;
+			std::lock_guard<std::mutex> lk(m_mutex);
+			m_lockMilliseconds += lockTimer.GetMilliseconds();
+		b2_notifyLockScopeEnd
+		if (count == 1)
+		{
+			m_waitingForTasks.notify_one();
+		}
+		else
+		{
+			m_waitingForTasks.notify_all();
+		}
+	}
+}
+
+b2Task* b2ThreadPool::TakeTask(uint32 threadId)
+{
+	// Prefer our own tasks, then steal from the other threads.
+	b2Task* task = m_perThreadData[threadId].m_deque.Pop();
+	if (task == nullptr)
+	{
+		uint32 threadCount = GetThreadCount();
+		for (uint32 i = 1; i < threadCount && task == nullptr; ++i)
+		{
+			uint32 victim = (threadId + i) % threadCount;
+			task = m_perThreadData[victim].m_deque.Steal();
+
+			b2Tracer* tracer = m_tracer.load(std::memory_order_relaxed);
+			if (task && tracer)
+			{
+				b2TraceEvent event;
+				event.begin = b2Timer::GetNanoseconds();
+				event.end = event.begin;
+				event.name = nullptr;
+				event.taskType = task->GetType();
+				event.cost = victim;
+				event.kind = b2TraceEvent::e_steal;
+				tracer->Record(threadId, event);
+			}
+		}
+	}
+
+	if (task)
+	{
+		m_pendingTaskCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	return task;
+}
+
+void b2ThreadPool::WaitStealing(const b2ThreadPoolTaskGroup& group, const b2ThreadContext& context)
+{
+	b2Assert(context.threadId == GetSubmitThreadId());
+
+	while (group.m_remainingTasks.load(std::memory_order_acquire) > 0)
+	{
+		// Execute a task while waiting.
+		b2Task* task = TakeTask(context.threadId);
+		if (task == nullptr)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		ExecuteTask(task, context);
+
+		// This isn't necessarily the group we're waiting on.
+		b2ThreadPoolTaskGroup* executeGroup = static_cast<b2ThreadPoolTaskGroup*>(task->GetTaskGroup());
+		executeGroup->m_remainingTasks.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+void b2ThreadPool::WorkerMainStealing(const b2ThreadContext& context)
+{
+	b2Timer waitTimer;
+
+	while (true)
+	{
+		b2Task* task = TakeTask(context.threadId);
+		if (task)
+		{
+			b2ThreadPoolTaskGroup* group = static_cast<b2ThreadPoolTaskGroup*>(task->GetTaskGroup());
+
+			ExecuteTask(task, context);
+
+			group->m_remainingTasks.fetch_sub(1, std::memory_order_release);
+			waitTimer.Reset();
+			continue;
+		}
+
+		if (m_pendingTaskCount.load(std::memory_order_relaxed) > 0 ||
+			waitTimer.GetMilliseconds() <= m_busyWaitTimeout.load(std::memory_order_relaxed))
+		{
+			// Busy wait. Pending tasks might not be pushed yet, or another thread took them first.
+			std::this_thread::yield();
+			continue;
+		}
+
+		b2Timer lockTimer;
+		std::unique_lock<std::mutex> lk(m_mutex);
+		m_lockMilliseconds += lockTimer.GetMilliseconds();
+
+		// The submitter checks the sleeping count after adding to the pending count, so either
+		// we see the pending task here or the submitter sees us sleeping and notifies us.
+		m_sleepingThreadCount.fetch_add(1, std::memory_order_seq_cst);
+		m_waitingForTasks.wait(lk, [this]()
+		{
+			if (m_pendingTaskCount.load(std::memory_order_seq_cst) > 0)
+			{
+				return true;
+			}
+			if (m_signalShutdown.load(std::memory_order_relaxed))
+			{
+				return true;
+			}
+			return false;
+		});
+		m_sleepingThreadCount.fetch_sub(1, std::memory_order_relaxed);
+
+		if (m_signalShutdown.load(std::memory_order_relaxed))
+		{
+			// Shutting down in the middle of processing tasks is not supported.
+			b2Assert(m_pendingTaskCount.load(std::memory_order_relaxed) == 0);
+			return;
+		}
+
+		waitTimer.Reset();
+	}
+}
+
 void b2ThreadPool::Shutdown()
 {
 	{
 		b2_notifyLockScopeBegin
 			std::lock_guard<std::mutex> lk(m_mutex);
-			m_signalShutdown = true;
+			m_signalShutdown.store(true, std::memory_order_relaxed);
 			m_busyWaitTimeout.store(0, std::memory_order_relaxed);
 		b2_notifyLockScopeEnd
 		m_waitingForTasks.notify_all();
@@ -361,7 +647,6 @@ void b2ThreadPoolTaskExecutor::ReleaseTaskGroup(b2TaskGroup* taskGroup)
 
 void b2ThreadPoolTaskExecutor::PartitionRange(b2Task::Type type, uint32 begin, uint32 end, b2PartitionedRange& output)
 {
-	static_assert(b2_maxThreads <= b2_maxRangeSubTasks, "Increase b2_maxRangeSubTasks.");
 	b2Assert(b2IsRangeTask(type) || type >= b2Task::e_userTask);
 	b2Assert(type < b2Task::e_rangeTypeCount || type >= b2Task::e_userTask);
 
@@ -22,6 +22,9 @@
 #include "Box2D/Common/b2GrowableArray.h"
 #include "Box2D/Common/b2Timer.h"
 #include "Box2D/MT/b2MtUtil.h"
+#include "Box2D/MT/b2ThreadDataArray.h"
+#include "Box2D/MT/b2Tracer.h"
+#include "Box2D/MT/b2WorkStealingDeque.h"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -36,6 +39,9 @@ struct b2ThreadPoolOptions
 	{
 		totalThreadCount = -1;
 		busyWaitTimeoutMs = 0.03f;
+		workStealing = false;
+		stackSize = b2_stackSize;
+		largePageStacks = false;
 	}
 
 	/// The number of threads to make available for execution. This includes
@@ -46,6 +52,18 @@ struct b2ThreadPoolOptions
 	/// The number of milliseconds that a worker thread will busy wait before
 	/// waiting on a condition variable.
 	float32 busyWaitTimeoutMs;
+
+	/// Use a lock-free deque per thread instead of a single task heap that is
+	/// protected by a mutex. Idle threads steal tasks from the other threads' deques.
+	bool workStealing;
+
+	/// The initial size in bytes of each worker thread's stack allocator. Stack allocations that
+	/// don't fit use b2Alloc until the stack grows to the peak, so raise this if large islands are
+	/// solved on worker threads and the first steps shouldn't use b2Alloc.
+	int32 stackSize;
+
+	/// Back the worker threads' stack allocators with large pages when the platform allows it.
+	bool largePageStacks;
 };
 
 /// A task group is used to wait for completion of a group of tasks.
@@ -100,6 +118,11 @@ public:
 	/// @warning must only be called from a single thread while no tasks are being executed.
 	float32 GetLockMilliseconds() const;
 
+	/// The number of times the worker threads' stack allocators have used b2Alloc.
+	/// The count starts over when the worker threads are restarted.
+	/// @warning must only be called from a single thread while no tasks are being executed.
+	int32 GetStackMallocCount() const;
+
 	/// Reset the lock timer.
 	/// @warning must only be called from a single thread while no tasks are being executed.
 	void ResetTimers();
@@ -108,12 +131,51 @@ public:
 	/// @warning must only be called from a single thread while no tasks are being executed.
 	void Restart(uint32 threadCount);
 
+	/// Enable/disable work stealing. This restarts the worker threads if the mode changes.
+	/// In work stealing mode, tasks submitted together are ordered by cost so that other threads
+	/// steal the most expensive tasks first. The submitting thread starts with the most expensive
+	/// task. Tasks submitted separately are stolen in submission order.
+	/// @warning must only be called from a single thread while no tasks are being executed.
+	void SetWorkStealing(bool flag);
+
+	/// Is work stealing enabled?
+	bool IsWorkStealing() const;
+
+	/// Record executed tasks, waits and steals into a tracer, or stop recording with nullptr.
+	/// @warning must only be called from a single thread while no tasks are being executed.
+	void SetTracer(b2Tracer* tracer);
+
+	/// Get the tracer, or nullptr if tasks aren't being recorded.
+	b2Tracer* GetTracer() const;
+
 private:
+	struct PerThreadData
+	{
+		// Owned by this thread, stolen from by other threads.
+		b2WorkStealingDeque m_deque;
+
+		// Used to sort tasks by cost before they're pushed.
+		b2GrowableArray<b2Task*> m_submitBuffer;
+
+		// The stack allocator's malloc count after the thread's last task.
+		std::atomic<int32> m_stackMallocCount;
+
+		uint8 _padding[b2_cacheLineSize];
+	};
+
 	b2Task* PopTask();
+	void ExecuteTask(b2Task* task, const b2ThreadContext& ctx);
 	void WorkerMain(uint32 threadId);
 	void Shutdown();
+	void Start(uint32 threadCount);
+
+	uint32 GetSubmitThreadId() const;
+	void PushTasks(b2ThreadPoolTaskGroup& group, b2Task** tasks, uint32 count);
+	b2Task* TakeTask(uint32 threadId);
+	void WaitStealing(const b2ThreadPoolTaskGroup& group, const b2ThreadContext& ctx);
+	void WorkerMainStealing(const b2ThreadContext& ctx);
 
-	std::thread m_threads[b2_maxThreads - 1];
+	b2ThreadDataArray<std::thread> m_threads;
 	uint32 m_threadCount;
 
 	std::atomic<float32> m_busyWaitTimeout;
@@ -126,7 +188,16 @@ private:
 	// A heap of tasks sorted by cost.
 	b2GrowableArray<b2Task*> m_taskHeap;
 
-	bool m_signalShutdown;
+	// Used instead of the task heap when work stealing is enabled.
+	b2ThreadDataArray<PerThreadData> m_perThreadData;
+	std::atomic<int32> m_sleepingThreadCount;
+	bool m_workStealing;
+	int32 m_stackSize;
+	bool m_largePageStacks;
+
+	std::atomic<b2Tracer*> m_tracer;
+
+	std::atomic<bool> m_signalShutdown;
 };
 
 /// A task executor that uses b2ThreadPool.
@@ -162,6 +233,9 @@ public:
 	/// Wait for all tasks in the group to finish.
 	void Wait(b2TaskGroup* taskGroup, const b2ThreadContext& ctx) override;
 
+	/// The number of times the worker threads' stack allocators have used b2Alloc.
+	int32 GetStackMallocCount() const override;
+
 private:
 	b2ThreadPool m_threadPool;
 	b2ThreadPoolTaskGroup m_taskGroups[b2_maxWorldStepTaskGroups];
@@ -179,12 +253,37 @@ inline int32 b2ThreadPool::GetThreadCount() const
 	return m_threadCount + 1;
 }
 
+inline bool b2ThreadPool::IsWorkStealing() const
+{
+	return m_workStealing;
+}
+
+inline void b2ThreadPool::SetTracer(b2Tracer* tracer)
+{
+	m_tracer.store(tracer, std::memory_order_relaxed);
+}
+
+inline b2Tracer* b2ThreadPool::GetTracer() const
+{
+	return m_tracer.load(std::memory_order_relaxed);
+}
+
 inline float32 b2ThreadPool::GetLockMilliseconds() const
 {
 	std::lock_guard<std::mutex> lk(m_mutex);
 	return m_lockMilliseconds;
 }
 
+inline int32 b2ThreadPool::GetStackMallocCount() const
+{
+	int32 count = 0;
+	for (uint32 i = 1; i < m_perThreadData.size(); ++i)
+	{
+		count += m_perThreadData[i].m_stackMallocCount.load(std::memory_order_relaxed);
+	}
+	return count;
+}
+
 inline void b2ThreadPool::ResetTimers()
 {
 	std::lock_guard<std::mutex> lk(m_mutex);
@@ -216,4 +315,9 @@ inline uint32 b2ThreadPoolTaskExecutor::GetThreadCount() const
 	return m_threadPool.GetThreadCount();
 }
 
+inline int32 b2ThreadPoolTaskExecutor::GetStackMallocCount() const
+{
+	return m_threadPool.GetStackMallocCount();
+}
+
 #endif
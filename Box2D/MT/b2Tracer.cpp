@@ -0,0 +1,160 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Box2D/MT/b2Tracer.h"
+#include <cstdio>
+
+b2Tracer::PerThreadData::PerThreadData()
+{
+	m_events = nullptr;
+	m_capacity = 0;
+	m_next = 0;
+	m_count = 0;
+}
+
+b2Tracer::PerThreadData::~PerThreadData()
+{
+	b2Free(m_events);
+}
+
+b2Tracer::b2Tracer(uint32 threadCount, uint32 eventsPerThread)
+{
+	b2Assert(threadCount > 0);
+	b2Assert(eventsPerThread > 0);
+
+	m_perThreadData.resize(threadCount);
+	for (uint32 i = 0; i < threadCount; ++i)
+	{
+		PerThreadData& td = m_perThreadData[i];
+		td.m_events = (b2TraceEvent*)b2Alloc(eventsPerThread * sizeof(b2TraceEvent));
+		td.m_capacity = eventsPerThread;
+	}
+}
+
+b2Tracer::~b2Tracer()
+{
+}
+
+void b2Tracer::Clear()
+{
+	for (uint32 i = 0; i < m_perThreadData.size(); ++i)
+	{
+		m_perThreadData[i].m_next = 0;
+		m_perThreadData[i].m_count = 0;
+	}
+}
+
+bool b2Tracer::WriteChromeTrace(const char* path) const
+{
+	FILE* file = fopen(path, "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	// Timestamps are written in microseconds relative to the oldest event.
+	uint64 origin = UINT64_MAX;
+	for (uint32 i = 0; i < GetThreadCount(); ++i)
+	{
+		for (uint32 j = 0; j < GetEventCount(i); ++j)
+		{
+			origin = b2Min(origin, GetEvent(i, j).begin);
+		}
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for (uint32 i = 0; i < GetThreadCount(); ++i)
+	{
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+			i > 0 ? ",\n" : "", i, i);
+	}
+
+	for (uint32 i = 0; i < GetThreadCount(); ++i)
+	{
+		for (uint32 j = 0; j < GetEventCount(i); ++j)
+		{
+			const b2TraceEvent& e = GetEvent(i, j);
+			float64 ts = 0.001 * float64(e.begin - origin);
+			float64 dur = 0.001 * float64(e.end - e.begin);
+			const char* taskName = e.taskType >= 0 ? b2GetTaskTypeName((b2Task::Type)e.taskType) : "";
+
+			switch (e.kind)
+			{
+			case b2TraceEvent::e_task:
+				fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"task\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"cost\":%u}}",
+					taskName, ts, dur, i, e.cost);
+				break;
+
+			case b2TraceEvent::e_stage:
+				fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+					e.name, ts, dur, i);
+				break;
+
+			case b2TraceEvent::e_wait:
+				fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"wait\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+					e.name, ts, dur, i);
+				break;
+
+			case b2TraceEvent::e_steal:
+				fprintf(file, ",\n{\"name\":\"steal\",\"cat\":\"steal\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,\"args\":{\"task\":\"%s\",\"victim\":%u}}",
+					ts, i, taskName, e.cost);
+				break;
+			}
+		}
+	}
+
+	fprintf(file, "\n]}\n");
+
+	bool ok = ferror(file) == 0;
+	ok = fclose(file) == 0 && ok;
+	return ok;
+}
+
+const char* b2GetTaskTypeName(b2Task::Type type)
+{
+	switch (type)
+	{
+	case b2Task::e_broadPhaseFindContacts: return "broadPhaseFindContacts";
+	case b2Task::e_broadPhaseSyncFixtures: return "broadPhaseSyncFixtures";
+	case b2Task::e_clearContactSolveFlags: return "clearContactSolveFlags";
+	case b2Task::e_clearContactSolveToiFlags: return "clearContactSolveToiFlags";
+	case b2Task::e_clearBodySolveFlags: return "clearBodySolveFlags";
+	case b2Task::e_clearBodySolveToiFlags: return "clearBodySolveToiFlags";
+	case b2Task::e_clearForces: return "clearForces";
+	case b2Task::e_collide: return "collide";
+	case b2Task::e_findMinToiContact: return "findMinToiContact";
+	case b2Task::e_resetIslandSets: return "resetIslandSets";
+	case b2Task::e_uniteIslandSets: return "uniteIslandSets";
+	case b2Task::e_findIslandSeeds: return "findIslandSeeds";
+	case b2Task::e_activateIslandContacts: return "activateIslandContacts";
+	case b2Task::e_buildIslands: return "buildIslands";
+	case b2Task::e_solveVelocityConstraints: return "solveVelocityConstraints";
+	case b2Task::e_solvePositionConstraints: return "solvePositionConstraints";
+	case b2Task::e_queryAABB: return "queryAABB";
+	case b2Task::e_rayCast: return "rayCast";
+	case b2Task::e_moveProxies: return "moveProxies";
+	case b2Task::e_findToiEvents: return "findToiEvents";
+	case b2Task::e_solveToiEvents: return "solveToiEvents";
+	case b2Task::e_buildTree: return "buildTree";
+	case b2Task::e_merge: return "merge";
+	case b2Task::e_solve: return "solve";
+	case b2Task::e_sort: return "sort";
+	default: return "userTask";
+	}
+}
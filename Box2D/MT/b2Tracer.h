@@ -0,0 +1,193 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TRACER_H
+#define B2_TRACER_H
+
+#include "Box2D/Common/b2Math.h"
+#include "Box2D/Common/b2Timer.h"
+#include "Box2D/MT/b2Task.h"
+#include "Box2D/MT/b2ThreadDataArray.h"
+
+/// Something that a thread did, recorded by b2Tracer.
+struct b2TraceEvent
+{
+	enum Kind
+	{
+		/// A task was executed.
+		e_task,
+		/// A stage of a world step, such as the collide or solve stage.
+		e_stage,
+		/// A thread waited for a task group to finish. Tasks executed while waiting are nested in it.
+		e_wait,
+		/// A task was stolen from another thread's deque. Steals have no duration.
+		e_steal
+	};
+
+	/// Timestamps from b2Timer::GetNanoseconds.
+	uint64 begin;
+	uint64 end;
+
+	/// The stage name. Tasks are named by their type.
+	const char* name;
+
+	/// The task type, or for steals the type of the stolen task.
+	int32 taskType;
+
+	/// The task's cost estimate, or for steals the id of the thread that was stolen from.
+	uint32 cost;
+
+	Kind kind;
+};
+
+/// Records the stages of world steps and the tasks executed by each thread into per-thread
+/// ring buffers, to find load imbalance and idle time. Give a tracer to b2World::SetTracer
+/// and b2ThreadPool::SetTracer, step, then export the events with WriteChromeTrace.
+/// Each thread only writes to its own buffer, so recording doesn't lock. When a buffer is
+/// full its oldest events are overwritten.
+class b2Tracer
+{
+public:
+	/// Construct a tracer that records events from threads with ids below threadCount.
+	/// Events from other threads are ignored.
+	b2Tracer(uint32 threadCount, uint32 eventsPerThread = 16384);
+
+	~b2Tracer();
+
+	b2Tracer(const b2Tracer&) = delete;
+	b2Tracer& operator=(const b2Tracer&) = delete;
+
+	/// Record an event. This must only be called by the thread with the given id.
+	void Record(uint32 threadId, const b2TraceEvent& event);
+
+	/// Discard all recorded events.
+	/// @warning must only be called while no events are being recorded.
+	void Clear();
+
+	/// Get the number of threads that events are recorded for.
+	uint32 GetThreadCount() const;
+
+	/// Get the number of events recorded for a thread.
+	uint32 GetEventCount(uint32 threadId) const;
+
+	/// Get an event recorded for a thread. Events are ordered from oldest to newest.
+	/// @warning must only be called while no events are being recorded.
+	const b2TraceEvent& GetEvent(uint32 threadId, uint32 index) const;
+
+	/// Write the recorded events as Chrome trace event JSON, which can be viewed with
+	/// chrome://tracing or Perfetto. Returns false if the file couldn't be written.
+	/// @warning must only be called while no events are being recorded.
+	bool WriteChromeTrace(const char* path) const;
+
+private:
+	struct PerThreadData
+	{
+		PerThreadData();
+		~PerThreadData();
+
+		b2TraceEvent* m_events;
+		uint32 m_capacity;
+		uint32 m_next;
+		uint32 m_count;
+
+		uint8 _padding[b2_cacheLineSize];
+	};
+
+	b2ThreadDataArray<PerThreadData> m_perThreadData;
+};
+
+/// Records a stage or wait for as long as it's in scope. Stages are recorded on the user
+/// thread by default. Does nothing if the tracer is null.
+class b2TraceScope
+{
+public:
+	b2TraceScope(b2Tracer* tracer, const char* name,
+		b2TraceEvent::Kind kind = b2TraceEvent::e_stage, uint32 threadId = 0);
+	~b2TraceScope();
+
+	b2TraceScope(const b2TraceScope&) = delete;
+	b2TraceScope& operator=(const b2TraceScope&) = delete;
+
+private:
+	b2Tracer* m_tracer;
+	const char* m_name;
+	uint64 m_begin;
+	b2TraceEvent::Kind m_kind;
+	uint32 m_threadId;
+};
+
+/// Get the name of a task type.
+const char* b2GetTaskTypeName(b2Task::Type type);
+
+inline void b2Tracer::Record(uint32 threadId, const b2TraceEvent& event)
+{
+	if (threadId >= m_perThreadData.size())
+	{
+		return;
+	}
+
+	PerThreadData& td = m_perThreadData[threadId];
+	td.m_events[td.m_next] = event;
+	td.m_next = td.m_next + 1 < td.m_capacity ? td.m_next + 1 : 0;
+	td.m_count = b2Min(td.m_count + 1, td.m_capacity);
+}
+
+inline uint32 b2Tracer::GetThreadCount() const
+{
+	return m_perThreadData.size();
+}
+
+inline uint32 b2Tracer::GetEventCount(uint32 threadId) const
+{
+	return m_perThreadData[threadId].m_count;
+}
+
+inline const b2TraceEvent& b2Tracer::GetEvent(uint32 threadId, uint32 index) const
+{
+	const PerThreadData& td = m_perThreadData[threadId];
+	b2Assert(index < td.m_count);
+	uint32 oldest = td.m_count < td.m_capacity ? 0 : td.m_next;
+	uint32 i = oldest + index;
+	return td.m_events[i < td.m_capacity ? i : i - td.m_capacity];
+}
+
+inline b2TraceScope::b2TraceScope(b2Tracer* tracer, const char* name, b2TraceEvent::Kind kind, uint32 threadId)
+	: m_tracer(tracer)
+	, m_name(name)
+	, m_begin(tracer ? b2Timer::GetNanoseconds() : 0)
+	, m_kind(kind)
+	, m_threadId(threadId)
+{
+}
+
+inline b2TraceScope::~b2TraceScope()
+{
+	if (m_tracer)
+	{
+		b2TraceEvent event;
+		event.begin = m_begin;
+		event.end = b2Timer::GetNanoseconds();
+		event.name = m_name;
+		event.taskType = -1;
+		event.cost = 0;
+		event.kind = m_kind;
+		m_tracer->Record(m_threadId, event);
+	}
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "Box2D/MT/b2WorkStealingDeque.h"
+#include <new>
+
+// Based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Le, Pop, Cohen, Nardelli).
+
+static const int64 b2_initialDequeCapacity = 64;
+
+b2WorkStealingDeque::b2WorkStealingDeque()
+{
+	m_top.store(0, std::memory_order_relaxed);
+	m_bottom.store(0, std::memory_order_relaxed);
+	m_buffer.store(CreateBuffer(b2_initialDequeCapacity, nullptr), std::memory_order_relaxed);
+}
+
+b2WorkStealingDeque::~b2WorkStealingDeque()
+{
+	Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+	while (buffer)
+	{
+		Buffer* retired = buffer->retired;
+		b2Free(buffer->tasks);
+		b2Free(buffer);
+		buffer = retired;
+	}
+}
+
+b2WorkStealingDeque::Buffer* b2WorkStealingDeque::CreateBuffer(int64 capacity, Buffer* retired)
+{
+	// The capacity must be a power of 2.
+	b2Assert((capacity & (capacity - 1)) == 0);
+
+	Buffer* buffer = (Buffer*)b2Alloc(sizeof(Buffer));
+	buffer->capacity = capacity;
+	buffer->tasks = (std::atomic<b2Task*>*)b2Alloc((int32)(capacity * sizeof(std::atomic<b2Task*>)));
+	for (int64 i = 0; i < capacity; ++i)
+	{
+		new (buffer->tasks + i) std::atomic<b2Task*>(nullptr);
+	}
+	buffer->retired = retired;
+	return buffer;
+}
+
+b2WorkStealingDeque::Buffer* b2WorkStealingDeque::Grow(Buffer* buffer, int64 top, int64 bottom)
+{
+	Buffer* newBuffer = CreateBuffer(2 * buffer->capacity, buffer);
+	for (int64 i = top; i < bottom; ++i)
+	{
+		b2Task* task = buffer->tasks[i & (buffer->capacity - 1)].load(std::memory_order_relaxed);
+		newBuffer->tasks[i & (newBuffer->capacity - 1)].store(task, std::memory_order_relaxed);
+	}
+	m_buffer.store(newBuffer, std::memory_order_release);
+	return newBuffer;
+}
+
+void b2WorkStealingDeque::Push(b2Task* task)
+{
+	int64 bottom = m_bottom.load(std::memory_order_relaxed);
+	int64 top = m_top.load(std::memory_order_acquire);
+	Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+	if (bottom - top > buffer->capacity - 1)
+	{
+		buffer = Grow(buffer, top, bottom);
+	}
+
+	buffer->tasks[bottom & (buffer->capacity - 1)].store(task, std::memory_order_relaxed);
+	m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+b2Task* b2WorkStealingDeque::Pop()
+{
+	int64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+	m_bottom.store(bottom, std::memory_order_release);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// The deque was empty.
+		m_bottom.store(bottom + 1, std::memory_order_release);
+		return nullptr;
+	}
+
+	b2Task* task = buffer->tasks[bottom & (buffer->capacity - 1)].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// This is the last task, so we must race with thieves for it.
+		if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+		{
+			task = nullptr;
+		}
+		m_bottom.store(bottom + 1, std::memory_order_release);
+	}
+	return task;
+}
+
+b2Task* b2WorkStealingDeque::Steal()
+{
+	int64 top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	Buffer* buffer = m_buffer.load(std::memory_order_acquire);
+	b2Task* task = buffer->tasks[top & (buffer->capacity - 1)].load(std::memory_order_relaxed);
+	if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+	{
+		// Lost the race with another thief or the owner.
+		return nullptr;
+	}
+	return task;
+}
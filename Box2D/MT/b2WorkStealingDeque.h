@@ -0,0 +1,70 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_WORK_STEALING_DEQUE_H
+#define B2_WORK_STEALING_DEQUE_H
+
+#include "Box2D/Common/b2Settings.h"
+#include <atomic>
+
+class b2Task;
+
+/// A lock-free deque of tasks (Chase-Lev).
+/// The owning thread pushes and pops at the bottom, other threads steal from the top.
+class b2WorkStealingDeque
+{
+public:
+	b2WorkStealingDeque();
+	~b2WorkStealingDeque();
+
+	/// Push a task onto the bottom of the deque.
+	/// @warning must only be called by the owning thread.
+	void Push(b2Task* task);
+
+	/// Pop a task from the bottom of the deque. Returns null if the deque is empty.
+	/// @warning must only be called by the owning thread.
+	b2Task* Pop();
+
+	/// Steal a task from the top of the deque. Returns null if the deque is empty or
+	/// if another thread took the task first.
+	/// This can be called by any thread.
+	b2Task* Steal();
+
+private:
+	b2WorkStealingDeque(const b2WorkStealingDeque&) = delete;
+	b2WorkStealingDeque& operator=(const b2WorkStealingDeque&) = delete;
+
+	// A circular buffer. Buffers are retired rather than freed when the deque grows,
+	// because a thief may still be reading from the old buffer.
+	struct Buffer
+	{
+		int64 capacity;
+		std::atomic<b2Task*>* tasks;
+		Buffer* retired;
+	};
+
+	static Buffer* CreateBuffer(int64 capacity, Buffer* retired);
+	Buffer* Grow(Buffer* buffer, int64 top, int64 bottom);
+
+	std::atomic<int64> m_top;
+	uint8 _padding[b2_cacheLineSize];
+	std::atomic<int64> m_bottom;
+	std::atomic<Buffer*> m_buffer;
+};
+
+#endif
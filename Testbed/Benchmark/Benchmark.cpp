@@ -0,0 +1,535 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Runs the Testbed tests without graphics and reports step time statistics per profile
+// phase for each thread count. Results can be saved as CSV and compared against a
+// previous run to find regressions.
+
+#include "Testbed/Framework/Test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Phase
+{
+	const char* name;
+	float32 b2Profile::*field;
+};
+
+static const Phase k_phases[] =
+{
+	{"step", &b2Profile::step},
+	{"broadphase", &b2Profile::broadphase},
+	{"broadphaseFindContacts", &b2Profile::broadphaseFindContacts},
+	{"broadphaseSyncFixtures", &b2Profile::broadphaseSyncFixtures},
+	{"collide", &b2Profile::collide},
+	{"solve", &b2Profile::solve},
+	{"solveTraversal", &b2Profile::solveTraversal},
+	{"solveInit", &b2Profile::solveInit},
+	{"solveVelocity", &b2Profile::solveVelocity},
+	{"solvePosition", &b2Profile::solvePosition},
+	{"solveTOI", &b2Profile::solveTOI},
+	{"solveTOIFindMinContact", &b2Profile::solveTOIFindMinContact},
+	{"locking", &b2Profile::locking}
+};
+
+static const int k_phaseCount = sizeof(k_phases) / sizeof(k_phases[0]);
+
+struct PhaseStats
+{
+	float32 mean;
+	float32 median;
+	float32 p99;
+};
+
+struct RunResult
+{
+	std::string testName;
+	int threadCount;
+	PhaseStats phases[k_phaseCount];
+};
+
+struct Options
+{
+	Options()
+	{
+		stepCount = 0;
+		iterations = 1;
+		tolerance = 10.0f;
+		minDelta = 0.02f;
+		outputPath = nullptr;
+		baselinePath = nullptr;
+	}
+
+	std::vector<int> testIndices;
+	std::vector<int> threadCounts;
+	int stepCount;
+	int iterations;
+	float32 tolerance;
+	float32 minDelta;
+	const char* outputPath;
+	const char* baselinePath;
+	Settings settings;
+};
+
+static void PrintUsage()
+{
+	printf(
+		"Usage: Benchmark [options]\n"
+		"  -t, --test NAME|INDEX   run a test (repeatable, default: all tests)\n"
+		"  -j, --threads LIST      comma separated thread counts (default: 1, 2, 4, ... up to the core count)\n"
+		"  -s, --steps N           steps per run (default: the test's MT step count)\n"
+		"  -i, --iterations N      runs per test and thread count (default: 1)\n"
+		"  -o, --output FILE       write the results as CSV\n"
+		"  -b, --baseline FILE     compare the results with a CSV written by --output\n"
+		"      --tolerance PCT     median increase that counts as a regression (default: 10)\n"
+		"      --min-delta MS      ignore regressions smaller than this (default: 0.02)\n"
+		"      --work-stealing     enable work stealing in the thread pool\n"
+		"      --parallel-islands  solve large islands in parallel\n"
+		"      --wide-contacts     use the wide contact solver\n"
+		"      --parallel-toi      solve TOI events in parallel\n"
+		"      --static-tree       use a separate broad-phase tree for static proxies\n"
+		"  -l, --list              list the tests\n"
+		"  -h, --help              show this message\n");
+}
+
+static int FindTest(const char* nameOrIndex)
+{
+	int testCount = 0;
+	while (g_testEntries[testCount].createFcn != nullptr)
+	{
+		if (strcmp(g_testEntries[testCount].name, nameOrIndex) == 0)
+		{
+			return testCount;
+		}
+		++testCount;
+	}
+
+	char* end;
+	long index = strtol(nameOrIndex, &end, 10);
+	if (*end == '\0' && end != nameOrIndex && index >= 0 && index < testCount)
+	{
+		return (int)index;
+	}
+
+	return -1;
+}
+
+static bool ParseThreadCounts(const char* list, std::vector<int>* threadCounts)
+{
+	threadCounts->clear();
+	const char* p = list;
+	while (*p)
+	{
+		char* end;
+		long count = strtol(p, &end, 10);
+		if (end == p || count < 1)
+		{
+			return false;
+		}
+		threadCounts->push_back((int)count);
+		p = *end == ',' ? end + 1 : end;
+		if (*end != ',' && *end != '\0')
+		{
+			return false;
+		}
+	}
+	return threadCounts->empty() == false;
+}
+
+// Returns false if the program should exit.
+static bool ParseOptions(int argc, char** argv, Options* options, int* exitCode)
+{
+	*exitCode = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		bool needsValue = true;
+
+		if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0)
+		{
+			PrintUsage();
+			return false;
+		}
+		else if (strcmp(arg, "-l") == 0 || strcmp(arg, "--list") == 0)
+		{
+			for (int j = 0; g_testEntries[j].createFcn != nullptr; ++j)
+			{
+				printf("%3d  %s\n", j, g_testEntries[j].name);
+			}
+			return false;
+		}
+		else if (strcmp(arg, "--work-stealing") == 0)
+		{
+			options->settings.workStealing = true;
+			needsValue = false;
+		}
+		else if (strcmp(arg, "--parallel-islands") == 0)
+		{
+			options->settings.enableParallelIslands = true;
+			needsValue = false;
+		}
+		else if (strcmp(arg, "--wide-contacts") == 0)
+		{
+			options->settings.enableWideContactSolver = true;
+			needsValue = false;
+		}
+		else if (strcmp(arg, "--parallel-toi") == 0)
+		{
+			options->settings.enableParallelToi = true;
+			needsValue = false;
+		}
+		else if (strcmp(arg, "--static-tree") == 0)
+		{
+			options->settings.enableStaticTree = true;
+			needsValue = false;
+		}
+		else if (value == nullptr)
+		{
+			// Every remaining option takes a value.
+		}
+		else if (strcmp(arg, "-t") == 0 || strcmp(arg, "--test") == 0)
+		{
+			int testIndex = FindTest(value);
+			if (testIndex == -1)
+			{
+				fprintf(stderr, "Unknown test: %s\n", value);
+				*exitCode = 2;
+				return false;
+			}
+			options->testIndices.push_back(testIndex);
+		}
+		else if (strcmp(arg, "-j") == 0 || strcmp(arg, "--threads") == 0)
+		{
+			if (ParseThreadCounts(value, &options->threadCounts) == false)
+			{
+				fprintf(stderr, "Invalid thread counts: %s\n", value);
+				*exitCode = 2;
+				return false;
+			}
+		}
+		else if (strcmp(arg, "-s") == 0 || strcmp(arg, "--steps") == 0)
+		{
+			options->stepCount = atoi(value);
+		}
+		else if (strcmp(arg, "-i") == 0 || strcmp(arg, "--iterations") == 0)
+		{
+			options->iterations = b2Max(atoi(value), 1);
+		}
+		else if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0)
+		{
+			options->outputPath = value;
+		}
+		else if (strcmp(arg, "-b") == 0 || strcmp(arg, "--baseline") == 0)
+		{
+			options->baselinePath = value;
+		}
+		else if (strcmp(arg, "--tolerance") == 0)
+		{
+			options->tolerance = (float32)atof(value);
+		}
+		else if (strcmp(arg, "--min-delta") == 0)
+		{
+			options->minDelta = (float32)atof(value);
+		}
+		else
+		{
+			value = nullptr;
+		}
+
+		if (needsValue)
+		{
+			if (value == nullptr)
+			{
+				fprintf(stderr, "Unknown option or missing value: %s\n", arg);
+				PrintUsage();
+				*exitCode = 2;
+				return false;
+			}
+			++i;
+		}
+	}
+
+	if (options->testIndices.empty())
+	{
+		for (int i = 0; g_testEntries[i].createFcn != nullptr; ++i)
+		{
+			options->testIndices.push_back(i);
+		}
+	}
+
+	if (options->threadCounts.empty())
+	{
+		int coreCount = b2Max((int)std::thread::hardware_concurrency(), 1);
+		for (int count = 1; count < coreCount; count *= 2)
+		{
+			options->threadCounts.push_back(count);
+		}
+		options->threadCounts.push_back(coreCount);
+	}
+
+	return true;
+}
+
+// Sorts the samples.
+static PhaseStats ComputeStats(std::vector<float32>& samples)
+{
+	PhaseStats stats{};
+	if (samples.empty())
+	{
+		return stats;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	float64 sum = 0.0;
+	for (float32 sample : samples)
+	{
+		sum += sample;
+	}
+
+	size_t count = samples.size();
+	stats.mean = float32(sum / count);
+	stats.median = count % 2 ? samples[count / 2] : 0.5f * (samples[count / 2 - 1] + samples[count / 2]);
+
+	// Nearest rank.
+	size_t p99Rank = (size_t)ceil(0.99 * count);
+	stats.p99 = samples[b2Max(p99Rank, (size_t)1) - 1];
+
+	return stats;
+}
+
+static RunResult RunTest(const Options& options, int testIndex, int threadCount, TestResult* testResult)
+{
+	const TestEntry& entry = g_testEntries[testIndex];
+	int stepCount = options.stepCount > 0 ? options.stepCount : entry.mtStepCount;
+
+	Settings settings = options.settings;
+	settings.threadCount = threadCount;
+
+	std::vector<float32> samples[k_phaseCount];
+	for (int i = 0; i < k_phaseCount; ++i)
+	{
+		samples[i].reserve(options.iterations * stepCount);
+	}
+
+	for (int iteration = 0; iteration < options.iterations; ++iteration)
+	{
+		// For consistent profiling
+		srand(0);
+
+		Test* test = entry.createFcn();
+		test->SetVisible(false);
+
+		for (int step = 0; step < stepCount; ++step)
+		{
+			test->Step(&settings);
+
+			const b2Profile& profile = test->GetWorld()->GetProfile();
+			for (int i = 0; i < k_phaseCount; ++i)
+			{
+				samples[i].push_back(profile.*k_phases[i].field);
+			}
+		}
+
+		*testResult &= test->TestPassed();
+
+		delete test;
+	}
+
+	RunResult result;
+	result.testName = entry.name;
+	result.threadCount = threadCount;
+	for (int i = 0; i < k_phaseCount; ++i)
+	{
+		result.phases[i] = ComputeStats(samples[i]);
+	}
+	return result;
+}
+
+static void PrintResults(const std::vector<RunResult>& results, size_t begin, size_t end)
+{
+	printf("  %-24s %7s %10s %10s %10s\n", "phase (ms)", "threads", "mean", "median", "p99");
+	for (int i = 0; i < k_phaseCount; ++i)
+	{
+		for (size_t j = begin; j < end; ++j)
+		{
+			const PhaseStats& stats = results[j].phases[i];
+			printf("  %-24s %7d %10.3f %10.3f %10.3f\n", j == begin ? k_phases[i].name : "",
+				results[j].threadCount, stats.mean, stats.median, stats.p99);
+		}
+	}
+
+	// Speedup is relative to the first thread count.
+	const RunResult& first = results[begin];
+	float32 firstStep = first.phases[0].mean;
+	printf("  %-24s %7s %10s %10s %10s\n", "scaling", "threads", "step", "speedup", "efficiency");
+	for (size_t j = begin; j < end; ++j)
+	{
+		float32 step = results[j].phases[0].mean;
+		float32 speedup = step > 0.0f ? firstStep / step : 0.0f;
+		float32 efficiency = speedup * first.threadCount / results[j].threadCount;
+		printf("  %-24s %7d %10.3f %10.2f %9.0f%%\n", "", results[j].threadCount, step, speedup, 100.0f * efficiency);
+	}
+}
+
+static bool WriteResults(const char* path, const std::vector<RunResult>& results)
+{
+	FILE* csv = fopen(path, "w");
+	if (csv == nullptr)
+	{
+		return false;
+	}
+
+	fputs("test,threads,phase,mean,median,p99\n", csv);
+	for (const RunResult& result : results)
+	{
+		for (int i = 0; i < k_phaseCount; ++i)
+		{
+			const PhaseStats& stats = result.phases[i];
+			fprintf(csv, "%s,%d,%s,%.4f,%.4f,%.4f\n", result.testName.c_str(), result.threadCount,
+				k_phases[i].name, stats.mean, stats.median, stats.p99);
+		}
+	}
+
+	return fclose(csv) == 0;
+}
+
+// Returns the number of regressions, or -1 if the baseline can't be read.
+static int CompareResults(const Options& options, const std::vector<RunResult>& results)
+{
+	FILE* csv = fopen(options.baselinePath, "r");
+	if (csv == nullptr)
+	{
+		return -1;
+	}
+
+	int regressionCount = 0;
+	int comparedCount = 0;
+
+	char line[512];
+	while (fgets(line, sizeof(line), csv))
+	{
+		char testName[256];
+		char phaseName[64];
+		int threadCount;
+		PhaseStats base;
+		if (sscanf(line, "%255[^,],%d,%63[^,],%f,%f,%f", testName, &threadCount, phaseName,
+			&base.mean, &base.median, &base.p99) != 6)
+		{
+			// Header.
+			continue;
+		}
+
+		for (const RunResult& result : results)
+		{
+			if (result.threadCount != threadCount || result.testName != testName)
+			{
+				continue;
+			}
+
+			for (int i = 0; i < k_phaseCount; ++i)
+			{
+				if (strcmp(k_phases[i].name, phaseName) != 0)
+				{
+					continue;
+				}
+
+				++comparedCount;
+
+				// Medians are compared because they're less sensitive to outliers than means.
+				float32 median = result.phases[i].median;
+				float32 delta = median - base.median;
+				if (delta > options.minDelta && median > base.median * (1.0f + 0.01f * options.tolerance))
+				{
+					float32 percent = base.median > 0.0f ? 100.0f * delta / base.median : 100.0f;
+					printf("REGRESSION %s, %d threads, %s: median %.3f -> %.3f ms (+%.0f%%)\n",
+						testName, threadCount, phaseName, base.median, median, percent);
+					++regressionCount;
+				}
+			}
+		}
+	}
+
+	fclose(csv);
+
+	printf("Compared %d medians with %s: %d regressions\n", comparedCount, options.baselinePath, regressionCount);
+
+	return regressionCount;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	int exitCode;
+	if (ParseOptions(argc, argv, &options, &exitCode) == false)
+	{
+		return exitCode;
+	}
+
+	std::vector<RunResult> results;
+	int failCount = 0;
+
+	for (int testIndex : options.testIndices)
+	{
+		printf("%s\n", g_testEntries[testIndex].name);
+		fflush(stdout);
+
+		size_t begin = results.size();
+		TestResult testResult = TestResult::NONE;
+		for (int threadCount : options.threadCounts)
+		{
+			results.push_back(RunTest(options, testIndex, threadCount, &testResult));
+		}
+
+		if (testResult == TestResult::FAIL)
+		{
+			printf("  *** TEST FAILED ***\n");
+			++failCount;
+		}
+
+		PrintResults(results, begin, results.size());
+		fflush(stdout);
+	}
+
+	if (options.outputPath && WriteResults(options.outputPath, results) == false)
+	{
+		fprintf(stderr, "Couldn't write %s\n", options.outputPath);
+		return 2;
+	}
+
+	int regressionCount = 0;
+	if (options.baselinePath)
+	{
+		regressionCount = CompareResults(options, results);
+		if (regressionCount == -1)
+		{
+			fprintf(stderr, "Couldn't read %s\n", options.baselinePath);
+			return 2;
+		}
+	}
+
+	return failCount > 0 || regressionCount > 0 ? 1 : 0;
+}
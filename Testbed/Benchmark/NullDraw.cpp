@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2019 Justin Hoffman https://github.com/jhoffman0x/Box2D-MT
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Stands in for the OpenGL debug draw so the tests can be built without graphics.
+// Tests draw text while stepping even when they aren't visible, so every call is a no-op.
+
+#include "Testbed/Framework/DebugDraw.h"
+
+DebugDraw g_debugDraw;
+Camera g_camera;
+
+DebugDraw::DebugDraw()
+{
+	m_points = nullptr;
+	m_lines = nullptr;
+	m_triangles = nullptr;
+	m_active = false;
+}
+
+DebugDraw::~DebugDraw()
+{
+}
+
+void DebugDraw::Create()
+{
+}
+
+void DebugDraw::Destroy()
+{
+}
+
+void DebugDraw::SetActive(bool flag)
+{
+	m_active = flag;
+}
+
+void DebugDraw::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	B2_NOT_USED(vertices);
+	B2_NOT_USED(vertexCount);
+	B2_NOT_USED(color);
+}
+
+void DebugDraw::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	B2_NOT_USED(vertices);
+	B2_NOT_USED(vertexCount);
+	B2_NOT_USED(color);
+}
+
+void DebugDraw::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color)
+{
+	B2_NOT_USED(center);
+	B2_NOT_USED(radius);
+	B2_NOT_USED(color);
+}
+
+void DebugDraw::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color)
+{
+	B2_NOT_USED(center);
+	B2_NOT_USED(radius);
+	B2_NOT_USED(axis);
+	B2_NOT_USED(color);
+}
+
+void DebugDraw::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
+{
+	B2_NOT_USED(p1);
+	B2_NOT_USED(p2);
+	B2_NOT_USED(color);
+}
+
+void DebugDraw::DrawTransform(const b2Transform& xf)
+{
+	B2_NOT_USED(xf);
+}
+
+void DebugDraw::DrawPoint(const b2Vec2& p, float32 size, const b2Color& color)
+{
+	B2_NOT_USED(p);
+	B2_NOT_USED(size);
+	B2_NOT_USED(color);
+}
+
+void DebugDraw::DrawString(int x, int y, const char* string, ...)
+{
+	B2_NOT_USED(x);
+	B2_NOT_USED(y);
+	B2_NOT_USED(string);
+}
+
+void DebugDraw::DrawString(const b2Vec2& p, const char* string, ...)
+{
+	B2_NOT_USED(p);
+	B2_NOT_USED(string);
+}
+
+void DebugDraw::DrawAABB(b2AABB* aabb, const b2Color& color)
+{
+	B2_NOT_USED(aabb);
+	B2_NOT_USED(color);
+}
+
+void DebugDraw::Flush()
+{
+}
+
+void DebugDraw::Finish()
+{
+}
@@ -31,6 +31,7 @@
 
 #include "Testbed/glfw/glfw3.h"
 #include <stdio.h>
+#include <thread>
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -403,7 +404,9 @@ static void sInterface()
 		ImGui::Separator();
 
 		ImGui::Text("Thread Count");
-		ImGui::SliderInt("##Thread Count", &settings.threadCount, 1, b2_maxThreads);
+		int32 maxThreadCount = b2Max(8, (int32)std::thread::hardware_concurrency());
+		ImGui::SliderInt("##Thread Count", &settings.threadCount, 1, maxThreadCount);
+		ImGui::Checkbox("Work Stealing", &settings.workStealing);
 
 		ImGui::Separator();
 
@@ -414,6 +417,7 @@ static void sInterface()
 
 		ImGui::Text("Consistency Check Iters");
 		ImGui::SliderInt("##Consistency Check Iters", &settings.mtConsistencyIterations, 0, 16);
+		ImGui::Checkbox("Snapshot Checks", &settings.mtSnapshotCheck);
 
 		ImGui::Checkbox("Current Test Only", &settings.mtCurrentTestOnly);
 
@@ -433,6 +437,10 @@ static void sInterface()
 		ImGui::Checkbox("Warm Starting", &settings.enableWarmStarting);
 		ImGui::Checkbox("Time of Impact", &settings.enableContinuous);
 		ImGui::Checkbox("Sub-Stepping", &settings.enableSubStepping);
+		ImGui::Checkbox("Parallel Islands", &settings.enableParallelIslands);
+		ImGui::Checkbox("Wide Contact Solver", &settings.enableWideContactSolver);
+		ImGui::Checkbox("Parallel TOI", &settings.enableParallelToi);
+		ImGui::Checkbox("Static Tree", &settings.enableStaticTree);
 
 		ImGui::Separator();
 
@@ -41,7 +41,8 @@ Test::Test()
 	m_bomb = nullptr;
 	m_textLine = 30;
 	m_mouseJoint = nullptr;
-	memset(&m_pointCount, 0, sizeof(m_pointCount));
+	m_points.resize(m_threadPoolExec.GetThreadCount() * k_maxContactPoints);
+	m_pointCount.resize(m_threadPoolExec.GetThreadCount(), 0);
 
 	m_destructionListener.test = this;
 	m_world->SetDestructionListener(&m_destructionListener);
@@ -94,7 +95,7 @@ bool Test::PreSolveImmediate(b2Contact* contact, const b2Manifold* oldManifold,
 
 	for (int32 i = 0; i < manifold->pointCount && m_pointCount[threadId] < k_maxContactPoints; ++i)
 	{
-		ContactPoint* cp = m_points[threadId] + m_pointCount[threadId];
+		ContactPoint* cp = &m_points[threadId * k_maxContactPoints + m_pointCount[threadId]];
 		cp->fixtureA = fixtureA;
 		cp->fixtureB = fixtureB;
 		cp->position = worldManifold.points[i];
@@ -282,6 +283,7 @@ void Test::Step(Settings* settings)
 	{
 		m_threadPoolExec.GetThreadPool()->Restart(settings->threadCount);
 	}
+	m_threadPoolExec.GetThreadPool()->SetWorkStealing(settings->workStealing);
 
 	m_timeStep = settings->hz > 0.0f ? 1.0f / settings->hz : float32(0.0f);
 
@@ -312,8 +314,13 @@ void Test::Step(Settings* settings)
 	m_world->SetWarmStarting(settings->enableWarmStarting);
 	m_world->SetContinuousPhysics(settings->enableContinuous);
 	m_world->SetSubStepping(settings->enableSubStepping);
+	m_world->SetParallelIslandSolving(settings->enableParallelIslands);
+	m_world->SetWideContactSolving(settings->enableWideContactSolver);
+	m_world->SetParallelToiSolving(settings->enableParallelToi);
+	m_world->SetSeparateStaticTree(settings->enableStaticTree);
 
-	memset(&m_pointCount, 0, sizeof(m_pointCount));
+	m_points.resize(m_threadPoolExec.GetThreadCount() * k_maxContactPoints);
+	m_pointCount.assign(m_threadPoolExec.GetThreadCount(), 0);
 
 	if (m_timeStep > 0.0f)
 	{
@@ -353,6 +360,15 @@ void Test::Step(Settings* settings)
 		float32 quality = m_world->GetTreeQuality();
 		g_debugDraw.DrawString(5, m_textLine, "proxies/height/balance/quality = %d/%d/%d/%g", proxyCount, height, balance, quality);
 		m_textLine += DRAW_STRING_NEW_LINE;
+
+		if (m_world->GetSeparateStaticTree())
+		{
+			height = m_world->GetStaticTreeHeight();
+			balance = m_world->GetStaticTreeBalance();
+			quality = m_world->GetStaticTreeQuality();
+			g_debugDraw.DrawString(5, m_textLine, "static height/balance/quality = %d/%d/%g", height, balance, quality);
+			m_textLine += DRAW_STRING_NEW_LINE;
+		}
 	}
 
 	// Track maximum profile times
@@ -454,11 +470,11 @@ void Test::Step(Settings* settings)
 		const float32 k_impulseScale = 0.1f;
 		const float32 k_axisScale = 0.3f;
 
-		for (int32 i = 0; i < b2_maxThreads; ++i)
+		for (uint32 i = 0; i < m_pointCount.size(); ++i)
 		{
 			for (int32 j = 0; j < m_pointCount[i]; ++j)
 			{
-				ContactPoint* point = m_points[i] + j;
+				ContactPoint* point = &m_points[i * k_maxContactPoints + j];
 
 				if (point->state == b2_addState)
 				{
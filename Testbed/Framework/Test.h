@@ -32,6 +32,7 @@
 #include "Testbed/glfw/glfw3.h"
 
 #include <stdlib.h>
+#include <vector>
 
 class Test;
 struct Settings;
@@ -68,9 +69,11 @@ struct Settings
 		velocityIterations = 8;
 		positionIterations = 3;
 		threadCount = 1;
+		workStealing = false;
 		stepsPerProfileUpdate = 4;
 		mtProfileIterations = 4;
 		mtConsistencyIterations = 2;
+		mtSnapshotCheck = true;
 		mtCurrentTestOnly = false;
 		drawSubTrees = true;
 		drawShapes = true;
@@ -86,6 +89,10 @@ struct Settings
 		enableWarmStarting = true;
 		enableContinuous = true;
 		enableSubStepping = false;
+		enableParallelIslands = false;
+		enableWideContactSolver = false;
+		enableParallelToi = false;
+		enableStaticTree = false;
 		enableSleep = true;
 		pause = false;
 		singleStep = false;
@@ -95,9 +102,11 @@ struct Settings
 	int32 velocityIterations;
 	int32 positionIterations;
 	int32 threadCount;
+	bool workStealing;
 	int32 stepsPerProfileUpdate;
 	int32 mtProfileIterations;
 	int32 mtConsistencyIterations;
+	bool mtSnapshotCheck;
 	bool mtCurrentTestOnly;
 	bool drawSubTrees;
 	bool drawShapes;
@@ -113,6 +122,10 @@ struct Settings
 	bool enableWarmStarting;
 	bool enableContinuous;
 	bool enableSubStepping;
+	bool enableParallelIslands;
+	bool enableWideContactSolver;
+	bool enableParallelToi;
+	bool enableStaticTree;
 	bool enableSleep;
 	bool pause;
 	bool singleStep;
@@ -260,8 +273,9 @@ protected:
 
 	b2Body* m_groundBody;
 	b2AABB m_worldAABB;
-	ContactPoint m_points[b2_maxThreads][k_maxContactPoints];
-	int32 m_pointCount[b2_maxThreads];
+	// Each thread has room for k_maxContactPoints.
+	std::vector<ContactPoint> m_points;
+	std::vector<int32> m_pointCount;
 	DestructionListener m_destructionListener;
 	int32 m_textLine;
 	b2World* m_world;
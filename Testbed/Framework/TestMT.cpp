@@ -47,6 +47,96 @@ static TestResult ProfileTest(Settings* settings, int testIndex, b2Profile* prof
     return testResult;
 }
 
+static bool BodiesMatch(b2World* worldA, b2World* worldB)
+{
+    b2Body* bodyA = worldA->GetBodyList();
+    b2Body* bodyB = worldB->GetBodyList();
+    while (bodyA && bodyB)
+    {
+        if (bodyA->GetPosition() != bodyB->GetPosition() ||
+            bodyA->GetAngle() != bodyB->GetAngle() ||
+            bodyA->IsAwake() != bodyB->IsAwake())
+        {
+            return false;
+        }
+
+        bodyA = bodyA->GetNext();
+        bodyB = bodyB->GetNext();
+    }
+    return bodyA == nullptr && bodyB == nullptr;
+}
+
+#ifndef b2_dynamicTreeOfTrees
+// A contact listener that ignores every callback.
+class NullContactListener : public b2ContactListener
+{
+public:
+    bool BeginContactImmediate(b2Contact*, uint32) override { return false; }
+    bool EndContactImmediate(b2Contact*, uint32) override { return false; }
+    bool PreSolveImmediate(b2Contact*, const b2Manifold*, uint32) override { return false; }
+    bool PostSolveImmediate(b2Contact*, const b2ContactImpulse*, uint32) override { return false; }
+};
+
+// Save the world halfway through the test, restore the snapshot into a fresh world, and step
+// both worlds to the end. The restored world must match the uninterrupted one on every step.
+// Returns the first step that doesn't match, or -1.
+static int CheckSnapshot(Settings* settings, int testIndex, int testIteration)
+{
+    srand(testIteration);
+    Test* test = g_testEntries[testIndex].createFcn();
+    b2World* world = test->GetWorld();
+    b2ThreadPoolTaskExecutor* executor = test->GetExecutor();
+
+    int stepCount = g_testEntries[testIndex].mtStepCount;
+    int snapshotStep = stepCount / 2;
+    for (int i = 0; i < snapshotStep; ++i)
+    {
+        srand((testIteration + 1) * (i + 1));
+        test->Step(settings);
+    }
+
+    // The test's callbacks refer to its own bodies and aren't stored in the snapshot, so from here
+    // on both worlds are stepped with the default contact filter and a listener that ignores contacts.
+    b2ContactFilter filter;
+    NullContactListener listener;
+    world->SetContactFilter(&filter);
+    world->SetContactListener(&listener);
+
+    b2Snapshot snapshot;
+    world->SaveSnapshot(snapshot);
+
+    // Solver options aren't stored either.
+    b2World restored(b2Vec2_zero);
+    restored.SetParallelIslandSolving(settings->enableParallelIslands);
+    restored.SetWideContactSolving(settings->enableWideContactSolver);
+    restored.SetParallelToiSolving(settings->enableParallelToi);
+    restored.SetContactFilter(&filter);
+    restored.SetContactListener(&listener);
+
+    int inconsistentStep = -1;
+    if (restored.RestoreSnapshot(snapshot) == false || BodiesMatch(world, &restored) == false)
+    {
+        inconsistentStep = snapshotStep;
+    }
+
+    float32 timeStep = settings->hz > 0.0f ? 1.0f / settings->hz : float32(0.0f);
+    for (int i = snapshotStep; i < stepCount && inconsistentStep == -1; ++i)
+    {
+        world->Step(timeStep, settings->velocityIterations, settings->positionIterations, *executor);
+        restored.Step(timeStep, settings->velocityIterations, settings->positionIterations, *executor);
+
+        if (BodiesMatch(world, &restored) == false)
+        {
+            inconsistentStep = i;
+        }
+    }
+
+    delete test;
+
+    return inconsistentStep;
+}
+#endif
+
 static TestResult CheckInconsistent(Settings* settings, int testIndex, int* inconsistentStep)
 {
     *inconsistentStep = -1;
@@ -88,22 +178,7 @@ static TestResult CheckInconsistent(Settings* settings, int testIndex, int* inco
             srand(seed);
             testB->Step(settings);
 
-            b2Body* bodyA = worldA->GetBodyList();
-            b2Body* bodyB = worldB->GetBodyList();
-            while (bodyA)
-            {
-                if (bodyA->GetPosition() != bodyB->GetPosition() ||
-                    bodyA->GetAngle() != bodyB->GetAngle() ||
-                    bodyA->IsAwake() != bodyB->IsAwake())
-                {
-                    *inconsistentStep = i;
-                    break;
-                }
-
-                bodyA = bodyA->GetNext();
-                bodyB = bodyB->GetNext();
-            }
-            if (bodyB != nullptr)
+            if (BodiesMatch(worldA, worldB) == false)
             {
                 *inconsistentStep = i;
                 break;
@@ -121,6 +196,18 @@ static TestResult CheckInconsistent(Settings* settings, int testIndex, int* inco
             printf("  - *** FAILURE on step %d ***\n", *inconsistentStep);
             break;
         }
+
+#ifndef b2_dynamicTreeOfTrees
+        if (settings->mtSnapshotCheck)
+        {
+            *inconsistentStep = CheckSnapshot(settings, testIndex, testIteration);
+            if (*inconsistentStep != -1)
+            {
+                printf("  - *** SNAPSHOT FAILURE on step %d ***\n", *inconsistentStep);
+                break;
+            }
+        }
+#endif
     }
 
     if (*inconsistentStep == -1)
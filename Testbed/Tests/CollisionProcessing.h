@@ -133,11 +133,11 @@ public:
 
 		// Traverse the contact results. Destroy bodies that
 		// are touching heavier bodies.
-		for (int32 i = 0; i < b2_maxThreads; ++i)
+		for (uint32 i = 0; i < m_pointCount.size(); ++i)
 		{
 			for (int32 j = 0; j < m_pointCount[i]; ++j)
 			{
-				ContactPoint* point = m_points[i] + j;
+				ContactPoint* point = &m_points[i * k_maxContactPoints + j];
 
 				b2Body* body1 = point->fixtureA->GetBody();
 				b2Body* body2 = point->fixtureB->GetBody();
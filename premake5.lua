@@ -66,6 +66,23 @@ project 'HelloWorld'
 		links { 'pthread' }
 	filter {}
 
+project 'Benchmark'
+	kind 'ConsoleApp'
+	warnings 'Default'
+	includedirs { '.' }
+	files
+	{
+		'Testbed/Benchmark/*',
+		'Testbed/Framework/DebugDraw.h',
+		'Testbed/Framework/Test.h',
+		'Testbed/Framework/Test.cpp',
+		'Testbed/Tests/*'
+	}
+	links { 'Box2D' }
+	filter 'system:linux'
+		links { 'pthread' }
+	filter {}
+
 project 'Testbed'
 	kind 'ConsoleApp'
 	debugdir 'Testbed'